@@ -1213,6 +1213,24 @@ PRIVATE int ac_send_command_answer(hgobj gobj, gobj_event_t event, json_t *kw, h
     );
 }
 
+/***************************************************************************
+ *  Tx flow of the route (EV_TX_FULL, EV_TX_RESUME),
+ *  inform to the user to stop or resume sending inter-events.
+ ***************************************************************************/
+PRIVATE int ac_tx_flow(hgobj gobj, gobj_event_t event, json_t *kw, hgobj src)
+{
+    if(gobj_is_pure_child(gobj)) {
+        if(gobj_has_input_event(gobj_parent(gobj), event)) {
+            gobj_send_event(gobj_parent(gobj), event, kw, gobj); // use the same kw
+        } else {
+            JSON_DECREF(kw)
+        }
+    } else {
+        gobj_publish_event(gobj, event, kw); // use the same kw
+    }
+    return 0;
+}
+
 /***************************************************************************
  *
  ***************************************************************************/
@@ -1306,6 +1324,8 @@ PRIVATE int create_gclass(gclass_name_t gclass_name)
         {EV_IDENTITY_CARD_ACK,  ac_identity_card_ack,   0},
         {EV_ON_CLOSE,           ac_on_close,        ST_DISCONNECTED},
         {EV_TIMEOUT,            ac_timeout_wait_idAck,  0},
+        {EV_TX_FULL,            ac_tx_flow,             0},
+        {EV_TX_RESUME,          ac_tx_flow,             0},
         {0,0,0}
     };
     ev_action_t st_session[] = {
@@ -1316,6 +1336,8 @@ PRIVATE int create_gclass(gclass_name_t gclass_name)
         {EV_PLAY_YUNO,          ac_play_yuno,           0},
         {EV_PAUSE_YUNO,         ac_pause_yuno,          0},
         {EV_ON_CLOSE,           ac_on_close,            ST_DISCONNECTED},
+        {EV_TX_FULL,            ac_tx_flow,             0},
+        {EV_TX_RESUME,          ac_tx_flow,             0},
         {EV_DROP,               ac_drop,                0},
         {0,0,0}
     };
@@ -1338,6 +1360,8 @@ PRIVATE int create_gclass(gclass_name_t gclass_name)
         {EV_ON_OPEN,                EVF_OUTPUT_EVENT},
         {EV_ON_CLOSE,               EVF_OUTPUT_EVENT},
         {EV_ON_ID_NAK,              EVF_OUTPUT_EVENT},
+        {EV_TX_FULL,                EVF_OUTPUT_EVENT},
+        {EV_TX_RESUME,              EVF_OUTPUT_EVENT},
         {0, 0}
     };
 
@@ -398,8 +398,9 @@ PRIVATE int ac_send_message(hgobj gobj, gobj_event_t event, json_t *kw, hgobj sr
              gobj_short_name(gobj_bottom_gobj(gobj))
         );
     }
-    json_t *kw_tx = json_pack("{s:I}",
-        "gbuffer", (json_int_t)(size_t)gbuf_header
+    json_t *kw_tx = json_pack("{s:I, s:b}",
+        "gbuffer", (json_int_t)(size_t)gbuf_header,
+        "more", 1   // header and payload in the same write
     );
     gobj_send_event(gobj_bottom_gobj(gobj), EV_TX_DATA, kw_tx, gobj);
 
@@ -421,6 +422,24 @@ PRIVATE int ac_send_message(hgobj gobj, gobj_event_t event, json_t *kw, hgobj sr
     return 0;
 }
 
+/***************************************************************************
+ *  Tx flow of the transport (EV_TX_FULL, EV_TX_RESUME), inform above
+ *  to stop or resume producing messages.
+ ***************************************************************************/
+PRIVATE int ac_tx_flow(hgobj gobj, gobj_event_t event, json_t *kw, hgobj src)
+{
+    if (gobj_is_pure_child(gobj)) {
+        if(gobj_has_input_event(gobj_parent(gobj), event)) {
+            gobj_send_event(gobj_parent(gobj), event, kw, gobj); // use the same kw
+        } else {
+            JSON_DECREF(kw)
+        }
+    } else {
+        gobj_publish_event(gobj, event, kw); // use the same kw
+    }
+    return 0;
+}
+
 /***************************************************************************
  *
  ***************************************************************************/
@@ -505,7 +524,8 @@ PRIVATE int create_gclass(gclass_name_t gclass_name)
     ev_action_t st_connected[] = {
         {EV_RX_DATA,            ac_rx_data,         0},
         {EV_SEND_MESSAGE,       ac_send_message,    0},
-        {EV_TX_READY,           0,                  0},
+        {EV_TX_FULL,            ac_tx_flow,         0},
+        {EV_TX_RESUME,          ac_tx_flow,         0},
         {EV_DISCONNECTED,       ac_disconnected,    ST_DISCONNECTED},
         {EV_DROP,               ac_drop,            0},
         {0,0,0}
@@ -521,6 +541,8 @@ PRIVATE int create_gclass(gclass_name_t gclass_name)
         {EV_ON_MESSAGE,     EVF_OUTPUT_EVENT},
         {EV_ON_OPEN,        EVF_OUTPUT_EVENT},
         {EV_ON_CLOSE,       EVF_OUTPUT_EVENT},
+        {EV_TX_FULL,        EVF_OUTPUT_EVENT},
+        {EV_TX_RESUME,      EVF_OUTPUT_EVENT},
         {0, 0}
     };
 
@@ -0,0 +1,695 @@
+/****************************************************************************
+ *          c_linux_tcp_server.c
+ *
+ *          GClass Tcp Server: accept connections, pool of clisrv transports
+ *          Low level linux
+ *
+ *          The connections are accepted with a multishot accept (one sqe for all),
+ *          each one is given to a clisrv C_LINUX_TRANSPORT child (__clisrv__),
+ *          that publishes EV_CONNECTED, EV_RX_DATA and EV_DISCONNECTED to the subscriber.
+ *          The clisrv disconnected returns to a pool and it's reused by the next connection,
+ *          with its events and rx gbuffer: the subscriber must not destroy the clisrv gobjs,
+ *          and must take each EV_CONNECTED as a new connection.
+ *
+ *          Copyright (c) 2024 Niyamaka.
+ *          All Rights Reserved.
+ ****************************************************************************/
+#include <string.h>
+#include <errno.h>
+#include <kwid.h>
+#include "c_timer.h"
+#include "c_linux_yuno.h"
+#include "c_linux_transport.h"
+#include "yunetas_ev_loop.h"
+#include "yunetas_tls.h"
+#include "c_linux_tcp_server.h"
+
+/***************************************************************
+ *              Constants
+ ***************************************************************/
+#define POOL_INITIAL_SIZE       16
+#define RETRY_ACCEPT_TIMEOUT    1000    // msec to retry the accept after an error (EMFILE,...)
+
+/***************************************************************
+ *              Structures
+ ***************************************************************/
+
+/***************************************************************
+ *              Prototypes
+ ***************************************************************/
+PRIVATE int yev_server_callback(yev_event_t *event);
+PRIVATE void pause_accept(hgobj gobj, json_int_t timeout_ms);
+
+/***************************************************************
+ *              Data
+ ***************************************************************/
+/*---------------------------------------------*
+ *          Attributes
+ *---------------------------------------------*/
+PRIVATE const sdata_desc_t tattr_desc[] = {
+/*-ATTR-type--------name----------------flag------------default-----description---------- */
+SDATA (DTP_STRING,  "url",              SDF_RD,         "",         "Url to listen"),
+SDATA (DTP_INTEGER, "backlog",          SDF_RD,         "512",      "Value for listen() backlog argument"),
+SDATA (DTP_BOOLEAN, "shared",           SDF_RD,         "false",    "Share the port with other processes (SO_REUSEPORT)"),
+SDATA (DTP_INTEGER, "max_clients",      SDF_WR|SDF_PERSIST, "0",    "Maximum connected clients, the excess are closed. 0 unlimited"),
+SDATA (DTP_INTEGER, "max_accepts_per_second",SDF_WR|SDF_PERSIST, "0", "Maximum connections accepted per second, the accept is paused until the next second (the clients wait in the backlog). 0 unlimited"),
+SDATA (DTP_JSON,    "clisrv_kw",        SDF_RD,         "{}",       "Kw to create the clisrv C_LINUX_TRANSPORT gobjs"),
+SDATA (DTP_JSON,    "crypto",           SDF_RD,         "{}",       "Tls configuration of a secure url (yunetas_tls.h): certificate and key"),
+
+SDATA (DTP_INTEGER, "accepts",          SDF_VOLATIL|SDF_STATS, "0", "Connections accepted"),
+SDATA (DTP_INTEGER, "acceptsRejected",  SDF_VOLATIL|SDF_STATS, "0", "Connections accepted and closed: max_clients reached or no clisrv"),
+SDATA (DTP_INTEGER, "acceptPauses",     SDF_VOLATIL|SDF_STATS, "0", "Times the accept was paused by max_accepts_per_second"),
+SDATA (DTP_INTEGER, "acceptErrors",     SDF_VOLATIL|SDF_STATS, "0", "Accept errors"),
+SDATA (DTP_INTEGER, "clisrvs",          SDF_VOLATIL|SDF_STATS, "0", "Clisrv gobjs created (connected and in pool)"),
+SDATA (DTP_INTEGER, "clisrvsConnected", SDF_VOLATIL|SDF_STATS, "0", "Clisrv gobjs with a connection"),
+SDATA (DTP_INTEGER, "clisrvsFree",      SDF_VOLATIL|SDF_STATS, "0", "Clisrv gobjs in pool"),
+SDATA (DTP_INTEGER, "clisrvsReused",    SDF_VOLATIL|SDF_STATS, "0", "Connections given to a clisrv of the pool"),
+SDATA (DTP_STRING,  "sockname",         SDF_VOLATIL|SDF_STATS, "",  "Sockname"),
+SDATA (DTP_INTEGER, "subscriber",       0,              0,          "subscriber of the clisrv output-events. Default if null is parent."),
+
+SDATA_END()
+};
+
+/*---------------------------------------------*
+ *      GClass trace levels
+ *  HACK strict ascendant value!
+ *  required paired correlative strings
+ *  in s_user_trace_level
+ *---------------------------------------------*/
+enum {
+    TRACE_ACCEPT                = 0x0001,
+};
+PRIVATE const trace_level_t s_user_trace_level[16] = {
+{"accept",              "Trace connections accepted"},
+{0, 0},
+};
+
+/*---------------------------------------------*
+ *              Private data
+ *---------------------------------------------*/
+typedef struct _PRIVATE_DATA {
+    hgobj gobj_timer;
+    yev_event_t *yev_accept;
+    ytls_t *ytls;               // tls context of the clisrvs, with a secure url
+
+    /*
+     *  Pool of clisrv disconnected, fifo: the oldest has more chances
+     *  of having its events of the previous connection back.
+     */
+    hgobj *pool;
+    unsigned pool_max;
+    unsigned pool_head;
+    unsigned pool_len;
+    unsigned clisrvs;
+    unsigned clisrvs_connected;
+    unsigned clisrv_seq;
+
+    /*
+     *  Rate limit
+     */
+    BOOL paused;
+    uint64_t window_start;      // msec
+    json_int_t window_accepts;
+
+    json_int_t max_clients;
+    json_int_t max_accepts_per_second;
+} PRIVATE_DATA;
+
+PRIVATE hgclass __gclass__ = 0;
+
+
+
+
+
+                    /******************************
+                     *      Framework Methods
+                     ******************************/
+
+
+
+
+/***************************************************************************
+ *      Framework Method
+ ***************************************************************************/
+PRIVATE void mt_create(hgobj gobj)
+{
+    PRIVATE_DATA *priv = gobj_priv_data(gobj);
+
+    priv->gobj_timer = gobj_create_pure_child(gobj_name(gobj), C_TIMER, 0, gobj);
+
+    char schema[16];
+    if(parse_url(
+        gobj,
+        gobj_read_str_attr(gobj, "url"),
+        schema, sizeof(schema),
+        0, 0,
+        0, 0,
+        0, 0,
+        0, 0,
+        FALSE
+    ) == 0 && strlen(schema) > 0 && schema[strlen(schema)-1]=='s') {
+        priv->ytls = ytls_init(gobj, gobj_read_json_attr(gobj, "crypto"), TRUE);
+        // Without it (error already logged) the clisrvs drop the connections
+    }
+
+    SET_PRIV(max_clients,               gobj_read_integer_attr)
+    SET_PRIV(max_accepts_per_second,    gobj_read_integer_attr)
+}
+
+/***************************************************************************
+ *      Framework Method writing
+ ***************************************************************************/
+PRIVATE void mt_writing(hgobj gobj, const char *path)
+{
+    PRIVATE_DATA *priv = gobj_priv_data(gobj);
+
+    IF_EQ_SET_PRIV(max_clients,             gobj_read_integer_attr)
+    ELIF_EQ_SET_PRIV(max_accepts_per_second, gobj_read_integer_attr)
+    END_EQ_SET_PRIV()
+}
+
+/***************************************************************************
+ *      Framework Method
+ ***************************************************************************/
+PRIVATE int mt_start(hgobj gobj)
+{
+    PRIVATE_DATA *priv = gobj_priv_data(gobj);
+
+    gobj_start(priv->gobj_timer);
+
+    if(!priv->yev_accept) {
+        priv->yev_accept = yev_create_accept_event(
+            yuno_event_loop(),
+            yev_server_callback,
+            gobj
+        );
+        if(!priv->yev_accept) {
+            // Error already logged
+            return -1;
+        }
+        if(yev_setup_accept_event(
+            priv->yev_accept,
+            gobj_read_str_attr(gobj, "url"),
+            (int)gobj_read_integer_attr(gobj, "backlog"),
+            gobj_read_bool_attr(gobj, "shared")
+        ) < 0) {
+            // Error already logged
+            EXEC_AND_RESET(yev_destroy_event, priv->yev_accept);
+            return -1;
+        }
+
+        char temp[60];
+        get_sockname(temp, sizeof(temp), priv->yev_accept->fd);
+        gobj_write_str_attr(gobj, "sockname", temp);
+    }
+
+    priv->paused = FALSE;
+    priv->window_start = time_in_miliseconds();
+    priv->window_accepts = 0;
+
+    if(!yev_event_in_ring(priv->yev_accept)) {
+        yev_start_event(priv->yev_accept);
+    }
+
+    gobj_change_state(gobj, ST_IDLE);
+
+    return 0;
+}
+
+/***************************************************************************
+ *      Framework Method
+ ***************************************************************************/
+PRIVATE int mt_stop(hgobj gobj)
+{
+    PRIVATE_DATA *priv = gobj_priv_data(gobj);
+
+    clear_timeout(priv->gobj_timer);
+    gobj_stop(priv->gobj_timer);
+    priv->paused = FALSE;
+
+    if(priv->yev_accept) {
+        yev_stop_event(priv->yev_accept);
+    }
+
+    /*
+     *  Drop the connections, the clisrv gobjs go to the pool
+     */
+    hgobj child = gobj_first_child(gobj);
+    while(child) {
+        hgobj next = gobj_next_child(child);
+        if(gobj_typeof_gclass(child, C_LINUX_TRANSPORT) &&
+                (gobj_read_bool_attr(child, "connected") ||
+                gobj_current_state(child) == ST_WAIT_CONNECTED)) { // in the tls handshake
+            gobj_send_event(child, EV_DROP, 0, gobj);
+        }
+        child = next;
+    }
+
+    gobj_change_state(gobj, ST_STOPPED);
+
+    return 0;
+}
+
+/***************************************************************************
+ *      Framework Method destroy
+ ***************************************************************************/
+PRIVATE void mt_destroy(hgobj gobj)
+{
+    PRIVATE_DATA *priv = gobj_priv_data(gobj);
+
+    EXEC_AND_RESET(yev_destroy_event, priv->yev_accept);
+    EXEC_AND_RESET(ytls_cleanup, priv->ytls);
+    GBMEM_FREE(priv->pool)
+    priv->pool_len = 0;
+}
+
+
+
+
+                    /***************************
+                     *      Local methods
+                     ***************************/
+
+
+
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PRIVATE void pool_stats(hgobj gobj)
+{
+    PRIVATE_DATA *priv = gobj_priv_data(gobj);
+
+    gobj_write_integer_attr(gobj, "clisrvs", (json_int_t)priv->clisrvs);
+    gobj_write_integer_attr(gobj, "clisrvsConnected", (json_int_t)priv->clisrvs_connected);
+    gobj_write_integer_attr(gobj, "clisrvsFree", (json_int_t)priv->pool_len);
+}
+
+/***************************************************************************
+ *  Put a clisrv disconnected at the tail of the pool
+ ***************************************************************************/
+PRIVATE int pool_push(hgobj gobj, hgobj clisrv)
+{
+    PRIVATE_DATA *priv = gobj_priv_data(gobj);
+
+    if(priv->pool_len >= priv->pool_max) {
+        unsigned new_max = priv->pool_max? priv->pool_max*2 : POOL_INITIAL_SIZE;
+        hgobj *pool = GBMEM_MALLOC(new_max * sizeof(hgobj));
+        if(!pool) {
+            gobj_log_critical(gobj, 0,
+                "function",     "%s", __FUNCTION__,
+                "msgset",       "%s", MSGSET_MEMORY_ERROR,
+                "msg",          "%s", "No memory to clisrv pool",
+                "size",         "%d", (int)new_max,
+                NULL
+            );
+            return -1;
+        }
+        for(unsigned i=0; i<priv->pool_len; i++) {
+            pool[i] = priv->pool[(priv->pool_head + i) % priv->pool_max];
+        }
+        GBMEM_FREE(priv->pool)
+        priv->pool = pool;
+        priv->pool_max = new_max;
+        priv->pool_head = 0;
+    }
+
+    priv->pool[(priv->pool_head + priv->pool_len) % priv->pool_max] = clisrv;
+    priv->pool_len++;
+    return 0;
+}
+
+/***************************************************************************
+ *  Get the oldest clisrv of the pool
+ ***************************************************************************/
+PRIVATE hgobj pool_pop(hgobj gobj)
+{
+    PRIVATE_DATA *priv = gobj_priv_data(gobj);
+
+    if(priv->pool_len == 0) {
+        return NULL;
+    }
+    hgobj clisrv = priv->pool[priv->pool_head];
+    priv->pool_head = (priv->pool_head + 1) % priv->pool_max;
+    priv->pool_len--;
+    return clisrv;
+}
+
+/***************************************************************************
+ *  Create a clisrv transport
+ ***************************************************************************/
+PRIVATE hgobj create_clisrv(hgobj gobj)
+{
+    PRIVATE_DATA *priv = gobj_priv_data(gobj);
+
+    json_t *kw_clisrv = json_deep_copy(gobj_read_json_attr(gobj, "clisrv_kw"));
+    if(!json_is_object(kw_clisrv)) {
+        JSON_DECREF(kw_clisrv)
+        kw_clisrv = json_object();
+    }
+    hgobj subscriber = (hgobj)(size_t)gobj_read_integer_attr(gobj, "subscriber");
+    if(!subscriber) {
+        subscriber = gobj_parent(gobj);
+    }
+    json_object_set_new(kw_clisrv, "url", json_string(gobj_read_str_attr(gobj, "url")));
+    json_object_set_new(kw_clisrv, "__clisrv__", json_true());
+    json_object_set_new(kw_clisrv, "subscriber", json_integer((json_int_t)(size_t)subscriber));
+    json_object_set_new(kw_clisrv, "ytls", json_integer((json_int_t)(size_t)priv->ytls));
+
+    char name[80];
+    snprintf(name, sizeof(name), "%s-%u", gobj_name(gobj), ++priv->clisrv_seq);
+    hgobj clisrv = gobj_create(name, C_LINUX_TRANSPORT, kw_clisrv, gobj);
+    if(!clisrv) {
+        // Error already logged
+        return NULL;
+    }
+
+    /*
+     *  The server is informed after the subscriber, the clisrv goes to the pool
+     */
+    gobj_subscribe_event(clisrv, EV_DISCONNECTED, 0, gobj);
+    gobj_start(clisrv);
+    priv->clisrvs++;
+
+    return clisrv;
+}
+
+/***************************************************************************
+ *  Give the socket to a clisrv of the pool or to a new one
+ ***************************************************************************/
+PRIVATE hgobj give_connection(hgobj gobj, int fd)
+{
+    PRIVATE_DATA *priv = gobj_priv_data(gobj);
+
+    for(unsigned n = priv->pool_len; n > 0; n--) {
+        hgobj clisrv = pool_pop(gobj);
+        if(accept_connection(clisrv, fd) == 0) {
+            INCR_ATTR_INTEGER(clisrvsReused)
+            return clisrv;
+        }
+        // Busy yet with the previous connection, to the tail
+        pool_push(gobj, clisrv);
+    }
+
+    hgobj clisrv = create_clisrv(gobj);
+    if(!clisrv) {
+        // Error already logged
+        return NULL;
+    }
+    if(accept_connection(clisrv, fd) < 0) {
+        gobj_log_error(gobj, 0,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_INTERNAL_ERROR,
+            "msg",          "%s", "new clisrv cannot accept",
+            "clisrv",       "%s", gobj_short_name(clisrv),
+            NULL
+        );
+        pool_push(gobj, clisrv);
+        return NULL;
+    }
+    return clisrv;
+}
+
+/***************************************************************************
+ *  Stop accepting until timeout, the clients wait in the backlog
+ ***************************************************************************/
+PRIVATE void pause_accept(hgobj gobj, json_int_t timeout_ms)
+{
+    PRIVATE_DATA *priv = gobj_priv_data(gobj);
+
+    priv->paused = TRUE;
+    if(yev_event_in_ring(priv->yev_accept)) {
+        yev_stop_event(priv->yev_accept);
+    }
+    set_timeout(priv->gobj_timer, MAX(timeout_ms, 1));
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PRIVATE int yev_server_callback(yev_event_t *yev_event)
+{
+    hgobj gobj = yev_event->gobj;
+    PRIVATE_DATA *priv = gobj_priv_data(gobj);
+
+    if(gobj_trace_level(gobj) & TRACE_UV) {
+        json_t *jn_flags = bits2jn_strlist(yev_flag_strings(), yev_event->flag);
+        gobj_log_info(gobj, 0,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_YEV_LOOP,
+            "msg",          "%s", "yev callback",
+            "msg2",         "%s", "💥 yev callback",
+            "event type",   "%s", yev_event_type_name(yev_event),
+            "result",       "%d", yev_event->result,
+            "sres",         "%s", (yev_event->result<0)? strerror(-yev_event->result):"",
+            "flag",         "%j", jn_flags,
+            "p",            "%p", yev_event,
+            NULL
+        );
+        json_decref(jn_flags);
+    }
+
+    switch(yev_event->type) {
+        case YEV_ACCEPT_TYPE:
+            {
+                if(yev_event->result < 0) {
+                    if(yev_event->result == -ECANCELED || !gobj_is_running(gobj)) {
+                        // Paused or stopped
+                        break;
+                    }
+                    INCR_ATTR_INTEGER(acceptErrors)
+                    gobj_log_error(gobj, 0,
+                        "function",     "%s", __FUNCTION__,
+                        "msgset",       "%s", MSGSET_LIBUV_ERROR,
+                        "msg",          "%s", "accept FAILED",
+                        "url",          "%s", gobj_read_str_attr(gobj, "url"),
+                        "errno",        "%d", -yev_event->result,
+                        "strerror",     "%s", strerror(-yev_event->result),
+                        NULL
+                    );
+                    if(!yev_event_in_ring(yev_event) && !priv->paused) {
+                        // Retry later, the cause (EMFILE, ENFILE, ENOMEM) can last
+                        pause_accept(gobj, RETRY_ACCEPT_TIMEOUT);
+                    }
+                    break;
+                }
+
+                int fd = yev_event->result;
+                INCR_ATTR_INTEGER(accepts)
+
+                if(gobj_trace_level(gobj) & TRACE_ACCEPT) {
+                    char peername[60];
+                    get_peername(peername, sizeof(peername), fd);
+                    gobj_log_info(gobj, 0,
+                        "function",     "%s", __FUNCTION__,
+                        "msgset",       "%s", MSGSET_CONNECT_DISCONNECT,
+                        "msg",          "%s", "Connection accepted",
+                        "url",          "%s", gobj_read_str_attr(gobj, "url"),
+                        "remote-addr",  "%s", peername,
+                        "fd",           "%d", fd,
+                        NULL
+                    );
+                }
+
+                if(!gobj_is_running(gobj) ||
+                        (priv->max_clients > 0 &&
+                            (json_int_t)priv->clisrvs_connected >= priv->max_clients) ||
+                        !give_connection(gobj, fd)) {
+                    INCR_ATTR_INTEGER(acceptsRejected)
+                    yev_close_fd(yuno_event_loop(), fd);
+                } else {
+                    priv->clisrvs_connected++;
+                }
+                pool_stats(gobj);
+
+                /*
+                 *  Rate limit, by windows of one second
+                 */
+                if(priv->max_accepts_per_second > 0 && !priv->paused && gobj_is_running(gobj)) {
+                    uint64_t now = time_in_miliseconds();
+                    if(now - priv->window_start >= 1000) {
+                        priv->window_start = now;
+                        priv->window_accepts = 0;
+                    }
+                    priv->window_accepts++;
+                    if(priv->window_accepts >= priv->max_accepts_per_second) {
+                        INCR_ATTR_INTEGER(acceptPauses)
+                        pause_accept(gobj, (json_int_t)(1000 - (now - priv->window_start)));
+                    }
+                }
+            }
+            break;
+
+        default:
+            gobj_log_error(gobj, LOG_OPT_TRACE_STACK,
+                "function",     "%s", __FUNCTION__,
+                "msgset",       "%s", MSGSET_SYSTEM_ERROR,
+                "msg",          "%s", "event type NOT IMPLEMENTED",
+                "url",          "%s", gobj_read_str_attr(gobj, "url"),
+                "event_type",   "%s", yev_event_type_name(yev_event),
+                "p",            "%p", yev_event,
+                NULL
+            );
+            break;
+    }
+
+    // The single shot accept is not re-armed while paused
+    return (gobj_is_running(gobj) && !priv->paused)?0:-1;
+}
+
+
+
+
+                    /***************************
+                     *      Actions
+                     ***************************/
+
+
+
+
+/***************************************************************************
+ *  End of pause, accept again
+ ***************************************************************************/
+PRIVATE int ac_timeout(hgobj gobj, gobj_event_t event, json_t *kw, hgobj src)
+{
+    PRIVATE_DATA *priv = gobj_priv_data(gobj);
+
+    if(priv->paused) {
+        if(yev_event_in_ring(priv->yev_accept)) {
+            // The cancel is not back yet
+            set_timeout(priv->gobj_timer, 10);
+        } else {
+            priv->paused = FALSE;
+            priv->window_start = time_in_miliseconds();
+            priv->window_accepts = 0;
+            yev_start_event(priv->yev_accept);
+        }
+    }
+
+    JSON_DECREF(kw)
+    return 0;
+}
+
+/***************************************************************************
+ *  A clisrv has been disconnected, to the pool
+ ***************************************************************************/
+PRIVATE int ac_clisrv_disconnected(hgobj gobj, gobj_event_t event, json_t *kw, hgobj src)
+{
+    PRIVATE_DATA *priv = gobj_priv_data(gobj);
+
+    if(priv->clisrvs_connected > 0) {
+        priv->clisrvs_connected--;
+    }
+    pool_push(gobj, src);
+    pool_stats(gobj);
+
+    JSON_DECREF(kw)
+    return 0;
+}
+
+
+
+
+                    /***************************
+                     *          FSM
+                     ***************************/
+
+
+
+
+/*---------------------------------------------*
+ *          Global methods table
+ *---------------------------------------------*/
+PRIVATE const GMETHODS gmt = {
+    .mt_create = mt_create,
+    .mt_writing = mt_writing,
+    .mt_destroy = mt_destroy,
+    .mt_start = mt_start,
+    .mt_stop = mt_stop,
+};
+
+/*------------------------*
+ *      GClass name
+ *------------------------*/
+GOBJ_DEFINE_GCLASS(C_LINUX_TCP_SERVER);
+
+/*------------------------*
+ *      States
+ *------------------------*/
+
+/*------------------------*
+ *      Events
+ *------------------------*/
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PRIVATE int create_gclass(gclass_name_t gclass_name)
+{
+    if(__gclass__) {
+        gobj_log_error(0, 0,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_INTERNAL_ERROR,
+            "msg",          "%s", "GClass ALREADY created",
+            "gclass",       "%s", gclass_name,
+            NULL
+        );
+        return -1;
+    }
+
+    /*----------------------------------------*
+     *          Define States
+     *----------------------------------------*/
+    ev_action_t st_stopped[] = {
+        {EV_DISCONNECTED,       ac_clisrv_disconnected,     0},
+        {0,0,0}
+    };
+    ev_action_t st_idle[] = {
+        {EV_DISCONNECTED,       ac_clisrv_disconnected,     0},
+        {EV_TIMEOUT,            ac_timeout,                 0},
+        {0,0,0}
+    };
+
+    states_t states[] = {
+        {ST_STOPPED,            st_stopped},
+        {ST_IDLE,               st_idle},
+        {0, 0}
+    };
+
+    event_type_t event_types[] = {
+        {EV_DISCONNECTED,   0},
+        {EV_TIMEOUT,        0},
+        {0, 0}
+    };
+
+    /*----------------------------------------*
+     *          Create the gclass
+     *----------------------------------------*/
+    __gclass__ = gclass_create(
+        gclass_name,
+        event_types,
+        states,
+        &gmt,
+        0,  // lmt,
+        tattr_desc,
+        sizeof(PRIVATE_DATA),
+        0,  // authz_table,
+        0,  // command_table,
+        s_user_trace_level,
+        0   // gclass_flag
+    );
+    if(!__gclass__) {
+        // Error already logged
+        return -1;
+    }
+
+    return 0;
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PUBLIC int register_c_linux_tcp_server(void)
+{
+    return create_gclass(C_LINUX_TCP_SERVER);
+}
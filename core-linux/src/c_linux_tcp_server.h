@@ -0,0 +1,42 @@
+/****************************************************************************
+ *          c_linux_tcp_server.h
+ *
+ *          GClass Tcp Server: accept connections, pool of clisrv transports
+ *          Low level linux
+ *
+ *          Copyright (c) 2024 Niyamaka.
+ *          All Rights Reserved.
+ ****************************************************************************/
+#pragma once
+
+#include <gobj.h>
+#include <kwid.h>
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+/***************************************************************
+ *              FSM
+ ***************************************************************/
+/*------------------------*
+ *      GClass name
+ *------------------------*/
+GOBJ_DECLARE_GCLASS(C_LINUX_TCP_SERVER);
+
+/*------------------------*
+ *      States
+ *------------------------*/
+
+/*------------------------*
+ *      Events
+ *------------------------*/
+
+/***************************************************************
+ *              Prototypes
+ ***************************************************************/
+PUBLIC int register_c_linux_tcp_server(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -8,16 +8,43 @@
  *          All Rights Reserved.
  ****************************************************************************/
 #include <string.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
 #include <parse_url.h>
 #include <kwid.h>
 #include "c_timer.h"
 #include "c_linux_yuno.h"
 #include "yunetas_ev_loop.h"
+#include "yunetas_tls.h"
 #include "c_linux_transport.h"
 
 /***************************************************************
  *              Constants
  ***************************************************************/
+#define TX_QUEUE_INITIAL_SIZE   16
+
+/***************************************************************
+ *              Structures
+ ***************************************************************/
+typedef struct tx_item_s {
+    gbuffer_t *gbuf;        // NULL in a file item (EV_TX_FILE)
+    size_t bytes;           // bytes pending to write
+    BOOL want_tx_ready;
+    BOOL more;              // the message continues in the next gbuffer
+    BOOL started;           // partially written, cannot be dropped
+
+    /*
+     *  File item: sent with splice, its bytes don't count in the tx queue bytes
+     */
+    int file_fd;
+    BOOL file_owned;        // opened by the transport from file_path
+    uint64_t file_offset;   // next offset to send
+    uint64_t file_length;   // total bytes asked
+    char *file_path;
+} tx_item_t;
 
 /***************************************************************
  *              Prototypes
@@ -25,6 +52,26 @@
 PRIVATE void set_connected(hgobj gobj, int fd);
 PRIVATE void set_disconnected(hgobj gobj, const char *cause);
 PRIVATE int yev_transport_callback(yev_event_t *event);
+PRIVATE int tx_enqueue(hgobj gobj, gbuffer_t *gbuf, BOOL want_tx_ready, BOOL more);
+PRIVATE int tx_enqueue_file(
+    hgobj gobj,
+    int fd,
+    BOOL owned,
+    const char *path,
+    uint64_t offset,
+    uint64_t length
+);
+PRIVATE void tx_flush(hgobj gobj);
+PRIVATE void tx_flush_file(hgobj gobj);
+PRIVATE void tx_consume(hgobj gobj, size_t written);
+PRIVATE void tx_queue_clear(hgobj gobj);
+PRIVATE size_t tx_drop_oldest(hgobj gobj);
+PRIVATE int tx_check_limits(hgobj gobj);
+PRIVATE void tx_check_watermarks(hgobj gobj);
+PRIVATE void tx_publish_flow(hgobj gobj, gobj_event_t event);
+PRIVATE void start_tls_handshake(hgobj gobj, int fd);
+PRIVATE void tls_handshake(hgobj gobj);
+PRIVATE void tx_flush_tls(hgobj gobj);
 
 /***************************************************************
  *              Data
@@ -44,18 +91,44 @@ SDATA (DTP_BOOLEAN, "use_ssl",          SDF_RD,         "false",    "True if sch
 SDATA (DTP_STRING,  "cert_pem",         SDF_RD,         "",         "SSL server certification, PEM str format"),
 SDATA (DTP_STRING,  "jwt",              SDF_RD,         "",         "TODO. Access with token JWT"),
 SDATA (DTP_BOOLEAN, "skip_cert_cn",     SDF_RD,         "true",     "Skip verification of cert common name"),
+SDATA (DTP_JSON,    "crypto",           SDF_RD,         "{}",       "Tls configuration of the client (yunetas_tls.h), cert_pem is added as trusted"),
+SDATA (DTP_POINTER, "ytls",             0,              0,          "Tls context of the server, used by its clisrvs. Set internally"),
 SDATA (DTP_INTEGER, "keep_alive",       SDF_RD,         "10",       "Set keep-alive if > 0"),
 SDATA (DTP_BOOLEAN, "manual",           SDF_RD,         "false",    "Set true if you want connect manually"),
 
-SDATA (DTP_INTEGER, "rx_buffer_size",   SDF_WR|SDF_PERSIST, "4096", "Rx buffer size"),
-SDATA (DTP_INTEGER, "timeout_waiting_connected", SDF_WR|SDF_PERSIST, "60000", "Timeout waiting connected in miliseconds"),
+SDATA (DTP_INTEGER, "rx_buffer_size",   SDF_WR|SDF_PERSIST, "4096", "Rx buffer size, not used with rx_multishot"),
+SDATA (DTP_BOOLEAN, "rx_multishot",     SDF_RD,         "true",     "Use multishot recv with the buffers of the yuno's buffer ring if kernel supports it"),
+SDATA (DTP_INTEGER, "tx_zerocopy_threshold",SDF_WR|SDF_PERSIST, "0", "Send with zero copy (SEND_ZC) the gbuffers of this size or bigger, if kernel supports it. 0 disabled"),
+SDATA (DTP_INTEGER, "tx_high_water_bytes",SDF_WR|SDF_PERSIST, "1048576", "Publish EV_TX_FULL when the bytes in the tx queue reach this level. 0 disabled"),
+SDATA (DTP_INTEGER, "tx_low_water_bytes",SDF_WR|SDF_PERSIST, "262144", "Publish EV_TX_RESUME, after an EV_TX_FULL, when the bytes in the tx queue go down to this level"),
+SDATA (DTP_INTEGER, "tx_high_water_msgs",SDF_WR|SDF_PERSIST, "0",   "Publish EV_TX_FULL when the gbuffers in the tx queue reach this level. 0 disabled"),
+SDATA (DTP_INTEGER, "tx_low_water_msgs",SDF_WR|SDF_PERSIST, "0",    "Publish EV_TX_RESUME, after an EV_TX_FULL, when the gbuffers in the tx queue go down to this level"),
+SDATA (DTP_INTEGER, "tx_hard_limit_bytes",SDF_WR|SDF_PERSIST, "16777216", "Maximum bytes in the tx queue, apply tx_overflow_policy when exceeded. 0 unlimited"),
+SDATA (DTP_INTEGER, "tx_hard_limit_msgs",SDF_WR|SDF_PERSIST, "0",   "Maximum gbuffers in the tx queue, apply tx_overflow_policy when exceeded. 0 unlimited"),
+SDATA (DTP_STRING,  "tx_overflow_policy",SDF_WR|SDF_PERSIST, "disconnect", "Policy when a tx hard limit is exceeded: \"disconnect\" or \"drop_oldest\" (drop the oldest messages not in flight)"),
+SDATA (DTP_INTEGER, "timeout_waiting_connected", SDF_WR|SDF_PERSIST, "60000", "Timeout waiting connected in miliseconds, linked timeout of the connect. 0 kernel's tcp connect timeout"),
 SDATA (DTP_INTEGER, "timeout_between_connections", SDF_WR|SDF_PERSIST, "2000", "Idle timeout to wait between attempts of connection, in miliseconds"),
-SDATA (DTP_INTEGER, "timeout_inactivity", SDF_WR|SDF_PERSIST, "-1", "Inactivity timeout in miliseconds to close the connection. Reconnect when new data arrived. With -1 never close."),
+SDATA (DTP_INTEGER, "timeout_inactivity", SDF_WR|SDF_PERSIST, "-1", "Inactivity timeout in miliseconds to close the connection, linked timeout of the reads (rx_multishot is not used). Reconnect when new data arrived. With -1 never close."),
 
 SDATA (DTP_INTEGER, "txBytes",          SDF_VOLATIL|SDF_STATS, "0", "Messages transmitted"),
 SDATA (DTP_INTEGER, "rxBytes",          SDF_VOLATIL|SDF_STATS, "0", "Messages received"),
 SDATA (DTP_INTEGER, "txMsgs",           SDF_VOLATIL|SDF_STATS, "0", "Messages transmitted"),
+SDATA (DTP_INTEGER, "txWrites",         SDF_VOLATIL|SDF_STATS, "0", "Write operations (each one can write several messages)"),
+SDATA (DTP_INTEGER, "txShortWrites",    SDF_VOLATIL|SDF_STATS, "0", "Writes shorter than requested, resumed with the remainder"),
+SDATA (DTP_INTEGER, "txQueued",         SDF_VOLATIL|SDF_STATS, "0", "Messages in the tx queue"),
+SDATA (DTP_INTEGER, "txQueuedBytes",    SDF_VOLATIL|SDF_STATS, "0", "Bytes in the tx queue"),
+SDATA (DTP_BOOLEAN, "txFull",           SDF_VOLATIL|SDF_STATS, "false", "Tx queue over the high watermark, EV_TX_FULL published"),
+SDATA (DTP_INTEGER, "txFullCount",      SDF_VOLATIL|SDF_STATS, "0", "Times the tx queue has reached the high watermark"),
+SDATA (DTP_INTEGER, "txDroppedMsgs",    SDF_VOLATIL|SDF_STATS, "0", "Messages dropped by the tx hard limit"),
+SDATA (DTP_INTEGER, "txDroppedBytes",   SDF_VOLATIL|SDF_STATS, "0", "Bytes dropped by the tx hard limit"),
+SDATA (DTP_INTEGER, "txZcBytes",        SDF_VOLATIL|SDF_STATS, "0", "Bytes transmitted with zero copy"),
+SDATA (DTP_INTEGER, "txCopiedBytes",    SDF_VOLATIL|SDF_STATS, "0", "Bytes transmitted copying to the socket buffers"),
+SDATA (DTP_INTEGER, "txFiles",          SDF_VOLATIL|SDF_STATS, "0", "Files transmitted (EV_TX_FILE)"),
+SDATA (DTP_INTEGER, "txFileBytes",      SDF_VOLATIL|SDF_STATS, "0", "Bytes of files transmitted with splice, without copies to user space"),
 SDATA (DTP_INTEGER, "rxMsgs",           SDF_VOLATIL|SDF_STATS, "0", "Messages received"),
+SDATA (DTP_STRING,  "tlsCipher",        SDF_VOLATIL|SDF_STATS, "",  "Tls protocol and cipher of the connection"),
+SDATA (DTP_BOOLEAN, "ktlsTx",           SDF_VOLATIL|SDF_STATS, "false", "Tls records encrypted by the kernel"),
+SDATA (DTP_BOOLEAN, "ktlsRx",           SDF_VOLATIL|SDF_STATS, "false", "Tls records decrypted by the kernel"),
 SDATA (DTP_STRING,  "peername",         SDF_VOLATIL|SDF_STATS, "",  "Peername"),
 SDATA (DTP_STRING,  "sockname",         SDF_VOLATIL|SDF_STATS, "",  "Sockname"),
 SDATA (DTP_BOOLEAN, "__clisrv__",       SDF_STATS,      "false",    "Client of tcp server"),
@@ -86,15 +159,64 @@ PRIVATE const trace_level_t s_user_trace_level[16] = {
 typedef struct _PRIVATE_DATA {
     hgobj gobj_timer;
     yev_event_t *yev_client_connect;    // Used in not __clisrv__
+    int fd_clisrv;                      // Socket accepted, used in __clisrv__
     yev_event_t *yev_client_rx;
+    gbuffer_t *rx_gbuf;                 // Rx gbuffer kept for the next connection
+
+    /*
+     *  Tx queue: at most one write in flight,
+     *  the writev of the queued gbuffers or the zero copy send of the first one
+     */
+    yev_event_t *yev_client_tx;         // writev of the tx queue
+    yev_event_t *yev_client_tx_zc;      // zero copy send of the first gbuffer
+    yev_event_t *yev_client_tx_file;    // splice of the file in the head of the queue
+    tx_item_t *tx_queue;                // ring of gbuffers pending to transmit
+    unsigned tx_queue_max;
+    unsigned tx_queue_head;
+    unsigned tx_queue_len;
+    unsigned tx_in_flight;              // gbuffers of the queue in the write in flight
+    size_t tx_queued_bytes;
+    BOOL tx_full;                       // EV_TX_FULL published, waiting the low watermark
+    struct iovec *tx_iov;
+    unsigned tx_iov_max;
+    json_int_t tx_zerocopy_threshold;
+    json_int_t tx_high_water_bytes;
+    json_int_t tx_low_water_bytes;
+    json_int_t tx_high_water_msgs;
+    json_int_t tx_low_water_msgs;
+    json_int_t tx_hard_limit_bytes;
+    json_int_t tx_hard_limit_msgs;
+    const char *tx_overflow_policy;
+    BOOL tx_drop_oldest;
     int timeout_inactivity;
     char inform_disconnection;
     BOOL use_ssl;
+
+    /*
+     *  Tls: handshake in user space, then kernel tls or the records encrypted here
+     */
+    ytls_t *ytls;                       // own in client, of the server in clisrv
+    BOOL ytls_owned;
+    ytls_sskt_t *sskt;                  // tls session of the connection
+    BOOL tls_handshaking;
+    BOOL tls_established;
+    yev_event_t *yev_tls_poll;          // readiness of the socket while the handshake
+    gbuffer_t *tx_tls_gbuf;             // encrypted data of the write in flight, without ktls
+    size_t tx_tls_plain;                // plain bytes of the tx queue in tx_tls_gbuf
+    struct iovec tx_tls_iov;
     const char *url;
 } PRIVATE_DATA;
 
 PRIVATE hgclass __gclass__ = 0;
 
+/*
+ *  Handles of the per-packet counters, resolved once in the gclass registration
+ */
+PRIVATE int h_rxMsgs = -1;
+PRIVATE int h_rxBytes = -1;
+PRIVATE int h_txMsgs = -1;
+PRIVATE int h_txBytes = -1;
+
 
 
 
@@ -114,6 +236,7 @@ PRIVATE void mt_create(hgobj gobj)
     PRIVATE_DATA *priv = gobj_priv_data(gobj);
 
     priv->gobj_timer = gobj_create_pure_child(gobj_name(gobj), C_TIMER, 0, gobj);
+    priv->fd_clisrv = -1;
 
     char schema[16];
     char host[120];
@@ -146,17 +269,32 @@ PRIVATE void mt_create(hgobj gobj)
     gobj_write_str_attr(gobj, "port", port);
 
     if(gobj_read_bool_attr(gobj, "use_ssl")) {
-//        priv->transport = esp_transport_ssl_init();
-
-// TODO       const char *cert_pem = gobj_read_str_attr(gobj, "cert_pem");
-//        if(!empty_string(cert_pem)) {
-//            esp_transport_ssl_set_cert_data(priv->transport, cert_pem, (int)strlen(cert_pem));
-//        }
-//        if(gobj_read_bool_attr(gobj, "skip_cert_cn")) {
-//            esp_transport_ssl_skip_common_name_check(priv->transport);
-//        }
-    } else {
-//        priv->transport = esp_transport_tcp_init();
+        if(gobj_read_bool_attr(gobj, "__clisrv__")) {
+            // The context is of the server, with its certificates
+            priv->ytls = gobj_read_pointer_attr(gobj, "ytls");
+        } else {
+            json_t *jn_crypto = json_deep_copy(gobj_read_json_attr(gobj, "crypto"));
+            if(!json_is_object(jn_crypto)) {
+                JSON_DECREF(jn_crypto)
+                jn_crypto = json_object();
+            }
+            const char *cert_pem = gobj_read_str_attr(gobj, "cert_pem");
+            if(!empty_string(cert_pem)) {
+                json_object_set_new(jn_crypto, "ssl_trusted_pem", json_string(cert_pem));
+            }
+            priv->ytls = ytls_init(gobj, jn_crypto, FALSE);
+            priv->ytls_owned = TRUE;
+            JSON_DECREF(jn_crypto)
+        }
+        if(!priv->ytls) {
+            gobj_log_error(gobj, 0,
+                "function",     "%s", __FUNCTION__,
+                "msgset",       "%s", MSGSET_PARAMETER_ERROR,
+                "msg",          "%s", "Secure schema without tls context, the connections will fail",
+                "url",          "%s", gobj_read_str_attr(gobj, "url"),
+                NULL
+            );
+        }
     }
 
     if(!gobj_read_bool_attr(gobj, "__clisrv__")) {
@@ -178,6 +316,15 @@ PRIVATE void mt_create(hgobj gobj)
     }
 
     SET_PRIV(timeout_inactivity,    (int)gobj_read_integer_attr)
+    SET_PRIV(tx_zerocopy_threshold, gobj_read_integer_attr)
+    SET_PRIV(tx_high_water_bytes,   gobj_read_integer_attr)
+    SET_PRIV(tx_low_water_bytes,    gobj_read_integer_attr)
+    SET_PRIV(tx_high_water_msgs,    gobj_read_integer_attr)
+    SET_PRIV(tx_low_water_msgs,     gobj_read_integer_attr)
+    SET_PRIV(tx_hard_limit_bytes,   gobj_read_integer_attr)
+    SET_PRIV(tx_hard_limit_msgs,    gobj_read_integer_attr)
+    SET_PRIV(tx_overflow_policy,    gobj_read_str_attr)
+    priv->tx_drop_oldest = strcmp(priv->tx_overflow_policy, "drop_oldest")==0;
 }
 
 /***************************************************************************
@@ -188,6 +335,19 @@ PRIVATE void mt_writing(hgobj gobj, const char *path)
     PRIVATE_DATA *priv = gobj_priv_data(gobj);
 
     IF_EQ_SET_PRIV(timeout_inactivity,  (int) gobj_read_integer_attr)
+        if(priv->yev_client_rx) {
+            // Applied in the next read
+            yev_set_timeout(priv->yev_client_rx, (uint32_t)MAX(priv->timeout_inactivity, 0));
+        }
+    ELIF_EQ_SET_PRIV(tx_zerocopy_threshold, gobj_read_integer_attr)
+    ELIF_EQ_SET_PRIV(tx_high_water_bytes,   gobj_read_integer_attr)
+    ELIF_EQ_SET_PRIV(tx_low_water_bytes,    gobj_read_integer_attr)
+    ELIF_EQ_SET_PRIV(tx_high_water_msgs,    gobj_read_integer_attr)
+    ELIF_EQ_SET_PRIV(tx_low_water_msgs,     gobj_read_integer_attr)
+    ELIF_EQ_SET_PRIV(tx_hard_limit_bytes,   gobj_read_integer_attr)
+    ELIF_EQ_SET_PRIV(tx_hard_limit_msgs,    gobj_read_integer_attr)
+    ELIF_EQ_SET_PRIV(tx_overflow_policy,    gobj_read_str_attr)
+        priv->tx_drop_oldest = strcmp(priv->tx_overflow_policy, "drop_oldest")==0;
     ELIF_EQ_SET_PRIV(url,     gobj_read_str_attr)
         if (!empty_string(priv->url)) {
             char host[120];
@@ -279,6 +439,24 @@ PRIVATE int mt_stop(hgobj gobj)
         }
         yev_stop_event(priv->yev_client_connect);
     }
+    if(priv->yev_client_tx) {
+        if(yev_event_in_ring(priv->yev_client_tx)) {
+            change_to_wait_stopped = TRUE;
+        }
+        yev_stop_event(priv->yev_client_tx);
+    }
+    if(priv->yev_client_tx_file) {
+        if(yev_event_in_ring(priv->yev_client_tx_file)) {
+            change_to_wait_stopped = TRUE;
+        }
+        yev_stop_event(priv->yev_client_tx_file);
+    }
+    if(priv->yev_tls_poll) {
+        if(yev_event_in_ring(priv->yev_tls_poll)) {
+            change_to_wait_stopped = TRUE;
+        }
+        yev_stop_event(priv->yev_tls_poll);
+    }
 
     if(change_to_wait_stopped) {
         gobj_change_state(gobj, ST_WAIT_STOPPED);
@@ -298,6 +476,24 @@ PRIVATE void mt_destroy(hgobj gobj)
 
     EXEC_AND_RESET(yev_destroy_event, priv->yev_client_connect);
     EXEC_AND_RESET(yev_destroy_event, priv->yev_client_rx);
+    EXEC_AND_RESET(yev_destroy_event, priv->yev_client_tx);
+    EXEC_AND_RESET(yev_destroy_event, priv->yev_client_tx_zc);
+    EXEC_AND_RESET(yev_destroy_event, priv->yev_client_tx_file);
+    EXEC_AND_RESET(yev_destroy_event, priv->yev_tls_poll);
+    EXEC_AND_RESET(ytls_free_secure_socket, priv->sskt);
+    if(priv->ytls_owned) {
+        EXEC_AND_RESET(ytls_cleanup, priv->ytls);
+    }
+    GBUFFER_DECREF(priv->tx_tls_gbuf)
+    GBUFFER_DECREF(priv->rx_gbuf)
+    if(priv->fd_clisrv >= 0) {
+        yev_close_fd(yuno_event_loop(), priv->fd_clisrv);
+        priv->fd_clisrv = -1;
+    }
+    priv->tx_in_flight = 0;
+    tx_queue_clear(gobj);
+    GBMEM_FREE(priv->tx_queue)
+    GBMEM_FREE(priv->tx_iov)
 }
 
 
@@ -333,6 +529,14 @@ PRIVATE void set_connected(hgobj gobj, int fd)
 {
     PRIVATE_DATA *priv = gobj_priv_data(gobj);
 
+    if(priv->use_ssl && !priv->tls_established) {
+        /*
+         *  Connected when the tls handshake is done
+         */
+        start_tls_handshake(gobj, fd);
+        return;
+    }
+
     gobj_write_bool_attr(gobj, "connected", TRUE);
     get_peer_and_sock_name(gobj, fd);
 
@@ -361,28 +565,81 @@ PRIVATE void set_connected(hgobj gobj, int fd)
      *  Ready to receive
      */
     if(!priv->yev_client_rx) {
-        json_int_t rx_buffer_size = gobj_read_integer_attr(gobj, "rx_buffer_size");
-        priv->yev_client_rx = yev_create_read_event(
-            yuno_event_loop(),
-            yev_transport_callback,
-            gobj,
-            fd,
-            gbuffer_create(rx_buffer_size, rx_buffer_size)
-        );
+        if(gobj_read_bool_attr(gobj, "rx_multishot") &&
+                priv->timeout_inactivity <= 0 &&
+                yev_recv_multishot_available(yuno_event_loop())) {
+            /*
+             *  Without own buffer, the memory is taken from the loop's buffer ring with traffic
+             */
+            priv->yev_client_rx = yev_create_recv_multishot_event(
+                yuno_event_loop(),
+                yev_transport_callback,
+                gobj,
+                fd
+            );
+        } else {
+            json_int_t rx_buffer_size = gobj_read_integer_attr(gobj, "rx_buffer_size");
+            priv->yev_client_rx = yev_create_read_event(
+                yuno_event_loop(),
+                yev_transport_callback,
+                gobj,
+                fd,
+                yev_gbuffer_create(yuno_event_loop(), (size_t)rx_buffer_size, (size_t)rx_buffer_size)
+            );
+            if(priv->yev_client_rx && priv->timeout_inactivity > 0) {
+                // Close the connection if nothing is read in timeout_inactivity
+                yev_set_timeout(priv->yev_client_rx, (uint32_t)priv->timeout_inactivity);
+            }
+        }
     }
 
-    if(priv->yev_client_rx) {
-        yev_set_fd(priv->yev_client_rx, fd);
+    if(!priv->yev_client_rx) {
+        gobj_log_error(gobj, 0,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_INTERNAL_ERROR,
+            "msg",          "%s", "Cannot create the rx event",
+            "fd",           "%d", fd,
+            NULL
+        );
+        set_disconnected(gobj, "no rx event");
+        return;
     }
-    if(!priv->yev_client_rx->gbuf) {
-        json_int_t rx_buffer_size = gobj_read_integer_attr(gobj, "rx_buffer_size");
-        yev_set_gbuffer(priv->yev_client_rx, gbuffer_create(rx_buffer_size, rx_buffer_size));
-    } else {
-        gbuffer_clear(priv->yev_client_rx->gbuf);
+
+    yev_set_fd(priv->yev_client_rx, fd);
+    if(priv->yev_client_rx->type == YEV_READ_TYPE) {
+        if(!priv->yev_client_rx->gbuf) {
+            if(priv->rx_gbuf) {
+                // The gbuffer of the previous connection
+                gbuffer_clear(priv->rx_gbuf);
+                yev_set_gbuffer(priv->yev_client_rx, priv->rx_gbuf);
+                priv->rx_gbuf = NULL;
+            } else {
+                json_int_t rx_buffer_size = gobj_read_integer_attr(gobj, "rx_buffer_size");
+                yev_set_gbuffer(
+                    priv->yev_client_rx,
+                    yev_gbuffer_create(yuno_event_loop(), (size_t)rx_buffer_size, (size_t)rx_buffer_size)
+                );
+            }
+        } else {
+            gbuffer_clear(priv->yev_client_rx->gbuf);
+        }
     }
 
     yev_start_event(priv->yev_client_rx);
 
+    /*
+     *  Ready to transmit
+     */
+    if(!priv->yev_client_tx) {
+        priv->yev_client_tx = yev_create_writev_event(
+            yuno_event_loop(),
+            yev_transport_callback,
+            gobj,
+            fd
+        );
+    }
+    yev_set_fd(priv->yev_client_tx, fd);
+
     priv->inform_disconnection = TRUE;
 
     /*
@@ -410,7 +667,8 @@ PRIVATE void set_disconnected(hgobj gobj, const char *cause)
     gobj_write_bool_attr(gobj, "connected", FALSE);
 
     if(gobj_current_state(gobj)==ST_DISCONNECTED) {
-        if(gobj_is_running(gobj)) {
+        if(gobj_is_running(gobj) && !gobj_read_bool_attr(gobj, "__clisrv__")) {
+            clear_timeout(priv->gobj_timer);    // armed yet if several operations fail
             set_timeout(
                 priv->gobj_timer,
                 gobj_read_integer_attr(gobj, "timeout_between_connections")
@@ -436,7 +694,27 @@ PRIVATE void set_disconnected(hgobj gobj, const char *cause)
         gobj_change_state(gobj, ST_DISCONNECTED);
     }
 
-    if(priv->yev_client_connect->fd > 0) {
+    if(priv->yev_client_rx && priv->yev_client_rx->type == YEV_READ_TYPE &&
+            priv->yev_client_rx->gbuf && !priv->rx_gbuf) {
+        /*
+         *  Keep the rx gbuffer for the next connection (the stop releases it),
+         *  it's used again when the read is back.
+         */
+        priv->rx_gbuf = priv->yev_client_rx->gbuf;
+        GBUFFER_INCREF(priv->rx_gbuf)
+    }
+
+    /*
+     *  All the operations of the socket (read, writes, poll) cancelled with one sqe,
+     *  before closing it. The gbuffers of the write in flight are released when the write returns.
+     */
+    int fd = priv->fd_clisrv >= 0? priv->fd_clisrv :
+        (priv->yev_client_connect? priv->yev_client_connect->fd : -1);
+    if(fd > 0) {
+        yev_cancel_fd(yuno_event_loop(), fd, NULL, gobj);
+    }
+
+    if(priv->yev_client_connect && priv->yev_client_connect->fd > 0) {
         if(gobj_trace_level(gobj) & TRACE_UV) {
             gobj_log_info(gobj, 0,
                 "function",     "%s", __FUNCTION__,
@@ -449,21 +727,56 @@ PRIVATE void set_disconnected(hgobj gobj, const char *cause)
             );
         }
 
-        close(priv->yev_client_connect->fd);
+        yev_close_fd(yuno_event_loop(), priv->yev_client_connect->fd);
         priv->yev_client_connect->fd = -1;
     }
+    if(priv->fd_clisrv >= 0) {
+        yev_close_fd(yuno_event_loop(), priv->fd_clisrv);
+        priv->fd_clisrv = -1;
+    }
 
-    yev_set_flag(priv->yev_client_connect, YEV_FLAG_CONNECTED, FALSE);
+    if(priv->yev_client_connect) {
+        yev_set_flag(priv->yev_client_connect, YEV_FLAG_CONNECTED, FALSE);
+    }
 
+    /*
+     *  The operations of the socket are cancelled by yev_cancel_fd()
+     *  (one by one by the loop if the cancel by fd fails), their callbacks are coming.
+     */
     if(priv->yev_client_rx) {
         yev_set_fd(priv->yev_client_rx, -1);
-        yev_stop_event(priv->yev_client_rx);
+    }
+    if(priv->yev_client_tx) {
+        yev_set_fd(priv->yev_client_tx, -1);
+    }
+    if(priv->yev_client_tx_file) {
+        yev_set_fd(priv->yev_client_tx_file, -1);
+    }
+    if(priv->yev_tls_poll) {
+        yev_set_fd(priv->yev_tls_poll, -1);
+    }
+    EXEC_AND_RESET(ytls_free_secure_socket, priv->sskt);
+    priv->tls_established = FALSE;
+    BOOL tls_handshaking = priv->tls_handshaking;
+    priv->tls_handshaking = FALSE;
+    tx_queue_clear(gobj);
+    if(priv->tx_full) {
+        /*
+         *  Every EV_TX_FULL has its EV_TX_RESUME: the queue is cleared,
+         *  resumed before EV_DISCONNECTED, the producers will know the connection is gone.
+         */
+        priv->tx_full = FALSE;
+        gobj_write_bool_attr(gobj, "txFull", FALSE);
+        if(priv->inform_disconnection) {
+            tx_publish_flow(gobj, EV_TX_RESUME);
+        }
     }
 
     if(priv->yev_client_connect) {
         yev_stop_event(priv->yev_client_connect);
     }
 
+    clear_timeout(priv->gobj_timer);    // of the tls handshake, if any
     if(gobj_read_bool_attr(gobj, "__clisrv__")) {
         // TODO to stop
     } else {
@@ -485,6 +798,12 @@ PRIVATE void set_disconnected(hgobj gobj, const char *cause)
         } else {
             gobj_publish_event(gobj, EV_DISCONNECTED, 0);
         }
+    } else if(tls_handshaking && gobj_read_bool_attr(gobj, "__clisrv__")) {
+        /*
+         *  Tls handshake failed: the subscriber doesn't know the connection,
+         *  the server takes back the clisrv.
+         */
+        gobj_send_event(gobj_parent(gobj), EV_DISCONNECTED, 0, gobj);
     }
 
     gobj_write_str_attr(gobj, "peername", "");
@@ -492,176 +811,975 @@ PRIVATE void set_disconnected(hgobj gobj, const char *cause)
 }
 
 /***************************************************************************
- *
+ *  Item `idx` of the tx queue, counting from the head
  ***************************************************************************/
-PRIVATE int yev_transport_callback(yev_event_t *yev_event)
+PRIVATE inline tx_item_t *tx_item(PRIVATE_DATA *priv, unsigned idx)
 {
-    hgobj gobj = yev_event->gobj;
-
-    if(gobj_trace_level(gobj) & TRACE_UV) {
-        json_t *jn_flags = bits2jn_strlist(yev_flag_strings(), yev_event->flag);
-        gobj_log_info(gobj, 0,
-            "function",     "%s", __FUNCTION__,
-            "msgset",       "%s", MSGSET_YEV_LOOP,
-            "msg",          "%s", "yev callback",
-            "msg2",         "%s", "💥 yev callback",
-            "event type",   "%s", yev_event_type_name(yev_event),
-            "result",       "%d", yev_event->result,
-            "sres",         "%s", (yev_event->result<0)? strerror(-yev_event->result):"",
-            "flag",         "%j", jn_flags,
-            "p",            "%p", yev_event,
-            NULL
-        );
-        json_decref(jn_flags);
-    }
-    switch(yev_event->type) {
-        case YEV_READ_TYPE:
-            {
-                if(yev_event->result < 0) {
-                    /*
-                     *  Disconnected
-                     */
-                    if(gobj_trace_level(gobj) & TRACE_UV) {
-                        if(yev_event->result != -ECANCELED) {
-                            gobj_log_info(gobj, 0,
-                                "function",     "%s", __FUNCTION__,
-                                "msgset",       "%s", MSGSET_CONNECT_DISCONNECT,
-                                "msg",          "%s", "read FAILED",
-                                "url",          "%s", gobj_read_str_attr(gobj, "url"),
-                                "remote-addr",  "%s", gobj_read_str_attr(gobj, "peername"),
-                                "local-addr",   "%s", gobj_read_str_attr(gobj, "sockname"),
-                                "errno",        "%d", -yev_event->result,
-                                "strerror",     "%s", strerror(-yev_event->result),
-                                "p",            "%p", yev_event,
-                                NULL
-                            );
-                        }
-                    }
-                    set_disconnected(gobj, strerror(-yev_event->result));
-
-                } else {
-                    if(gobj_trace_level(gobj) & TRACE_TRAFFIC) {
-                        gobj_trace_dump_gbuf(gobj, yev_event->gbuf, "%s: %s%s%s",
-                            gobj_short_name(gobj),
-                            gobj_read_str_attr(gobj, "sockname"),
-                            " <- ",
-                            gobj_read_str_attr(gobj, "peername")
-                        );
-                    }
-
-                    INCR_ATTR_INTEGER(rxMsgs)
-                    INCR_ATTR_INTEGER2(rxBytes, gbuffer_leftbytes(yev_event->gbuf))
+    return &priv->tx_queue[(priv->tx_queue_head + idx) % priv->tx_queue_max];
+}
 
-                    GBUFFER_INCREF(yev_event->gbuf)
-                    json_t *kw = json_pack("{s:I}",
-                        "gbuffer", (json_int_t)(size_t)yev_event->gbuf
-                    );
-                    if(gobj_is_pure_child(gobj)) {
-                        gobj_send_event(gobj_parent(gobj), EV_RX_DATA, kw, gobj);
-                    } else {
-                        gobj_publish_event(gobj, EV_RX_DATA, kw);
-                    }
+/***************************************************************************
+ *
+ ***************************************************************************/
+PRIVATE void tx_queue_stats(hgobj gobj)
+{
+    PRIVATE_DATA *priv = gobj_priv_data(gobj);
 
-                    /*
-                     *  Clear buffer
-                     *  Re-arm read
-                     */
-                    if(yev_event->gbuf) {
-                        gbuffer_clear(yev_event->gbuf);
-                        yev_start_event(yev_event);
-                    }
-                }
-            }
-            break;
+    gobj_write_integer_attr(gobj, "txQueued", (json_int_t)priv->tx_queue_len);
+    gobj_write_integer_attr(gobj, "txQueuedBytes", (json_int_t)priv->tx_queued_bytes);
+}
 
-        case YEV_WRITE_TYPE:
-            {
-                if(yev_event->result < 0) {
-                    /*
-                     *  Disconnected
-                     */
-                    if(gobj_trace_level(gobj) & TRACE_UV) {
-                        if(yev_event->result != -ECANCELED) {
-                            gobj_log_info(gobj, 0,
-                                "function",     "%s", __FUNCTION__,
-                                "msgset",       "%s", MSGSET_CONNECT_DISCONNECT,
-                                "msg",          "%s", "write FAILED",
-                                "url",          "%s", gobj_read_str_attr(gobj, "url"),
-                                "remote-addr",  "%s", gobj_read_str_attr(gobj, "peername"),
-                                "local-addr",   "%s", gobj_read_str_attr(gobj, "sockname"),
-                                "errno",        "%d", -yev_event->result,
-                                "strerror",     "%s", strerror(-yev_event->result),
-                                "p",            "%p", yev_event,
-                                NULL
-                            );
-                        }
-                    }
-                    set_disconnected(gobj, strerror(-yev_event->result));
+/***************************************************************************
+ *  Inform of the tx flow (EV_TX_FULL, EV_TX_RESUME) to the parent or subscribers.
+ *  EV_TX_READY is not used: it's the ready of a gbuffer (gbuffer_mark) or of a file.
+ ***************************************************************************/
+PRIVATE void tx_publish_flow(hgobj gobj, gobj_event_t event)
+{
+    PRIVATE_DATA *priv = gobj_priv_data(gobj);
 
-                } else {
-                    json_int_t mark = (json_int_t)gbuffer_getmark(yev_event->gbuf);
-                    if(yev_event->flag & YEV_FLAG_WANT_TX_READY) {
-                        json_t *kw_tx_ready = json_object();
-                        json_object_set_new(kw_tx_ready, "gbuffer_mark", json_integer(mark));
-                        if(gobj_is_pure_child(gobj)) {
-                            gobj_send_event(gobj_parent(gobj), EV_TX_READY, kw_tx_ready, gobj);
-                        } else {
-                            gobj_publish_event(gobj, EV_TX_READY, kw_tx_ready);
-                        }
-                    }
-                }
+    json_t *kw_flow = json_pack("{s:I, s:I}",
+        "txQueued", (json_int_t)priv->tx_queue_len,
+        "txQueuedBytes", (json_int_t)priv->tx_queued_bytes
+    );
+    if(gobj_is_pure_child(gobj)) {
+        if(gobj_has_input_event(gobj_parent(gobj), event)) {
+            gobj_send_event(gobj_parent(gobj), event, kw_flow, gobj);
+        } else {
+            JSON_DECREF(kw_flow)
+        }
+    } else {
+        gobj_publish_event(gobj, event, kw_flow);
+    }
+}
 
-                yev_destroy_event(yev_event);
-            }
-            break;
+/***************************************************************************
+ *  New item at the tail of the tx queue, growing it if full. NULL if no memory.
+ ***************************************************************************/
+PRIVATE tx_item_t *tx_queue_push(hgobj gobj)
+{
+    PRIVATE_DATA *priv = gobj_priv_data(gobj);
 
-        case YEV_CONNECT_TYPE:
-            {
-                if(yev_event->result < 0) {
-                    /*
-                     *  Error on connection
-                     */
-                    if(gobj_trace_level(gobj) & TRACE_UV) {
-                        if(yev_event->result != -ECANCELED) {
-                            gobj_log_error(gobj, 0,
-                                "function",     "%s", __FUNCTION__,
-                                "msgset",       "%s", MSGSET_LIBUV_ERROR,
-                                "msg",          "%s", "connect FAILED",
-                                "url",          "%s", gobj_read_str_attr(gobj, "url"),
-                                "errno",        "%d", -yev_event->result,
-                                "strerror",     "%s", strerror(-yev_event->result),
-                                "p",            "%p", yev_event,
-                                NULL
-                            );
-                        }
-                    }
-                    set_disconnected(gobj, strerror(-yev_event->result));
-                } else {
-                    set_connected(gobj, yev_event->fd);
-                }
-            }
-            break;
-        default:
-            gobj_log_error(gobj, LOG_OPT_TRACE_STACK,
+    if(priv->tx_queue_len >= priv->tx_queue_max) {
+        unsigned new_max = priv->tx_queue_max? priv->tx_queue_max*2 : TX_QUEUE_INITIAL_SIZE;
+        tx_item_t *tx_queue = GBMEM_MALLOC(new_max * sizeof(tx_item_t));
+        if(!tx_queue) {
+            gobj_log_critical(gobj, 0,
                 "function",     "%s", __FUNCTION__,
-                "msgset",       "%s", MSGSET_SYSTEM_ERROR,
-                "msg",          "%s", "event type NOT IMPLEMENTED",
-                "url",          "%s", gobj_read_str_attr(gobj, "url"),
-                "remote-addr",  "%s", gobj_read_str_attr(gobj, "peername"),
-                "local-addr",   "%s", gobj_read_str_attr(gobj, "sockname"),
-                "event_type",   "%s", yev_event_type_name(yev_event),
-                "p",            "%p", yev_event,
+                "msgset",       "%s", MSGSET_MEMORY_ERROR,
+                "msg",          "%s", "No memory to tx queue",
+                "size",         "%d", (int)new_max,
                 NULL
             );
-            break;
+            return NULL;
+        }
+        for(unsigned i=0; i<priv->tx_queue_len; i++) {
+            tx_queue[i] = priv->tx_queue[(priv->tx_queue_head + i) % priv->tx_queue_max];
+        }
+        GBMEM_FREE(priv->tx_queue)
+        priv->tx_queue = tx_queue;
+        priv->tx_queue_max = new_max;
+        priv->tx_queue_head = 0;
     }
 
-    return gobj_is_running(gobj)?0:-1;
+    tx_item_t *item = tx_item(priv, priv->tx_queue_len);
+    memset(item, 0, sizeof(tx_item_t));
+    item->file_fd = -1;
+    priv->tx_queue_len++;
+    return item;
 }
 
+/***************************************************************************
+ *  Append the gbuffer (owned) to the tx queue
+ ***************************************************************************/
+PRIVATE int tx_enqueue(hgobj gobj, gbuffer_t *gbuf, BOOL want_tx_ready, BOOL more)
+{
+    PRIVATE_DATA *priv = gobj_priv_data(gobj);
+
+    tx_item_t *item = tx_queue_push(gobj);
+    if(!item) {
+        // Error already logged
+        GBUFFER_DECREF(gbuf)
+        return -1;
+    }
+    item->gbuf = gbuf;
+    item->bytes = gbuffer_leftbytes(gbuf);
+    item->want_tx_ready = want_tx_ready;
+    item->more = more;
+    priv->tx_queued_bytes += item->bytes;
+    tx_queue_stats(gobj);
+    return 0;
+}
+
+/***************************************************************************
+ *  Append a file to the tx queue, `length` bytes of fd from offset.
+ *  If owned the fd is closed when the file is sent or released.
+ *  The file is not in memory, its bytes don't count in the tx queue bytes.
+ ***************************************************************************/
+PRIVATE int tx_enqueue_file(
+    hgobj gobj,
+    int fd,
+    BOOL owned,
+    const char *path,
+    uint64_t offset,
+    uint64_t length
+) {
+    tx_item_t *item = tx_queue_push(gobj);
+    if(!item) {
+        // Error already logged
+        if(owned) {
+            close(fd);
+        }
+        return -1;
+    }
+    item->bytes = length;
+    item->file_fd = fd;
+    item->file_owned = owned;
+    item->file_offset = offset;
+    item->file_length = length;
+    item->file_path = (path && *path)? GBMEM_STRDUP(path) : NULL;
+    tx_queue_stats(gobj);
+    return 0;
+}
+
+/***************************************************************************
+ *  Release the gbuffer or the file of a tx item
+ ***************************************************************************/
+PRIVATE void tx_item_release(PRIVATE_DATA *priv, tx_item_t *item)
+{
+    if(item->gbuf) {
+        priv->tx_queued_bytes -= item->bytes;
+        GBUFFER_DECREF(item->gbuf)
+    } else {
+        if(item->file_owned && item->file_fd >= 0) {
+            close(item->file_fd);
+        }
+        item->file_fd = -1;
+        GBMEM_FREE(item->file_path)
+    }
+}
+
+/***************************************************************************
+ *  Start the write of the tx queue if there is no write in flight:
+ *      - the first gbuffer alone with zero copy if it's big enough
+ *      - else a writev of the queued gbuffers (until IOV_MAX or a big one)
+ ***************************************************************************/
+PRIVATE void tx_flush(hgobj gobj)
+{
+    PRIVATE_DATA *priv = gobj_priv_data(gobj);
+
+    if(priv->sskt && priv->tls_established && !ytls_ktls_tx(priv->sskt)) {
+        tx_flush_tls(gobj);
+        return;
+    }
+    if(priv->tx_in_flight > 0 || priv->tx_queue_len == 0) {
+        return;
+    }
+    if(!priv->yev_client_tx || priv->yev_client_tx->fd <= 0) {
+        return;
+    }
+
+    BOOL zc = priv->tx_zerocopy_threshold > 0 && yev_send_zc_available(yuno_event_loop());
+    tx_item_t *item = tx_item(priv, 0);
+
+    if(!item->gbuf) {
+        tx_flush_file(gobj);
+        return;
+    }
+
+    if(zc && (json_int_t)gbuffer_leftbytes(item->gbuf) >= priv->tx_zerocopy_threshold) {
+        gbuffer_incref(item->gbuf);   // the event decref it on destroy
+        priv->yev_client_tx_zc = yev_create_send_zc_event(
+            yuno_event_loop(),
+            yev_transport_callback,
+            gobj,
+            priv->yev_client_tx->fd,
+            item->gbuf
+        );
+        if(!priv->yev_client_tx_zc || yev_start_event(priv->yev_client_tx_zc) < 0) {
+            // Error already logged
+            EXEC_AND_RESET(yev_destroy_event, priv->yev_client_tx_zc);
+            return;
+        }
+        priv->tx_in_flight = 1;
+        INCR_ATTR_INTEGER(txWrites)
+        return;
+    }
+
+    unsigned max_iov = MIN(priv->tx_queue_len, IOV_MAX);
+    if(max_iov > priv->tx_iov_max) {
+        unsigned new_max = MIN(priv->tx_queue_max, IOV_MAX);
+        GBMEM_FREE(priv->tx_iov)
+        priv->tx_iov = GBMEM_MALLOC(new_max * sizeof(struct iovec));
+        if(!priv->tx_iov) {
+            gobj_log_critical(gobj, 0,
+                "function",     "%s", __FUNCTION__,
+                "msgset",       "%s", MSGSET_MEMORY_ERROR,
+                "msg",          "%s", "No memory to tx iovecs",
+                "size",         "%d", (int)new_max,
+                NULL
+            );
+            priv->tx_iov_max = 0;
+            return;
+        }
+        priv->tx_iov_max = new_max;
+    }
+
+    unsigned n = 0;
+    for(; n<max_iov; n++) {
+        item = tx_item(priv, n);
+        if(!item->gbuf) {
+            break;  // The file goes after the gbuffers before it
+        }
+        size_t len = gbuffer_leftbytes(item->gbuf);
+        if(n > 0 && zc && (json_int_t)len >= priv->tx_zerocopy_threshold) {
+            break;  // The big one will go alone with zero copy
+        }
+        priv->tx_iov[n].iov_base = gbuffer_cur_rd_pointer(item->gbuf);
+        priv->tx_iov[n].iov_len = len;
+    }
+
+    yev_set_iov(priv->yev_client_tx, priv->tx_iov, (int)n);
+    if(yev_start_event(priv->yev_client_tx) < 0) {
+        // Error already logged
+        return;
+    }
+    priv->tx_in_flight = n;
+    INCR_ATTR_INTEGER(txWrites)
+}
+
+/***************************************************************************
+ *  Splice the next chunk of the file in the head of the tx queue to the socket.
+ *  A chunk is at most the pipe of the event (YEV_SPLICE_PIPE_SIZE),
+ *  the next one starts when the socket has taken it all: the flow control of the file.
+ ***************************************************************************/
+PRIVATE void tx_flush_file(hgobj gobj)
+{
+    PRIVATE_DATA *priv = gobj_priv_data(gobj);
+
+    if(!priv->yev_client_tx_file) {
+        priv->yev_client_tx_file = yev_create_splice_event(
+            yuno_event_loop(),
+            yev_transport_callback,
+            gobj,
+            priv->yev_client_tx->fd
+        );
+        if(!priv->yev_client_tx_file) {
+            // Error already logged
+            return;
+        }
+    }
+    if(yev_event_in_ring(priv->yev_client_tx_file)) {
+        return; // Cancelled chunk of the previous connection not returned yet
+    }
+
+    tx_item_t *item = tx_item(priv, 0);
+    yev_set_fd(priv->yev_client_tx_file, priv->yev_client_tx->fd);
+    if(yev_start_splice_event(
+            priv->yev_client_tx_file,
+            item->file_fd,
+            item->file_offset,
+            (size_t)MIN(item->bytes, (size_t)YEV_SPLICE_PIPE_SIZE)
+        ) < 0) {
+        // Error already logged
+        return;
+    }
+    priv->tx_in_flight = 1;
+    INCR_ATTR_INTEGER(txWrites)
+}
+
+/***************************************************************************
+ *  The file in the head of the tx queue is sent: release it and inform with EV_TX_READY
+ ***************************************************************************/
+PRIVATE void tx_file_sent(hgobj gobj)
+{
+    PRIVATE_DATA *priv = gobj_priv_data(gobj);
+
+    tx_item_t *item = tx_item(priv, 0);
+    json_t *kw_tx_ready = json_pack("{s:s, s:i, s:I, s:I}",
+        "path", item->file_path? item->file_path : "",
+        "fd", item->file_owned? -1 : item->file_fd,
+        "offset", (json_int_t)(item->file_offset - (item->file_length - item->bytes)),
+        "length", (json_int_t)(item->file_length - item->bytes)
+    );
+    tx_item_release(priv, item);
+    priv->tx_queue_head = (priv->tx_queue_head + 1) % priv->tx_queue_max;
+    priv->tx_queue_len--;
+    priv->tx_in_flight = 0;
+    INCR_ATTR_INTEGER(txFiles)
+    tx_queue_stats(gobj);
+
+    if(gobj_is_pure_child(gobj)) {
+        gobj_send_event(gobj_parent(gobj), EV_TX_READY, kw_tx_ready, gobj);
+    } else {
+        gobj_publish_event(gobj, EV_TX_READY, kw_tx_ready);
+    }
+    tx_check_watermarks(gobj);
+}
+
+/***************************************************************************
+ *  Tx without ktls: encrypt the head of the tx queue (YTLS_TX_BATCH_BYTES of plain data)
+ *  and write all its records at once, with the replies of the protocol pending.
+ *  The gbuffers are consumed when the encrypted data is written.
+ ***************************************************************************/
+PRIVATE void tx_flush_tls(hgobj gobj)
+{
+    PRIVATE_DATA *priv = gobj_priv_data(gobj);
+
+    if(!priv->yev_client_tx || priv->yev_client_tx->fd <= 0 || yev_event_in_ring(priv->yev_client_tx)) {
+        return;
+    }
+
+    if(!priv->tx_tls_gbuf) {
+        size_t plain = 0;
+        unsigned n = 0;
+        for(; n<priv->tx_queue_len && plain < YTLS_TX_BATCH_BYTES; n++) {
+            tx_item_t *item = tx_item(priv, n);
+            if(!item->gbuf) {
+                break;  // Files are not queued without ktls tx
+            }
+            size_t len = MIN(gbuffer_leftbytes(item->gbuf), YTLS_TX_BATCH_BYTES - plain);
+            if(ytls_encrypt(priv->sskt, gbuffer_cur_rd_pointer(item->gbuf), len) < 0) {
+                // Error already logged
+                set_disconnected(gobj, "tls encrypt failed");
+                return;
+            }
+            plain += len;
+        }
+        priv->tx_tls_gbuf = ytls_get_encrypted(priv->sskt);
+        if(!priv->tx_tls_gbuf) {
+            if(plain > 0) {
+                // Error already logged, the encrypted records are lost
+                set_disconnected(gobj, "tls encrypt failed");
+            }
+            return;
+        }
+        priv->tx_tls_plain = plain;
+        priv->tx_in_flight = n;
+    }
+
+    /*
+     *  The encrypted data or the remainder of a short write
+     */
+    priv->tx_tls_iov.iov_base = gbuffer_cur_rd_pointer(priv->tx_tls_gbuf);
+    priv->tx_tls_iov.iov_len = gbuffer_leftbytes(priv->tx_tls_gbuf);
+    yev_set_iov(priv->yev_client_tx, &priv->tx_tls_iov, 1);
+    if(yev_start_event(priv->yev_client_tx) < 0) {
+        // Error already logged
+        return;
+    }
+    INCR_ATTR_INTEGER(txWrites)
+}
+
+/***************************************************************************
+ *  The socket is connected, start the tls handshake.
+ *  The library reads and writes the socket in non-blocking mode,
+ *  waiting its readiness with a poll event of the loop.
+ ***************************************************************************/
+PRIVATE void start_tls_handshake(hgobj gobj, int fd)
+{
+    PRIVATE_DATA *priv = gobj_priv_data(gobj);
+
+    gobj_change_state(gobj, ST_WAIT_CONNECTED);
+    priv->tls_handshaking = TRUE;
+
+    if(priv->ytls) {
+        priv->sskt = ytls_new_secure_socket(
+            priv->ytls,
+            gobj,
+            fd,
+            gobj_read_str_attr(gobj, "host"),
+            !gobj_read_bool_attr(gobj, "skip_cert_cn")
+        );
+    }
+    if(!priv->sskt) {
+        // Error already logged
+        set_disconnected(gobj, "no tls");
+        return;
+    }
+
+    if(!priv->yev_tls_poll) {
+        priv->yev_tls_poll = yev_create_poll_event(
+            yuno_event_loop(),
+            yev_transport_callback,
+            gobj,
+            fd,
+            POLLIN
+        );
+        if(!priv->yev_tls_poll) {
+            // Error already logged
+            set_disconnected(gobj, "no tls");
+            return;
+        }
+    }
+    yev_set_fd(priv->yev_tls_poll, fd);
+
+    int flags = fcntl(fd, F_GETFL);
+    fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+
+    json_int_t timeout_waiting_connected = gobj_read_integer_attr(gobj, "timeout_waiting_connected");
+    if(timeout_waiting_connected > 0) {
+        set_timeout(priv->gobj_timer, timeout_waiting_connected);
+    }
+
+    tls_handshake(gobj);
+}
+
+/***************************************************************************
+ *  Step of the tls handshake, connected when it's done
+ ***************************************************************************/
+PRIVATE void tls_handshake(hgobj gobj)
+{
+    PRIVATE_DATA *priv = gobj_priv_data(gobj);
+    int fd = priv->yev_tls_poll->fd;
+
+    int ret = ytls_do_handshake(priv->sskt);
+    if(ret < 0) {
+        char cause[300];
+        snprintf(cause, sizeof(cause), "tls handshake: %s", ytls_last_error(priv->sskt));
+        gobj_log_error(gobj, 0,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_PROTOCOL_ERROR,
+            "msg",          "%s", "Tls handshake FAILED",
+            "url",          "%s", gobj_read_str_attr(gobj, "url"),
+            "remote-addr",  "%s", gobj_read_str_attr(gobj, "peername"),
+            "error",        "%s", ytls_last_error(priv->sskt),
+            NULL
+        );
+        set_disconnected(gobj, cause);
+        return;
+    }
+    if(ret == 0) {
+        yev_set_poll_events(priv->yev_tls_poll, ytls_poll_events(priv->sskt));
+        if(yev_start_event(priv->yev_tls_poll) < 0) {
+            // Error already logged
+            set_disconnected(gobj, "tls handshake: cannot poll");
+        }
+        return;
+    }
+
+    /*
+     *  Done, the io_uring reads and writes go on with the socket in blocking mode
+     */
+    priv->tls_handshaking = FALSE;
+    priv->tls_established = TRUE;
+    int flags = fcntl(fd, F_GETFL);
+    fcntl(fd, F_SETFL, flags & ~O_NONBLOCK);
+
+    char tls_cipher[120];
+    snprintf(tls_cipher, sizeof(tls_cipher), "%s %s",
+        ytls_protocol(priv->sskt), ytls_cipher_name(priv->sskt)
+    );
+    gobj_write_str_attr(gobj, "tlsCipher", tls_cipher);
+    gobj_write_bool_attr(gobj, "ktlsTx", ytls_ktls_tx(priv->sskt));
+    gobj_write_bool_attr(gobj, "ktlsRx", ytls_ktls_rx(priv->sskt));
+
+    set_connected(gobj, fd);
+}
+
+/***************************************************************************
+ *  Consume the bytes written from the gbuffers in flight,
+ *  the gbuffers written completely are released (and informed if want_tx_ready),
+ *  the remainder of a short write keeps in the head of the queue.
+ ***************************************************************************/
+PRIVATE void tx_consume(hgobj gobj, size_t written)
+{
+    PRIVATE_DATA *priv = gobj_priv_data(gobj);
+
+    while(priv->tx_in_flight > 0 && priv->tx_queue_len > 0) {
+        tx_item_t *item = tx_item(priv, 0);
+        if(!item->gbuf) {
+            break;  // File, consumed in tx_file_sent()
+        }
+        size_t len = gbuffer_leftbytes(item->gbuf);
+        size_t consumed = MIN(len, written);
+        if(consumed > 0) {
+            gbuffer_get(item->gbuf, consumed);
+            written -= consumed;
+        }
+        size_t left = gbuffer_leftbytes(item->gbuf);
+        priv->tx_queued_bytes -= item->bytes - left;
+        item->bytes = left;
+        if(left > 0) {
+            item->started = TRUE;
+            INCR_ATTR_INTEGER(txShortWrites)
+            break;
+        }
+
+        gbuffer_t *gbuf = item->gbuf;
+        BOOL want_tx_ready = item->want_tx_ready;
+        item->gbuf = 0;
+        priv->tx_queue_head = (priv->tx_queue_head + 1) % priv->tx_queue_max;
+        priv->tx_queue_len--;
+        priv->tx_in_flight--;
+
+        if(want_tx_ready) {
+            json_t *kw_tx_ready = json_object();
+            json_object_set_new(kw_tx_ready, "gbuffer_mark", json_integer((json_int_t)gbuffer_getmark(gbuf)));
+            if(gobj_is_pure_child(gobj)) {
+                gobj_send_event(gobj_parent(gobj), EV_TX_READY, kw_tx_ready, gobj);
+            } else {
+                gobj_publish_event(gobj, EV_TX_READY, kw_tx_ready);
+            }
+        }
+        GBUFFER_DECREF(gbuf)
+    }
+    priv->tx_in_flight = 0;
+    tx_queue_stats(gobj);
+    tx_check_watermarks(gobj);
+}
+
+/***************************************************************************
+ *  Release the gbuffers and files queued, except the ones of the write in flight
+ ***************************************************************************/
+PRIVATE void tx_queue_clear(hgobj gobj)
+{
+    PRIVATE_DATA *priv = gobj_priv_data(gobj);
+
+    while(priv->tx_queue_len > priv->tx_in_flight) {
+        tx_item_release(priv, tx_item(priv, priv->tx_queue_len - 1));
+        priv->tx_queue_len--;
+    }
+    tx_queue_stats(gobj);
+}
+
+/***************************************************************************
+ *  Drop the oldest complete message not in flight (its gbuffers linked with `more`),
+ *  return the bytes dropped, 0 if there is nothing to drop.
+ ***************************************************************************/
+PRIVATE size_t tx_drop_oldest(hgobj gobj)
+{
+    PRIVATE_DATA *priv = gobj_priv_data(gobj);
+
+    /*
+     *  Skip the gbuffers in flight and the rest of their message
+     */
+    unsigned first = priv->tx_in_flight;
+    while(first < priv->tx_queue_len) {
+        if(first == 0 && tx_item(priv, 0)->started) {
+            first++;
+        } else if(first > 0 && tx_item(priv, first - 1)->more) {
+            first++;
+        } else {
+            break;
+        }
+    }
+
+    unsigned last = first;
+    while(last < priv->tx_queue_len && tx_item(priv, last)->more) {
+        last++;
+    }
+    if(last >= priv->tx_queue_len) {
+        return 0;   // No complete message to drop
+    }
+
+    size_t bytes = 0;
+    unsigned n = last - first + 1;
+    for(unsigned i=first; i<=last; i++) {
+        tx_item_t *item = tx_item(priv, i);
+        bytes += item->bytes;
+        tx_item_release(priv, item);
+    }
+    for(unsigned i=last+1; i<priv->tx_queue_len; i++) {
+        *tx_item(priv, i - n) = *tx_item(priv, i);
+    }
+    priv->tx_queue_len -= n;
+
+    INCR_ATTR_INTEGER(txDroppedMsgs)
+    INCR_ATTR_INTEGER2(txDroppedBytes, bytes)
+    return bytes;
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PRIVATE inline BOOL tx_over_hard_limit(PRIVATE_DATA *priv)
+{
+    return (priv->tx_hard_limit_bytes > 0 && (json_int_t)priv->tx_queued_bytes > priv->tx_hard_limit_bytes) ||
+        (priv->tx_hard_limit_msgs > 0 && (json_int_t)priv->tx_queue_len > priv->tx_hard_limit_msgs);
+}
+
+/***************************************************************************
+ *  Apply the tx_overflow_policy if the tx queue is over a hard limit.
+ *  Return -1 if the connection has been closed.
+ ***************************************************************************/
+PRIVATE int tx_check_limits(hgobj gobj)
+{
+    PRIVATE_DATA *priv = gobj_priv_data(gobj);
+
+    if(!tx_over_hard_limit(priv)) {
+        return 0;
+    }
+
+    if(priv->tx_drop_oldest) {
+        while(tx_over_hard_limit(priv)) {
+            if(tx_drop_oldest(gobj) == 0) {
+                break;
+            }
+        }
+        tx_queue_stats(gobj);
+        return 0;
+    }
+
+    gobj_log_error(gobj, 0,
+        "function",     "%s", __FUNCTION__,
+        "msgset",       "%s", MSGSET_QUEUE_ALARM,
+        "msg",          "%s", "Tx queue over the hard limit, disconnecting",
+        "url",          "%s", gobj_read_str_attr(gobj, "url"),
+        "remote-addr",  "%s", gobj_read_str_attr(gobj, "peername"),
+        "txQueued",     "%d", (int)priv->tx_queue_len,
+        "txQueuedBytes","%lu", (unsigned long)priv->tx_queued_bytes,
+        NULL
+    );
+    set_disconnected(gobj, "tx hard limit");
+    return -1;
+}
+
+/***************************************************************************
+ *  Publish EV_TX_FULL crossing up the high watermark (bytes or gbuffers),
+ *  and EV_TX_RESUME crossing down the low watermark.
+ ***************************************************************************/
+PRIVATE void tx_check_watermarks(hgobj gobj)
+{
+    PRIVATE_DATA *priv = gobj_priv_data(gobj);
+
+    if(!priv->tx_full) {
+        if((priv->tx_high_water_bytes > 0 && (json_int_t)priv->tx_queued_bytes >= priv->tx_high_water_bytes) ||
+           (priv->tx_high_water_msgs > 0 && (json_int_t)priv->tx_queue_len >= priv->tx_high_water_msgs)) {
+            priv->tx_full = TRUE;
+            gobj_write_bool_attr(gobj, "txFull", TRUE);
+            INCR_ATTR_INTEGER(txFullCount)
+            tx_publish_flow(gobj, EV_TX_FULL);
+        }
+    } else {
+        if((priv->tx_high_water_bytes <= 0 || (json_int_t)priv->tx_queued_bytes <= priv->tx_low_water_bytes) &&
+           (priv->tx_high_water_msgs <= 0 || (json_int_t)priv->tx_queue_len <= priv->tx_low_water_msgs)) {
+            priv->tx_full = FALSE;
+            gobj_write_bool_attr(gobj, "txFull", FALSE);
+            tx_publish_flow(gobj, EV_TX_RESUME);
+        }
+    }
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PRIVATE int yev_transport_callback(yev_event_t *yev_event)
+{
+    hgobj gobj = yev_event->gobj;
+    PRIVATE_DATA *priv = gobj_priv_data(gobj);
+
+    if(gobj_trace_level(gobj) & TRACE_UV) {
+        json_t *jn_flags = bits2jn_strlist(yev_flag_strings(), yev_event->flag);
+        gobj_log_info(gobj, 0,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_YEV_LOOP,
+            "msg",          "%s", "yev callback",
+            "msg2",         "%s", "💥 yev callback",
+            "event type",   "%s", yev_event_type_name(yev_event),
+            "result",       "%d", yev_event->result,
+            "sres",         "%s", (yev_event->result<0)? strerror(-yev_event->result):"",
+            "flag",         "%j", jn_flags,
+            "p",            "%p", yev_event,
+            NULL
+        );
+        json_decref(jn_flags);
+    }
+    switch(yev_event->type) {
+        case YEV_READ_TYPE:
+        case YEV_RECV_MULTISHOT_TYPE:
+            {
+                BOOL ktls_record = (yev_event->result == -EIO &&
+                    priv->sskt && ytls_ktls_rx(priv->sskt));
+                if(yev_event->result < 0 && !ktls_record) {
+                    /*
+                     *  Disconnected
+                     */
+                    if(gobj_trace_level(gobj) & TRACE_UV) {
+                        if(yev_event->result != -ECANCELED) {
+                            gobj_log_info(gobj, 0,
+                                "function",     "%s", __FUNCTION__,
+                                "msgset",       "%s", MSGSET_CONNECT_DISCONNECT,
+                                "msg",          "%s", "read FAILED",
+                                "url",          "%s", gobj_read_str_attr(gobj, "url"),
+                                "remote-addr",  "%s", gobj_read_str_attr(gobj, "peername"),
+                                "local-addr",   "%s", gobj_read_str_attr(gobj, "sockname"),
+                                "errno",        "%d", -yev_event->result,
+                                "strerror",     "%s", strerror(-yev_event->result),
+                                "p",            "%p", yev_event,
+                                NULL
+                            );
+                        }
+                    }
+                    set_disconnected(
+                        gobj,
+                        yev_event->result == -ETIMEDOUT? "inactivity timeout" : strerror(-yev_event->result)
+                    );
+
+                } else {
+                    /*
+                     *  Without ktls the data read is decrypted here,
+                     *  an incomplete record waits the next read.
+                     *  With ktls a record that is not application data (EIO)
+                     *  is processed by the library.
+                     */
+                    gbuffer_t *gbuf = yev_event->gbuf;
+                    if(ktls_record) {
+                        if(ytls_ktls_read_record(priv->sskt, &gbuf) < 0) {
+                            char cause[300];
+                            snprintf(cause, sizeof(cause), "tls: %s", ytls_last_error(priv->sskt));
+                            set_disconnected(gobj, cause);
+                            break;
+                        }
+                        tx_flush(gobj); // replies of the protocol, if any
+                    } else if(priv->sskt && !ytls_ktls_rx(priv->sskt)) {
+                        if(ytls_decrypt(priv->sskt, yev_event->gbuf, &gbuf) < 0) {
+                            char cause[300];
+                            snprintf(cause, sizeof(cause), "tls: %s", ytls_last_error(priv->sskt));
+                            set_disconnected(gobj, cause);
+                            break;
+                        }
+                        tx_flush(gobj); // replies of the protocol, if any
+                    } else {
+                        GBUFFER_INCREF(gbuf)
+                    }
+
+                    if(gbuf) {
+                        if(gobj_trace_level(gobj) & TRACE_TRAFFIC) {
+                            gobj_trace_dump_gbuf(gobj, gbuf, "%s: %s%s%s",
+                                gobj_short_name(gobj),
+                                gobj_read_str_attr(gobj, "sockname"),
+                                " <- ",
+                                gobj_read_str_attr(gobj, "peername")
+                            );
+                        }
+
+                        gobj_incr_integer_attr_h(gobj, h_rxMsgs, 1);
+                        gobj_incr_integer_attr_h(gobj, h_rxBytes, (json_int_t)gbuffer_leftbytes(gbuf));
+
+                        json_t *kw = json_pack("{s:I}",
+                            "gbuffer", (json_int_t)(size_t)gbuf
+                        );
+                        if(gobj_is_pure_child(gobj)) {
+                            gobj_send_event(gobj_parent(gobj), EV_RX_DATA, kw, gobj);
+                        } else {
+                            gobj_publish_event(gobj, EV_RX_DATA, kw);
+                        }
+                    }
+
+                    /*
+                     *  Clear buffer
+                     *  Re-arm read, the multishot recv keeps armed but after an error
+                     */
+                    if(yev_event->type == YEV_READ_TYPE && yev_event->gbuf) {
+                        gbuffer_clear(yev_event->gbuf);
+                        yev_start_event(yev_event);
+                    } else if(ktls_record && gobj_current_state(gobj) == ST_CONNECTED &&
+                            !yev_event_in_ring(yev_event)) {
+                        yev_start_event(yev_event);
+                    }
+                }
+            }
+            break;
+
+        case YEV_WRITEV_TYPE:
+        case YEV_SEND_ZC_TYPE:
+            {
+                if(yev_event->type == YEV_SEND_ZC_TYPE) {
+                    // The zero copy send informs after the kernel has released the gbuffer
+                    priv->yev_client_tx_zc = NULL;
+                }
+                if(yev_event->result < 0) {
+                    /*
+                     *  Disconnected
+                     */
+                    if(gobj_trace_level(gobj) & TRACE_UV) {
+                        if(yev_event->result != -ECANCELED) {
+                            gobj_log_info(gobj, 0,
+                                "function",     "%s", __FUNCTION__,
+                                "msgset",       "%s", MSGSET_CONNECT_DISCONNECT,
+                                "msg",          "%s", "write FAILED",
+                                "url",          "%s", gobj_read_str_attr(gobj, "url"),
+                                "remote-addr",  "%s", gobj_read_str_attr(gobj, "peername"),
+                                "local-addr",   "%s", gobj_read_str_attr(gobj, "sockname"),
+                                "errno",        "%d", -yev_event->result,
+                                "strerror",     "%s", strerror(-yev_event->result),
+                                "p",            "%p", yev_event,
+                                NULL
+                            );
+                        }
+                    }
+                    priv->tx_in_flight = 0;
+                    tx_queue_clear(gobj);
+                    GBUFFER_DECREF(priv->tx_tls_gbuf)
+                    if(yev_event->type == YEV_SEND_ZC_TYPE) {
+                        yev_destroy_event(yev_event);
+                    }
+                    set_disconnected(gobj, strerror(-yev_event->result));
+
+                } else {
+                    if(yev_event->type == YEV_SEND_ZC_TYPE) {
+                        if(!(yev_event->flag & YEV_FLAG_ZC_COPIED)) {
+                            INCR_ATTR_INTEGER2(txZcBytes, yev_event->result)
+                        } else {
+                            INCR_ATTR_INTEGER2(txCopiedBytes, yev_event->result)
+                        }
+                        yev_destroy_event(yev_event);
+                        tx_consume(gobj, 0); // gbuffer already consumed by the yev loop
+                    } else if(priv->tx_tls_gbuf) {
+                        /*
+                         *  Encrypted data written, the plain gbuffers are consumed when complete
+                         */
+                        INCR_ATTR_INTEGER2(txCopiedBytes, yev_event->result)
+                        gbuffer_get(priv->tx_tls_gbuf, (size_t)yev_event->result);
+                        if(gbuffer_leftbytes(priv->tx_tls_gbuf) > 0) {
+                            INCR_ATTR_INTEGER(txShortWrites)
+                        } else {
+                            GBUFFER_DECREF(priv->tx_tls_gbuf)
+                            tx_consume(gobj, priv->tx_tls_plain);
+                        }
+                    } else {
+                        INCR_ATTR_INTEGER2(txCopiedBytes, yev_event->result)
+                        tx_consume(gobj, (size_t)yev_event->result);
+                    }
+
+                    /*
+                     *  Next write: the remainder of a short write and the gbuffers queued meanwhile
+                     */
+                    tx_flush(gobj);
+                }
+            }
+            break;
+
+        case YEV_SPLICE_TYPE:
+            {
+                if(priv->tx_in_flight == 0 || priv->tx_queue_len == 0 || tx_item(priv, 0)->gbuf) {
+                    break;  // Late cqe of a chunk cancelled
+                }
+                tx_item_t *item = tx_item(priv, 0);
+                if(yev_event->result < 0 || yev_event->fd < 0) {
+                    /*
+                     *  Disconnected (or stopped by the disconnection)
+                     */
+                    if(gobj_trace_level(gobj) & TRACE_UV) {
+                        if(yev_event->result < 0 && yev_event->result != -ECANCELED) {
+                            gobj_log_info(gobj, 0,
+                                "function",     "%s", __FUNCTION__,
+                                "msgset",       "%s", MSGSET_CONNECT_DISCONNECT,
+                                "msg",          "%s", "splice FAILED",
+                                "url",          "%s", gobj_read_str_attr(gobj, "url"),
+                                "remote-addr",  "%s", gobj_read_str_attr(gobj, "peername"),
+                                "local-addr",   "%s", gobj_read_str_attr(gobj, "sockname"),
+                                "path",         "%s", item->file_path? item->file_path : "",
+                                "errno",        "%d", -yev_event->result,
+                                "strerror",     "%s", strerror(-yev_event->result),
+                                "p",            "%p", yev_event,
+                                NULL
+                            );
+                        }
+                    }
+                    priv->tx_in_flight = 0;
+                    tx_queue_clear(gobj);
+                    if(yev_event->fd >= 0) {
+                        set_disconnected(gobj, strerror(-yev_event->result));
+                    }
+                    break;
+                }
+
+                if(yev_event->result == 0) {
+                    /*
+                     *  End of file before the length asked: the peer is waiting bytes never sent
+                     */
+                    gobj_log_error(gobj, 0,
+                        "function",     "%s", __FUNCTION__,
+                        "msgset",       "%s", MSGSET_SYSTEM_ERROR,
+                        "msg",          "%s", "File shorter than the length to send, disconnecting",
+                        "url",          "%s", gobj_read_str_attr(gobj, "url"),
+                        "path",         "%s", item->file_path? item->file_path : "",
+                        "offset",       "%lu", (unsigned long)item->file_offset,
+                        "pending",      "%lu", (unsigned long)item->bytes,
+                        NULL
+                    );
+                    priv->tx_in_flight = 0;
+                    tx_queue_clear(gobj);
+                    set_disconnected(gobj, "tx file truncated");
+                    break;
+                }
+
+                INCR_ATTR_INTEGER2(txFileBytes, yev_event->result)
+                item->file_offset += (uint64_t)yev_event->result;
+                item->bytes -= MIN(item->bytes, (size_t)yev_event->result);
+                item->started = TRUE;
+                if(item->bytes == 0) {
+                    tx_file_sent(gobj);
+                }
+                priv->tx_in_flight = 0;
+
+                /*
+                 *  Next chunk of the file or the gbuffers queued meanwhile
+                 */
+                tx_flush(gobj);
+            }
+            break;
+
+        case YEV_POLL_TYPE:
+            {
+                if(yev_event->result < 0) {
+                    if(yev_event->result != -ECANCELED) {
+                        set_disconnected(gobj, strerror(-yev_event->result));
+                    }
+                } else if(priv->sskt && priv->tls_handshaking) {
+                    tls_handshake(gobj);
+                }
+            }
+            break;
+
+        case YEV_CONNECT_TYPE:
+            {
+                if(yev_event->result < 0) {
+                    /*
+                     *  Error on connection
+                     */
+                    if(gobj_trace_level(gobj) & TRACE_UV) {
+                        if(yev_event->result != -ECANCELED) {
+                            gobj_log_error(gobj, 0,
+                                "function",     "%s", __FUNCTION__,
+                                "msgset",       "%s", MSGSET_LIBUV_ERROR,
+                                "msg",          "%s", "connect FAILED",
+                                "url",          "%s", gobj_read_str_attr(gobj, "url"),
+                                "errno",        "%d", -yev_event->result,
+                                "strerror",     "%s", strerror(-yev_event->result),
+                                "p",            "%p", yev_event,
+                                NULL
+                            );
+                        }
+                    }
+                    set_disconnected(gobj, strerror(-yev_event->result));
+                } else {
+                    set_connected(gobj, yev_event->fd);
+                }
+            }
+            break;
+        default:
+            gobj_log_error(gobj, LOG_OPT_TRACE_STACK,
+                "function",     "%s", __FUNCTION__,
+                "msgset",       "%s", MSGSET_SYSTEM_ERROR,
+                "msg",          "%s", "event type NOT IMPLEMENTED",
+                "url",          "%s", gobj_read_str_attr(gobj, "url"),
+                "remote-addr",  "%s", gobj_read_str_attr(gobj, "peername"),
+                "local-addr",   "%s", gobj_read_str_attr(gobj, "sockname"),
+                "event_type",   "%s", yev_event_type_name(yev_event),
+                "p",            "%p", yev_event,
+                NULL
+            );
+            break;
+    }
+
+    return gobj_is_running(gobj)?0:-1;
+}
+
+
 
 
-
                     /***************************
                      *      Actions
                      ***************************/
@@ -694,25 +1812,15 @@ PRIVATE int ac_timeout_disconnected(hgobj gobj, gobj_event_t event, json_t *kw,
 }
 
 /***************************************************************************
- *
+ *  Timeout of the tls handshake
  ***************************************************************************/
-PRIVATE int ac_connect(hgobj gobj, gobj_event_t event, json_t *kw, hgobj src)
+PRIVATE int ac_timeout_handshake(hgobj gobj, gobj_event_t event, json_t *kw, hgobj src)
 {
     PRIVATE_DATA *priv = gobj_priv_data(gobj);
 
-    const char *url = gobj_read_str_attr(gobj, "url");
-    yev_setup_connect_event(
-        priv->yev_client_connect,
-        url,    // client_url
-        NULL    // local bind
-    );
-
-    //  HACK cannot use timeout to connect,
-    //      it can't be clear instantly on connection (you must wait CANCEL)
-    //      it supposed that connect-event always return (with successful or error)
-    //set_timeout(priv->gobj_timer, gobj_read_integer_attr(gobj, "timeout_waiting_connected"));
-    gobj_change_state(gobj, ST_WAIT_CONNECTED);
-    yev_start_event(priv->yev_client_connect);
+    if(priv->tls_handshaking) {
+        set_disconnected(gobj, "tls handshake timeout");
+    }
 
     JSON_DECREF(kw);
     return 0;
@@ -721,9 +1829,29 @@ PRIVATE int ac_connect(hgobj gobj, gobj_event_t event, json_t *kw, hgobj src)
 /***************************************************************************
  *
  ***************************************************************************/
-PRIVATE int ac_timeout_wait_connected(hgobj gobj, gobj_event_t event, json_t *kw, hgobj src)
+PRIVATE int ac_connect(hgobj gobj, gobj_event_t event, json_t *kw, hgobj src)
 {
-    set_disconnected(gobj, "timeout connection");  // this re-set timeout
+    PRIVATE_DATA *priv = gobj_priv_data(gobj);
+
+    const char *url = gobj_read_str_attr(gobj, "url");
+
+    /*
+     *  The connect is cancelled by its linked timeout, returning -ETIMEDOUT,
+     *  no timer to clear when connected.
+     *  The name is resolved without blocking the loop, the timeout starts with the connect.
+     */
+    clear_timeout(priv->gobj_timer);
+    json_int_t timeout_waiting_connected = gobj_read_integer_attr(gobj, "timeout_waiting_connected");
+    yev_set_timeout(priv->yev_client_connect, (uint32_t)MAX(timeout_waiting_connected, 0));
+    gobj_change_state(gobj, ST_WAIT_CONNECTED);
+    if(yev_start_connect_event(
+        priv->yev_client_connect,
+        url,    // client_url
+        NULL    // local bind
+    ) < 0) {
+        // Error already logged, retry later
+        set_disconnected(gobj, "cannot connect");
+    }
 
     JSON_DECREF(kw);
     return 0;
@@ -734,8 +1862,6 @@ PRIVATE int ac_timeout_wait_connected(hgobj gobj, gobj_event_t event, json_t *kw
  ***************************************************************************/
 PRIVATE int ac_tx_data(hgobj gobj, gobj_event_t event, json_t *kw, hgobj src)
 {
-    PRIVATE_DATA *priv = gobj_priv_data(gobj);
-
     BOOL want_tx_ready = kw_get_bool(gobj, kw, "want_tx_ready", 0, 0);
     gbuffer_t *gbuf = (gbuffer_t *)(size_t)kw_get_int(gobj, kw, "gbuffer", 0, KW_REQUIRED|KW_EXTRACT);
     if(!gbuf) {
@@ -758,21 +1884,136 @@ PRIVATE int ac_tx_data(hgobj gobj, gobj_event_t event, json_t *kw, hgobj src)
         );
     }
 
-    INCR_ATTR_INTEGER(txMsgs)
-    INCR_ATTR_INTEGER2(txBytes, gbuffer_leftbytes(gbuf))
+    gobj_incr_integer_attr_h(gobj, h_txMsgs, 1);
+    gobj_incr_integer_attr_h(gobj, h_txBytes, (json_int_t)gbuffer_leftbytes(gbuf));
 
     /*
-     *  Transmit
+     *  Queue and transmit.
+     *  With `more` the gbuffer waits for the next one, to go together in the same writev
      */
-    yev_event_t *yev_client_tx = yev_create_write_event(
-        yuno_event_loop(),
-        yev_transport_callback,
-        gobj,
-        priv->yev_client_connect->fd,
-        gbuf
-    );
-    yev_set_flag(yev_client_tx, YEV_FLAG_WANT_TX_READY, want_tx_ready);
-    yev_start_event(yev_client_tx);
+    BOOL more = kw_get_bool(gobj, kw, "more", 0, 0);
+    if(tx_enqueue(gobj, gbuf, want_tx_ready, more) < 0) {
+        // Error already logged
+        KW_DECREF(kw)
+        return -1;
+    }
+    if(tx_check_limits(gobj) < 0) {
+        // Disconnected, error already logged
+        KW_DECREF(kw)
+        return -1;
+    }
+    tx_check_watermarks(gobj);
+    if(!more) {
+        tx_flush(gobj);
+    }
+
+    KW_DECREF(kw)
+    return 0;
+}
+
+/***************************************************************************
+ *  Send a file, without copies to user space:
+ *      "path":     file to open, or
+ *      "fd":       file opened by the sender (not closed, keep it open until EV_TX_READY)
+ *      "offset":   first byte to send, default 0
+ *      "length":   bytes to send, default 0: until the end of the file
+ *  It goes in the tx queue after the gbuffers sent before,
+ *  EV_TX_READY with the "path", "fd", "offset" and "length" sent when done.
+ ***************************************************************************/
+PRIVATE int ac_tx_file(hgobj gobj, gobj_event_t event, json_t *kw, hgobj src)
+{
+    PRIVATE_DATA *priv = gobj_priv_data(gobj);
+
+    const char *path = kw_get_str(gobj, kw, "path", "", 0);
+    int fd = (int)kw_get_int(gobj, kw, "fd", -1, 0);
+    json_int_t offset = kw_get_int(gobj, kw, "offset", 0, 0);
+    json_int_t length = kw_get_int(gobj, kw, "length", 0, 0);
+
+    if(priv->sskt && !ytls_ktls_tx(priv->sskt)) {
+        gobj_log_error(gobj, 0,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_PARAMETER_ERROR,
+            "msg",          "%s", "EV_TX_FILE in a tls connection requires ktls tx",
+            "url",          "%s", gobj_read_str_attr(gobj, "url"),
+            "path",         "%s", path,
+            NULL
+        );
+        KW_DECREF(kw)
+        return -1;
+    }
+
+    BOOL owned = FALSE;
+    if(!empty_string(path)) {
+        fd = open(path, O_RDONLY|O_CLOEXEC);
+        if(fd < 0) {
+            gobj_log_error(gobj, 0,
+                "function",     "%s", __FUNCTION__,
+                "msgset",       "%s", MSGSET_SYSTEM_ERROR,
+                "msg",          "%s", "Cannot open file to send",
+                "path",         "%s", path,
+                "errno",        "%d", errno,
+                "strerror",     "%s", strerror(errno),
+                NULL
+            );
+            KW_DECREF(kw)
+            return -1;
+        }
+        owned = TRUE;
+    }
+
+    struct stat st;
+    if(fd < 0 || offset < 0 || length < 0 || fstat(fd, &st) < 0) {
+        gobj_log_error(gobj, 0,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_PARAMETER_ERROR,
+            "msg",          "%s", "File to send without a valid path or fd",
+            "path",         "%s", path,
+            "fd",           "%d", fd,
+            "offset",       "%ld", (long)offset,
+            "length",       "%ld", (long)length,
+            NULL
+        );
+        if(owned) {
+            close(fd);
+        }
+        KW_DECREF(kw)
+        return -1;
+    }
+    if(length == 0) {
+        length = (json_int_t)st.st_size - offset;
+    }
+    if(length <= 0) {
+        gobj_log_error(gobj, 0,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_PARAMETER_ERROR,
+            "msg",          "%s", "Nothing to send, offset beyond the end of the file",
+            "path",         "%s", path,
+            "offset",       "%ld", (long)offset,
+            "size",         "%ld", (long)st.st_size,
+            NULL
+        );
+        if(owned) {
+            close(fd);
+        }
+        KW_DECREF(kw)
+        return -1;
+    }
+
+    gobj_incr_integer_attr_h(gobj, h_txMsgs, 1);
+    gobj_incr_integer_attr_h(gobj, h_txBytes, (json_int_t)length);
+
+    if(tx_enqueue_file(gobj, fd, owned, path, (uint64_t)offset, (uint64_t)length) < 0) {
+        // Error already logged
+        KW_DECREF(kw)
+        return -1;
+    }
+    if(tx_check_limits(gobj) < 0) {
+        // Disconnected, error already logged
+        KW_DECREF(kw)
+        return -1;
+    }
+    tx_check_watermarks(gobj);
+    tx_flush(gobj);
 
     KW_DECREF(kw)
     return 0;
@@ -785,9 +2026,7 @@ PRIVATE int ac_drop(hgobj gobj, gobj_event_t event, json_t *kw, hgobj src)
 {
     PRIVATE_DATA *priv = gobj_priv_data(gobj);
 
-    if (!gobj_read_bool_attr(gobj, "__clisrv__")) {
-        // TODO ???
-    } else {
+    if(priv->yev_client_connect) {
         yev_stop_event(priv->yev_client_connect);
     }
     set_disconnected(gobj, "drop");
@@ -858,12 +2097,13 @@ PRIVATE int create_gclass(gclass_name_t gclass_name)
         {0,0,0}
     };
     ev_action_t st_wait_connected[] = {
-        {EV_TIMEOUT,            ac_timeout_wait_connected,  0},
         {EV_DROP,               ac_drop,                    0},
+        {EV_TIMEOUT,            ac_timeout_handshake,       0},
         {0,0,0}
     };
     ev_action_t st_connected[] = {
         {EV_TX_DATA,            ac_tx_data,                 0},
+        {EV_TX_FILE,            ac_tx_file,                 0},
         {EV_DROP,               ac_drop,                    0},
         {0,0,0}
     };
@@ -887,7 +2127,10 @@ PRIVATE int create_gclass(gclass_name_t gclass_name)
     event_type_t event_types[] = {
         {EV_RX_DATA,        EVF_OUTPUT_EVENT},
         {EV_TX_DATA,        0},
+        {EV_TX_FILE,        0},
         {EV_TX_READY,       EVF_OUTPUT_EVENT},
+        {EV_TX_FULL,        EVF_OUTPUT_EVENT},
+        {EV_TX_RESUME,      EVF_OUTPUT_EVENT},
         {EV_DROP,           0},
         {EV_CONNECTED,      EVF_OUTPUT_EVENT},
         {EV_DISCONNECTED,   EVF_OUTPUT_EVENT},
@@ -909,13 +2152,18 @@ PRIVATE int create_gclass(gclass_name_t gclass_name)
         0,  // authz_table,
         0,  // command_table,
         s_user_trace_level,
-        gcflag_manual_start // gclass_flag TODO is needed?
+        gcflag_manual_start|gcflag_native_attrs // gclass_flag TODO is needed?
     );
     if(!__gclass__) {
         // Error already logged
         return -1;
     }
 
+    h_rxMsgs = gclass_attr_handle(__gclass__, "rxMsgs");
+    h_rxBytes = gclass_attr_handle(__gclass__, "rxBytes");
+    h_txMsgs = gclass_attr_handle(__gclass__, "txMsgs");
+    h_txBytes = gclass_attr_handle(__gclass__, "txBytes");
+
     return 0;
 }
 
@@ -927,51 +2175,36 @@ PUBLIC int register_c_linux_transport(void)
     return create_gclass(C_LINUX_TRANSPORT);
 }
 
-/*----------------------------------------------------------------------*
- *      New client of server connected.
- *      Called from TODO on_connection_cb() of c_tcp_s0.c
- *      If return -1 the clisrv gobj is destroyed by c_tcp_s0
- *----------------------------------------------------------------------*/
+/***************************************************************************
+ *  New client of server connected: the socket accepted is given to the clisrv.
+ *  The clisrv gobjs are reused: a disconnected clisrv can accept
+ *  when its events of the previous connection are back.
+ *  If return -1 the socket is not taken.
+ ***************************************************************************/
 PUBLIC int accept_connection(
     hgobj clisrv,
-    void *uv_server_socket)
-{
-//    PRIVATE_DATA *priv = gobj_priv_data(clisrv);
-
-    if(!gobj_is_running(clisrv)) {
-//       if(gobj_trace_level(clisrv) & TRACE_UV) {
-//            trace_msg(">>> tcp not_accept p=%p", &priv->uv_socket);
-//        }
-//        uv_not_accept((uv_stream_t *)uv_server_socket);
-//        log_error(0,
-//            "gobj",         "%s", gobj_full_name(clisrv),
-//            "function",     "%s", __FUNCTION__,
-//            "msgset",       "%s", MSGSET_OPERATIONAL_ERROR,
-//            "msg",          "%s", "TCP Gobj must be RUNNING",
-//            NULL
-//        );
+    int fd
+) {
+    PRIVATE_DATA *priv = gobj_priv_data(clisrv);
+
+    if(!gobj_is_running(clisrv) || !gobj_read_bool_attr(clisrv, "__clisrv__")) {
+        return -1;
+    }
+    if(gobj_current_state(clisrv) != ST_DISCONNECTED || priv->fd_clisrv >= 0) {
+        return -1;
+    }
+    if((priv->yev_client_rx && yev_event_in_ring(priv->yev_client_rx)) ||
+            (priv->yev_client_tx && yev_event_in_ring(priv->yev_client_tx)) ||
+            (priv->yev_client_tx_file && yev_event_in_ring(priv->yev_client_tx_file)) ||
+            (priv->yev_tls_poll && yev_event_in_ring(priv->yev_tls_poll)) ||
+            priv->yev_client_tx_zc) {
+        // Busy yet with the previous connection
         return -1;
     }
 
-    /*-------------------------------------*
-     *      Accept connection
-     *-------------------------------------*/
-    if(gobj_trace_level(clisrv) & TRACE_UV) {
-        // trace_msg(">>> tcp accept p=%p", &priv->uv_socket);
-    }
-//   int err = uv_accept((uv_stream_t *)uv_server_socket, (uv_stream_t*)&priv->uv_socket);
-//    if (err != 0) {
-//        log_error(0,
-//            "gobj",         "%s", gobj_full_name(clisrv),
-//            "function",     "%s", __FUNCTION__,
-//            "msgset",       "%s", MSGSET_LIBUV_ERROR,
-//            "msg",          "%s", "uv_accept FAILED",
-//            "uv_error",     "%s", uv_err_name(err),
-//            NULL
-//        );
-//        return -1;
-//    }
-//    set_connected(clisrv);
+    gobj_reset_volatil_attrs(clisrv);
+    priv->fd_clisrv = fd;
+    set_connected(clisrv, fd);
 
     return 0;
 }
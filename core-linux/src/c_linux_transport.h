@@ -37,6 +37,15 @@ GOBJ_DECLARE_GCLASS(C_LINUX_TRANSPORT);
  ***************************************************************/
 PUBLIC int register_c_linux_transport(void);
 
+/*
+ *  Give the socket accepted by a server to a clisrv (__clisrv__) transport.
+ *  Return -1 if the clisrv is busy (running a connection) and the socket is not taken.
+ */
+PUBLIC int accept_connection(
+    hgobj clisrv,
+    int fd
+);
+
 #ifdef __cplusplus
 }
 #endif
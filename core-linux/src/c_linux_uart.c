@@ -528,6 +528,7 @@ PRIVATE void set_connected(hgobj gobj, int fd)
     PRIVATE_DATA *priv = gobj_priv_data(gobj);
 
     priv->tty_fd = fd;
+    yev_register_fd(yuno_event_loop(), fd); // The tty i/o will use the fixed file
 
     /*
      *  Info of "connected"
@@ -558,7 +559,7 @@ PRIVATE void set_connected(hgobj gobj, int fd)
             yev_tty_callback,
             gobj,
             fd,
-            gbuffer_create(rx_buffer_size, rx_buffer_size)
+            yev_gbuffer_create(yuno_event_loop(), (size_t)rx_buffer_size, (size_t)rx_buffer_size)
         );
     }
 
@@ -567,7 +568,10 @@ PRIVATE void set_connected(hgobj gobj, int fd)
     }
     if(!priv->yev_client_rx->gbuf) {
         json_int_t rx_buffer_size = gobj_read_integer_attr(gobj, "rx_buffer_size");
-        yev_set_gbuffer(priv->yev_client_rx, gbuffer_create(rx_buffer_size, rx_buffer_size));
+        yev_set_gbuffer(
+            priv->yev_client_rx,
+            yev_gbuffer_create(yuno_event_loop(), (size_t)rx_buffer_size, (size_t)rx_buffer_size)
+        );
     } else {
         gbuffer_clear(priv->yev_client_rx->gbuf);
     }
@@ -633,7 +637,7 @@ PRIVATE void set_disconnected(hgobj gobj, const char *cause)
             );
         }
 
-        close(priv->tty_fd);
+        yev_close_fd(yuno_event_loop(), priv->tty_fd);
         priv->tty_fd = -1;
     }
 
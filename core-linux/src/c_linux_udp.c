@@ -0,0 +1,927 @@
+/****************************************************************************
+ *          c_linux_udp.c
+ *
+ *          GClass Udp: datagrams with peer address
+ *          Low level linux
+ *
+ *          Each received datagram is published in EV_RX_DATA with its source "peername".
+ *          EV_TX_DATA sends the gbuffer as a datagram to the kw "peername"
+ *          or to the default peer_url.
+ *          The peers are numeric ip and port, the names are not resolved:
+ *          it would block the loop.
+ *
+ *          Copyright (c) 2024 Niyamaka.
+ *          All Rights Reserved.
+ ****************************************************************************/
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <parse_url.h>
+#include <kwid.h>
+#include "c_linux_yuno.h"
+#include "yunetas_ev_loop.h"
+#include "c_linux_udp.h"
+
+/***************************************************************
+ *              Constants
+ ***************************************************************/
+
+/***************************************************************
+ *              Structures
+ ***************************************************************/
+
+/***************************************************************
+ *              Prototypes
+ ***************************************************************/
+PRIVATE int open_socket(hgobj gobj);
+PRIVATE void close_socket(hgobj gobj);
+PRIVATE int resolve_peer(
+    hgobj gobj,
+    const char *peer,
+    struct sockaddr_storage *addr,
+    socklen_t *addrlen
+);
+PRIVATE int yev_udp_callback(yev_event_t *event);
+
+/***************************************************************
+ *              Data
+ ***************************************************************/
+/*---------------------------------------------*
+ *          Attributes
+ *---------------------------------------------*/
+PRIVATE const sdata_desc_t tattr_desc[] = {
+/*-ATTR-type--------name----------------flag------------default-----description---------- */
+SDATA (DTP_STRING,  "url",              SDF_RD,         "udp://0.0.0.0:0", "Local url to bind, numeric ip and port"),
+SDATA (DTP_STRING,  "peer_url",         SDF_WR|SDF_PERSIST, "",     "Default destination of the datagrams without kw peername, numeric ip and port"),
+SDATA (DTP_BOOLEAN, "connected",        SDF_VOLATIL|SDF_STATS, "false", "Socket open"),
+SDATA (DTP_BOOLEAN, "rx_multishot",     SDF_RD,         "true",     "Use multishot recvmsg with the buffers of the yuno's buffer ring if kernel supports it. Datagrams bigger than the ring's buffers are truncated"),
+SDATA (DTP_INTEGER, "rx_buffer_size",   SDF_RD,         "65536",    "Rx buffer size, not used with rx_multishot"),
+SDATA (DTP_INTEGER, "tx_max_in_flight", SDF_WR|SDF_PERSIST, "256",  "Maximum datagrams sending at the same time, the excess are dropped"),
+
+SDATA (DTP_INTEGER, "txBytes",          SDF_VOLATIL|SDF_STATS, "0", "Bytes transmitted"),
+SDATA (DTP_INTEGER, "rxBytes",          SDF_VOLATIL|SDF_STATS, "0", "Bytes received"),
+SDATA (DTP_INTEGER, "txMsgs",           SDF_VOLATIL|SDF_STATS, "0", "Datagrams transmitted"),
+SDATA (DTP_INTEGER, "rxMsgs",           SDF_VOLATIL|SDF_STATS, "0", "Datagrams received"),
+SDATA (DTP_INTEGER, "txInFlight",       SDF_VOLATIL|SDF_STATS, "0", "Datagrams sending"),
+SDATA (DTP_INTEGER, "txDroppedMsgs",    SDF_VOLATIL|SDF_STATS, "0", "Datagrams dropped: tx_max_in_flight reached, peer unknown or send failed"),
+SDATA (DTP_INTEGER, "rxErrors",         SDF_VOLATIL|SDF_STATS, "0", "Receive errors (icmp errors like connection refused)"),
+SDATA (DTP_STRING,  "sockname",         SDF_VOLATIL|SDF_STATS, "",  "Sockname"),
+SDATA (DTP_INTEGER, "subscriber",       0,              0,          "subscriber of output-events. Default if null is parent."),
+
+SDATA_END()
+};
+
+/*---------------------------------------------*
+ *      GClass trace levels
+ *  HACK strict ascendant value!
+ *  required paired correlative strings
+ *  in s_user_trace_level
+ *---------------------------------------------*/
+enum {
+    TRACE_CONNECT_DISCONNECT    = 0x0001,
+    TRACE_TRAFFIC               = 0x0002,
+};
+PRIVATE const trace_level_t s_user_trace_level[16] = {
+{"connections",         "Trace open and close of the socket"},
+{"traffic",             "Trace dump traffic"},
+{0, 0},
+};
+
+/*---------------------------------------------*
+ *              Private data
+ *---------------------------------------------*/
+typedef struct _PRIVATE_DATA {
+    int fd;
+    yev_event_t *yev_rx;
+
+    /*
+     *  Tx: a sendmsg event per datagram in flight, all submitted together in the loop iteration.
+     *  The free events are reused.
+     */
+    yev_event_t **tx_free;              // stack of free sendmsg events
+    unsigned tx_free_len;
+    unsigned tx_free_max;
+    unsigned tx_in_flight;
+    json_int_t tx_max_in_flight;
+
+    /*
+     *  Last peer resolved, the peers use to repeat
+     */
+    char last_peer[NI_MAXHOST + NI_MAXSERV + 8];
+    struct sockaddr_storage last_addr;
+    socklen_t last_addrlen;
+    struct sockaddr_storage default_addr;   // of peer_url
+    socklen_t default_addrlen;
+
+    const char *peer_url;
+} PRIVATE_DATA;
+
+PRIVATE hgclass __gclass__ = 0;
+
+
+
+
+
+                    /******************************
+                     *      Framework Methods
+                     ******************************/
+
+
+
+
+/***************************************************************************
+ *      Framework Method
+ ***************************************************************************/
+PRIVATE void mt_create(hgobj gobj)
+{
+    PRIVATE_DATA *priv = gobj_priv_data(gobj);
+
+    priv->fd = -1;
+
+    if(!gobj_is_pure_child(gobj)) {
+        /*
+         *  Not pure child, explicitly use subscriber
+         */
+        hgobj subscriber = (hgobj)(size_t)gobj_read_integer_attr(gobj, "subscriber");
+        if(subscriber) {
+            gobj_subscribe_event(gobj, NULL, NULL, subscriber);
+        }
+    }
+
+    SET_PRIV(tx_max_in_flight,      gobj_read_integer_attr)
+    SET_PRIV(peer_url,              gobj_read_str_attr)
+}
+
+/***************************************************************************
+ *      Framework Method writing
+ ***************************************************************************/
+PRIVATE void mt_writing(hgobj gobj, const char *path)
+{
+    PRIVATE_DATA *priv = gobj_priv_data(gobj);
+
+    IF_EQ_SET_PRIV(tx_max_in_flight,    gobj_read_integer_attr)
+    ELIF_EQ_SET_PRIV(peer_url,          gobj_read_str_attr)
+        priv->default_addrlen = 0;
+        if(!empty_string(priv->peer_url)) {
+            resolve_peer(gobj, priv->peer_url, &priv->default_addr, &priv->default_addrlen);
+        }
+    END_EQ_SET_PRIV()
+}
+
+/***************************************************************************
+ *      Framework Method
+ ***************************************************************************/
+PRIVATE int mt_start(hgobj gobj)
+{
+    PRIVATE_DATA *priv = gobj_priv_data(gobj);
+
+    gobj_state_t state = gobj_current_state(gobj);
+    if(state != ST_STOPPED) {
+        gobj_log_error(gobj, 0,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_INTERNAL_ERROR,
+            "msg",          "%s", "Initial wrong task state",
+            "state",        "%s", gobj_current_state(gobj),
+            NULL
+        );
+        return -1;
+    }
+
+    gobj_reset_volatil_attrs(gobj);
+
+    priv->default_addrlen = 0;
+    if(!empty_string(priv->peer_url)) {
+        if(resolve_peer(gobj, priv->peer_url, &priv->default_addr, &priv->default_addrlen) < 0) {
+            // Error already logged
+            return -1;
+        }
+    }
+
+    if(open_socket(gobj) < 0) {
+        // Error already logged
+        return -1;
+    }
+
+    /*
+     *  Ready to receive
+     */
+    if(!priv->yev_rx) {
+        if(gobj_read_bool_attr(gobj, "rx_multishot") &&
+                yev_recv_multishot_available(yuno_event_loop())) {
+            /*
+             *  Without own buffer, the datagrams are received in the loop's buffer ring
+             */
+            priv->yev_rx = yev_create_recvmsg_multishot_event(
+                yuno_event_loop(),
+                yev_udp_callback,
+                gobj,
+                priv->fd
+            );
+        } else {
+            json_int_t rx_buffer_size = gobj_read_integer_attr(gobj, "rx_buffer_size");
+            priv->yev_rx = yev_create_recvmsg_event(
+                yuno_event_loop(),
+                yev_udp_callback,
+                gobj,
+                priv->fd,
+                gbuffer_create(rx_buffer_size, rx_buffer_size)
+            );
+        }
+    }
+    if(!priv->yev_rx) {
+        // Error already logged
+        close_socket(gobj);
+        return -1;
+    }
+    yev_set_fd(priv->yev_rx, priv->fd);
+    if(priv->yev_rx->type == YEV_RECVMSG_TYPE) {
+        if(!priv->yev_rx->gbuf) {
+            json_int_t rx_buffer_size = gobj_read_integer_attr(gobj, "rx_buffer_size");
+            yev_set_gbuffer(priv->yev_rx, gbuffer_create(rx_buffer_size, rx_buffer_size));
+        } else {
+            gbuffer_clear(priv->yev_rx->gbuf);
+        }
+    }
+    yev_start_event(priv->yev_rx);
+
+    gobj_change_state(gobj, ST_CONNECTED);
+
+    return 0;
+}
+
+/***************************************************************************
+ *      Framework Method
+ ***************************************************************************/
+PRIVATE int mt_stop(hgobj gobj)
+{
+    PRIVATE_DATA *priv = gobj_priv_data(gobj);
+
+    if(priv->yev_rx) {
+        yev_stop_event(priv->yev_rx);
+    }
+
+    /*
+     *  The sendmsg events in flight return to the free stack when they complete
+     */
+    close_socket(gobj);
+
+    if((priv->yev_rx && yev_event_in_ring(priv->yev_rx)) || priv->tx_in_flight > 0) {
+        gobj_change_state(gobj, ST_WAIT_STOPPED);
+    } else {
+        gobj_change_state(gobj, ST_STOPPED);
+    }
+
+    return 0;
+}
+
+/***************************************************************************
+ *      Framework Method destroy
+ ***************************************************************************/
+PRIVATE void mt_destroy(hgobj gobj)
+{
+    PRIVATE_DATA *priv = gobj_priv_data(gobj);
+
+    EXEC_AND_RESET(yev_destroy_event, priv->yev_rx);
+    for(unsigned i=0; i<priv->tx_free_len; i++) {
+        yev_destroy_event(priv->tx_free[i]);
+    }
+    priv->tx_free_len = 0;
+    GBMEM_FREE(priv->tx_free)
+    close_socket(gobj);
+}
+
+
+
+
+                    /***************************
+                     *      Local methods
+                     ***************************/
+
+
+
+
+/***************************************************************************
+ *  Open the udp socket bound to the url
+ ***************************************************************************/
+PRIVATE int open_socket(hgobj gobj)
+{
+    PRIVATE_DATA *priv = gobj_priv_data(gobj);
+
+    const char *url = gobj_read_str_attr(gobj, "url");
+    struct sockaddr_storage addr;
+    socklen_t addrlen;
+    if(resolve_peer(gobj, url, &addr, &addrlen) < 0) {
+        // Error already logged
+        return -1;
+    }
+
+    int fd = socket(addr.ss_family, SOCK_DGRAM|SOCK_CLOEXEC, IPPROTO_UDP);
+    if(fd < 0) {
+        gobj_log_error(gobj, 0,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_SYSTEM_ERROR,
+            "msg",          "%s", "socket() FAILED",
+            "url",          "%s", url,
+            "errno",        "%d", errno,
+            "strerror",     "%s", strerror(errno),
+            NULL
+        );
+        return -1;
+    }
+
+    if(bind(fd, (struct sockaddr *)&addr, addrlen) < 0) {
+        gobj_log_error(gobj, 0,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_SYSTEM_ERROR,
+            "msg",          "%s", "bind() FAILED",
+            "url",          "%s", url,
+            "errno",        "%d", errno,
+            "strerror",     "%s", strerror(errno),
+            NULL
+        );
+        close(fd);
+        return -1;
+    }
+
+    priv->fd = fd;
+
+    char temp[60];
+    get_sockname(temp, sizeof(temp), fd);
+    gobj_write_str_attr(gobj, "sockname", temp);
+    gobj_write_bool_attr(gobj, "connected", TRUE);
+
+    if(gobj_trace_level(gobj) & TRACE_CONNECT_DISCONNECT) {
+        gobj_log_info(gobj, 0,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_CONNECT_DISCONNECT,
+            "msg",          "%s", "Udp open",
+            "msg2",         "%s", "Udp open🔵",
+            "url",          "%s", url,
+            "local-addr",   "%s", gobj_read_str_attr(gobj, "sockname"),
+            "fd",           "%d", fd,
+            NULL
+        );
+    }
+
+    return 0;
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PRIVATE void close_socket(hgobj gobj)
+{
+    PRIVATE_DATA *priv = gobj_priv_data(gobj);
+
+    if(priv->fd < 0) {
+        return;
+    }
+
+    if(gobj_trace_level(gobj) & TRACE_CONNECT_DISCONNECT) {
+        gobj_log_info(gobj, 0,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_CONNECT_DISCONNECT,
+            "msg",          "%s", "Udp close",
+            "msg2",         "%s", "Udp close🔴",
+            "url",          "%s", gobj_read_str_attr(gobj, "url"),
+            "local-addr",   "%s", gobj_read_str_attr(gobj, "sockname"),
+            "fd",           "%d", priv->fd,
+            NULL
+        );
+    }
+
+    if(priv->yev_rx) {
+        yev_set_fd(priv->yev_rx, -1);
+    }
+    yev_close_fd(yuno_event_loop(), priv->fd);
+    priv->fd = -1;
+
+    gobj_write_bool_attr(gobj, "connected", FALSE);
+    gobj_write_str_attr(gobj, "sockname", "");
+}
+
+/***************************************************************************
+ *  Resolve a peer, "udp://ip:port" or "ip:port" (the peername of EV_RX_DATA),
+ *  the last one is cached: the same peers use to repeat.
+ *  Only numeric ips and ports: the names are rejected,
+ *  getaddrinfo() would block the loop in each datagram to a new peer.
+ ***************************************************************************/
+PRIVATE int resolve_peer(
+    hgobj gobj,
+    const char *peer,
+    struct sockaddr_storage *addr,
+    socklen_t *addrlen
+) {
+    PRIVATE_DATA *priv = gobj_priv_data(gobj);
+
+    if(priv->last_addrlen > 0 && strcmp(peer, priv->last_peer)==0) {
+        memcpy(addr, &priv->last_addr, priv->last_addrlen);
+        *addrlen = priv->last_addrlen;
+        return 0;
+    }
+
+    char host[NI_MAXHOST];
+    char port[NI_MAXSERV];
+
+    if(strstr(peer, "://")) {
+        if(parse_url(
+            gobj,
+            peer,
+            0, 0,
+            host, sizeof(host),
+            port, sizeof(port),
+            0, 0,
+            0, 0,
+            FALSE
+        )<0) {
+            // Error already logged
+            return -1;
+        }
+    } else {
+        /*
+         *  "ip:port", the ip6 has colons too, the port is after the last one
+         */
+        const char *colon = strrchr(peer, ':');
+        if(!colon || (size_t)(colon - peer) >= sizeof(host)) {
+            gobj_log_error(gobj, 0,
+                "function",     "%s", __FUNCTION__,
+                "msgset",       "%s", MSGSET_PARAMETER_ERROR,
+                "msg",          "%s", "Bad peer, must be ip:port",
+                "peer",         "%s", peer,
+                NULL
+            );
+            return -1;
+        }
+        snprintf(host, sizeof(host), "%.*s", (int)(colon - peer), peer);
+        snprintf(port, sizeof(port), "%s", colon + 1);
+    }
+
+    struct addrinfo hints = {
+        .ai_family = AF_UNSPEC,
+        .ai_socktype = SOCK_DGRAM,
+        .ai_protocol = IPPROTO_UDP,
+        .ai_flags = AI_NUMERICHOST|AI_NUMERICSERV,
+    };
+    struct addrinfo *results;
+    int ret = getaddrinfo(host, port, &hints, &results);
+    if(ret != 0) {
+        gobj_log_error(gobj, 0,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_PARAMETER_ERROR,
+            "msg",          "%s", ret == EAI_NONAME?
+                "Peer must be a numeric ip and port, names are not resolved" :
+                "getaddrinfo() FAILED",
+            "peer",         "%s", peer,
+            "error",        "%s", gai_strerror(ret),
+            NULL
+        );
+        return -1;
+    }
+    memcpy(addr, results->ai_addr, results->ai_addrlen);
+    *addrlen = (socklen_t)results->ai_addrlen;
+    freeaddrinfo(results);
+
+    snprintf(priv->last_peer, sizeof(priv->last_peer), "%s", peer);
+    memcpy(&priv->last_addr, addr, *addrlen);
+    priv->last_addrlen = *addrlen;
+
+    return 0;
+}
+
+/***************************************************************************
+ *  Get a free sendmsg event, NULL if tx_max_in_flight is reached
+ ***************************************************************************/
+PRIVATE yev_event_t *tx_get_event(hgobj gobj)
+{
+    PRIVATE_DATA *priv = gobj_priv_data(gobj);
+
+    if(priv->tx_max_in_flight > 0 && (json_int_t)priv->tx_in_flight >= priv->tx_max_in_flight) {
+        return NULL;
+    }
+    if(priv->tx_free_len > 0) {
+        return priv->tx_free[--priv->tx_free_len];
+    }
+    return yev_create_sendmsg_event(
+        yuno_event_loop(),
+        yev_udp_callback,
+        gobj,
+        priv->fd,
+        NULL
+    );
+}
+
+/***************************************************************************
+ *  Return the sendmsg event to the free stack
+ ***************************************************************************/
+PRIVATE void tx_put_event(hgobj gobj, yev_event_t *yev_event)
+{
+    PRIVATE_DATA *priv = gobj_priv_data(gobj);
+
+    GBUFFER_DECREF(yev_event->gbuf)
+
+    if(priv->tx_free_len >= priv->tx_free_max) {
+        unsigned new_max = priv->tx_free_max? priv->tx_free_max*2 : 16;
+        yev_event_t **tx_free = GBMEM_MALLOC(new_max * sizeof(yev_event_t *));
+        if(!tx_free) {
+            gobj_log_critical(gobj, 0,
+                "function",     "%s", __FUNCTION__,
+                "msgset",       "%s", MSGSET_MEMORY_ERROR,
+                "msg",          "%s", "No memory to tx events",
+                "size",         "%d", (int)new_max,
+                NULL
+            );
+            yev_destroy_event(yev_event);
+            return;
+        }
+        if(priv->tx_free_len > 0) {
+            memcpy(tx_free, priv->tx_free, priv->tx_free_len * sizeof(yev_event_t *));
+        }
+        GBMEM_FREE(priv->tx_free)
+        priv->tx_free = tx_free;
+        priv->tx_free_max = new_max;
+    }
+    priv->tx_free[priv->tx_free_len++] = yev_event;
+}
+
+/***************************************************************************
+ *  All the events back, the gobj is stopped
+ ***************************************************************************/
+PRIVATE void check_stopped(hgobj gobj)
+{
+    PRIVATE_DATA *priv = gobj_priv_data(gobj);
+
+    if(gobj_current_state(gobj) != ST_WAIT_STOPPED) {
+        return;
+    }
+    if((priv->yev_rx && yev_event_in_ring(priv->yev_rx)) || priv->tx_in_flight > 0) {
+        return;
+    }
+    gobj_change_state(gobj, ST_STOPPED);
+
+    if(gobj_is_pure_child(gobj)) {
+        if(gobj_has_input_event(gobj_parent(gobj), EV_STOPPED)) {
+            gobj_send_event(gobj_parent(gobj), EV_STOPPED, 0, gobj);
+        }
+    } else {
+        gobj_publish_event(gobj, EV_STOPPED, 0);
+    }
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PRIVATE int yev_udp_callback(yev_event_t *yev_event)
+{
+    hgobj gobj = yev_event->gobj;
+    PRIVATE_DATA *priv = gobj_priv_data(gobj);
+
+    if(gobj_trace_level(gobj) & TRACE_UV) {
+        json_t *jn_flags = bits2jn_strlist(yev_flag_strings(), yev_event->flag);
+        gobj_log_info(gobj, 0,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_YEV_LOOP,
+            "msg",          "%s", "yev callback",
+            "msg2",         "%s", "💥 yev callback",
+            "event type",   "%s", yev_event_type_name(yev_event),
+            "result",       "%d", yev_event->result,
+            "sres",         "%s", (yev_event->result<0)? strerror(-yev_event->result):"",
+            "flag",         "%j", jn_flags,
+            "p",            "%p", yev_event,
+            NULL
+        );
+        json_decref(jn_flags);
+    }
+
+    switch(yev_event->type) {
+        case YEV_RECVMSG_TYPE:
+        case YEV_RECVMSG_MULTISHOT_TYPE:
+            {
+                if(yev_event->result < 0) {
+                    if(yev_event->result == -ECANCELED || !gobj_is_running(gobj)) {
+                        check_stopped(gobj);
+                        break;
+                    }
+
+                    /*
+                     *  Errors of datagram sockets (icmp) don't close the socket, go on receiving
+                     */
+                    INCR_ATTR_INTEGER(rxErrors)
+                    if(gobj_trace_level(gobj) & TRACE_UV) {
+                        gobj_log_info(gobj, 0,
+                            "function",     "%s", __FUNCTION__,
+                            "msgset",       "%s", MSGSET_CONNECT_DISCONNECT,
+                            "msg",          "%s", "recvmsg FAILED",
+                            "local-addr",   "%s", gobj_read_str_attr(gobj, "sockname"),
+                            "errno",        "%d", -yev_event->result,
+                            "strerror",     "%s", strerror(-yev_event->result),
+                            "p",            "%p", yev_event,
+                            NULL
+                        );
+                    }
+                    if(!yev_event_in_ring(yev_event) && priv->fd >= 0) {
+                        if(yev_event->type == YEV_RECVMSG_TYPE) {
+                            gbuffer_clear(yev_event->gbuf);
+                        }
+                        yev_start_event(yev_event);
+                    }
+                    break;
+                }
+
+                socklen_t addrlen;
+                char peername[NI_MAXHOST + NI_MAXSERV + 8];
+                get_sockaddr_name(peername, sizeof(peername), yev_get_peer(yev_event, &addrlen));
+
+                if(gobj_trace_level(gobj) & TRACE_TRAFFIC) {
+                    gobj_trace_dump_gbuf(gobj, yev_event->gbuf, "%s: %s%s%s",
+                        gobj_short_name(gobj),
+                        gobj_read_str_attr(gobj, "sockname"),
+                        " <- ",
+                        peername
+                    );
+                }
+
+                INCR_ATTR_INTEGER(rxMsgs)
+                INCR_ATTR_INTEGER2(rxBytes, gbuffer_leftbytes(yev_event->gbuf))
+
+                /*
+                 *  The single shot recvmsg gives its gbuffer and gets a new one,
+                 *  the multishot gbuffer is a buffer of the ring, released by the loop after the callback
+                 */
+                gbuffer_t *gbuf = yev_event->gbuf;
+                if(yev_event->type == YEV_RECVMSG_TYPE) {
+                    json_int_t rx_buffer_size = gobj_read_integer_attr(gobj, "rx_buffer_size");
+                    yev_event->gbuf = gbuffer_create(rx_buffer_size, rx_buffer_size);
+                } else {
+                    GBUFFER_INCREF(gbuf)
+                }
+                json_t *kw = json_pack("{s:I, s:s}",
+                    "gbuffer", (json_int_t)(size_t)gbuf,
+                    "peername", peername
+                );
+                if(gobj_is_pure_child(gobj)) {
+                    gobj_send_event(gobj_parent(gobj), EV_RX_DATA, kw, gobj);
+                } else {
+                    gobj_publish_event(gobj, EV_RX_DATA, kw);
+                }
+
+                /*
+                 *  Re-arm recvmsg, the multishot keeps armed
+                 */
+                if(yev_event->type == YEV_RECVMSG_TYPE && yev_event->gbuf && priv->fd >= 0 &&
+                        gobj_is_running(gobj)) {
+                    yev_start_event(yev_event);
+                }
+            }
+            break;
+
+        case YEV_SENDMSG_TYPE:
+            {
+                priv->tx_in_flight--;
+                gobj_write_integer_attr(gobj, "txInFlight", (json_int_t)priv->tx_in_flight);
+
+                if(yev_event->result < 0) {
+                    if(yev_event->result != -ECANCELED) {
+                        INCR_ATTR_INTEGER(txDroppedMsgs)
+                        if(gobj_trace_level(gobj) & TRACE_UV) {
+                            gobj_log_info(gobj, 0,
+                                "function",     "%s", __FUNCTION__,
+                                "msgset",       "%s", MSGSET_CONNECT_DISCONNECT,
+                                "msg",          "%s", "sendmsg FAILED",
+                                "local-addr",   "%s", gobj_read_str_attr(gobj, "sockname"),
+                                "errno",        "%d", -yev_event->result,
+                                "strerror",     "%s", strerror(-yev_event->result),
+                                "p",            "%p", yev_event,
+                                NULL
+                            );
+                        }
+                    }
+                }
+                tx_put_event(gobj, yev_event);
+                check_stopped(gobj);
+            }
+            break;
+
+        default:
+            gobj_log_error(gobj, LOG_OPT_TRACE_STACK,
+                "function",     "%s", __FUNCTION__,
+                "msgset",       "%s", MSGSET_SYSTEM_ERROR,
+                "msg",          "%s", "event type NOT IMPLEMENTED",
+                "local-addr",   "%s", gobj_read_str_attr(gobj, "sockname"),
+                "event_type",   "%s", yev_event_type_name(yev_event),
+                "p",            "%p", yev_event,
+                NULL
+            );
+            break;
+    }
+
+    return gobj_is_running(gobj)?0:-1;
+}
+
+
+
+
+                    /***************************
+                     *      Actions
+                     ***************************/
+
+
+
+
+/***************************************************************************
+ *  Send a datagram to kw "peername" (ip:port or url) or to peer_url
+ ***************************************************************************/
+PRIVATE int ac_tx_data(hgobj gobj, gobj_event_t event, json_t *kw, hgobj src)
+{
+    PRIVATE_DATA *priv = gobj_priv_data(gobj);
+
+    gbuffer_t *gbuf = (gbuffer_t *)(size_t)kw_get_int(gobj, kw, "gbuffer", 0, KW_REQUIRED|KW_EXTRACT);
+    if(!gbuf) {
+        gobj_log_error(gobj, LOG_OPT_TRACE_STACK,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_INTERNAL_ERROR,
+            "msg",          "%s", "gbuffer NULL",
+            NULL
+        );
+        KW_DECREF(kw)
+        return -1;
+    }
+
+    struct sockaddr_storage addr;
+    socklen_t addrlen = 0;
+    const char *peername = kw_get_str(gobj, kw, "peername", "", 0);
+    if(!empty_string(peername)) {
+        resolve_peer(gobj, peername, &addr, &addrlen);
+    } else if(priv->default_addrlen > 0) {
+        memcpy(&addr, &priv->default_addr, priv->default_addrlen);
+        addrlen = priv->default_addrlen;
+    }
+    if(addrlen == 0) {
+        gobj_log_error(gobj, 0,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_PARAMETER_ERROR,
+            "msg",          "%s", "Datagram without peer, dropped",
+            "peername",     "%s", peername,
+            NULL
+        );
+        INCR_ATTR_INTEGER(txDroppedMsgs)
+        GBUFFER_DECREF(gbuf)
+        KW_DECREF(kw)
+        return -1;
+    }
+
+    yev_event_t *yev_tx = tx_get_event(gobj);
+    if(!yev_tx) {
+        /*
+         *  Udp without flow control: drop it, like the kernel with the socket buffer full
+         */
+        INCR_ATTR_INTEGER(txDroppedMsgs)
+        GBUFFER_DECREF(gbuf)
+        KW_DECREF(kw)
+        return -1;
+    }
+
+    if(gobj_trace_level(gobj) & TRACE_TRAFFIC) {
+        char peer[NI_MAXHOST + NI_MAXSERV + 8];
+        get_sockaddr_name(peer, sizeof(peer), (struct sockaddr *)&addr);
+        gobj_trace_dump_gbuf(gobj, gbuf, "%s: %s%s%s",
+            gobj_short_name(gobj),
+            gobj_read_str_attr(gobj, "sockname"),
+            " -> ",
+            peer
+        );
+    }
+
+    INCR_ATTR_INTEGER(txMsgs)
+    INCR_ATTR_INTEGER2(txBytes, gbuffer_leftbytes(gbuf))
+
+    /*
+     *  The sendmsg sqes of the datagrams sent in this loop iteration go to kernel in one submit
+     */
+    yev_set_fd(yev_tx, priv->fd);
+    yev_set_gbuffer(yev_tx, gbuf);
+    yev_set_peer(yev_tx, (struct sockaddr *)&addr, addrlen);
+    if(yev_start_event(yev_tx) < 0) {
+        // Error already logged
+        INCR_ATTR_INTEGER(txDroppedMsgs)
+        tx_put_event(gobj, yev_tx);
+        KW_DECREF(kw)
+        return -1;
+    }
+    priv->tx_in_flight++;
+    gobj_write_integer_attr(gobj, "txInFlight", (json_int_t)priv->tx_in_flight);
+
+    KW_DECREF(kw)
+    return 0;
+}
+
+
+
+
+                    /***************************
+                     *          FSM
+                     ***************************/
+
+
+
+
+/*---------------------------------------------*
+ *          Global methods table
+ *---------------------------------------------*/
+PRIVATE const GMETHODS gmt = {
+    .mt_create = mt_create,
+    .mt_writing = mt_writing,
+    .mt_destroy = mt_destroy,
+    .mt_start = mt_start,
+    .mt_stop = mt_stop,
+};
+
+/*------------------------*
+ *      GClass name
+ *------------------------*/
+GOBJ_DEFINE_GCLASS(C_LINUX_UDP);
+
+/*------------------------*
+ *      States
+ *------------------------*/
+
+/*------------------------*
+ *      Events
+ *------------------------*/
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PRIVATE int create_gclass(gclass_name_t gclass_name)
+{
+    if(__gclass__) {
+        gobj_log_error(0, 0,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_INTERNAL_ERROR,
+            "msg",          "%s", "GClass ALREADY created",
+            "gclass",       "%s", gclass_name,
+            NULL
+        );
+        return -1;
+    }
+
+    /*----------------------------------------*
+     *          Define States
+     *----------------------------------------*/
+    ev_action_t st_stopped[] = {
+        {0,0,0}
+    };
+    ev_action_t st_connected[] = {
+        {EV_TX_DATA,            ac_tx_data,                 0},
+        {0,0,0}
+    };
+    ev_action_t st_wait_stopped[] = {
+        {0,0,0}
+    };
+
+    states_t states[] = {
+        {ST_STOPPED,            st_stopped},
+        {ST_CONNECTED,          st_connected},
+        {ST_WAIT_STOPPED,       st_wait_stopped},
+        {0, 0}
+    };
+
+    event_type_t event_types[] = {
+        {EV_RX_DATA,        EVF_OUTPUT_EVENT},
+        {EV_TX_DATA,        0},
+        {EV_STOPPED,        EVF_OUTPUT_EVENT},
+        {0, 0}
+    };
+
+    /*----------------------------------------*
+     *          Create the gclass
+     *----------------------------------------*/
+    __gclass__ = gclass_create(
+        gclass_name,
+        event_types,
+        states,
+        &gmt,
+        0,  // lmt,
+        tattr_desc,
+        sizeof(PRIVATE_DATA),
+        0,  // authz_table,
+        0,  // command_table,
+        s_user_trace_level,
+        gcflag_manual_start // gclass_flag
+    );
+    if(!__gclass__) {
+        // Error already logged
+        return -1;
+    }
+
+    return 0;
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PUBLIC int register_c_linux_udp(void)
+{
+    return create_gclass(C_LINUX_UDP);
+}
@@ -0,0 +1,42 @@
+/****************************************************************************
+ *          c_linux_udp.h
+ *
+ *          GClass Udp: datagrams with peer address
+ *          Low level linux
+ *
+ *          Copyright (c) 2024 Niyamaka.
+ *          All Rights Reserved.
+ ****************************************************************************/
+#pragma once
+
+#include <gobj.h>
+#include <kwid.h>
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+/***************************************************************
+ *              FSM
+ ***************************************************************/
+/*------------------------*
+ *      GClass name
+ *------------------------*/
+GOBJ_DECLARE_GCLASS(C_LINUX_UDP);
+
+/*------------------------*
+ *      States
+ *------------------------*/
+
+/*------------------------*
+ *      Events
+ *------------------------*/
+
+/***************************************************************
+ *              Prototypes
+ ***************************************************************/
+PUBLIC int register_c_linux_udp(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -16,9 +16,12 @@
 #include <stdlib.h>
 #include <string.h>
 #include <limits.h>
+#include <pthread.h>
+#include <semaphore.h>
 #include <gobj_environment.h>
 #include <kwid.h>
 #include <command_parser.h>
+#include <stats_parser.h>
 #include <log_udp_handler.h>
 #include "yunetas_ev_loop.h"
 #include "yunetas_environment.h"
@@ -41,6 +44,10 @@ PRIVATE int set_user_gclass_no_traces(hgobj gobj);
 PRIVATE int set_user_trace_filter(hgobj gobj);
 PRIVATE int set_user_gobj_traces(hgobj gobj);
 PRIVATE int set_user_gobj_no_traces(hgobj gobj);
+PRIVATE int create_loops(hgobj gobj, const yev_loop_options_t *loop_options);
+PRIVATE void stop_loops(hgobj gobj);
+PRIVATE void destroy_loops(hgobj gobj);
+PRIVATE void add_loop_root(hgobj gobj, hgobj gobj_created);
 
 PRIVATE json_t *cmd_help(hgobj gobj, const char *cmd, json_t *kw, hgobj src);
 PRIVATE json_t *cmd_view_gclass_register(hgobj gobj, const char *cmd, json_t *kw, hgobj src);
@@ -52,6 +59,7 @@ PRIVATE json_t *cmd_attrs_schema(hgobj gobj, const char *cmd, json_t *kw, hgobj
 PRIVATE json_t *cmd_authzs(hgobj gobj, const char *cmd, json_t *kw, hgobj src);
 PRIVATE json_t *cmd_view_config(hgobj gobj, const char *cmd, json_t *kw, hgobj src);
 PRIVATE json_t *cmd_view_mem(hgobj gobj, const char *cmd, json_t *kw, hgobj src);
+PRIVATE json_t *cmd_view_loop_stats(hgobj gobj, const char *cmd, json_t *kw, hgobj src);
 PRIVATE json_t *cmd_view_gclass(hgobj gobj, const char *cmd, json_t *kw, hgobj src);
 PRIVATE json_t *cmd_view_gobj(hgobj gobj, const char *cmd, json_t *kw, hgobj src);
 PRIVATE json_t *cmd_view_gobj_tree(hgobj gobj, const char *cmd, json_t *kw, hgobj src);
@@ -212,6 +220,11 @@ SDATAPM (DTP_STRING,    "authz",        0,              0,          "permission
 SDATAPM (DTP_STRING,    "service",      0,              0,          "Service where to search the permission. If empty print all service's permissions"),
 SDATA_END()
 };
+PRIVATE const sdata_desc_t pm_loop_stats[] = {
+/*-PM----type-----------name------------flag------------default-----description---------- */
+SDATAPM (DTP_BOOLEAN,   "reset",        0,              0,          "Reset the counters after reading them"),
+SDATA_END()
+};
 PRIVATE const sdata_desc_t pm_help[] = {
 /*-PM----type-----------name------------flag------------default-----description---------- */
 SDATAPM (DTP_STRING,    "cmd",          0,              0,          "command about you want help."),
@@ -260,6 +273,7 @@ SDATACM (DTP_SCHEMA,    "view-attrs-schema",        a_read_attrs2,pm_gobj_def_na
 
 SDATACM (DTP_SCHEMA,    "view-config",              0,      0,          cmd_view_config,            "View final json configuration"),
 SDATACM (DTP_SCHEMA,    "view-mem",                 0,      0,          cmd_view_mem,               "View yuno memory"),
+SDATACM (DTP_SCHEMA,    "view-loop-stats",          0,      pm_loop_stats,cmd_view_loop_stats,      "View event loop stats: syscalls, latency of callbacks, saturation"),
 
 SDATACM (DTP_SCHEMA,    "view-gclass",              0,      pm_gclass_name, cmd_view_gclass,        "View gclass description"),
 SDATACM (DTP_SCHEMA,    "view-gobj",                0,      pm_gobj_def_name, cmd_view_gobj,        "View gobj"),
@@ -358,6 +372,24 @@ SDATA (DTP_INTEGER, "timeout_restart",  SDF_PERSIST,    "0",            "timeout
 SDATA (DTP_INTEGER, "autokill",         SDF_RD,         "0",            "Timeout (>0) to autokill in seconds"),
 
 SDATA (DTP_INTEGER, "io_uring_entries", SDF_RD,         "0",            "Entries for the SQ ring"),
+SDATA (DTP_BOOLEAN, "io_uring_coop_taskrun",SDF_RD,     "0",            "io_uring setup COOP_TASKRUN"),
+SDATA (DTP_BOOLEAN, "io_uring_single_issuer",SDF_RD,    "0",            "io_uring setup SINGLE_ISSUER"),
+SDATA (DTP_BOOLEAN, "io_uring_defer_taskrun",SDF_RD,    "0",            "io_uring setup DEFER_TASKRUN (implies SINGLE_ISSUER), better cache locality in shared hosts"),
+SDATA (DTP_BOOLEAN, "io_uring_sqpoll",  SDF_RD,         "0",            "io_uring setup SQPOLL, a kernel thread polls the SQ, without submission syscalls"),
+SDATA (DTP_INTEGER, "io_uring_sqpoll_cpu",SDF_RD,       "-1",           "Cpu where pin the SQPOLL kernel thread, -1 not pinned"),
+SDATA (DTP_INTEGER, "io_uring_sqpoll_idle",SDF_RD,      "0",            "Miliseconds idle before the SQPOLL kernel thread sleeps, 0 kernel default"),
+SDATA (DTP_BOOLEAN, "io_uring_no_batch",SDF_RD,         "0",            "Submit every sqe when prepared, instead of once per loop iteration"),
+SDATA (DTP_INTEGER, "io_uring_recv_buffers",SDF_RD,     "0",            "Buffers (power of 2) of the buffer ring shared by the multishot recvs, 0 default 256"),
+SDATA (DTP_INTEGER, "io_uring_recv_buffer_size",SDF_RD, "0",            "Size of each buffer of the multishot recv buffer ring, 0 default 4096"),
+SDATA (DTP_INTEGER, "io_uring_fixed_files",SDF_RD,      "0",            "Slots of the registered files table (sockets and ttys), 0 default 1024"),
+SDATA (DTP_BOOLEAN, "io_uring_no_fixed_files",SDF_RD,   "0",            "Don't register the files, use plain fds"),
+SDATA (DTP_INTEGER, "io_uring_fixed_buffers",SDF_RD,    "0",            "Buffers of the registered buffers region (rx gbuffers of sockets and ttys), 0 default 256"),
+SDATA (DTP_INTEGER, "io_uring_fixed_buffer_size",SDF_RD,"0",            "Size of each registered buffer, 0 default 4096"),
+SDATA (DTP_BOOLEAN, "io_uring_no_fixed_buffers",SDF_RD, "0",            "Don't register buffers, use plain gbuffers"),
+SDATA (DTP_INTEGER, "dns_cache_ttl",    SDF_RD,         "0",            "Miliseconds of life of the resolved addresses, 0 default 60000"),
+SDATA (DTP_BOOLEAN, "no_dns_cache",     SDF_RD,         "0",            "Don't cache the resolved addresses, the names are resolved blocking the loop"),
+SDATA (DTP_INTEGER, "cpu",              SDF_RD,         "-1",           "Cpu where pin the yuno (its event loop), -1 not pinned. The shared listeners steer the connections to the yuno of the cpu that received them"),
+SDATA (DTP_INTEGER, "loops",            SDF_RD,         "1",            "Event loops of the yuno, each one in its own thread with its own gobjs (the first in the yuno's thread). With cpu >= 0 the loop i is pinned to the cpu+i"),
 SDATA_END()
 };
 
@@ -386,12 +418,46 @@ PRIVATE const sdata_desc_t authz_table[] = {
 SDATA_END()
 };
 
+/*---------------------------------------------*
+ *      Loops, see Loops in gobj.h
+ *---------------------------------------------*/
+typedef struct loop_post_s {
+    struct loop_post_s *next;
+    hgobj dst;                      // event to send to dst
+    gobj_event_t event;
+    json_t *kw;
+    hgobj src;
+    void (*fn)(void *user_data);    // or function to call, yuno_loop_call()
+    void *user_data;
+} loop_post_t;
+
+typedef struct yuno_loop_s {
+    int idx;
+    yev_loop_t *yev_loop;
+    yev_event_t *yev_mailbox;       // msg event, woken by the first post
+    pthread_mutex_t mutex;          // of the posts, the only data used by other threads
+    loop_post_t *posts;
+    loop_post_t *last_post;
+    BOOL woken;                     // mailbox woken, it will get the new posts
+
+    hgobj *roots;                   // gobjs of the loop with parent of other loop
+    int n_roots;
+    int max_roots;
+
+    yev_loop_options_t loop_options;
+    pthread_t thread;               // loops > 0
+    sem_t created;
+    BOOL thread_running;
+} yuno_loop_t;
+
 /*---------------------------------------------*
  *              Private data
  *---------------------------------------------*/
 typedef struct _PRIVATE_DATA {
     hgobj gobj_timer;
     yev_loop_t *yev_loop;
+    yuno_loop_t *loops;             // the first is the yuno's loop, only if loops > 1
+    int n_loops;
 
     size_t t_flush;
     size_t t_stats;
@@ -426,11 +492,42 @@ PRIVATE void mt_create(hgobj gobj)
     /*
      *  Create the event loop
      */
-    yev_loop_create(
+    yev_loop_options_t loop_options = {
+        .entries = (unsigned)gobj_read_integer_attr(gobj, "io_uring_entries"),
+        .sqpoll_idle = (unsigned)gobj_read_integer_attr(gobj, "io_uring_sqpoll_idle"),
+        .sqpoll_cpu = (int)gobj_read_integer_attr(gobj, "io_uring_sqpoll_cpu"),
+        .no_batch_submit = gobj_read_bool_attr(gobj, "io_uring_no_batch"),
+        .recv_buffers = (unsigned)gobj_read_integer_attr(gobj, "io_uring_recv_buffers"),
+        .recv_buffer_size = (unsigned)gobj_read_integer_attr(gobj, "io_uring_recv_buffer_size"),
+        .fixed_files = (unsigned)gobj_read_integer_attr(gobj, "io_uring_fixed_files"),
+        .no_fixed_files = gobj_read_bool_attr(gobj, "io_uring_no_fixed_files"),
+        .fixed_buffers = (unsigned)gobj_read_integer_attr(gobj, "io_uring_fixed_buffers"),
+        .fixed_buffer_size = (unsigned)gobj_read_integer_attr(gobj, "io_uring_fixed_buffer_size"),
+        .no_fixed_buffers = gobj_read_bool_attr(gobj, "io_uring_no_fixed_buffers"),
+        .dns_cache_ttl = (unsigned)gobj_read_integer_attr(gobj, "dns_cache_ttl"),
+        .no_dns_cache = gobj_read_bool_attr(gobj, "no_dns_cache"),
+        .cpu = (int)gobj_read_integer_attr(gobj, "cpu"),
+    };
+    if(gobj_read_bool_attr(gobj, "io_uring_coop_taskrun")) {
+        loop_options.mode |= YEV_LOOP_COOP_TASKRUN;
+    }
+    if(gobj_read_bool_attr(gobj, "io_uring_single_issuer")) {
+        loop_options.mode |= YEV_LOOP_SINGLE_ISSUER;
+    }
+    if(gobj_read_bool_attr(gobj, "io_uring_defer_taskrun")) {
+        loop_options.mode |= YEV_LOOP_DEFER_TASKRUN;
+    }
+    if(gobj_read_bool_attr(gobj, "io_uring_sqpoll")) {
+        loop_options.mode |= YEV_LOOP_SQPOLL;
+    }
+    yev_loop_create2(
         gobj,
-        (unsigned)gobj_read_integer_attr(gobj, "io_uring_entries"),
+        &loop_options,
         &priv->yev_loop
     );
+    if(gobj_read_integer_attr(gobj, "loops") > 1) {
+        create_loops(gobj, &loop_options);
+    }
 
     if (!atexit_registered) {
         atexit(remove_pid_file);
@@ -600,6 +697,7 @@ PRIVATE int mt_stop(hgobj gobj)
      */
     clear_timeout(priv->gobj_timer);
     gobj_stop(priv->gobj_timer);
+    stop_loops(gobj);   // the gobjs of the other loops are stopped by their threads
     gobj_stop_childs(gobj);
     yev_loop_stop(priv->yev_loop);
 
@@ -613,7 +711,49 @@ PRIVATE void mt_destroy(hgobj gobj)
 {
     PRIVATE_DATA *priv = gobj_priv_data(gobj);
 
-     yev_loop_destroy(priv->yev_loop);
+    stop_loops(gobj);
+    destroy_loops(gobj);
+    yev_loop_destroy(priv->yev_loop);
+}
+
+/***************************************************************************
+ *      Framework Method
+ *  The gobjs of the other loops with the parent in other loop
+ *  are the roots of the subtrees destroyed by its loop when the yuno stops.
+ ***************************************************************************/
+PRIVATE void mt_gobj_created(hgobj gobj, hgobj gobj_created)
+{
+    add_loop_root(gobj, gobj_created);
+}
+
+/***************************************************************************
+ *      Framework Method stats
+ *  The attributes with SDF_STATS and the event loop's stats
+ ***************************************************************************/
+PRIVATE json_t *mt_stats(hgobj gobj, const char *stats, json_t *kw, hgobj src)
+{
+    PRIVATE_DATA *priv = gobj_priv_data(gobj);
+
+    BOOL reset = (stats && strcmp(stats, "__reset__")==0)? TRUE : FALSE;
+    BOOL want_loop = (empty_string(stats) || reset || strstr(stats, "loop"))? TRUE : FALSE;
+
+    json_t *jn_data = build_stats(
+        gobj,
+        stats,
+        kw,     // owned
+        src
+    );
+    if(jn_data && want_loop) {
+        json_object_set_new(jn_data, "yev_loop", yev_loop_stats(priv->yev_loop, reset));
+    }
+
+    return build_command_response(
+        gobj,
+        0,          // result
+        0,          // jn_comment
+        0,          // jn_schema
+        jn_data     // jn_data, owned
+    );
 }
 
 /***************************************************************************
@@ -1104,6 +1244,27 @@ PRIVATE json_t *cmd_view_mem(hgobj gobj, const char *cmd, json_t *kw, hgobj src)
     return kw_response;
 }
 
+/***************************************************************************
+ *  Stats of the event loop
+ ***************************************************************************/
+PRIVATE json_t *cmd_view_loop_stats(hgobj gobj, const char *cmd, json_t *kw, hgobj src)
+{
+    PRIVATE_DATA *priv = gobj_priv_data(gobj);
+
+    BOOL reset = kw_get_bool(gobj, kw, "reset", 0, KW_WILD_NUMBER);
+    json_t *jn_data = yev_loop_stats(priv->yev_loop, reset);
+
+    json_t *kw_response = build_command_response(
+        gobj,
+        0,          // result
+        0,          // jn_comment
+        0,          // jn_schema
+        jn_data     // jn_data
+    );
+    JSON_DECREF(kw)
+    return kw_response;
+}
+
 /***************************************************************************
  *  Show a gclass description
  ***************************************************************************/
@@ -3282,6 +3443,414 @@ PRIVATE int set_user_gobj_no_traces(hgobj gobj)
 
 
 
+/***************************************************************************
+ *  Loop of the yev_loop, NULL the yuno's loop
+ ***************************************************************************/
+PRIVATE yuno_loop_t *get_yuno_loop(PRIVATE_DATA *priv, void *yev_loop)
+{
+    if(!yev_loop) {
+        return priv->n_loops > 0? &priv->loops[0] : NULL;
+    }
+    for(int i=0; i<priv->n_loops; i++) {
+        if(priv->loops[i].yev_loop == yev_loop) {
+            return &priv->loops[i];
+        }
+    }
+    return NULL;
+}
+
+/***************************************************************************
+ *  Append a post to the mailbox of the loop,
+ *  wake it with a message if it's not woken yet.
+ *  Called from the thread of any loop.
+ ***************************************************************************/
+PRIVATE int mailbox_post(yuno_loop_t *yuno_loop, loop_post_t *post)
+{
+    post->next = NULL;
+
+    pthread_mutex_lock(&yuno_loop->mutex);
+    if(yuno_loop->last_post) {
+        yuno_loop->last_post->next = post;
+    } else {
+        yuno_loop->posts = post;
+    }
+    yuno_loop->last_post = post;
+    BOOL wake = !yuno_loop->woken;
+    yuno_loop->woken = TRUE;
+    pthread_mutex_unlock(&yuno_loop->mutex);
+
+    if(wake) {
+        /*
+         *  The message goes by the ring of the loop of this thread
+         */
+        if(yev_send_msg(yuno_event_loop(), yuno_loop->yev_mailbox, 0) < 0) {
+            gobj_log_error(gobj_yuno(), 0,
+                "function",     "%s", __FUNCTION__,
+                "msgset",       "%s", MSGSET_INTERNAL_ERROR,
+                "msg",          "%s", "Cannot wake the loop, the post waits the next one",
+                "loop",         "%d", yuno_loop->idx,
+                NULL
+            );
+            pthread_mutex_lock(&yuno_loop->mutex);
+            yuno_loop->woken = FALSE;
+            pthread_mutex_unlock(&yuno_loop->mutex);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/***************************************************************************
+ *  Posts of other loops, in the thread of the loop
+ ***************************************************************************/
+PRIVATE int yev_mailbox_callback(yev_event_t *yev_event)
+{
+    yuno_loop_t *yuno_loop = get_yuno_loop(
+        gobj_priv_data(gobj_yuno()),
+        yev_event->yev_loop
+    );
+
+    while(1) {
+        pthread_mutex_lock(&yuno_loop->mutex);
+        loop_post_t *post = yuno_loop->posts;
+        if(post) {
+            yuno_loop->posts = post->next;
+            if(!yuno_loop->posts) {
+                yuno_loop->last_post = NULL;
+            }
+        } else {
+            yuno_loop->woken = FALSE;
+        }
+        pthread_mutex_unlock(&yuno_loop->mutex);
+        if(!post) {
+            break;
+        }
+
+        if(post->fn) {
+            post->fn(post->user_data);
+        } else {
+            gobj_send_event(post->dst, post->event, post->kw, post->src);
+        }
+        GBMEM_FREE(post);
+    }
+    return 0;
+}
+
+/***************************************************************************
+ *  Hook of gobj_send_event() to a gobj of other loop
+ ***************************************************************************/
+PRIVATE int post_event(void *loop, hgobj dst, gobj_event_t event, json_t *kw, hgobj src)
+{
+    yuno_loop_t *yuno_loop = get_yuno_loop(gobj_priv_data(gobj_yuno()), loop);
+    if(!yuno_loop) {
+        gobj_log_error(dst, LOG_OPT_TRACE_STACK,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_INTERNAL_ERROR,
+            "msg",          "%s", "Loop of gobj not found",
+            "event",        "%s", event,
+            NULL
+        );
+        KW_DECREF(kw)
+        return -1;
+    }
+
+    if(kw && kw->refcount > 1) {
+        /*
+         *  The kw is shared with the sender (publishing), the receiver gets its own
+         */
+        json_t *kw_copy = json_deep_copy(kw);
+        KW_DECREF(kw)
+        kw = kw_copy;
+    }
+
+    loop_post_t *post = GBMEM_MALLOC(sizeof(loop_post_t));
+    if(!post) {
+        gobj_log_error(dst, 0,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_MEMORY_ERROR,
+            "msg",          "%s", "no memory",
+            "event",        "%s", event,
+            NULL
+        );
+        KW_DECREF(kw)
+        return -1;
+    }
+    post->dst = dst;
+    post->event = event;
+    post->kw = kw;
+    post->src = src;
+    post->fn = NULL;
+    post->user_data = NULL;
+
+    mailbox_post(yuno_loop, post);
+    return 0;   // Posted, the wake failures are retried by the next posts
+}
+
+/***************************************************************************
+ *  Hook of gobj_destroy(): drop the events posted to the gobj,
+ *  the events sent by it are sent without src.
+ ***************************************************************************/
+PRIVATE void purge_events(hgobj gobj)
+{
+    PRIVATE_DATA *priv = gobj_priv_data(gobj_yuno());
+
+    for(int i=0; i<priv->n_loops; i++) {
+        yuno_loop_t *yuno_loop = &priv->loops[i];
+
+        if(yuno_loop->yev_loop && yuno_loop->yev_loop == gobj_loop(gobj)) {
+            for(int j=0; j<yuno_loop->n_roots; j++) {
+                if(yuno_loop->roots[j] == gobj) {
+                    yuno_loop->roots[j] = yuno_loop->roots[--yuno_loop->n_roots];
+                    break;
+                }
+            }
+        }
+
+        pthread_mutex_lock(&yuno_loop->mutex);
+        loop_post_t **pp = &yuno_loop->posts;
+        yuno_loop->last_post = NULL;
+        while(*pp) {
+            loop_post_t *post = *pp;
+            if(post->dst == gobj) {
+                *pp = post->next;
+                KW_DECREF(post->kw)
+                GBMEM_FREE(post);
+                continue;
+            }
+            if(post->src == gobj) {
+                post->src = NULL;
+            }
+            yuno_loop->last_post = post;
+            pp = &post->next;
+        }
+        pthread_mutex_unlock(&yuno_loop->mutex);
+    }
+}
+
+/***************************************************************************
+ *  Thread of the loops > 0
+ ***************************************************************************/
+PRIVATE void *loop_thread(void *arg)
+{
+    yuno_loop_t *yuno_loop = arg;
+
+    yev_loop_create2(
+        gobj_yuno(),
+        &yuno_loop->loop_options,
+        &yuno_loop->yev_loop
+    );
+    if(yuno_loop->yev_loop) {
+        yuno_loop->yev_mailbox = yev_create_msg_event(
+            yuno_loop->yev_loop,
+            yev_mailbox_callback,
+            NULL
+        );
+    }
+    gobj_set_thread_loop(yuno_loop->yev_loop);
+    BOOL ok = yuno_loop->yev_mailbox? TRUE : FALSE;
+    sem_post(&yuno_loop->created);
+
+    if(ok) {
+        yev_loop_run(yuno_loop->yev_loop);   // Until stop_loops()
+    }
+    return NULL;
+}
+
+/***************************************************************************
+ *  Create the loops > 0, each one in its thread.
+ *  The gobjs of a loop are created with yuno_loop_call().
+ ***************************************************************************/
+PRIVATE int create_loops(hgobj gobj, const yev_loop_options_t *loop_options)
+{
+    PRIVATE_DATA *priv = gobj_priv_data(gobj);
+    int n_loops = (int)gobj_read_integer_attr(gobj, "loops");
+
+    if(!priv->yev_loop || !yev_msg_available(priv->yev_loop)) {
+        gobj_log_error(gobj, 0,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_INTERNAL_ERROR,
+            "msg",          "%s", "Loops need the messages between loops (IORING_OP_MSG_RING), only one loop",
+            "loops",        "%d", n_loops,
+            NULL
+        );
+        return -1;
+    }
+
+    priv->loops = GBMEM_MALLOC(sizeof(yuno_loop_t) * (size_t)n_loops);
+    if(!priv->loops) {
+        gobj_log_error(gobj, 0,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_MEMORY_ERROR,
+            "msg",          "%s", "no memory",
+            NULL
+        );
+        return -1;
+    }
+    memset(priv->loops, 0, sizeof(yuno_loop_t) * (size_t)n_loops);
+
+    yuno_loop_t *yuno_loop = &priv->loops[0];
+    pthread_mutex_init(&yuno_loop->mutex, NULL);
+    yuno_loop->yev_loop = priv->yev_loop;
+    yuno_loop->yev_mailbox = yev_create_msg_event(
+        priv->yev_loop,
+        yev_mailbox_callback,
+        NULL
+    );
+    priv->n_loops = 1;
+    gobj_set_loop_hooks(post_event, purge_events);
+
+    for(int i=1; i<n_loops; i++) {
+        yuno_loop = &priv->loops[i];
+        yuno_loop->idx = i;
+        pthread_mutex_init(&yuno_loop->mutex, NULL);
+        yuno_loop->loop_options = *loop_options;
+        if(loop_options->cpu >= 0) {
+            yuno_loop->loop_options.cpu = loop_options->cpu + i;
+        }
+        sem_init(&yuno_loop->created, 0, 0);
+
+        int err = pthread_create(&yuno_loop->thread, NULL, loop_thread, yuno_loop);
+        if(err == 0) {
+            sem_wait(&yuno_loop->created);
+        }
+        sem_destroy(&yuno_loop->created);
+        if(err != 0 || !yuno_loop->yev_mailbox) {
+            gobj_log_error(gobj, 0,
+                "function",     "%s", __FUNCTION__,
+                "msgset",       "%s", MSGSET_SYSTEM_ERROR,
+                "msg",          "%s", "Cannot create the loop",
+                "loop",         "%d", i,
+                "serr",         "%s", err? strerror(err) : "",
+                NULL
+            );
+            if(err == 0) {
+                pthread_join(yuno_loop->thread, NULL);
+                if(yuno_loop->yev_loop) {
+                    yev_loop_destroy(yuno_loop->yev_loop);
+                }
+            }
+            pthread_mutex_destroy(&yuno_loop->mutex);
+            break;
+        }
+        yuno_loop->thread_running = TRUE;
+        priv->n_loops++;
+    }
+
+    return 0;
+}
+
+/***************************************************************************
+ *  In the thread of the loop: destroy its subtrees and stop it
+ ***************************************************************************/
+PRIVATE void loop_shutdown(void *user_data)
+{
+    yuno_loop_t *yuno_loop = user_data;
+
+    while(yuno_loop->n_roots > 0) {
+        // Destroyed roots are removed from the list by purge_events()
+        hgobj root = yuno_loop->roots[yuno_loop->n_roots - 1];
+        gobj_stop_tree(root);
+        gobj_destroy(root);
+    }
+    yev_loop_stop(yuno_loop->yev_loop);
+}
+
+/***************************************************************************
+ *  Stop the loops > 0 and wait their threads
+ ***************************************************************************/
+PRIVATE void stop_loops(hgobj gobj)
+{
+    PRIVATE_DATA *priv = gobj_priv_data(gobj);
+
+    for(int i=1; i<priv->n_loops; i++) {
+        yuno_loop_t *yuno_loop = &priv->loops[i];
+        if(yuno_loop->thread_running) {
+            if(yuno_loop_call(i, loop_shutdown, yuno_loop) < 0) {
+                /*
+                 *  Never woken, don't wait it
+                 */
+                pthread_detach(yuno_loop->thread);
+                yuno_loop->thread_running = FALSE;
+                yuno_loop->yev_loop = NULL;
+            }
+        }
+    }
+    for(int i=1; i<priv->n_loops; i++) {
+        yuno_loop_t *yuno_loop = &priv->loops[i];
+        if(yuno_loop->thread_running) {
+            pthread_join(yuno_loop->thread, NULL);
+            yuno_loop->thread_running = FALSE;
+        }
+    }
+}
+
+/***************************************************************************
+ *  Destroy the loops > 0 (already stopped) and the posts not sent
+ ***************************************************************************/
+PRIVATE void destroy_loops(hgobj gobj)
+{
+    PRIVATE_DATA *priv = gobj_priv_data(gobj);
+
+    if(!priv->loops) {
+        return;
+    }
+    gobj_set_loop_hooks(NULL, NULL);
+
+    for(int i=0; i<priv->n_loops; i++) {
+        yuno_loop_t *yuno_loop = &priv->loops[i];
+        loop_post_t *post = yuno_loop->posts;
+        while(post) {
+            loop_post_t *next = post->next;
+            KW_DECREF(post->kw)
+            GBMEM_FREE(post);
+            post = next;
+        }
+        if(i > 0 && yuno_loop->yev_loop) {
+            yev_loop_destroy(yuno_loop->yev_loop);  // Destroy too the mailbox
+        }
+        GBMEM_FREE(yuno_loop->roots);
+        pthread_mutex_destroy(&yuno_loop->mutex);
+    }
+    GBMEM_FREE(priv->loops);
+    priv->n_loops = 0;
+}
+
+/***************************************************************************
+ *  Keep the roots of the subtrees of the loops > 0
+ ***************************************************************************/
+PRIVATE void add_loop_root(hgobj gobj, hgobj gobj_created)
+{
+    PRIVATE_DATA *priv = gobj_priv_data(gobj);
+    void *loop = gobj_loop(gobj_created);
+
+    if(!loop || loop == gobj_loop(gobj_parent(gobj_created))) {
+        return;
+    }
+    yuno_loop_t *yuno_loop = get_yuno_loop(priv, loop);
+    if(!yuno_loop) {
+        return;
+    }
+    if(yuno_loop->n_roots >= yuno_loop->max_roots) {
+        int max_roots = yuno_loop->max_roots? yuno_loop->max_roots*2 : 8;
+        hgobj *roots = GBMEM_REALLOC(yuno_loop->roots, sizeof(hgobj) * (size_t)max_roots);
+        if(!roots) {
+            gobj_log_error(gobj, 0,
+                "function",     "%s", __FUNCTION__,
+                "msgset",       "%s", MSGSET_MEMORY_ERROR,
+                "msg",          "%s", "no memory",
+                NULL
+            );
+            return;
+        }
+        yuno_loop->roots = roots;
+        yuno_loop->max_roots = max_roots;
+    }
+    yuno_loop->roots[yuno_loop->n_roots++] = gobj_created;
+}
+
+
+
+
                     /***************************
                      *      Actions
                      ***************************/
@@ -3362,6 +3931,8 @@ PRIVATE const GMETHODS gmt = {
     .mt_stop = mt_stop,
     .mt_play = mt_play,
     .mt_pause = mt_pause,
+    .mt_stats = mt_stats,
+    .mt_gobj_created = mt_gobj_created,
 };
 
 /*---------------------------------------------*
@@ -3450,7 +4021,7 @@ PUBLIC int register_c_linux_yuno(void)
 }
 
 /***************************************************************************
- *
+ *  Loop of the calling thread
  ***************************************************************************/
 PUBLIC void *yuno_event_loop(void)
 {
@@ -3459,7 +4030,88 @@ PUBLIC void *yuno_event_loop(void)
     if(!yuno) {
         return 0;
     }
+    void *loop = gobj_thread_loop();
+    if(loop) {
+        return loop;
+    }
     priv = gobj_priv_data(yuno);
 
     return priv->yev_loop;
 }
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PUBLIC int yuno_loops(void)
+{
+    hgobj yuno = gobj_yuno();
+    if(!yuno) {
+        return 0;
+    }
+    PRIVATE_DATA *priv = gobj_priv_data(yuno);
+
+    return priv->n_loops > 0? priv->n_loops : 1;
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PUBLIC void *yuno_loop(int idx)
+{
+    hgobj yuno = gobj_yuno();
+    if(!yuno) {
+        return 0;
+    }
+    PRIVATE_DATA *priv = gobj_priv_data(yuno);
+
+    if(idx == 0) {
+        return priv->yev_loop;
+    }
+    if(idx < 0 || idx >= priv->n_loops) {
+        return 0;
+    }
+    return priv->loops[idx].yev_loop;
+}
+
+/***************************************************************************
+ *  Call fn in the thread of the loop idx
+ ***************************************************************************/
+PUBLIC int yuno_loop_call(int idx, void (*fn)(void *user_data), void *user_data)
+{
+    hgobj yuno = gobj_yuno();
+    if(!yuno) {
+        return -1;
+    }
+    PRIVATE_DATA *priv = gobj_priv_data(yuno);
+
+    if(idx < 0 || idx >= priv->n_loops || !fn) {
+        gobj_log_error(yuno, LOG_OPT_TRACE_STACK,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_PARAMETER_ERROR,
+            "msg",          "%s", "Loop not found",
+            "loop",         "%d", idx,
+            "loops",        "%d", priv->n_loops,
+            NULL
+        );
+        return -1;
+    }
+
+    loop_post_t *post = GBMEM_MALLOC(sizeof(loop_post_t));
+    if(!post) {
+        gobj_log_error(yuno, 0,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_MEMORY_ERROR,
+            "msg",          "%s", "no memory",
+            NULL
+        );
+        return -1;
+    }
+    post->dst = NULL;
+    post->event = NULL;
+    post->kw = NULL;
+    post->src = NULL;
+    post->fn = fn;
+    post->user_data = user_data;
+
+    return mailbox_post(&priv->loops[idx], post);
+}
@@ -36,18 +36,22 @@ GOBJ_DECLARE_GCLASS(C_YUNO);
  ***************************************************************/
 PUBLIC int register_c_linux_yuno(void);
 
-// PUBLIC int gobj_post_event(
-//     hgobj dst,
-//     gobj_event_t event,
-//     json_t *kw,  // owned
-//     hgobj src
-// );
-
 /*
- *  Get yuno event loop
+ *  Get the event loop of the calling thread (the yuno's loop in the main thread)
  */
 PUBLIC void *yuno_event_loop(void);
 
+/*
+ *  Loops of the yuno (attribute `loops`), see Loops in gobj.h.
+ *  The loop 0 is the yuno's loop, the others run each one in its own thread.
+ *  yuno_loop_call(): call fn in the thread of the loop idx, the gobjs created by fn
+ *      are of that loop (the roots of its subtree are destroyed by its thread when the yuno stops).
+ *      Return -1 if the loop cannot be woken.
+ */
+PUBLIC int yuno_loops(void);
+PUBLIC void *yuno_loop(int idx);
+PUBLIC int yuno_loop_call(int idx, void (*fn)(void *user_data), void *user_data);
+
 /*--------------------------------------------------*
  *  Denied ips (prevalence over allowed)
  *
@@ -7,12 +7,20 @@
  *          All Rights Reserved.
  ****************************************************************************/
 #include <liburing.h>
-#include <sys/timerfd.h>
+#include <time.h>
+#include <sched.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
 #include <netdb.h>
 #include <sys/socket.h>
 #include <netinet/tcp.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/eventfd.h>
+#include <linux/filter.h>
 #include "yunetas_ev_loop.h"
 
 
@@ -20,17 +28,231 @@
  *              Constants
  ***************************************************************/
 #define DEFAULT_BACKLOG 512
+#define YEV_RECV_BGID   0   // Buffer group id of the recv buffer ring
+#define YEV_UDATA_LINK_TIMEOUT  (LIBURING_UDATA_TIMEOUT - 1)    // user_data of the linked timeout sqes
+#define YEV_UDATA_MSG_RING      (LIBURING_UDATA_TIMEOUT - 2)    // user_data of the yev_send_msg() sqes
+#define YEV_UDATA_CANCEL        (LIBURING_UDATA_TIMEOUT - 3)    // user_data of the cancel sqes
+#define YEV_UDATA_CANCEL_FD     0xFFFF000000000000ULL           // | fd, user_data of the cancel sqes by fd
+#define yev_udata_is_cancel_fd(udata)   (((udata) & 0xFFFFFFFF00000000ULL) == YEV_UDATA_CANCEL_FD)
+#define YEV_UDATA_FD_INSTALL    0xFFFE000000000000ULL           // | slot, user_data of the fd install of the accepted sockets
+#define yev_udata_is_fd_install(udata)  (((udata) & 0xFFFFFFFF00000000ULL) == YEV_UDATA_FD_INSTALL)
+
+/*
+ *  IORING_OP_FIXED_FD_INSTALL (6.8) is not in the headers of liburing < 2.6,
+ *  the opcodes are kernel abi.
+ */
+#if IO_URING_VERSION_MAJOR > 2 || (IO_URING_VERSION_MAJOR == 2 && IO_URING_VERSION_MINOR >= 6)
+#define YEV_IORING_OP_FIXED_FD_INSTALL  IORING_OP_FIXED_FD_INSTALL
+#else
+#define YEV_IORING_OP_FIXED_FD_INSTALL  54
+#endif
+#define YEV_EVENTS_PER_CHUNK    32  // events allocated at once by the slab
+
+/*
+ *  Timer wheel: root level of 256 slots of 1 msec,
+ *  and 4 upper levels of 64 slots, covering 2^32 msec (~49 days).
+ */
+#define TW_ROOT_BITS    8
+#define TW_LEVEL_BITS   6
+#define TW_LEVELS       4
+#define TW_ROOT_SIZE    (1 << TW_ROOT_BITS)
+#define TW_LEVEL_SIZE   (1 << TW_LEVEL_BITS)
+#define TW_ROOT_MASK    (TW_ROOT_SIZE - 1)
+#define TW_LEVEL_MASK   (TW_LEVEL_SIZE - 1)
+#define TW_MAX_DELTA    ((1ULL << (TW_ROOT_BITS + TW_LEVELS*TW_LEVEL_BITS)) - 1)
 
 /***************************************************************
  *              Structures
  ***************************************************************/
-int multishot_available = 0; // Available since kernel 5.19
+/*
+ *  Buffer ring of the multishot recv events, one per loop.
+ *  The buffers are given to the callbacks wrapped in gbuffers,
+ *  and returned to the ring when the gbuffers are released.
+ */
+struct yev_recv_ring_s {
+    yev_loop_t *yev_loop;   // NULL if the loop was destroyed with buffers still in use
+    struct io_uring_buf_ring *br;
+    char *buffers;          // mmap'ed, the pages are touched only when used by the kernel
+    size_t buffers_size;
+    unsigned nbufs;
+    unsigned buf_size;      // size given to kernel
+    unsigned stride;        // buf_size + final null, aligned
+    unsigned in_use;        // buffers out of the ring (given to callbacks)
+    yev_event_t **starved;  // recv events stopped with ENOBUFS, re-armed when a buffer returns
+    unsigned n_starved;
+    unsigned max_starved;
+};
+
+/*
+ *  Sparse table of registered files, one per loop.
+ *  With accept direct the slots from direct_start are allocated by the kernel
+ *  to the sockets accepted, the slots below by yev_register_fd().
+ */
+struct yev_fixed_files_s {
+    unsigned size;          // slots registered in kernel
+    unsigned n_free;
+    int *free_slots;        // stack of free slots, below direct_start
+    int *fd2slot;           // fixed slot of each fd, -1 not registered
+    unsigned fd2slot_size;
+    unsigned in_use;
+    unsigned direct_start;  // first slot of the kernel allocation, size if no accept direct
+    unsigned direct_used;   // slots of the kernel allocation with a socket
+    unsigned direct_low;    // free slots of the kernel allocation below which the accepts go plain
+    yev_event_t **accepting;    // accept event of each slot with its fd install in flight
+};
+
+/*
+ *  Registered buffers, one region per loop registered as one iovec (buffer index 0).
+ *  The buffers are given wrapped in gbuffers, and returned when the gbuffers are released.
+ */
+struct yev_fixed_bufs_s {
+    yev_loop_t *yev_loop;   // NULL if the loop was destroyed with buffers still in use
+    char *buffers;          // mmap'ed
+    size_t buffers_size;
+    unsigned nbufs;
+    unsigned buf_size;      // size of the gbuffers
+    unsigned stride;        // buf_size + final null, aligned
+    unsigned in_use;
+    unsigned *free_bufs;    // stack of free buffers
+    unsigned n_free;
+};
+
+/*
+ *  Hierarchical timer wheel of the timer events, one per loop.
+ *  The slots are lists linked through the yev_event tw_next/tw_pprev fields.
+ */
+struct yev_timer_wheel_s {
+    uint64_t jiffies;       // next msec tick to process
+    unsigned n_timers;
+    BOOL next_dirty;        // next_expiry must be recalculated
+    uint64_t next_expiry;   // tick to wake up (exact or the next cascade)
+    yev_event_t *root[TW_ROOT_SIZE];
+    yev_event_t *levels[TW_LEVELS][TW_LEVEL_SIZE];
+};
+
+/*
+ *  Resolved addresses, the addrinfo chain is copied in one block.
+ */
+typedef struct dns_entry_s {
+    char host[120];
+    char port[10];
+    int socktype;
+    int protocol;
+    struct addrinfo *results;
+    uint64_t expires;       // monotonic msec
+} dns_entry_t;
+
+/*
+ *  Connect event waiting a name resolution
+ */
+typedef struct yev_dns_waiter_s {
+    struct yev_dns_waiter_s *next;
+    yev_event_t *yev_event;     // NULL if the event was stopped
+    char *dst_url;
+    char *src_url;
+} yev_dns_waiter_t;
+
+/*
+ *  Name to resolve by the resolver thread, the connects to the same name wait the same request.
+ *  The thread only touches host, port, hints, results and gai_err (it doesn't use gbmem).
+ */
+typedef struct dns_request_s {
+    struct dns_request_s *next;     // list of pending requests, loop thread
+    struct dns_request_s *qnext;    // todo or done queue, protected by the mutex
+    char host[120];
+    char port[10];
+    struct addrinfo hints;
+    struct addrinfo *results;       // got by the thread, freed with freeaddrinfo()
+    int gai_err;
+    uint64_t t0;                    // nsec
+    yev_dns_waiter_t *waiters;
+} dns_request_t;
+
+/*
+ *  Cache of resolved addresses and resolver thread, one per loop.
+ *  The thread posts the requests done through an eventfd read by the loop.
+ */
+struct yev_resolver_s {
+    dns_entry_t *cache[YEV_DNS_CACHE_SIZE];
+    dns_request_t *pending;         // requests not processed by the loop yet
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    dns_request_t *todo;            // queue to the thread
+    dns_request_t **todo_tail;
+    dns_request_t *done;            // queue from the thread
+    BOOL quit;
+    BOOL thread_running;
+    pthread_t thread;
+    int efd;
+    yev_event_t *yev_efd;           // read of efd
+};
 
 /***************************************************************
  *              Prototypes
  ***************************************************************/
 PRIVATE int process_cqe(yev_loop_t *yev_loop, struct io_uring_cqe *cqe);
+PRIVATE uint64_t process_cqe_timed(yev_loop_t *yev_loop, struct io_uring_cqe *cqe, uint64_t t0);
+PRIVATE void stats_submitted(yev_loop_t *yev_loop, uint64_t sqes);
+PRIVATE void stats_callback(yev_loop_t *yev_loop, uint8_t type, gclass_name_t gclass_name, uint64_t ns);
+PRIVATE uint64_t yev_now_nsec(void);
+PRIVATE const char *yev_type_name(yev_type_t type);
+PRIVATE struct io_uring_sqe *yev_get_sqe(yev_loop_t *yev_loop);
+PRIVATE struct io_uring_sqe *yev_get_event_sqe(yev_event_t *yev_event);
+PRIVATE void sqe_link_timeout(yev_event_t *yev_event, struct io_uring_sqe *sqe);
+PRIVATE void yev_submit(yev_loop_t *yev_loop);
 PRIVATE int print_addrinfo(hgobj gobj, char *bf, size_t bfsize, struct addrinfo *ai, int port);
+PRIVATE yev_recv_ring_t *get_recv_ring(yev_loop_t *yev_loop);
+PRIVATE void recv_ring_destroy(yev_loop_t *yev_loop);
+PRIVATE void recv_ring_give_back(void *user_data, char *data);
+PRIVATE int recv_ring_add_starved(yev_recv_ring_t *recv_ring, yev_event_t *yev_event);
+PRIVATE void recv_ring_del_starved(yev_recv_ring_t *recv_ring, yev_event_t *yev_event);
+PRIVATE int rearm_recv_multishot(yev_event_t *yev_event);
+PRIVATE uint32_t probe_capabilities(yev_loop_t *yev_loop, uint32_t features);
+PRIVATE yev_fixed_files_t *get_fixed_files(yev_loop_t *yev_loop);
+PRIVATE void fixed_files_destroy(yev_loop_t *yev_loop);
+PRIVATE void sqe_set_fixed_file(yev_loop_t *yev_loop, struct io_uring_sqe *sqe, int fd);
+PRIVATE int fd2slot_set(yev_loop_t *yev_loop, yev_fixed_files_t *fixed, int fd, int slot);
+PRIVATE void release_slot(yev_loop_t *yev_loop, yev_fixed_files_t *fixed, int slot);
+PRIVATE BOOL accept_direct_available(yev_loop_t *yev_loop);
+PRIVATE void accept_switch(yev_loop_t *yev_loop, yev_event_t *yev_event);
+PRIVATE void prep_accept(yev_loop_t *yev_loop, struct io_uring_sqe *sqe, yev_event_t *yev_event);
+PRIVATE void accept_fd_install(yev_loop_t *yev_loop, yev_event_t *yev_event, int slot);
+PRIVATE void accept_fd_installed(yev_loop_t *yev_loop, int slot, int fd);
+PRIVATE uint64_t yev_now_msec(void);
+PRIVATE void timer_wheel_add(yev_timer_wheel_t *tw, yev_event_t *yev_event, uint64_t expires);
+PRIVATE void timer_wheel_del(yev_timer_wheel_t *tw, yev_event_t *yev_event);
+PRIVATE void timer_wheel_run(yev_loop_t *yev_loop);
+PRIVATE void timer_wheel_cancel_all(yev_loop_t *yev_loop);
+PRIVATE struct __kernel_timespec *timer_wheel_timeout(yev_loop_t *yev_loop, struct __kernel_timespec *ts);
+PRIVATE void set_hints_by_schema(yev_event_t *yev_event, const char *url, const char *schema, struct addrinfo *hints);
+PRIVATE yev_resolver_t *get_resolver(yev_loop_t *yev_loop);
+PRIVATE void resolver_destroy(yev_loop_t *yev_loop);
+PRIVATE dns_entry_t *dns_cache_find(yev_loop_t *yev_loop, const char *host, const char *port, const struct addrinfo *hints);
+PRIVATE struct addrinfo *dns_resolve(hgobj gobj, yev_loop_t *yev_loop, const char *url, const char *host, const char *port, const struct addrinfo *hints);
+PRIVATE int dns_resolve_async(yev_event_t *yev_event, const char *dst_url, const char *src_url, const char *host, const char *port, const struct addrinfo *hints);
+PRIVATE void dns_cancel_all(yev_loop_t *yev_loop);
+PRIVATE int attach_reuseport_cpu_steering(hgobj gobj, int fd);
+PRIVATE yev_event_t *slab_get(yev_loop_t *yev_loop);
+PRIVATE void slab_put(yev_loop_t *yev_loop, yev_event_t *yev_event);
+PRIVATE void slab_destroy(yev_loop_t *yev_loop);
+PRIVATE void process_zombie_cqe(yev_loop_t *yev_loop, yev_event_t *yev_event, struct io_uring_cqe *cqe);
+PRIVATE yev_fixed_bufs_t *get_fixed_bufs(yev_loop_t *yev_loop);
+PRIVATE void fixed_bufs_destroy(yev_loop_t *yev_loop);
+PRIVATE void fixed_bufs_give_back(void *user_data, char *data);
+PRIVATE BOOL is_fixed_gbuffer(yev_loop_t *yev_loop, gbuffer_t *gbuf);
+PRIVATE int start_file_event(yev_event_t *yev_event);
+PRIVATE yev_event_t *create_file_event(yev_loop_t *yev_loop, yev_callback_t callback, hgobj gobj, int fd, gbuffer_t *gbuf, yev_type_t type, const char *fn);
+PRIVATE int start_splice_event(yev_event_t *yev_event);
+PRIVATE int splice_drain(yev_event_t *yev_event);
+PRIVATE void splice_reset_pipe(yev_event_t *yev_event);
+PRIVATE void set_in_ring(yev_event_t *yev_event);
+PRIVATE void fd_ops_del(yev_event_t *yev_event);
+PRIVATE void cancel_fd_ops_by_event(yev_loop_t *yev_loop, int fd);
+PRIVATE void cancel_group_done(yev_event_t *yev_event);
+PRIVATE void cancel_groups_inform(yev_loop_t *yev_loop);
+PRIVATE int stop_event_prepare(yev_event_t *yev_event);
+PRIVATE int cancel_fd_ops(yev_loop_t *yev_loop, int fd, yev_event_t *group);
+PRIVATE yev_event_t *create_event(yev_loop_t *yev_loop, yev_callback_t callback, hgobj gobj, int fd);
 
 /***************************************************************
  *              Data
@@ -43,6 +265,25 @@ PRIVATE const char *yev_flag_s[] = {
     "YEV_FLAG_IS_TCP",
     "YEV_FLAG_CONNECTED",
     "YEV_FLAG_WANT_TX_READY",
+    "YEV_FLAG_ZC_COPIED",
+    0
+};
+
+PRIVATE const char *yev_loop_mode_s[] = {
+    "YEV_LOOP_COOP_TASKRUN",
+    "YEV_LOOP_SINGLE_ISSUER",
+    "YEV_LOOP_DEFER_TASKRUN",
+    "YEV_LOOP_SQPOLL",
+    0
+};
+
+PRIVATE const char *yev_loop_cap_s[] = {
+    "YEV_CAP_ACCEPT_MULTISHOT",
+    "YEV_CAP_RECV_MULTISHOT",
+    "YEV_CAP_SEND_ZC",
+    "YEV_CAP_SEND_ZC_REPORT_USAGE",
+    "YEV_CAP_MSG_RING",
+    "YEV_CAP_ACCEPT_DIRECT",
     0
 };
 
@@ -51,30 +292,126 @@ PRIVATE const char *yev_flag_s[] = {
  ***************************************************************************/
 PUBLIC int yev_loop_create(hgobj yuno, unsigned entries, yev_loop_t **yev_loop_)
 {
-    struct io_uring ring_test;
+    yev_loop_options_t options = {
+        .entries = entries,
+        .sqpoll_cpu = -1,
+        .cpu = -1
+    };
+    return yev_loop_create2(yuno, &options, yev_loop_);
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PUBLIC int yev_loop_create2(hgobj yuno, const yev_loop_options_t *options, yev_loop_t **yev_loop_)
+{
     int err;
 
     *yev_loop_ = 0;     // error case
 
+    unsigned entries = options->entries;
     if(entries == 0) {
         entries = DEFAULT_ENTRIES;
     }
 
-    struct io_uring_params params_test = {0};
-    //params_test.flags |= IORING_SETUP_COOP_TASKRUN; // Available since 5.18
-    //params_test.flags |= IORING_SETUP_SINGLE_ISSUER; // Available since 6.0
+    uint32_t mode = options->mode;
+    if(mode & YEV_LOOP_DEFER_TASKRUN) {
+        mode |= YEV_LOOP_SINGLE_ISSUER;
+    }
+    if((mode & YEV_LOOP_SQPOLL) && (mode & (YEV_LOOP_COOP_TASKRUN|YEV_LOOP_DEFER_TASKRUN))) {
+        gobj_log_warning(yuno, 0,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_YEV_LOOP,
+            "msg",          "%s", "SQPOLL not compatible with COOP_TASKRUN or DEFER_TASKRUN, using SQPOLL",
+            "mode",         "0x%x", (unsigned)mode,
+            NULL
+        );
+        mode &= ~(YEV_LOOP_COOP_TASKRUN|YEV_LOOP_DEFER_TASKRUN);
+    }
+
+    yev_loop_t *yev_loop = GBMEM_MALLOC(sizeof(yev_loop_t));
+    if(!yev_loop) {
+        gobj_log_critical(yuno, 0,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_MEMORY_ERROR,
+            "msg",          "%s", "No memory to yev_loop",
+            NULL
+        );
+        return -1;
+    }
+
+    /*
+     *  Pin the thread of the loop before creating the ring:
+     *  the ring's memory and the kernel task_work are local to the cpu.
+     */
+    yev_loop->cpu = -1;
+    if(options->cpu >= 0) {
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        CPU_SET(options->cpu, &cpuset);
+        err = pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset);
+        if(err) {
+            gobj_log_warning(yuno, 0,
+                "function",     "%s", __FUNCTION__,
+                "msgset",       "%s", MSGSET_YEV_LOOP,
+                "msg",          "%s", "Cannot pin the loop to cpu",
+                "cpu",          "%d", options->cpu,
+                "errno",        "%d", err,
+                "serrno",       "%s", strerror(err),
+                NULL
+            );
+        } else {
+            yev_loop->cpu = options->cpu;
+        }
+    }
+
+    struct io_uring_params params = {0};
+    if(mode & YEV_LOOP_COOP_TASKRUN) {
+        params.flags |= IORING_SETUP_COOP_TASKRUN;
+    }
+    if(mode & YEV_LOOP_SINGLE_ISSUER) {
+        params.flags |= IORING_SETUP_SINGLE_ISSUER;
+    }
+    if(mode & YEV_LOOP_DEFER_TASKRUN) {
+        params.flags |= IORING_SETUP_DEFER_TASKRUN;
+    }
+    if(mode & YEV_LOOP_SQPOLL) {
+        params.flags |= IORING_SETUP_SQPOLL;
+        params.sq_thread_idle = options->sqpoll_idle;
+        if(options->sqpoll_cpu >= 0) {
+            params.flags |= IORING_SETUP_SQ_AFF;
+            params.sq_thread_cpu = (uint32_t)options->sqpoll_cpu;
+        }
+    }
+
 retry:
-    err = io_uring_queue_init_params(entries, &ring_test, &params_test);
+    err = io_uring_queue_init_params(entries, &yev_loop->ring, &params);
     if(err) {
-        if (err == -EINVAL && params_test.flags & IORING_SETUP_SINGLE_ISSUER) {
-            params_test.flags &= ~IORING_SETUP_SINGLE_ISSUER;
+        /*
+         *  Drop the modes not supported by the kernel, from the newest to the oldest
+         */
+        if (err == -EINVAL && params.flags & IORING_SETUP_DEFER_TASKRUN) {
+            params.flags &= ~IORING_SETUP_DEFER_TASKRUN;
+            goto retry;
+        }
+        if (err == -EINVAL && params.flags & IORING_SETUP_SINGLE_ISSUER) {
+            params.flags &= ~IORING_SETUP_SINGLE_ISSUER;
+            goto retry;
+        }
+        if (err == -EINVAL && params.flags & IORING_SETUP_COOP_TASKRUN) {
+            params.flags &= ~IORING_SETUP_COOP_TASKRUN;
+            goto retry;
+        }
+        if ((err == -EINVAL || err == -EPERM) && params.flags & IORING_SETUP_SQ_AFF) {
+            params.flags &= ~IORING_SETUP_SQ_AFF;
             goto retry;
         }
-        if (err == -EINVAL && params_test.flags & IORING_SETUP_COOP_TASKRUN) {
-            params_test.flags &= ~IORING_SETUP_COOP_TASKRUN;
+        if ((err == -EINVAL || err == -EPERM) && params.flags & IORING_SETUP_SQPOLL) {
+            params.flags &= ~IORING_SETUP_SQPOLL;
             goto retry;
         }
 
+        GBMEM_FREE(yev_loop)
         gobj_log_critical(yuno, LOG_OPT_EXIT_ZERO,
             "function",     "%s", __FUNCTION__,
             "msgset",       "%s", MSGSET_YEV_LOOP,
@@ -86,36 +423,79 @@ retry:
         return -1;
     }
 
-    yev_loop_t *yev_loop = GBMEM_MALLOC(sizeof(yev_loop_t));
-    if(!yev_loop) {
-        gobj_log_critical(yuno, 0,
+    yev_loop->mode = 0;
+    if(params.flags & IORING_SETUP_COOP_TASKRUN) {
+        yev_loop->mode |= YEV_LOOP_COOP_TASKRUN;
+    }
+    if(params.flags & IORING_SETUP_SINGLE_ISSUER) {
+        yev_loop->mode |= YEV_LOOP_SINGLE_ISSUER;
+    }
+    if(params.flags & IORING_SETUP_DEFER_TASKRUN) {
+        yev_loop->mode |= YEV_LOOP_DEFER_TASKRUN;
+    }
+    if(params.flags & IORING_SETUP_SQPOLL) {
+        yev_loop->mode |= YEV_LOOP_SQPOLL;
+    }
+
+    if(yev_loop->mode != mode) {
+        json_t *jn_wanted = bits2jn_strlist(yev_loop_mode_s, mode);
+        json_t *jn_got = bits2jn_strlist(yev_loop_mode_s, yev_loop->mode);
+        gobj_log_warning(yuno, 0,
             "function",     "%s", __FUNCTION__,
-            "msgset",       "%s", MSGSET_MEMORY_ERROR,
-            "msg",          "%s", "No memory to yev_loop",
+            "msgset",       "%s", MSGSET_YEV_LOOP,
+            "msg",          "%s", "io_uring modes not supported by kernel",
+            "wanted",       "%j", jn_wanted,
+            "got",          "%j", jn_got,
             NULL
         );
-        return -1;
+        json_decref(jn_wanted);
+        json_decref(jn_got);
     }
-    struct io_uring_params params = {
-        .flags = params_test.flags
-    };
 
-    err = io_uring_queue_init_params(entries, &yev_loop->ring, &params);
-    if (err < 0) {
+    yev_loop->timer_wheel = GBMEM_MALLOC(sizeof(yev_timer_wheel_t));
+    if(!yev_loop->timer_wheel) {
+        io_uring_queue_exit(&yev_loop->ring);
         GBMEM_FREE(yev_loop)
         gobj_log_critical(yuno, LOG_OPT_EXIT_ZERO,
             "function",     "%s", __FUNCTION__,
-            "msgset",       "%s", MSGSET_YEV_LOOP,
-            "msg",          "%s", "Linux io_uring_queue_init_params() FAILED, cannot run yunetas",
-            "errno",        "%d", -err,
-            "serrno",       "%s", strerror(-err),
+            "msgset",       "%s", MSGSET_MEMORY_ERROR,
+            "msg",          "%s", "No memory to timer wheel",
             NULL
         );
         return -1;
     }
+    yev_loop->timer_wheel->jiffies = yev_now_msec();
 
     yev_loop->yuno = yuno;
     yev_loop->entries = entries;
+    yev_loop->batch_submit = options->no_batch_submit? FALSE:TRUE;
+
+    yev_loop->recv_buffers = options->recv_buffers? options->recv_buffers : YEV_RECV_BUFFERS;
+    if(yev_loop->recv_buffers & (yev_loop->recv_buffers - 1)) {
+        unsigned n = 1;
+        while(n < yev_loop->recv_buffers && n < 32768) {
+            n <<= 1;
+        }
+        yev_loop->recv_buffers = n;   // must be power of 2
+    }
+    if(yev_loop->recv_buffers > 32768) {
+        yev_loop->recv_buffers = 32768;   // max entries of a buffer ring
+    }
+    yev_loop->recv_buffer_size = options->recv_buffer_size?
+        options->recv_buffer_size : YEV_RECV_BUFFER_SIZE;
+    yev_loop->caps = probe_capabilities(yev_loop, params.features);
+
+    if(!options->no_fixed_files) {
+        yev_loop->fixed_files = options->fixed_files? options->fixed_files : YEV_FIXED_FILES;
+    }
+    if(!options->no_dns_cache) {
+        yev_loop->dns_cache_ttl = options->dns_cache_ttl? options->dns_cache_ttl : YEV_DNS_CACHE_TTL;
+    }
+    if(!options->no_fixed_buffers) {
+        yev_loop->fixed_buffers = options->fixed_buffers? options->fixed_buffers : YEV_FIXED_BUFFERS;
+        yev_loop->fixed_buffer_size = options->fixed_buffer_size?
+            options->fixed_buffer_size : YEV_FIXED_BUFFER_SIZE;
+    }
 
     *yev_loop_ = yev_loop;
 
@@ -127,7 +507,20 @@ retry:
  ***************************************************************************/
 PUBLIC void yev_loop_destroy(yev_loop_t *yev_loop)
 {
+    resolver_destroy(yev_loop);
+    recv_ring_destroy(yev_loop);
     io_uring_queue_exit(&yev_loop->ring);
+    for(unsigned fd=0; fd<yev_loop->fd_ops_size; fd++) {
+        if(yev_loop->fd_close_pending[fd]) {
+            close((int)fd);
+        }
+    }
+    fixed_bufs_destroy(yev_loop);
+    fixed_files_destroy(yev_loop);
+    slab_destroy(yev_loop);
+    GBMEM_FREE(yev_loop->fd_ops)
+    GBMEM_FREE(yev_loop->fd_close_pending)
+    GBMEM_FREE(yev_loop->timer_wheel)
     GBMEM_FREE(yev_loop)
 }
 
@@ -136,31 +529,128 @@ PUBLIC void yev_loop_destroy(yev_loop_t *yev_loop)
  ***************************************************************************/
 PUBLIC int yev_loop_run(yev_loop_t *yev_loop)
 {
+    struct io_uring_cqe *cqes[YEV_CQE_BATCH_SIZE];
     struct io_uring_cqe *cqe;
+    struct __kernel_timespec ts;
 
     /*------------------------------------------*
      *      Infinite loop
      *------------------------------------------*/
     yev_loop->running = TRUE;
     while(yev_loop->running) {
-        int err = io_uring_wait_cqe(&yev_loop->ring, &cqe);
-        if (err < 0) {
-            if(err == -EINTR) {
-                // Ctrl+C cause this
+        yev_loop->stats.loop_iterations++;
+
+        /*
+         *  Expire the timers, the wait is limited by the nearest one
+         */
+        timer_wheel_run(yev_loop);
+        if(!yev_loop->running) {
+            break;
+        }
+        struct __kernel_timespec *timeout = timer_wheel_timeout(yev_loop, &ts);
+
+        if(!yev_loop->batch_submit) {
+            /*
+             *  Not batched: one cqe per wait, the sqes were already submitted
+             */
+            if(io_uring_cq_ready(&yev_loop->ring) == 0) {
+                yev_loop->stats.enter_calls++;
+            }
+            uint64_t t0 = yev_now_nsec();
+            int err = timeout?
+                io_uring_wait_cqe_timeout(&yev_loop->ring, &cqe, timeout) :
+                io_uring_wait_cqe(&yev_loop->ring, &cqe);
+            uint64_t t1 = yev_now_nsec();
+            yev_loop->stats.wait_ns += t1 - t0;
+            if (err < 0) {
+                if(err == -EINTR || err == -ETIME) {
+                    // Ctrl+C cause EINTR, ETIME is the timeout of timers
+                    continue;
+                }
+                gobj_log_error(yev_loop->yuno, LOG_OPT_TRACE_STACK,
+                    "function",     "%s", __FUNCTION__,
+                    "msgset",       "%s", MSGSET_LIBUV_ERROR,
+                    "msg",          "%s", "io_uring_wait_cqe() FAILED",
+                    "err",          "%d", -err,
+                    "serr",         "%s", strerror(-err),
+                    NULL
+                );
+                break;
+            }
+
+            yev_loop->stats.cqe_batches++;
+            yev_loop->stats.cqes++;
+            if(yev_loop->stats.max_cqe_batch < 1) {
+                yev_loop->stats.max_cqe_batch = 1;
+            }
+            yev_loop->stats.cqes_per_wakeup[0]++;
+            process_cqe_timed(yev_loop, cqe, t1);
+            io_uring_cqe_seen(&yev_loop->ring, cqe);
+            continue;
+        }
+
+        /*
+         *  Batched: flush the sqes queued by the callbacks and wait for cqes,
+         *  only one io_uring_enter syscall per iteration.
+         *  Don't wait if there are cqes already pending.
+         */
+        int err;
+        uint64_t t0 = yev_now_nsec();
+        if(io_uring_cq_ready(&yev_loop->ring) > 0) {
+            err = yev_loop_flush(yev_loop);
+        } else {
+            if(timeout) {
+                unsigned to_submit = io_uring_sq_ready(&yev_loop->ring);
+                err = io_uring_submit_and_wait_timeout(&yev_loop->ring, &cqe, 1, timeout, NULL);
+                if(err >= 0 || err == -ETIME) {
+                    // Return 0 or -ETIME, the sqes were submitted
+                    stats_submitted(yev_loop, to_submit);
+                }
+            } else {
+                err = io_uring_submit_and_wait(&yev_loop->ring, 1);
+                if(err > 0) {
+                    stats_submitted(yev_loop, (uint64_t)err);
+                }
+            }
+            yev_loop->stats.enter_calls++;
+        }
+        uint64_t t1 = yev_now_nsec();
+        yev_loop->stats.wait_ns += t1 - t0;
+        if(err < 0) {
+            if(err == -EINTR || err == -ETIME) {
+                // Ctrl+C cause EINTR, ETIME is the timeout of timers
                 continue;
             }
-            gobj_log_error(yev_loop->yuno, LOG_OPT_TRACE_STACK,
-                "function",     "%s", __FUNCTION__,
-                "msgset",       "%s", MSGSET_LIBUV_ERROR,
-                "msg",          "%s", "io_uring_wait_cqe() FAILED",
-                "err",          "%d", -err,
-                "serr",         "%s", strerror(-err),
-                NULL
-            );
-            break;
+            if(err != -EAGAIN && err != -EBUSY) {
+                gobj_log_error(yev_loop->yuno, LOG_OPT_TRACE_STACK,
+                    "function",     "%s", __FUNCTION__,
+                    "msgset",       "%s", MSGSET_LIBUV_ERROR,
+                    "msg",          "%s", "io_uring_submit_and_wait() FAILED",
+                    "err",          "%d", -err,
+                    "serr",         "%s", strerror(-err),
+                    NULL
+                );
+                break;
+            }
+            // EAGAIN, EBUSY: kernel without resources, reap the cqes to get room
         }
 
-        process_cqe(yev_loop, cqe);
+        unsigned count = io_uring_peek_batch_cqe(&yev_loop->ring, cqes, YEV_CQE_BATCH_SIZE);
+        if(count > 0) {
+            yev_loop->stats.cqe_batches++;
+            yev_loop->stats.cqes += count;
+            if(count > yev_loop->stats.max_cqe_batch) {
+                yev_loop->stats.max_cqe_batch = count;
+            }
+            unsigned bucket = 31 - (unsigned)__builtin_clz(count);
+            yev_loop->stats.cqes_per_wakeup[MIN(bucket, YEV_STATS_BATCH_BUCKETS-1)]++;
+        }
+        for(unsigned i=0; i<count; i++) {
+            t1 = process_cqe_timed(yev_loop, cqes[i], t1);
+        }
+
+        /* Mark the batch as processed */
+        io_uring_cq_advance(&yev_loop->ring, count);
     }
 
     if(gobj_trace_level(yev_loop->yuno) & TRACE_UV) {
@@ -173,19 +663,13 @@ PUBLIC int yev_loop_run(yev_loop_t *yev_loop)
         );
     }
 
-    cqe = 0;
-    while(io_uring_peek_cqe(&yev_loop->ring, &cqe)==0) {
-        process_cqe(yev_loop, cqe);
-    }
+    yev_loop_run_once(yev_loop);
 
     if(!yev_loop->stopping) {
         yev_loop_stop(yev_loop);
     }
 
-    cqe = 0;
-    while(io_uring_peek_cqe(&yev_loop->ring, &cqe)==0) {
-        process_cqe(yev_loop, cqe);
-    }
+    yev_loop_run_once(yev_loop);
 
     if(gobj_trace_level(yev_loop->yuno) & TRACE_UV) {
         gobj_log_info(yev_loop->yuno, 0,
@@ -206,10 +690,21 @@ PUBLIC int yev_loop_run_once(yev_loop_t *yev_loop)
 {
     struct io_uring_cqe *cqe;
 
+    yev_loop_flush(yev_loop);
+    if(yev_loop->mode & YEV_LOOP_DEFER_TASKRUN) {
+        // The completions are posted only when entering the kernel
+        io_uring_get_events(&yev_loop->ring);
+        yev_loop->stats.enter_calls++;
+    }
+
     cqe = 0;
+    uint64_t t0 = yev_now_nsec();
     while(io_uring_peek_cqe(&yev_loop->ring, &cqe)==0) {
-        process_cqe(yev_loop, cqe);
+        t0 = process_cqe_timed(yev_loop, cqe, t0);
+        io_uring_cqe_seen(&yev_loop->ring, cqe);
     }
+
+    timer_wheel_run(yev_loop);
     return 0;
 }
 
@@ -232,11 +727,23 @@ PUBLIC int yev_loop_stop(yev_loop_t *yev_loop)
         }
 
         struct io_uring_sqe *sqe;
-        sqe = io_uring_get_sqe(&yev_loop->ring);
-        io_uring_sqe_set_data(sqe, NULL);  // HACK CQE event without data is loop ending
-        io_uring_prep_cancel(sqe, 0, IORING_ASYNC_CANCEL_ANY);
-        io_uring_submit(&yev_loop->ring);
+        sqe = yev_get_sqe(yev_loop);
+        if(sqe) {
+            io_uring_sqe_set_data(sqe, NULL);  // HACK CQE event without data is loop ending
+            io_uring_prep_cancel(sqe, 0, IORING_ASYNC_CANCEL_ANY);
+        }
+        yev_loop_flush(yev_loop);
         yev_loop->running = FALSE;
+
+        /*
+         *  The timers are not in the ring, cancel them like the ring's events
+         */
+        timer_wheel_cancel_all(yev_loop);
+
+        /*
+         *  Neither the connects waiting the resolver
+         */
+        dns_cancel_all(yev_loop);
     }
 
     return 0;
@@ -245,70 +752,604 @@ PUBLIC int yev_loop_stop(yev_loop_t *yev_loop)
 /***************************************************************************
  *
  ***************************************************************************/
-PRIVATE int process_cqe(yev_loop_t *yev_loop, struct io_uring_cqe *cqe)
+PUBLIC void yev_loop_set_batch_submit(yev_loop_t *yev_loop, BOOL batch)
 {
-    yev_event_t *yev_event = (yev_event_t *)io_uring_cqe_get_data(cqe);
-    if(!yev_event) {
-        // HACK CQE event without data is loop ending
-        /* Mark this request as processed */
-        io_uring_cqe_seen(&yev_loop->ring, cqe);
-        return cqe->res;
+    if(!batch) {
+        yev_loop_flush(yev_loop);
     }
-    hgobj gobj = yev_event->gobj;
+    yev_loop->batch_submit = batch;
+}
 
-    if(gobj_trace_level(gobj) & TRACE_UV) {
-        do {
-            json_t *jn_flags = bits2jn_strlist(yev_flag_s, yev_event->flag);
-            gobj_log_info(gobj, 0,
+/***************************************************************************
+ *  Flush the pending sqes
+ ***************************************************************************/
+PUBLIC int yev_loop_flush(yev_loop_t *yev_loop)
+{
+    if(io_uring_sq_ready(&yev_loop->ring) == 0) {
+        return 0;
+    }
+
+    int ret = io_uring_submit(&yev_loop->ring);
+    yev_loop->stats.enter_calls++;
+    if(ret < 0) {
+        gobj_log_error(yev_loop->yuno, LOG_OPT_TRACE_STACK,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_LIBUV_ERROR,
+            "msg",          "%s", "io_uring_submit() FAILED",
+            "err",          "%d", -ret,
+            "serr",         "%s", strerror(-ret),
+            NULL
+        );
+        return ret;
+    }
+    stats_submitted(yev_loop, (uint64_t)ret);
+    return ret;
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PUBLIC json_t *yev_loop_stats(yev_loop_t *yev_loop, BOOL reset)
+{
+    yev_loop_stats_t *stats = &yev_loop->stats;
+
+    json_t *jn_stats = json_object();
+    json_object_set_new(jn_stats, "mode", bits2jn_strlist(yev_loop_mode_s, yev_loop->mode));
+    json_object_set_new(jn_stats, "caps", bits2jn_strlist(yev_loop_cap_s, yev_loop->caps));
+    json_object_set_new(jn_stats, "batch_submit", json_boolean(yev_loop->batch_submit));
+    json_object_set_new(jn_stats, "cpu", json_integer(yev_loop->cpu));
+    json_object_set_new(jn_stats, "loop_iterations", json_integer((json_int_t)stats->loop_iterations));
+    json_object_set_new(jn_stats, "enter_calls", json_integer((json_int_t)stats->enter_calls));
+    json_object_set_new(jn_stats, "sqes_submitted", json_integer((json_int_t)stats->sqes_submitted));
+    json_object_set_new(jn_stats, "cqe_batches", json_integer((json_int_t)stats->cqe_batches));
+    json_object_set_new(jn_stats, "cqes", json_integer((json_int_t)stats->cqes));
+    json_object_set_new(jn_stats, "max_cqe_batch", json_integer((json_int_t)stats->max_cqe_batch));
+    json_object_set_new(jn_stats, "sq_full", json_integer((json_int_t)stats->sq_full));
+    json_object_set_new(jn_stats, "recv_buffers",
+        json_integer(yev_loop->recv_ring? (json_int_t)yev_loop->recv_ring->nbufs : 0)
+    );
+    json_object_set_new(jn_stats, "recv_buffer_size", json_integer((json_int_t)yev_loop->recv_buffer_size));
+    json_object_set_new(jn_stats, "recv_buffers_in_use",
+        json_integer(yev_loop->recv_ring? (json_int_t)yev_loop->recv_ring->in_use : 0)
+    );
+    json_object_set_new(jn_stats, "recv_enobufs", json_integer((json_int_t)stats->recv_enobufs));
+    json_object_set_new(jn_stats, "timers", json_integer((json_int_t)yev_loop->timer_wheel->n_timers));
+    json_object_set_new(jn_stats, "timers_fired", json_integer((json_int_t)stats->timers_fired));
+    json_object_set_new(jn_stats, "fixed_files", json_integer((json_int_t)yev_loop->fixed_files));
+    json_object_set_new(jn_stats, "fixed_files_in_use",
+        json_integer(yev_loop->fixed? (json_int_t)yev_loop->fixed->in_use : 0)
+    );
+    json_object_set_new(jn_stats, "fixed_full", json_integer((json_int_t)stats->fixed_full));
+    json_object_set_new(jn_stats, "accepts_direct", json_integer((json_int_t)stats->accepts_direct));
+    json_object_set_new(jn_stats, "accepts_switched", json_integer((json_int_t)stats->accepts_switched));
+    json_object_set_new(jn_stats, "fixed_buffers",
+        json_integer(yev_loop->fixed_bufs? (json_int_t)yev_loop->fixed_bufs->nbufs : 0)
+    );
+    json_object_set_new(jn_stats, "fixed_buffer_size", json_integer((json_int_t)yev_loop->fixed_buffer_size));
+    json_object_set_new(jn_stats, "fixed_buffers_in_use",
+        json_integer(yev_loop->fixed_bufs? (json_int_t)yev_loop->fixed_bufs->in_use : 0)
+    );
+    json_object_set_new(jn_stats, "fixed_bufs_full", json_integer((json_int_t)stats->fixed_bufs_full));
+    json_object_set_new(jn_stats, "fixed_bufs_ops", json_integer((json_int_t)stats->fixed_bufs_ops));
+    json_object_set_new(jn_stats, "zc_sends", json_integer((json_int_t)stats->zc_sends));
+    json_object_set_new(jn_stats, "zc_copied", json_integer((json_int_t)stats->zc_copied));
+    json_object_set_new(jn_stats, "link_timeouts", json_integer((json_int_t)stats->link_timeouts));
+    json_object_set_new(jn_stats, "dgrams_truncated", json_integer((json_int_t)stats->dgrams_truncated));
+    json_object_set_new(jn_stats, "dns_cache_ttl", json_integer((json_int_t)yev_loop->dns_cache_ttl));
+    json_object_set_new(jn_stats, "dns_cache_hits", json_integer((json_int_t)stats->dns_cache_hits));
+    json_object_set_new(jn_stats, "dns_resolves", json_integer((json_int_t)stats->dns_resolves));
+    json_object_set_new(jn_stats, "dns_async_resolves", json_integer((json_int_t)stats->dns_async_resolves));
+    json_object_set_new(jn_stats, "dns_block_ms", json_integer((json_int_t)(stats->dns_block_ns/1000000)));
+    json_object_set_new(jn_stats, "dns_wait_ms", json_integer((json_int_t)(stats->dns_wait_ns/1000000)));
+    json_object_set_new(jn_stats, "dns_max_wait_ms", json_integer((json_int_t)(stats->dns_max_wait_ns/1000000)));
+    json_object_set_new(jn_stats, "msgs_sent", json_integer((json_int_t)stats->msgs_sent));
+    json_object_set_new(jn_stats, "msgs_failed", json_integer((json_int_t)stats->msgs_failed));
+    json_object_set_new(jn_stats, "bulk_cancels", json_integer((json_int_t)stats->bulk_cancels));
+    json_object_set_new(jn_stats, "bulk_cancelled", json_integer((json_int_t)stats->bulk_cancelled));
+    json_object_set_new(jn_stats, "bulk_cancels_failed", json_integer((json_int_t)stats->bulk_cancels_failed));
+    json_object_set_new(jn_stats, "closes_deferred", json_integer((json_int_t)stats->closes_deferred));
+    json_object_set_new(jn_stats, "events_allocated", json_integer((json_int_t)yev_loop->events_allocated));
+    json_object_set_new(jn_stats, "events_in_use", json_integer((json_int_t)yev_loop->events_in_use));
+    json_object_set_new(jn_stats, "events_zombies", json_integer((json_int_t)yev_loop->events_zombies));
+    json_object_set_new(jn_stats, "syscalls_per_iteration", json_real(
+        stats->loop_iterations? (double)stats->enter_calls/(double)stats->loop_iterations : 0
+    ));
+    json_object_set_new(jn_stats, "cqes_per_batch", json_real(
+        stats->cqe_batches? (double)stats->cqes/(double)stats->cqe_batches : 0
+    ));
+
+    /*
+     *  Latency and saturation
+     */
+    json_t *jn_wakeups = json_object();
+    for(int i=0; i<YEV_STATS_BATCH_BUCKETS; i++) {
+        char key[32];
+        if(i == 0) {
+            snprintf(key, sizeof(key), "1");
+        } else if(i < YEV_STATS_BATCH_BUCKETS-1) {
+            snprintf(key, sizeof(key), "%u-%u", 1u<<i, (2u<<i)-1);
+        } else {
+            snprintf(key, sizeof(key), ">=%u", 1u<<i);
+        }
+        json_object_set_new(jn_wakeups, key, json_integer((json_int_t)stats->cqes_per_wakeup[i]));
+    }
+    json_object_set_new(jn_stats, "cqes_per_wakeup", jn_wakeups);
+    json_object_set_new(jn_stats, "sqes_in_flight", json_integer((json_int_t)yev_loop->sqes_in_flight));
+    json_object_set_new(jn_stats, "max_in_flight", json_integer((json_int_t)stats->max_in_flight));
+    json_object_set_new(jn_stats, "wait_ms", json_integer((json_int_t)(stats->wait_ns/1000000)));
+    json_object_set_new(jn_stats, "callbacks_ms", json_integer((json_int_t)(stats->callbacks_ns/1000000)));
+    json_object_set_new(jn_stats, "busy_ratio", json_real(
+        (stats->wait_ns + stats->callbacks_ns)?
+            (double)stats->callbacks_ns/(double)(stats->wait_ns + stats->callbacks_ns) : 0
+    ));
+
+    json_t *jn_callbacks = json_object();
+    for(int type=0; type<YEV_STATS_TYPES; type++) {
+        yev_type_stats_t *ts = &stats->types[type];
+        if(!ts->callbacks) {
+            continue;
+        }
+        json_t *jn_histogram = json_object();
+        for(int i=0; i<YEV_STATS_LATENCY_BUCKETS; i++) {
+            if(!ts->histogram[i]) {
+                continue;
+            }
+            char key[32];
+            if(i < YEV_STATS_LATENCY_BUCKETS-1) {
+                snprintf(key, sizeof(key), "<%uus", 1u<<i);
+            } else {
+                snprintf(key, sizeof(key), ">=%uus", 1u<<(i-1));
+            }
+            json_object_set_new(jn_histogram, key, json_integer((json_int_t)ts->histogram[i]));
+        }
+        json_object_set_new(jn_callbacks, yev_type_name((yev_type_t)type), json_pack("{s:I, s:I, s:I, s:o}",
+            "callbacks", (json_int_t)ts->callbacks,
+            "avg_us", (json_int_t)(ts->total_ns/ts->callbacks/1000),
+            "max_us", (json_int_t)(ts->max_ns/1000),
+            "histogram", jn_histogram
+        ));
+    }
+    json_object_set_new(jn_stats, "callbacks", jn_callbacks);
+    json_object_set_new(jn_stats, "slowest_callback", json_pack("{s:I, s:s, s:s, s:I}",
+        "us", (json_int_t)(stats->slowest_ns/1000),
+        "type", stats->slowest_ns? yev_type_name((yev_type_t)stats->slowest_type) : "",
+        "gclass", stats->slowest_gclass? stats->slowest_gclass : "",
+        "t", (json_int_t)stats->slowest_t
+    ));
+
+    if(reset) {
+        memset(stats, 0, sizeof(*stats));
+    }
+    return jn_stats;
+}
+
+/***************************************************************************
+ *  Get a sqe, if the SQ is full then flush the pending sqes and retry
+ ***************************************************************************/
+PRIVATE struct io_uring_sqe *yev_get_sqe(yev_loop_t *yev_loop)
+{
+    struct io_uring_sqe *sqe = io_uring_get_sqe(&yev_loop->ring);
+    if(!sqe) {
+        yev_loop->stats.sq_full++;
+        yev_loop_flush(yev_loop);
+        sqe = io_uring_get_sqe(&yev_loop->ring);
+        if(!sqe) {
+            gobj_log_error(yev_loop->yuno, LOG_OPT_TRACE_STACK,
                 "function",     "%s", __FUNCTION__,
-                "msgset",       "%s", MSGSET_YEV_LOOP,
-                "msg",          "%s", "process_cqe",
-                "msg2",         "%s", "💥💥💥💥⏪ process_cqe",
-                "type",         "%s", yev_event_type_name(yev_event),
-                "loop_running", "%d", yev_loop->running?1:0,
-                "loop_stopping","%d", yev_loop->stopping?1:0,
-                "p",            "%p", yev_event,
-                "fd",           "%d", yev_event->fd,
-                "flag",         "%j", jn_flags,
-                "cqe->res",     "%d", (int)cqe->res,
-                "sres",         "%s", (cqe->res<0)? strerror(-cqe->res):"",
+                "msgset",       "%s", MSGSET_LIBUV_ERROR,
+                "msg",          "%s", "io_uring SQ full",
+                "entries",      "%d", (int)yev_loop->entries,
                 NULL
             );
-            json_decref(jn_flags);
-        } while(0);
+        }
     }
+    return sqe;
+}
 
-    yev_set_flag(yev_event, YEV_FLAG_IN_RING, FALSE);
-    if(cqe->res == -ECANCELED && yev_event_cancelling(yev_event)) {
-        yev_set_flag(yev_event, YEV_FLAG_CANCELLING, FALSE);
+/***************************************************************************
+ *  The operation of the event will be submitted with a linked timeout
+ ***************************************************************************/
+PRIVATE BOOL yev_event_linkable(yev_event_t *yev_event)
+{
+    if(!yev_event->timeout_ms) {
+        return FALSE;
     }
-
     switch((yev_type_t)yev_event->type) {
         case YEV_READ_TYPE:
-            {
-                if(cqe->res == 0) {
-                    cqe->res = -EPIPE; // force EPIPE, close by peer
-                    /*
-                     *  Behaviour seen in YEV_READ_TYPE type when socket has broken:
-                     *      - cqe->res = 0
-                     *
-                     *      Repeated forever
-                     */
-                }
+        case YEV_WRITE_TYPE:
+        case YEV_WRITEV_TYPE:
+        case YEV_CONNECT_TYPE:
+        case YEV_RECVMSG_TYPE:
+        case YEV_SENDMSG_TYPE:
+            return TRUE;
+        default:
+            return FALSE;
+    }
+}
 
-                if(cqe->res > 0 && yev_event->gbuf) {
-                    // Mark the written bytes of reading fd
-                    gbuffer_set_wr(yev_event->gbuf, cqe->res);
-                }
+/***************************************************************************
+ *  Get the sqe of the event's operation,
+ *  with a linked timeout the two sqes must go in the same submit.
+ ***************************************************************************/
+PRIVATE struct io_uring_sqe *yev_get_event_sqe(yev_event_t *yev_event)
+{
+    yev_loop_t *yev_loop = yev_event->yev_loop;
 
-                /*
-                 *  Call callback
-                 */
-                yev_event->result = cqe->res;
-                if (yev_event->callback) {
-                    yev_event->callback(
-                        yev_event
-                    );
+    if(yev_event_linkable(yev_event) && io_uring_sq_space_left(&yev_loop->ring) < 2) {
+        yev_loop->stats.sq_full++;
+        yev_loop_flush(yev_loop);
+    }
+    return yev_get_sqe(yev_loop);
+}
+
+/***************************************************************************
+ *  Link a timeout to the operation's sqe (already prepared)
+ ***************************************************************************/
+PRIVATE void sqe_link_timeout(yev_event_t *yev_event, struct io_uring_sqe *sqe)
+{
+    if(!yev_event_linkable(yev_event)) {
+        return;
+    }
+    yev_loop_t *yev_loop = yev_event->yev_loop;
+
+    struct io_uring_sqe *sqe_timeout = io_uring_get_sqe(&yev_loop->ring); // space reserved
+    if(!sqe_timeout) {
+        gobj_log_error(yev_loop->yuno, LOG_OPT_TRACE_STACK,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_LIBUV_ERROR,
+            "msg",          "%s", "io_uring SQ full, operation without timeout",
+            "event_type",   "%s", yev_event_type_name(yev_event),
+            "p",            "%p", yev_event,
+            NULL
+        );
+        return;
+    }
+
+    yev_event->timeout_ts.tv_sec = yev_event->timeout_ms / 1000;
+    yev_event->timeout_ts.tv_nsec = (long long)(yev_event->timeout_ms % 1000) * 1000000;
+    sqe->flags |= IOSQE_IO_LINK;
+    io_uring_prep_link_timeout(sqe_timeout, &yev_event->timeout_ts, 0);
+    io_uring_sqe_set_data64(sqe_timeout, YEV_UDATA_LINK_TIMEOUT);
+}
+
+/***************************************************************************
+ *  Account the sqes submitted, they are in flight until their final cqe
+ ***************************************************************************/
+PRIVATE void stats_submitted(yev_loop_t *yev_loop, uint64_t sqes)
+{
+    yev_loop->stats.sqes_submitted += sqes;
+    yev_loop->sqes_in_flight += sqes;
+    if(yev_loop->sqes_in_flight > yev_loop->stats.max_in_flight) {
+        yev_loop->stats.max_in_flight = yev_loop->sqes_in_flight;
+    }
+}
+
+/***************************************************************************
+ *  Account the duration of a callback
+ ***************************************************************************/
+PRIVATE void stats_callback(yev_loop_t *yev_loop, uint8_t type, gclass_name_t gclass_name, uint64_t ns)
+{
+    yev_loop_stats_t *stats = &yev_loop->stats;
+    yev_type_stats_t *ts = &stats->types[type % YEV_STATS_TYPES];
+
+    uint64_t us = ns/1000;
+    unsigned bucket = us? 64 - (unsigned)__builtin_clzll(us) : 0;
+
+    stats->callbacks_ns += ns;
+    ts->callbacks++;
+    ts->total_ns += ns;
+    ts->histogram[MIN(bucket, YEV_STATS_LATENCY_BUCKETS-1)]++;
+    if(ns > ts->max_ns) {
+        ts->max_ns = ns;
+    }
+    if(ns > stats->slowest_ns) {
+        stats->slowest_ns = ns;
+        stats->slowest_type = type;
+        stats->slowest_gclass = gclass_name;
+        stats->slowest_t = time(NULL);
+    }
+}
+
+/***************************************************************************
+ *  Process the cqe measuring its callback,
+ *  t0 is the end of the previous one (a clock read per cqe).
+ *  Return the end time.
+ ***************************************************************************/
+PRIVATE uint64_t process_cqe_timed(yev_loop_t *yev_loop, struct io_uring_cqe *cqe, uint64_t t0)
+{
+    yev_event_t *yev_event = (yev_event_t *)io_uring_cqe_get_data(cqe);
+    if(!yev_event ||
+            cqe->user_data == LIBURING_UDATA_TIMEOUT ||
+            cqe->user_data == YEV_UDATA_LINK_TIMEOUT ||
+            cqe->user_data == YEV_UDATA_MSG_RING ||
+            cqe->user_data == YEV_UDATA_CANCEL ||
+            yev_udata_is_cancel_fd(cqe->user_data) ||
+            yev_udata_is_fd_install(cqe->user_data) ||
+            yev_event->zombie) {
+        process_cqe(yev_loop, cqe);
+        if(yev_loop->cancels_done) {
+            cancel_groups_inform(yev_loop);
+        }
+        return t0;
+    }
+
+    /*
+     *  Get the data before the callback, it can destroy the event and the gobj
+     */
+    uint8_t type = yev_event->type;
+    gclass_name_t gclass_name = yev_event->gobj? gobj_gclass_name(yev_event->gobj) : NULL;
+
+    process_cqe(yev_loop, cqe);
+    if(yev_loop->cancels_done) {
+        cancel_groups_inform(yev_loop);
+    }
+
+    uint64_t t1 = yev_now_nsec();
+    stats_callback(yev_loop, type, gclass_name, t1 - t0);
+    return t1;
+}
+
+/***************************************************************************
+ *  In batched mode and loop running, the sqes are flushed by yev_loop_run()
+ ***************************************************************************/
+PRIVATE void yev_submit(yev_loop_t *yev_loop)
+{
+    if(yev_loop->batch_submit && yev_loop->running) {
+        return;
+    }
+    yev_loop_flush(yev_loop);
+}
+
+/***************************************************************************
+ *  The cqe is marked as seen by the caller
+ ***************************************************************************/
+PRIVATE int process_cqe(yev_loop_t *yev_loop, struct io_uring_cqe *cqe)
+{
+    yev_event_t *yev_event = (yev_event_t *)io_uring_cqe_get_data(cqe);
+    BOOL posted = FALSE;    // cqe posted by other loop with yev_send_msg(), without sqe in this loop
+    if(yev_event &&
+            cqe->user_data != LIBURING_UDATA_TIMEOUT &&
+            cqe->user_data != YEV_UDATA_LINK_TIMEOUT &&
+            cqe->user_data != YEV_UDATA_MSG_RING &&
+            cqe->user_data != YEV_UDATA_CANCEL &&
+            !yev_udata_is_cancel_fd(cqe->user_data) &&
+            !yev_udata_is_fd_install(cqe->user_data)) {
+        posted = ((yev_type_t)yev_event->type == YEV_MSG_TYPE)? TRUE:FALSE;
+    }
+    if(!(cqe->flags & IORING_CQE_F_MORE) && cqe->user_data != LIBURING_UDATA_TIMEOUT && !posted &&
+            yev_loop->sqes_in_flight > 0) {
+        yev_loop->sqes_in_flight--;     // final cqe of its sqe
+    }
+    if(!yev_event) {
+        // HACK CQE event without data is loop ending
+        return cqe->res;
+    }
+    if(cqe->user_data == LIBURING_UDATA_TIMEOUT) {
+        // Internal timeout of io_uring_submit_and_wait_timeout() in kernels without EXT_ARG
+        return cqe->res;
+    }
+    if(cqe->user_data == YEV_UDATA_LINK_TIMEOUT) {
+        // Linked timeout, the result is informed in the cqe of its operation
+        return cqe->res;
+    }
+    if(cqe->user_data == YEV_UDATA_MSG_RING) {
+        // Result of a yev_send_msg() of this loop, the message is in the ring of the receiver
+        if(cqe->res < 0) {
+            yev_loop->stats.msgs_failed++;
+        }
+        return cqe->res;
+    }
+    if(cqe->user_data == YEV_UDATA_CANCEL) {
+        // Cancel sqe, the result of the operations cancelled is informed in their cqes
+        return cqe->res;
+    }
+    if(yev_udata_is_cancel_fd(cqe->user_data)) {
+        /*
+         *  Cancel sqe by fd. -ENOENT: the operations had returned yet, their cqes are coming.
+         *  Other error (the kernel doesn't know the fd or IORING_ASYNC_CANCEL_FD):
+         *  the operations are cancelled one by one.
+         */
+        if(cqe->res < 0 && cqe->res != -ENOENT) {
+            yev_loop->stats.bulk_cancels_failed++;
+            cancel_fd_ops_by_event(yev_loop, (int)(cqe->user_data & 0xFFFFFFFF));
+        }
+        return cqe->res;
+    }
+    if(yev_udata_is_fd_install(cqe->user_data)) {
+        // fd of a socket accepted in a fixed slot, now it goes to its accept event
+        accept_fd_installed(yev_loop, (int)(cqe->user_data & 0xFFFFFFFF), cqe->res);
+        return cqe->res;
+    }
+    if(yev_event->zombie) {
+        // Destroyed while in ring, nobody to inform
+        process_zombie_cqe(yev_loop, yev_event, cqe);
+        return cqe->res;
+    }
+    if(yev_event->sync_pending > 1) {
+        /*
+         *  Write of a write+fdatasync chain, keep its result until the cqe of the fdatasync
+         */
+        yev_event->sync_pending--;
+        yev_event->result = cqe->res;
+        return cqe->res;
+    }
+    hgobj gobj = yev_event->gobj;
+
+    if(gobj_trace_level(gobj) & TRACE_UV) {
+        do {
+            json_t *jn_flags = bits2jn_strlist(yev_flag_s, yev_event->flag);
+            gobj_log_info(gobj, 0,
+                "function",     "%s", __FUNCTION__,
+                "msgset",       "%s", MSGSET_YEV_LOOP,
+                "msg",          "%s", "process_cqe",
+                "msg2",         "%s", "💥💥💥💥⏪ process_cqe",
+                "type",         "%s", yev_event_type_name(yev_event),
+                "loop_running", "%d", yev_loop->running?1:0,
+                "loop_stopping","%d", yev_loop->stopping?1:0,
+                "p",            "%p", yev_event,
+                "fd",           "%d", yev_event->fd,
+                "flag",         "%j", jn_flags,
+                "cqe->res",     "%d", (int)cqe->res,
+                "sres",         "%s", (cqe->res<0)? strerror(-cqe->res):"",
+                NULL
+            );
+            json_decref(jn_flags);
+        } while(0);
+    }
+
+    BOOL cancelling = yev_event_cancelling(yev_event);
+    if(!(cqe->flags & IORING_CQE_F_MORE)) {
+        /*
+         *  The multishot events stay in ring while F_MORE.
+         *  The cancel ends with the last cqe, the operation cancelled or complete before.
+         */
+        yev_set_flag(yev_event, YEV_FLAG_IN_RING, FALSE);
+        yev_set_flag(yev_event, YEV_FLAG_CANCELLING, FALSE);
+        fd_ops_del(yev_event);
+        cancel_group_done(yev_event);
+    }
+    if(cqe->res == -ECANCELED && !cancelling && yev_event_linkable(yev_event)) {
+        // Not cancelled by the user, cancelled by its linked timeout
+        yev_loop->stats.link_timeouts++;
+        cqe->res = -ETIMEDOUT;
+    }
+
+    switch((yev_type_t)yev_event->type) {
+        case YEV_READ_TYPE:
+            {
+                if(cqe->res == 0) {
+                    cqe->res = -EPIPE; // force EPIPE, close by peer
+                    /*
+                     *  Behaviour seen in YEV_READ_TYPE type when socket has broken:
+                     *      - cqe->res = 0
+                     *
+                     *      Repeated forever
+                     */
+                }
+
+                if(cqe->res > 0 && yev_event->gbuf) {
+                    // Mark the written bytes of reading fd
+                    gbuffer_set_wr(yev_event->gbuf, cqe->res);
+                }
+
+                /*
+                 *  Call callback
+                 */
+                yev_event->result = cqe->res;
+                if (yev_event->callback) {
+                    yev_event->callback(
+                        yev_event
+                    );
+                }
+            }
+            break;
+
+        case YEV_RECV_MULTISHOT_TYPE:
+        case YEV_RECVMSG_MULTISHOT_TYPE:
+            {
+                yev_recv_ring_t *recv_ring = yev_loop->recv_ring;
+                if(cqe->res == -ENOBUFS && recv_ring) {
+                    /*
+                     *  Ring without buffers, the multishot is terminated.
+                     *  Wait until a buffer is returned to re-arm, don't inform the user.
+                     */
+                    yev_loop->stats.recv_enobufs++;
+                    if(yev_loop->running && !cancelling && yev_event->fd > 0) {
+                        if(recv_ring->in_use < recv_ring->nbufs) {
+                            rearm_recv_multishot(yev_event);
+                        } else {
+                            recv_ring_add_starved(recv_ring, yev_event);
+                        }
+                    }
+                    break;
+                }
+
+                if(cqe->res == 0 && yev_event->type == YEV_RECV_MULTISHOT_TYPE) {
+                    cqe->res = -EPIPE; // force EPIPE, close by peer, like YEV_READ_TYPE
+                }
+
+                gbuffer_t *gbuf_rx = NULL;
+                if((cqe->flags & IORING_CQE_F_BUFFER) && recv_ring) {
+                    unsigned bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+                    char *data = recv_ring->buffers + (size_t)bid * recv_ring->stride;
+                    char *payload = data;
+                    recv_ring->in_use++;
+                    size_t len = cqe->res > 0? (size_t)cqe->res : 0;
+                    if(yev_event->type == YEV_RECVMSG_MULTISHOT_TYPE && cqe->res >= 0) {
+                        /*
+                         *  The buffer has the io_uring_recvmsg_out header,
+                         *  the source address and the payload of the datagram
+                         */
+                        yev_msghdr_t *msghdr = yev_event->msghdr;
+                        struct io_uring_recvmsg_out *o = io_uring_recvmsg_validate(
+                            data, cqe->res, &msghdr->msg
+                        );
+                        if(o) {
+                            msghdr->peerlen = MIN(o->namelen, msghdr->msg.msg_namelen);
+                            memcpy(&msghdr->peer, io_uring_recvmsg_name(o), msghdr->peerlen);
+                            if(o->flags & MSG_TRUNC) {
+                                yev_loop->stats.dgrams_truncated++;
+                            }
+                            payload = io_uring_recvmsg_payload(o, &msghdr->msg);
+                            len = io_uring_recvmsg_payload_length(o, cqe->res, &msghdr->msg);
+                            cqe->res = (int)len;
+                        } else {
+                            msghdr->peerlen = 0;
+                            len = 0;
+                            cqe->res = -EMSGSIZE;
+                        }
+                    }
+                    gbuffer_t *gbuf = gbuffer_create_external(
+                        payload,
+                        recv_ring->buf_size - (size_t)(payload - data),
+                        len,
+                        recv_ring_give_back,
+                        recv_ring
+                    );
+                    if(!gbuf) {
+                        // Error already logged
+                        recv_ring_give_back(recv_ring, data);
+                        cqe->res = -ENOMEM;
+                    }
+                    yev_set_gbuffer(yev_event, gbuf);
+                    /*
+                     *  Own reference: the callback can destroy the event,
+                     *  and its slot be reused, before releasing the buffer of the ring
+                     */
+                    gbuf_rx = gbuf;
+                    GBUFFER_INCREF(gbuf_rx)
+                }
+
+                /*
+                 *  Call callback
+                 */
+                yev_event->result = cqe->res;
+                int ret = 0;
+                if(yev_event->callback) {
+                    ret = yev_event->callback(
+                        yev_event
+                    );
+                }
+
+                /*
+                 *  The callback must incref the gbuffer to keep it.
+                 *  With ret != 0 the event can be destroyed, don't touch it.
+                 */
+                if(ret == 0 && gbuf_rx && yev_event->gbuf == gbuf_rx) {
+                    GBUFFER_DECREF(yev_event->gbuf)
+                }
+                GBUFFER_DECREF(gbuf_rx)
+
+                if(ret == 0 && yev_loop->running && cqe->res >= 0 && !(cqe->flags & IORING_CQE_F_MORE)) {
+                    if(!gobj || (gobj && gobj_is_running(gobj))) {
+                        /*
+                         *  Multishot terminated by the kernel without error, rearm
+                         */
+                        if(!yev_event_in_ring(yev_event) && !cancelling &&
+                                yev_event->fd > 0) {
+                            rearm_recv_multishot(yev_event);
+                        }
+                    }
                 }
             }
             break;
@@ -346,53 +1387,37 @@ PRIVATE int process_cqe(yev_loop_t *yev_loop, struct io_uring_cqe *cqe)
             }
             break;
 
-        case YEV_ACCEPT_TYPE:
+        case YEV_WRITEV_TYPE:
             {
                 /*
-                 *  Call callback
+                 *  The user consumes his buffers with the bytes written
                  */
-                yev_event->result = cqe->res; // cli_srv socket
-                if(yev_event->result > 0) {
-                    if (is_tcp_socket(yev_event->result)) {
-                        set_tcp_socket_options(yev_event->result);
-                    }
-                }
-
-                int ret = 0;
+                yev_event->result = cqe->res;
                 if(yev_event->callback) {
-                    ret = yev_event->callback(
+                    yev_event->callback(
                         yev_event
                     );
                 }
-
-                if(ret == 0 && yev_loop->running && cqe->res > 0) {
-                    if(!gobj || (gobj && gobj_is_running(gobj))) {
-                        /*
-                         *  Rearm accept event
-                         */
-                        struct io_uring_sqe *sqe = io_uring_get_sqe(&yev_loop->ring);
-                        io_uring_sqe_set_data(sqe, yev_event);
-                        yev_event->src_addrlen = sizeof(*yev_event->src_addr);
-                        io_uring_prep_accept(
-                            sqe,
-                            yev_event->fd,
-                            yev_event->src_addr,
-                            &yev_event->src_addrlen,
-                            0
-                        );
-                        io_uring_submit(&yev_loop->ring);
-                        yev_set_flag(yev_event, YEV_FLAG_IN_RING, TRUE);
-                    }
-                }
             }
             break;
 
-        case YEV_CONNECT_TYPE:
+        case YEV_RECVMSG_TYPE:
             {
-                if(cqe->res < 0) {
-                    yev_set_flag(yev_event, YEV_FLAG_CONNECTED, FALSE); // user TODO
+                /*
+                 *  In datagram sockets 0 is an empty datagram, not a close
+                 */
+                yev_msghdr_t *msghdr = yev_event->msghdr;
+                if(cqe->res >= 0) {
+                    msghdr->peerlen = msghdr->msg.msg_namelen;
+                    if(msghdr->msg.msg_flags & MSG_TRUNC) {
+                        yev_loop->stats.dgrams_truncated++;
+                    }
+                    if(cqe->res > 0 && yev_event->gbuf) {
+                        // Mark the written bytes of reading fd
+                        gbuffer_set_wr(yev_event->gbuf, cqe->res);
+                    }
                 } else {
-                    yev_set_flag(yev_event, YEV_FLAG_CONNECTED, TRUE);
+                    msghdr->peerlen = 0;
                 }
 
                 /*
@@ -407,58 +1432,321 @@ PRIVATE int process_cqe(yev_loop_t *yev_loop, struct io_uring_cqe *cqe)
             }
             break;
 
-        case YEV_TIMER_TYPE:
+        case YEV_SENDMSG_TYPE:
             {
+                if(cqe->res > 0 && yev_event->gbuf) {
+                    // Pop the bytes sent
+                    gbuffer_get(yev_event->gbuf, cqe->res);
+                }
+
                 /*
                  *  Call callback
                  */
                 yev_event->result = cqe->res;
-                int ret = 0;
                 if(yev_event->callback) {
-                    ret = yev_event->callback(
+                    yev_event->callback(
                         yev_event
                     );
                 }
+            }
+            break;
 
-                if(ret == 0 && yev_loop->running && cqe->res > 0 && (yev_event->flag & YEV_FLAG_TIMER_PERIODIC)) {
-                    if(!gobj || (gobj && gobj_is_running(gobj))) {
-                        /*
-                         *  Rearm periodic timer event
-                         */
-                        struct io_uring_sqe *sqe = io_uring_get_sqe(&yev_loop->ring);
-                        io_uring_sqe_set_data(sqe, yev_event);
-                        io_uring_prep_read(
-                            sqe,
-                            yev_event->fd,
-                            &yev_event->timer_bf,
-                            sizeof(yev_event->timer_bf),
-                            0
-                        );
-                        io_uring_submit(&yev_loop->ring);
-                        yev_set_flag(yev_event, YEV_FLAG_IN_RING, TRUE);
+        case YEV_SEND_ZC_TYPE:
+            {
+                if(!(cqe->flags & IORING_CQE_F_NOTIF)) {
+                    /*
+                     *  Result of the send, with F_MORE the notification will come
+                     */
+                    yev_event->result = cqe->res;
+                    yev_set_flag(yev_event, YEV_FLAG_ZC_COPIED, FALSE);
+                    if(cqe->flags & IORING_CQE_F_MORE) {
+                        break;
+                    }
+                } else {
+                    /*
+                     *  Notification: the kernel has released the buffer
+                     */
+                    yev_loop->stats.zc_sends++;
+                    if((yev_loop->caps & YEV_CAP_SEND_ZC_REPORT_USAGE) &&
+                            (cqe->res & (int)IORING_NOTIF_USAGE_ZC_COPIED)) {
+                        yev_set_flag(yev_event, YEV_FLAG_ZC_COPIED, TRUE);
+                        yev_loop->stats.zc_copied++;
                     }
                 }
+
+                if(yev_event->result > 0 && yev_event->gbuf) {
+                    // Pop the bytes sent
+                    gbuffer_get(yev_event->gbuf, (size_t)yev_event->result);
+                }
+
+                /*
+                 *  Call callback
+                 */
+                if(yev_event->callback) {
+                    yev_event->callback(
+                        yev_event
+                    );
+                }
             }
             break;
-    }
 
-    /* Mark this request as processed */
-    io_uring_cqe_seen(&yev_loop->ring, cqe);
+        case YEV_ACCEPT_TYPE:
+            {
+                int ret = 0;
+                if(yev_event->accept_direct && cqe->res >= 0) {
+                    /*
+                     *  Socket accepted in the fixed slot `res`,
+                     *  the callback is called with its fd when installed
+                     */
+                    yev_loop->stats.accepts_direct++;
+                    yev_loop->fixed->direct_used++;
+                    accept_fd_install(yev_loop, yev_event, cqe->res);
 
-    return 0;
-}
+                } else if(yev_event->accept_direct && cqe->res == -ENFILE) {
+                    /*
+                     *  No free slot (a burst faster than the switch to plain),
+                     *  the kernel closed the socket. Rearm with plain accept.
+                     */
+                    gobj_log_warning(gobj, 0,
+                        "function",     "%s", __FUNCTION__,
+                        "msgset",       "%s", MSGSET_YEV_LOOP,
+                        "msg",          "%s", "No free fixed slot to accept direct, socket lost",
+                        "fd",           "%d", yev_event->fd,
+                        NULL
+                    );
+                    yev_loop->stats.fixed_full++;
+                    yev_event->accept_switch = TRUE;
 
-/***************************************************************************
- *
- ***************************************************************************/
-PUBLIC int yev_set_gbuffer( // only for yev_create_read_event() and yev_create_write_event()
-    yev_event_t *yev_event,
-    gbuffer_t *gbuf // WARNING if there is previous gbuffer it will be free
-) {
-    if(gbuf == yev_event->gbuf) {
-        return 0;
-    }
-    if(yev_event->gbuf) {
+                } else if(cqe->res == -ECANCELED && yev_event->accept_switch && !cancelling) {
+                    // Cancelled by accept_switch(), rearm below
+
+                } else {
+                    /*
+                     *  Call callback
+                     */
+                    yev_event->result = cqe->res; // cli_srv socket
+                    if(yev_event->result > 0) {
+                        if (is_tcp_socket(yev_event->result)) {
+                            set_tcp_socket_options(yev_event->result);
+                        }
+                        yev_register_fd(yev_loop, yev_event->result);
+                    }
+
+                    if(yev_event->callback) {
+                        ret = yev_event->callback(
+                            yev_event
+                        );
+                    }
+                }
+
+                /*
+                 *  The multishot accept keeps armed while F_MORE
+                 */
+                if((cqe->flags & IORING_CQE_F_MORE) && ret == 0) {
+                    accept_switch(yev_loop, yev_event);
+                }
+                if(!(cqe->flags & IORING_CQE_F_MORE) && !yev_event_in_ring(yev_event) &&
+                        ret == 0 && yev_loop->running &&
+                        (cqe->res > 0 || (yev_event->accept_switch && !cancelling))) {
+                    if(!gobj || (gobj && gobj_is_running(gobj))) {
+                        /*
+                         *  Rearm accept event
+                         */
+                        struct io_uring_sqe *sqe = yev_get_sqe(yev_loop);
+                        if(sqe) {
+                            io_uring_sqe_set_data(sqe, yev_event);
+                            prep_accept(yev_loop, sqe, yev_event);
+                            yev_submit(yev_loop);
+                            set_in_ring(yev_event);
+                        }
+                    }
+                }
+            }
+            break;
+
+        case YEV_CONNECT_TYPE:
+            {
+                if(cqe->res < 0) {
+                    yev_set_flag(yev_event, YEV_FLAG_CONNECTED, FALSE); // user TODO
+                } else {
+                    yev_set_flag(yev_event, YEV_FLAG_CONNECTED, TRUE);
+                }
+
+                /*
+                 *  Call callback
+                 */
+                yev_event->result = cqe->res;
+                if(yev_event->callback) {
+                    yev_event->callback(
+                        yev_event
+                    );
+                }
+            }
+            break;
+
+        case YEV_MSG_TYPE:
+            {
+                /*
+                 *  Call callback, with the value sent by the other loop
+                 */
+                yev_event->result = cqe->res;
+                if(yev_event->callback) {
+                    yev_event->callback(
+                        yev_event
+                    );
+                }
+            }
+            break;
+
+        case YEV_FILE_READ_TYPE:
+            {
+                if(cqe->res > 0 && yev_event->gbuf) {
+                    // Mark the written bytes of reading the file (after the previous ones), 0 is end of file
+                    gbuffer_set_wr(yev_event->gbuf, gbuffer_totalbytes(yev_event->gbuf) + (size_t)cqe->res);
+                }
+
+                /*
+                 *  Call callback
+                 */
+                yev_event->result = cqe->res;
+                if(yev_event->callback) {
+                    yev_event->callback(
+                        yev_event
+                    );
+                }
+            }
+            break;
+
+        case YEV_FILE_WRITE_TYPE:
+            {
+                int res = cqe->res;
+                if(yev_event->sync_pending) {
+                    /*
+                     *  Cqe of the linked fdatasync, the result of the write was kept.
+                     *  A failed or short write breaks the link, the fdatasync is cancelled.
+                     */
+                    yev_event->sync_pending = 0;
+                    res = yev_event->result;
+                    if(res >= 0 && cqe->res < 0 && cqe->res != -ECANCELED) {
+                        res = cqe->res;
+                    }
+                }
+
+                if(res > 0 && yev_event->gbuf) {
+                    // Pop the read bytes used to write the file
+                    gbuffer_get(yev_event->gbuf, res);
+                }
+
+                /*
+                 *  Call callback
+                 */
+                yev_event->result = res;
+                if(yev_event->callback) {
+                    yev_event->callback(
+                        yev_event
+                    );
+                }
+            }
+            break;
+
+        case YEV_FSYNC_TYPE:
+        case YEV_POLL_TYPE:
+            {
+                /*
+                 *  Call callback
+                 */
+                yev_event->result = cqe->res;
+                if(yev_event->callback) {
+                    yev_event->callback(
+                        yev_event
+                    );
+                }
+            }
+            break;
+
+        case YEV_SPLICE_TYPE:
+            {
+                int res = cqe->res; // bytes from the pipe to the fd
+                if(yev_event->sync_pending) {
+                    /*
+                     *  Cqe of the pipe->fd splice of the chain, the result of fd_in->pipe was kept.
+                     *  A short fd_in->pipe breaks the link, the pipe->fd is cancelled.
+                     */
+                    yev_event->sync_pending = 0;
+                    int in_res = yev_event->result;
+                    if(in_res <= 0) {
+                        res = in_res;   // end of file or error, nothing in the pipe
+                    } else {
+                        yev_event->in_pipe += (uint32_t)in_res;
+                        yev_event->splice_moved = (uint32_t)in_res;
+                        if(res == -ECANCELED && !cancelling) {
+                            res = 0;    // link broken by a short fd_in->pipe, drain what is in the pipe
+                        }
+                    }
+                    if(in_res < 0 || (in_res == 0 && yev_event->in_pipe == 0)) {
+                        yev_event->result = in_res;
+                        if(yev_event->callback) {
+                            yev_event->callback(
+                                yev_event
+                            );
+                        }
+                        break;
+                    }
+                } else if(res == 0 && yev_event->in_pipe > 0) {
+                    res = -EPIPE;   // the fd doesn't take more data
+                }
+
+                if(res < 0) {
+                    // The data in the pipe is lost, the next start uses a new pipe
+                    splice_reset_pipe(yev_event);
+                    yev_event->result = res;
+                } else {
+                    yev_event->in_pipe -= MIN((uint32_t)res, yev_event->in_pipe);
+                    if(yev_event->in_pipe > 0) {
+                        // Short send, resume with the rest of the pipe
+                        if(!cancelling && splice_drain(yev_event) == 0) {
+                            break;
+                        }
+                        splice_reset_pipe(yev_event);
+                        yev_event->result = cancelling? -ECANCELED : -EPIPE;
+                    } else {
+                        yev_event->result = (int)yev_event->splice_moved;
+                    }
+                }
+
+                /*
+                 *  Call callback
+                 */
+                if(yev_event->callback) {
+                    yev_event->callback(
+                        yev_event
+                    );
+                }
+            }
+            break;
+
+        case YEV_TIMER_TYPE:
+            // The timers are in the timer wheel, not in the ring
+            break;
+        case YEV_CANCEL_TYPE:
+            // Informed by cancel_groups_inform(), never in ring
+            break;
+    }
+
+    return 0;
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PUBLIC int yev_set_gbuffer( // only for yev_create_read_event() and yev_create_write_event()
+    yev_event_t *yev_event,
+    gbuffer_t *gbuf // WARNING if there is previous gbuffer it will be free
+) {
+    if(gbuf == yev_event->gbuf) {
+        return 0;
+    }
+    if(yev_event->gbuf) {
         gobj_log_warning(yev_event->gobj, LOG_OPT_TRACE_STACK,
             "function",     "%s", __FUNCTION__,
             "msgset",       "%s", MSGSET_LIBUV_ERROR,
@@ -577,20 +1865,63 @@ PUBLIC int yev_start_event(
                     return -1;
                 }
 
-                struct io_uring_sqe *sqe = io_uring_get_sqe(&yev_loop->ring);
+                struct io_uring_sqe *sqe = yev_get_event_sqe(yev_event);
+                if(!sqe) {
+                    // Error already logged
+                    return -1;
+                }
                 io_uring_sqe_set_data(sqe, yev_event);
-                io_uring_prep_read(
-                    sqe,
-                    yev_event->fd,
-                    gbuffer_cur_wr_pointer(yev_event->gbuf),
-                    gbuffer_freebytes(yev_event->gbuf),
-                    0
-                );
-                io_uring_submit(&yev_loop->ring);
-                yev_set_flag(yev_event, YEV_FLAG_IN_RING, TRUE);
+                if(is_fixed_gbuffer(yev_loop, yev_event->gbuf)) {
+                    io_uring_prep_read_fixed(
+                        sqe,
+                        yev_event->fd,
+                        gbuffer_cur_wr_pointer(yev_event->gbuf),
+                        (unsigned)gbuffer_freebytes(yev_event->gbuf),
+                        0,
+                        0   // the region is the buffer index 0
+                    );
+                    yev_loop->stats.fixed_bufs_ops++;
+                } else {
+                    io_uring_prep_read(
+                        sqe,
+                        yev_event->fd,
+                        gbuffer_cur_wr_pointer(yev_event->gbuf),
+                        gbuffer_freebytes(yev_event->gbuf),
+                        0
+                    );
+                }
+                sqe_set_fixed_file(yev_loop, sqe, yev_event->fd);
+                sqe_link_timeout(yev_event, sqe);
+                yev_submit(yev_loop);
+                set_in_ring(yev_event);
+            }
+            break;
+        case YEV_RECV_MULTISHOT_TYPE:
+        case YEV_RECVMSG_MULTISHOT_TYPE:
+            {
+                if(yev_event->fd <= 0) {
+                    gobj_log_error(gobj, LOG_OPT_TRACE_STACK,
+                        "function",     "%s", __FUNCTION__,
+                        "msgset",       "%s", MSGSET_LIBUV_ERROR,
+                        "msg",          "%s", "Cannot start event: fd negative",
+                        "event_type",   "%s", yev_event_type_name(yev_event),
+                        "p",            "%p", yev_event,
+                        NULL
+                    );
+                    return -1;
+                };
+                if(!get_recv_ring(yev_loop)) {
+                    // Error already logged
+                    return -1;
+                }
+                if(rearm_recv_multishot(yev_event) < 0) {
+                    // Error already logged
+                    return -1;
+                }
             }
             break;
         case YEV_WRITE_TYPE:
+        case YEV_SEND_ZC_TYPE:
             {
                 if(yev_event->fd <= 0) {
                     gobj_log_error(gobj, LOG_OPT_TRACE_STACK,
@@ -627,89 +1958,230 @@ PUBLIC int yev_start_event(
                     return -1;
                 }
 
-                struct io_uring_sqe *sqe = io_uring_get_sqe(&yev_loop->ring);
+                struct io_uring_sqe *sqe = yev_get_event_sqe(yev_event);
+                if(!sqe) {
+                    // Error already logged
+                    return -1;
+                }
                 io_uring_sqe_set_data(sqe, yev_event);
-                io_uring_prep_write(
-                    sqe,
-                    yev_event->fd,
-                    gbuffer_cur_rd_pointer(yev_event->gbuf),
-                    gbuffer_leftbytes(yev_event->gbuf),
-                    0
-                );
-                io_uring_submit(&yev_loop->ring);
-                yev_set_flag(yev_event, YEV_FLAG_IN_RING, TRUE);
+                if(yev_event->type == YEV_SEND_ZC_TYPE) {
+                    /*
+                     *  MSG_WAITALL: the kernel retries the partial sends of stream sockets
+                     */
+                    io_uring_prep_send_zc(
+                        sqe,
+                        yev_event->fd,
+                        gbuffer_cur_rd_pointer(yev_event->gbuf),
+                        gbuffer_leftbytes(yev_event->gbuf),
+                        MSG_WAITALL|MSG_NOSIGNAL,
+                        (yev_loop->caps & YEV_CAP_SEND_ZC_REPORT_USAGE)? IORING_SEND_ZC_REPORT_USAGE : 0
+                    );
+                } else if(is_fixed_gbuffer(yev_loop, yev_event->gbuf)) {
+                    io_uring_prep_write_fixed(
+                        sqe,
+                        yev_event->fd,
+                        gbuffer_cur_rd_pointer(yev_event->gbuf),
+                        (unsigned)gbuffer_leftbytes(yev_event->gbuf),
+                        0,
+                        0   // the region is the buffer index 0
+                    );
+                    yev_loop->stats.fixed_bufs_ops++;
+                } else {
+                    io_uring_prep_write(
+                        sqe,
+                        yev_event->fd,
+                        gbuffer_cur_rd_pointer(yev_event->gbuf),
+                        gbuffer_leftbytes(yev_event->gbuf),
+                        0
+                    );
+                }
+                sqe_set_fixed_file(yev_loop, sqe, yev_event->fd);
+                sqe_link_timeout(yev_event, sqe);
+                yev_submit(yev_loop);
+                set_in_ring(yev_event);
             }
             break;
-        case YEV_CONNECT_TYPE:
+        case YEV_WRITEV_TYPE:
             {
-                if(!yev_event->dst_addr || yev_event->dst_addrlen <= 0) {
+                if(yev_event->fd <= 0) {
                     gobj_log_error(gobj, LOG_OPT_TRACE_STACK,
                         "function",     "%s", __FUNCTION__,
                         "msgset",       "%s", MSGSET_LIBUV_ERROR,
-                        "msg",          "%s", "Cannot start event: connect addr NULL",
+                        "msg",          "%s", "Cannot start event: fd negative",
+                        "event_type",   "%s", yev_event_type_name(yev_event),
+                        "p",            "%p", yev_event,
+                        NULL
+                    );
+                    return -1;
+                };
+                if(!yev_event->iov || yev_event->iovcnt <= 0) {
+                    gobj_log_error(gobj, LOG_OPT_TRACE_STACK,
+                        "function",     "%s", __FUNCTION__,
+                        "msgset",       "%s", MSGSET_LIBUV_ERROR,
+                        "msg",          "%s", "Cannot start event: iovecs empty",
                         "event_type",   "%s", yev_event_type_name(yev_event),
                         "p",            "%p", yev_event,
+                        "iovcnt",       "%d", yev_event->iovcnt,
                         NULL
                     );
                     return -1;
                 }
 
-                struct io_uring_sqe *sqe = io_uring_get_sqe(&yev_loop->ring);
+                struct io_uring_sqe *sqe = yev_get_event_sqe(yev_event);
+                if(!sqe) {
+                    // Error already logged
+                    return -1;
+                }
                 io_uring_sqe_set_data(sqe, yev_event);
-                /*
-                 *  Use the file descriptor fd to start connecting to the destination
-                 *  described by the socket address at addr and of structure length addrlen.
-                 */
-                io_uring_prep_connect(
+                io_uring_prep_writev(
                     sqe,
                     yev_event->fd,
-                    yev_event->dst_addr,
-                    yev_event->dst_addrlen
+                    yev_event->iov,
+                    (unsigned)yev_event->iovcnt,
+                    0
                 );
-                io_uring_submit(&yev_loop->ring);
-                yev_set_flag(yev_event, YEV_FLAG_IN_RING, TRUE);
+                sqe_set_fixed_file(yev_loop, sqe, yev_event->fd);
+                sqe_link_timeout(yev_event, sqe);
+                yev_submit(yev_loop);
+                set_in_ring(yev_event);
             }
             break;
-        case YEV_ACCEPT_TYPE:
+        case YEV_RECVMSG_TYPE:
+        case YEV_SENDMSG_TYPE:
             {
-                if(!yev_event->src_addr || yev_event->src_addrlen <= 0) {
+                if(yev_event->fd <= 0) {
                     gobj_log_error(gobj, LOG_OPT_TRACE_STACK,
                         "function",     "%s", __FUNCTION__,
                         "msgset",       "%s", MSGSET_LIBUV_ERROR,
-                        "msg",          "%s", "Cannot start event: accept addr NULL",
+                        "msg",          "%s", "Cannot start event: fd negative",
+                        "event_type",   "%s", yev_event_type_name(yev_event),
+                        "p",            "%p", yev_event,
+                        NULL
+                    );
+                    return -1;
+                };
+                if(!yev_event->gbuf) {
+                    gobj_log_error(gobj, LOG_OPT_TRACE_STACK,
+                        "function",     "%s", __FUNCTION__,
+                        "msgset",       "%s", MSGSET_LIBUV_ERROR,
+                        "msg",          "%s", "Cannot start event: gbuffer NULL",
                         "event_type",   "%s", yev_event_type_name(yev_event),
                         "p",            "%p", yev_event,
                         NULL
                     );
                     return -1;
+                };
+
+                yev_msghdr_t *msghdr = yev_event->msghdr;
+                memset(&msghdr->msg, 0, sizeof(msghdr->msg));
+                msghdr->msg.msg_iov = &msghdr->iov;
+                msghdr->msg.msg_iovlen = 1;
+                if(yev_event->type == YEV_RECVMSG_TYPE) {
+                    if(gbuffer_freebytes(yev_event->gbuf)==0) {
+                        gobj_log_error(gobj, LOG_OPT_TRACE_STACK,
+                            "function",     "%s", __FUNCTION__,
+                            "msgset",       "%s", MSGSET_LIBUV_ERROR,
+                            "msg",          "%s", "Cannot start event: gbuffer WITHOUT space to read",
+                            "event_type",   "%s", yev_event_type_name(yev_event),
+                            "p",            "%p", yev_event,
+                            "gbuf_label",   "%s", gbuffer_getlabel(yev_event->gbuf),
+                            NULL
+                        );
+                        return -1;
+                    }
+                    msghdr->iov.iov_base = gbuffer_cur_wr_pointer(yev_event->gbuf);
+                    msghdr->iov.iov_len = gbuffer_freebytes(yev_event->gbuf);
+                    msghdr->msg.msg_name = &msghdr->peer;
+                    msghdr->msg.msg_namelen = sizeof(msghdr->peer);
+                } else {
+                    msghdr->iov.iov_base = gbuffer_cur_rd_pointer(yev_event->gbuf);
+                    msghdr->iov.iov_len = gbuffer_leftbytes(yev_event->gbuf);
+                    if(msghdr->peerlen > 0) {
+                        msghdr->msg.msg_name = &msghdr->peer;
+                        msghdr->msg.msg_namelen = msghdr->peerlen;
+                    }
                 }
 
-                struct io_uring_sqe *sqe = io_uring_get_sqe(&yev_loop->ring);
+                struct io_uring_sqe *sqe = yev_get_event_sqe(yev_event);
+                if(!sqe) {
+                    // Error already logged
+                    return -1;
+                }
                 io_uring_sqe_set_data(sqe, yev_event);
-                /*
-                 *  Use the file descriptor fd to start accepting a connection request
-                 *  described by the socket address at addr and of structure length addrlen
-                 */
-                if(multishot_available) {
-                    io_uring_prep_multishot_accept(
-                        sqe,
-                        yev_event->fd,
-                        NULL,
-                        NULL,
-                        0
+                if(yev_event->type == YEV_RECVMSG_TYPE) {
+                    io_uring_prep_recvmsg(sqe, yev_event->fd, &msghdr->msg, 0);
+                } else {
+                    io_uring_prep_sendmsg(sqe, yev_event->fd, &msghdr->msg, MSG_NOSIGNAL);
+                }
+                sqe_set_fixed_file(yev_loop, sqe, yev_event->fd);
+                sqe_link_timeout(yev_event, sqe);
+                yev_submit(yev_loop);
+                set_in_ring(yev_event);
+            }
+            break;
+        case YEV_CONNECT_TYPE:
+            {
+                if(!yev_event->dst_addr || yev_event->dst_addrlen <= 0) {
+                    gobj_log_error(gobj, LOG_OPT_TRACE_STACK,
+                        "function",     "%s", __FUNCTION__,
+                        "msgset",       "%s", MSGSET_LIBUV_ERROR,
+                        "msg",          "%s", "Cannot start event: connect addr NULL",
+                        "event_type",   "%s", yev_event_type_name(yev_event),
+                        "p",            "%p", yev_event,
+                        NULL
                     );
+                    return -1;
+                }
 
-                } else {
-                    io_uring_prep_accept(
-                        sqe,
-                        yev_event->fd,
-                        yev_event->src_addr,
-                        &yev_event->src_addrlen,
-                        0
+                struct io_uring_sqe *sqe = yev_get_event_sqe(yev_event);
+                if(!sqe) {
+                    // Error already logged
+                    return -1;
+                }
+                io_uring_sqe_set_data(sqe, yev_event);
+                /*
+                 *  Use the file descriptor fd to start connecting to the destination
+                 *  described by the socket address at addr and of structure length addrlen.
+                 */
+                io_uring_prep_connect(
+                    sqe,
+                    yev_event->fd,
+                    yev_event->dst_addr,
+                    yev_event->dst_addrlen
+                );
+                sqe_set_fixed_file(yev_loop, sqe, yev_event->fd);
+                sqe_link_timeout(yev_event, sqe);
+                yev_submit(yev_loop);
+                set_in_ring(yev_event);
+            }
+            break;
+        case YEV_ACCEPT_TYPE:
+            {
+                if(!yev_event->src_addr || yev_event->src_addrlen <= 0) {
+                    gobj_log_error(gobj, LOG_OPT_TRACE_STACK,
+                        "function",     "%s", __FUNCTION__,
+                        "msgset",       "%s", MSGSET_LIBUV_ERROR,
+                        "msg",          "%s", "Cannot start event: accept addr NULL",
+                        "event_type",   "%s", yev_event_type_name(yev_event),
+                        "p",            "%p", yev_event,
+                        NULL
                     );
+                    return -1;
+                }
+
+                struct io_uring_sqe *sqe = yev_get_sqe(yev_loop);
+                if(!sqe) {
+                    // Error already logged
+                    return -1;
                 }
-                io_uring_submit(&yev_loop->ring);
-                yev_set_flag(yev_event, YEV_FLAG_IN_RING, TRUE);
+                io_uring_sqe_set_data(sqe, yev_event);
+                /*
+                 *  Use the file descriptor fd to start accepting a connection request
+                 *  described by the socket address at addr and of structure length addrlen
+                 */
+                prep_accept(yev_loop, sqe, yev_event);
+                yev_submit(yev_loop);
+                set_in_ring(yev_event);
             }
             break;
         case YEV_TIMER_TYPE:
@@ -722,6 +2194,65 @@ PUBLIC int yev_start_event(
                 NULL
             );
             return -1;
+        case YEV_MSG_TYPE:
+            gobj_log_error(gobj, LOG_OPT_TRACE_STACK,
+                "function",     "%s", __FUNCTION__,
+                "msgset",       "%s", MSGSET_LIBUV_ERROR,
+                "msg",          "%s", "Cannot start event: msg event receives the yev_send_msg() of other loops",
+                "event_type",   "%s", yev_event_type_name(yev_event),
+                "p",            "%p", yev_event,
+                NULL
+            );
+            return -1;
+        case YEV_FILE_READ_TYPE:
+        case YEV_FILE_WRITE_TYPE:
+        case YEV_FSYNC_TYPE:
+            if(start_file_event(yev_event) < 0) {
+                // Error already logged
+                return -1;
+            }
+            break;
+        case YEV_SPLICE_TYPE:
+            if(start_splice_event(yev_event) < 0) {
+                // Error already logged
+                return -1;
+            }
+            break;
+        case YEV_CANCEL_TYPE:
+            gobj_log_error(gobj, LOG_OPT_TRACE_STACK,
+                "function",     "%s", __FUNCTION__,
+                "msgset",       "%s", MSGSET_LIBUV_ERROR,
+                "msg",          "%s", "Cannot start event: cancel event is created by yev_cancel_fd()/yev_cancel_gobj()",
+                "event_type",   "%s", yev_event_type_name(yev_event),
+                "p",            "%p", yev_event,
+                NULL
+            );
+            return -1;
+        case YEV_POLL_TYPE:
+            {
+                if(yev_event->fd < 0) {
+                    gobj_log_error(gobj, LOG_OPT_TRACE_STACK,
+                        "function",     "%s", __FUNCTION__,
+                        "msgset",       "%s", MSGSET_LIBUV_ERROR,
+                        "msg",          "%s", "Cannot start event: fd negative",
+                        "event_type",   "%s", yev_event_type_name(yev_event),
+                        "p",            "%p", yev_event,
+                        NULL
+                    );
+                    return -1;
+                }
+                struct io_uring_sqe *sqe = yev_get_sqe(yev_loop);
+                if(!sqe) {
+                    // Error already logged
+                    return -1;
+                }
+                io_uring_sqe_set_data(sqe, yev_event);
+                io_uring_prep_poll_add(sqe, yev_event->fd, yev_event->poll_events);
+                sqe_set_fixed_file(yev_loop, sqe, yev_event->fd);
+                yev_submit(yev_loop);
+                set_in_ring(yev_event);
+            }
+            break;
     }
 
     return 0;
@@ -737,7 +2268,6 @@ PUBLIC int yev_start_timer_event(
 ) {
     yev_event_t *yev_event = yev_event_;
     hgobj gobj = yev_event->gobj;
-    struct io_uring_sqe *sqe;
 
     if(timeout_ms <= 0) {
         gobj_log_error(gobj, LOG_OPT_TRACE_STACK,
@@ -786,74 +2316,110 @@ PUBLIC int yev_start_timer_event(
         return -1;
     }
 
-    struct timeval timeout = {
-        .tv_sec  = timeout_ms / 1000,
-        .tv_usec = (timeout_ms % 1000) * 1000,
-    };
-    struct itimerspec delta = {
-        .it_interval.tv_sec = periodic? timeout.tv_sec : 0,
-        .it_interval.tv_nsec = periodic? timeout.tv_usec*1000 : 0,
-        .it_value.tv_sec = timeout.tv_sec,
-        .it_value.tv_nsec = timeout.tv_usec * 1000,
-
-    };
-    timerfd_settime(yev_event->fd, 0, &delta, NULL);
+    if(yev_event->yev_loop->stopping) {
+        // The timers are cancelled on loop stop
+        return -1;
+    }
 
-    sqe = io_uring_get_sqe(&yev_event->yev_loop->ring);
-    io_uring_sqe_set_data(sqe, (char *)yev_event);
-    io_uring_prep_read(sqe, yev_event->fd, &yev_event->timer_bf, sizeof(yev_event->timer_bf), 0);
-    io_uring_submit(&yev_event->yev_loop->ring);
+    yev_event->tw_period = (uint32_t)MIN((uint64_t)timeout_ms, TW_MAX_DELTA);
+    timer_wheel_add(
+        yev_event->yev_loop->timer_wheel,
+        yev_event,
+        yev_now_msec() + (uint64_t)timeout_ms
+    );
     yev_set_flag(yev_event, YEV_FLAG_IN_RING, TRUE);
 
     return 0;
 }
 
 /***************************************************************************
- *
+ *  The stop of yev_stop_event() before the cancel sqe.
+ *  Return 1 if the operation must be cancelled in the kernel,
+ *  0 if it's stopped (and informed) now, -1 if there is nothing to stop.
  ***************************************************************************/
-PUBLIC int yev_stop_event(yev_event_t *yev_event)
+PRIVATE int stop_event_prepare(yev_event_t *yev_event)
 {
     yev_loop_t *yev_loop = yev_event->yev_loop;
-    hgobj gobj = yev_event->gobj;
-    struct io_uring_sqe *sqe;
-
-    if(gobj_trace_level(gobj) & TRACE_UV) {
-        do {
-            json_t *jn_flags = bits2jn_strlist(yev_flag_s, yev_event->flag);
-            gobj_log_info(gobj, 0,
-                "function",     "%s", __FUNCTION__,
-                "msgset",       "%s", MSGSET_YEV_LOOP,
-                "msg",          "%s", "yev_stop_event",
-                "msg2",         "%s", (yev_type_t)yev_event->type == YEV_TIMER_TYPE?
-                                        "💥🟥⏰⏰ yev_stop_event":
-                                        "💥🟥 yev_stop_event",
-                "type",         "%s", yev_event_type_name(yev_event),
-                "fd",           "%d", yev_event->fd,
-                "p",            "%p", yev_event,
-                "gbuffer",      "%p", yev_event->gbuf,
-                "flag",         "%j", jn_flags,
-                NULL
-            );
-            json_decref(jn_flags);
-        } while(0);
-    }
 
     switch((yev_type_t)yev_event->type) {
+        case YEV_RECV_MULTISHOT_TYPE:
+        case YEV_RECVMSG_MULTISHOT_TYPE:
+            if(yev_loop->recv_ring) {
+                recv_ring_del_starved(yev_loop->recv_ring, yev_event);
+            }
+            // fall through
         case YEV_READ_TYPE:
         case YEV_WRITE_TYPE:
+        case YEV_RECVMSG_TYPE:
             GBUFFER_DECREF(yev_event->gbuf)
             yev_event->fd = -1;
             break;
+        case YEV_SENDMSG_TYPE:
+            // The gbuffer is released on destroy, the kernel can be sending it
+            yev_event->fd = -1;
+            break;
+        case YEV_SEND_ZC_TYPE:
+            // The kernel can be using the gbuffer until the notification, it's released on destroy
+            yev_event->fd = -1;
+            break;
+        case YEV_WRITEV_TYPE:
+            yev_event->fd = -1;
+            break;
         case YEV_CONNECT_TYPE:
-            GBMEM_FREE(yev_event->dst_addr)
+            yev_event->dst_addr = NULL;
             yev_event->dst_addrlen = 0;
+            if(yev_event->dns_waiter) {
+                /*
+                 *  Waiting the resolver, not in the io_uring, inform now like a cancelled event
+                 */
+                yev_event->dns_waiter->yev_event = NULL;
+                yev_event->dns_waiter = NULL;
+                yev_set_flag(yev_event, YEV_FLAG_IN_RING, FALSE);
+                yev_event->result = -ECANCELED;
+                if(yev_event->callback) {
+                    yev_event->callback(
+                        yev_event
+                    );
+                }
+                return 0;
+            }
             break;
         case YEV_ACCEPT_TYPE:
-            GBMEM_FREE(yev_event->src_addr)
-            yev_event->src_addrlen = 0;
+            // The listening address is kept (released on destroy), the accept can be started again
             break;
-        case YEV_TIMER_TYPE:
+        case YEV_MSG_TYPE:
+            // Never in ring, the messages are posted by other loops
+            return -1;
+        case YEV_FILE_READ_TYPE:
+        case YEV_FILE_WRITE_TYPE:
+        case YEV_FSYNC_TYPE:
+            // The disk i/o is not cancelable, it ends with its cqe
+            return -1;
+        case YEV_POLL_TYPE:
             break;
+        case YEV_SPLICE_TYPE:
+            // The pipe can have data, the next start uses a new pipe
+            splice_reset_pipe(yev_event);
+            break;
+        case YEV_CANCEL_TYPE:
+            // Never in ring
+            return -1;
+        case YEV_TIMER_TYPE:
+            if(!yev_event_in_ring(yev_event)) {
+                return -1;
+            }
+            /*
+             *  Timer in the timer wheel, remove it and inform now, like a cancelled event
+             */
+            timer_wheel_del(yev_loop->timer_wheel, yev_event);
+            yev_set_flag(yev_event, YEV_FLAG_IN_RING, FALSE);
+            yev_event->result = -ECANCELED;
+            if(yev_event->callback) {
+                yev_event->callback(
+                    yev_event
+                );
+            }
+            return 0;
     }
 
     if(!(yev_event_in_ring(yev_event))) {
@@ -890,10 +2456,52 @@ PUBLIC int yev_stop_event(yev_event_t *yev_event)
         return -1;
     }
 
-    sqe = io_uring_get_sqe(&yev_loop->ring);
-    io_uring_sqe_set_data(sqe, yev_event);
+    return 1;
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PUBLIC int yev_stop_event(yev_event_t *yev_event)
+{
+    yev_loop_t *yev_loop = yev_event->yev_loop;
+    hgobj gobj = yev_event->gobj;
+    struct io_uring_sqe *sqe;
+
+    if(gobj_trace_level(gobj) & TRACE_UV) {
+        do {
+            json_t *jn_flags = bits2jn_strlist(yev_flag_s, yev_event->flag);
+            gobj_log_info(gobj, 0,
+                "function",     "%s", __FUNCTION__,
+                "msgset",       "%s", MSGSET_YEV_LOOP,
+                "msg",          "%s", "yev_stop_event",
+                "msg2",         "%s", (yev_type_t)yev_event->type == YEV_TIMER_TYPE?
+                                        "💥🟥⏰⏰ yev_stop_event":
+                                        "💥🟥 yev_stop_event",
+                "type",         "%s", yev_event_type_name(yev_event),
+                "fd",           "%d", yev_event->fd,
+                "p",            "%p", yev_event,
+                "gbuffer",      "%p", yev_event->gbuf,
+                "flag",         "%j", jn_flags,
+                NULL
+            );
+            json_decref(jn_flags);
+        } while(0);
+    }
+
+    int ret = stop_event_prepare(yev_event);
+    if(ret <= 0) {
+        return ret;
+    }
+
+    sqe = yev_get_sqe(yev_loop);
+    if(!sqe) {
+        // Error already logged
+        return -1;
+    }
     io_uring_prep_cancel(sqe, yev_event, 0);
-    io_uring_submit(&yev_event->yev_loop->ring);
+    io_uring_sqe_set_data64(sqe, YEV_UDATA_CANCEL);
+    yev_submit(yev_loop);
     yev_set_flag(yev_event, YEV_FLAG_IN_RING, TRUE);
     yev_set_flag(yev_event, YEV_FLAG_CANCELLING, TRUE);
 
@@ -952,87 +2560,455 @@ PUBLIC void yev_destroy_event(yev_event_t *yev_event)
         yev_stop_event(yev_event);
     }
 
-    if(yev_event->gbuf) {
+    /*
+     *  If the cancel is pending the kernel can be using the gbuffer and the msghdr,
+     *  they are released when the event is recycled.
+     */
+    BOOL zombie = yev_event_in_ring(yev_event);
+
+    if(yev_event->gbuf && !zombie) {
         GBUFFER_DECREF(yev_event->gbuf)
     }
 
-    if(yev_event->src_addr) {
-        GBMEM_FREE(yev_event->src_addr)
+    if((yev_event->type == YEV_RECV_MULTISHOT_TYPE || yev_event->type == YEV_RECVMSG_MULTISHOT_TYPE) &&
+            yev_event->yev_loop->recv_ring) {
+        recv_ring_del_starved(yev_event->yev_loop->recv_ring, yev_event);
     }
-    if(yev_event->dst_addr) {
-        GBMEM_FREE(yev_event->dst_addr)
+
+    yev_event->src_addr = NULL;
+    yev_event->dst_addr = NULL;
+    if(yev_event->msghdr && !zombie) {
+        GBMEM_FREE(yev_event->msghdr)
     }
 
     switch((yev_type_t)yev_event->type) {
         case YEV_READ_TYPE:
         case YEV_WRITE_TYPE:
+        case YEV_RECV_MULTISHOT_TYPE:
+        case YEV_SEND_ZC_TYPE:
+        case YEV_WRITEV_TYPE:
+        case YEV_RECVMSG_TYPE:
+        case YEV_RECVMSG_MULTISHOT_TYPE:
+        case YEV_SENDMSG_TYPE:
+        case YEV_MSG_TYPE:
+        case YEV_FILE_READ_TYPE:
+        case YEV_FILE_WRITE_TYPE:
+        case YEV_FSYNC_TYPE:
+            // The fd of the file is owned by the user
+            break;
+        case YEV_POLL_TYPE:
+            // The fd is owned by other
+            break;
+        case YEV_SPLICE_TYPE:
+            // The fds are owned by the user, the pipe by the event (the kernel keeps it while in use)
+            splice_reset_pipe(yev_event);
+            break;
+        case YEV_CANCEL_TYPE:
             break;
-        case YEV_CONNECT_TYPE:
         case YEV_ACCEPT_TYPE:
+            if(yev_event->yev_loop->fixed && yev_event->yev_loop->fixed->accepting) {
+                // The fd installs in flight have nobody to inform, their sockets are closed
+                yev_fixed_files_t *fixed = yev_event->yev_loop->fixed;
+                for(unsigned i=fixed->direct_start; i<fixed->size; i++) {
+                    if(fixed->accepting[i] == yev_event) {
+                        fixed->accepting[i] = NULL;
+                    }
+                }
+            }
+            // fall through
+        case YEV_CONNECT_TYPE:
         case YEV_TIMER_TYPE:
             if(yev_event->fd > 0) {
-                close(yev_event->fd);
+                yev_close_fd(yev_event->yev_loop, yev_event->fd);
                 yev_event->fd = -1;
             }
             break;
     }
 
-    GBMEM_FREE(yev_event)
+    if(zombie) {
+        yev_event->zombie = TRUE;
+        yev_event->gobj = NULL;
+        yev_event->callback = NULL;
+        yev_event->yev_loop->events_zombies++;
+        return;
+    }
+    slab_put(yev_event->yev_loop, yev_event);
 }
 
 /***************************************************************************
- *
+ *  Mark the operations of the fd in the kernel as cancelling (without sqe),
+ *  add them to the group if any. Return the number of operations.
  ***************************************************************************/
-PRIVATE yev_event_t *create_event(
-    yev_loop_t *yev_loop,
-    yev_callback_t callback,
-    hgobj gobj,
-    int fd
-) {
-    yev_event_t *yev_event = GBMEM_MALLOC(sizeof(yev_event_t));
-    if(!yev_event) {
-        gobj_log_critical(gobj, 0,
-            "function",     "%s", __FUNCTION__,
-            "msgset",       "%s", MSGSET_SYSTEM_ERROR,
-            "msg",          "%s", "No memory for yev event",    // use the same string
-            NULL
-        );
-        return NULL;
+PRIVATE int cancel_fd_ops(yev_loop_t *yev_loop, int fd, yev_event_t *group)
+{
+    int n = 0;
+    yev_event_t *yev_event = yev_loop->fd_ops[fd];
+    while(yev_event) {
+        /*
+         *  The operations in the kernel are not informed now (no callbacks)
+         */
+        yev_event_t *next = yev_event->ring_next;
+        if(!yev_event->zombie && stop_event_prepare(yev_event) > 0) {
+            yev_set_flag(yev_event, YEV_FLAG_CANCELLING, TRUE);
+            if(group) {
+                yev_event->cancel_group = group;
+                group->cancel_pending++;
+            }
+            n++;
+        }
+        yev_event = next;
     }
-
-    yev_event->yev_loop = yev_loop;
-    yev_event->gobj = gobj;
-    yev_event->callback = callback;
-    yev_event->fd = fd;
-
-    return yev_event;
+    return n;
 }
 
 /***************************************************************************
- *
+ *  Cancel sqe of all the operations of the fd
  ***************************************************************************/
-PUBLIC yev_event_t *yev_create_timer_event(
-    yev_loop_t *loop,
-    yev_callback_t callback,
-    hgobj gobj
-) {
-    yev_event_t *yev_event = create_event(loop, callback, gobj, -1);
-    if(!yev_event) {
+PRIVATE int submit_cancel_fd(yev_loop_t *yev_loop, int fd)
+{
+    struct io_uring_sqe *sqe = yev_get_sqe(yev_loop);
+    if(!sqe) {
         // Error already logged
-        return NULL;
-    }
-
-    yev_event->type = YEV_TIMER_TYPE;
-    yev_event->fd = timerfd_create(CLOCK_BOOTTIME, TFD_NONBLOCK|TFD_CLOEXEC);
-    if(yev_event->fd < 0) {
-        gobj_log_critical(gobj, 0,
-            "function",     "%s", __FUNCTION__,
-            "msgset",       "%s", MSGSET_SYSTEM_ERROR,
-            "msg",          "%s", "timerfd_create() FAILED, cannot run yunetas",
-            NULL
-        );
-        return NULL;
+        return -1;
     }
+    io_uring_prep_cancel_fd(sqe, fd, IORING_ASYNC_CANCEL_ALL);
+    io_uring_sqe_set_data64(sqe, YEV_UDATA_CANCEL_FD | (uint32_t)fd);
+    yev_loop->stats.bulk_cancels++;
+    return 0;
+}
+
+/***************************************************************************
+ *  The cancel by fd has failed, a cancel sqe by user_data
+ *  for each operation of the fd still cancelling (as yev_stop_event() does)
+ ***************************************************************************/
+PRIVATE void cancel_fd_ops_by_event(yev_loop_t *yev_loop, int fd)
+{
+    if(fd < 0 || (unsigned)fd >= yev_loop->fd_ops_size) {
+        return;
+    }
+    for(yev_event_t *yev_event = yev_loop->fd_ops[fd]; yev_event; yev_event = yev_event->ring_next) {
+        if(!yev_event_cancelling(yev_event)) {
+            continue;
+        }
+        struct io_uring_sqe *sqe = yev_get_sqe(yev_loop);
+        if(!sqe) {
+            // Error already logged
+            return;
+        }
+        io_uring_prep_cancel(sqe, yev_event, 0);
+        io_uring_sqe_set_data64(sqe, YEV_UDATA_CANCEL);
+    }
+    yev_submit(yev_loop);
+}
+
+/***************************************************************************
+ *  TRUE if the fd has operations to cancel in the kernel
+ ***************************************************************************/
+PRIVATE BOOL fd_has_ops(yev_loop_t *yev_loop, int fd)
+{
+    if(fd < 0 || (unsigned)fd >= yev_loop->fd_ops_size) {
+        return FALSE;
+    }
+    for(yev_event_t *yev_event = yev_loop->fd_ops[fd]; yev_event; yev_event = yev_event->ring_next) {
+        if(!yev_event->zombie && !yev_event_cancelling(yev_event)) {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+/***************************************************************************
+ *  New YEV_CANCEL_TYPE event to inform the end of a bulk cancellation
+ ***************************************************************************/
+PRIVATE yev_event_t *create_cancel_group(
+    yev_loop_t *yev_loop,
+    yev_callback_t callback,
+    hgobj gobj,
+    int fd
+) {
+    if(!callback) {
+        return NULL;
+    }
+    yev_event_t *group = create_event(yev_loop, callback, gobj, fd);
+    if(group) {
+        group->type = YEV_CANCEL_TYPE;
+    }
+    return group;
+}
+
+/***************************************************************************
+ *  All the operations are in the group, without any the group is not informed
+ ***************************************************************************/
+PRIVATE void cancel_group_close(yev_event_t *group)
+{
+    if(!group) {
+        return;
+    }
+    group->result = (int)group->cancel_pending;
+    if(group->cancel_pending == 0) {
+        yev_destroy_event(group);
+    }
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PUBLIC int yev_cancel_fd(
+    yev_loop_t *yev_loop,
+    int fd,
+    yev_callback_t callback,
+    hgobj gobj
+) {
+    if(!fd_has_ops(yev_loop, fd)) {
+        return 0;
+    }
+
+    if(submit_cancel_fd(yev_loop, fd) < 0) {
+        // Error already logged
+        return -1;
+    }
+    yev_event_t *group = create_cancel_group(yev_loop, callback, gobj, fd);
+    int n = cancel_fd_ops(yev_loop, fd, group);
+    yev_loop->stats.bulk_cancelled += (uint64_t)n;
+    yev_submit(yev_loop);
+
+    if(gobj_trace_level(gobj) & TRACE_UV) {
+        gobj_log_info(gobj, 0,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_YEV_LOOP,
+            "msg",          "%s", "Cancel fd",
+            "msg2",         "%s", "💥🟥🟥 Cancel fd",
+            "fd",           "%d", fd,
+            "operations",   "%d", n,
+            NULL
+        );
+    }
+
+    cancel_group_close(group);
+    return n;
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PUBLIC int yev_cancel_gobj(
+    yev_loop_t *yev_loop,
+    hgobj gobj,
+    yev_callback_t callback
+) {
+    yev_event_t *group = create_cancel_group(yev_loop, callback, gobj, -1);
+    int n = 0;
+
+    /*
+     *  The callbacks of the events stopped now can create or destroy events,
+     *  the chunks of the slab are never released while the loop lives.
+     */
+    void **chunk = yev_loop->event_chunks;
+    while(chunk) {
+        yev_event_t *events = (yev_event_t *)(chunk + 1);
+        for(int i=0; i<YEV_EVENTS_PER_CHUNK; i++) {
+            yev_event_t *yev_event = &events[i];
+            if(yev_event == group || yev_event->gobj != gobj || yev_event->type == 0 ||
+                    yev_event->zombie || !yev_event_in_ring(yev_event) || yev_event_cancelling(yev_event)) {
+                continue;
+            }
+            if(yev_event->ring_pprev) {
+                /*
+                 *  Operation in the kernel, cancel all the operations of its fd
+                 */
+                int fd = yev_event->ring_fd;
+                if(submit_cancel_fd(yev_loop, fd) < 0) {
+                    // Error already logged
+                    continue;
+                }
+                n += cancel_fd_ops(yev_loop, fd, group);
+            } else if(yev_stop_event(yev_event) == 0) {
+                // Timer or connect waiting the resolver, informed now
+                n++;
+            }
+        }
+        chunk = *chunk;
+    }
+    yev_loop->stats.bulk_cancelled += (uint64_t)n;
+    yev_submit(yev_loop);
+
+    if(gobj_trace_level(gobj) & TRACE_UV) {
+        gobj_log_info(gobj, 0,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_YEV_LOOP,
+            "msg",          "%s", "Cancel gobj",
+            "msg2",         "%s", "💥🟥🟥 Cancel gobj",
+            "operations",   "%d", n,
+            NULL
+        );
+    }
+
+    cancel_group_close(group);
+    return n;
+}
+
+/***************************************************************************
+ *  The operation is in the kernel, add it to the index by fd
+ ***************************************************************************/
+PRIVATE void set_in_ring(yev_event_t *yev_event)
+{
+    yev_loop_t *yev_loop = yev_event->yev_loop;
+    int fd = yev_event->fd;
+
+    yev_set_flag(yev_event, YEV_FLAG_IN_RING, TRUE);
+    if(yev_event->ring_pprev || fd < 0) {
+        return;
+    }
+
+    if((unsigned)fd >= yev_loop->fd_ops_size) {
+        unsigned new_size = yev_loop->fd_ops_size? yev_loop->fd_ops_size : 64;
+        while(new_size <= (unsigned)fd) {
+            new_size *= 2;
+        }
+        uint8_t *fd_close_pending = GBMEM_REALLOC(yev_loop->fd_close_pending, new_size);
+        yev_event_t **fd_ops = fd_close_pending?
+            GBMEM_REALLOC(yev_loop->fd_ops, new_size * sizeof(yev_event_t *)) : NULL;
+        if(fd_close_pending) {
+            yev_loop->fd_close_pending = fd_close_pending;
+            memset(fd_close_pending + yev_loop->fd_ops_size, 0, new_size - yev_loop->fd_ops_size);
+        }
+        if(!fd_ops) {
+            gobj_log_critical(yev_loop->yuno, 0,
+                "function",     "%s", __FUNCTION__,
+                "msgset",       "%s", MSGSET_MEMORY_ERROR,
+                "msg",          "%s", "No memory to fd index of operations",
+                "fd",           "%d", fd,
+                NULL
+            );
+            return; // Not cancelable by yev_cancel_fd(), yev_stop_event() works
+        }
+        /*
+         *  The first of each list points to its head, relink them
+         */
+        for(unsigned i=0; i<yev_loop->fd_ops_size; i++) {
+            if(fd_ops[i]) {
+                fd_ops[i]->ring_pprev = &fd_ops[i];
+            }
+        }
+        for(unsigned i=yev_loop->fd_ops_size; i<new_size; i++) {
+            fd_ops[i] = NULL;
+        }
+        yev_loop->fd_ops = fd_ops;
+        yev_loop->fd_ops_size = new_size;
+    }
+
+    yev_event->ring_fd = fd;
+    yev_event->ring_next = yev_loop->fd_ops[fd];
+    if(yev_event->ring_next) {
+        yev_event->ring_next->ring_pprev = &yev_event->ring_next;
+    }
+    yev_loop->fd_ops[fd] = yev_event;
+    yev_event->ring_pprev = &yev_loop->fd_ops[fd];
+}
+
+/***************************************************************************
+ *  The operation has returned, remove it from the index by fd
+ ***************************************************************************/
+PRIVATE void fd_ops_del(yev_event_t *yev_event)
+{
+    if(!yev_event->ring_pprev) {
+        return;
+    }
+    *yev_event->ring_pprev = yev_event->ring_next;
+    if(yev_event->ring_next) {
+        yev_event->ring_next->ring_pprev = yev_event->ring_pprev;
+    }
+    yev_event->ring_next = NULL;
+    yev_event->ring_pprev = NULL;
+
+    /*
+     *  The last operation of a fd closed by yev_close_fd() has returned, close it now
+     */
+    yev_loop_t *yev_loop = yev_event->yev_loop;
+    int fd = yev_event->ring_fd;
+    if(!yev_loop->fd_ops[fd] && yev_loop->fd_close_pending[fd]) {
+        yev_loop->fd_close_pending[fd] = 0;
+        yev_unregister_fd(yev_loop, fd);
+        close(fd);
+    }
+}
+
+/***************************************************************************
+ *  The operation cancelled has returned, the group is complete with the last one
+ ***************************************************************************/
+PRIVATE void cancel_group_done(yev_event_t *yev_event)
+{
+    yev_event_t *group = yev_event->cancel_group;
+    if(!group) {
+        return;
+    }
+    yev_event->cancel_group = NULL;
+    if(--group->cancel_pending == 0) {
+        yev_loop_t *yev_loop = yev_event->yev_loop;
+        group->tw_next = yev_loop->cancels_done;
+        yev_loop->cancels_done = group;
+    }
+}
+
+/***************************************************************************
+ *  Aggregated callbacks of the cancel groups complete
+ ***************************************************************************/
+PRIVATE void cancel_groups_inform(yev_loop_t *yev_loop)
+{
+    yev_event_t *group;
+    while((group = yev_loop->cancels_done)) {
+        yev_loop->cancels_done = group->tw_next;
+        group->tw_next = NULL;
+        if(group->callback) {
+            group->callback(group);
+        }
+        yev_destroy_event(group);
+    }
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PRIVATE yev_event_t *create_event(
+    yev_loop_t *yev_loop,
+    yev_callback_t callback,
+    hgobj gobj,
+    int fd
+) {
+    yev_event_t *yev_event = slab_get(yev_loop);
+    if(!yev_event) {
+        gobj_log_critical(gobj, 0,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_SYSTEM_ERROR,
+            "msg",          "%s", "No memory for yev event",    // use the same string
+            NULL
+        );
+        return NULL;
+    }
+
+    yev_event->yev_loop = yev_loop;
+    yev_event->gobj = gobj;
+    yev_event->callback = callback;
+    yev_event->fd = fd;
+
+    return yev_event;
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PUBLIC yev_event_t *yev_create_timer_event(
+    yev_loop_t *loop,
+    yev_callback_t callback,
+    hgobj gobj
+) {
+    yev_event_t *yev_event = create_event(loop, callback, gobj, -1);
+    if(!yev_event) {
+        // Error already logged
+        return NULL;
+    }
+
+    yev_event->type = YEV_TIMER_TYPE;   // Without fd, it lives in the loop's timer wheel
 
     if(gobj_trace_level(gobj) & TRACE_UV) {
         do {
@@ -1101,6 +3077,7 @@ PUBLIC int yev_setup_connect_event(
     const char *src_url
 ) {
     hgobj gobj = yev_event->gobj;
+    yev_loop_t *yev_loop = yev_event->yev_loop;
 
     if(yev_event->fd >= 0) {
         gobj_log_error(gobj, LOG_OPT_TRACE_STACK,
@@ -1140,73 +3117,55 @@ PUBLIC int yev_setup_connect_event(
         yev_event->flag &= ~YEV_FLAG_USE_SSL;
     }
 
-    struct addrinfo hints = {
-        .ai_family = AF_UNSPEC,  /* Allow IPv4 or IPv6 */
-        .ai_flags = AI_V4MAPPED | AI_ADDRCONFIG,
-    };
-
-    SWITCHS(schema) { // WARNING Repeated
-        ICASES("tcps")
-        ICASES("tcp")
-        ICASES("tcphs")
-        ICASES("tcph")
-        ICASES("http")
-        ICASES("https")
-        ICASES("wss")
-        ICASES("ws")
-            hints.ai_socktype = SOCK_STREAM; /* TCP socket */
-            hints.ai_protocol = IPPROTO_TCP;
-            yev_event->flag |= YEV_FLAG_IS_TCP;
-            break;
-
-        ICASES("udps")
-        ICASES("udp")
-            hints.ai_socktype = SOCK_DGRAM; /* UDP socket */
-            hints.ai_protocol = IPPROTO_UDP;
-            yev_event->flag &= ~YEV_FLAG_IS_TCP;
-            break;
+    struct addrinfo hints;
+    set_hints_by_schema(yev_event, dst_url, schema, &hints);
+
+    /*--------------------------------------*
+     *  Option to bind to local host/port,
+     *  resolved first, the cache entry
+     *  of the destination must live
+     *  while it's used.
+     *--------------------------------------*/
+    struct sockaddr_storage src_addr;
+    socklen_t src_addrlen = 0;
+    char src_port[10] = {0};
+    if(!empty_string(src_url)) {
+        char src_host[120] = {0};
+        ret = parse_url(
+            gobj,
+            src_url,
+            0, 0,
+            src_host, sizeof(src_host),
+            src_port, sizeof(src_port),
+            0, 0,
+            0, 0,
+            TRUE
+        );
+        if(ret < 0) {
+            // Error already logged
+            return -1;
+        }
 
-        DEFAULTS
-            gobj_log_warning(gobj, LOG_OPT_TRACE_STACK,
-                "function",     "%s", __FUNCTION__,
-                "msgset",       "%s", MSGSET_LIBUV_ERROR,
-                "msg",          "%s", "schema NOT supported, using tcp",
-                "url",          "%s", dst_url,
-                "schema",       "%s", schema,
-                NULL
-            );
-            hints.ai_socktype = SOCK_STREAM; /* TCP socket */
-            hints.ai_protocol = IPPROTO_TCP;
-            break;
-    } SWITCHS_END;
+        struct addrinfo *res = dns_resolve(gobj, yev_loop, src_url, src_host, src_port, &hints);
+        if(!res) {
+            // Error already logged
+            return -1;
+        }
+        memcpy(&src_addr, res->ai_addr, res->ai_addrlen);
+        src_addrlen = (socklen_t) res->ai_addrlen;
+    }
 
-    struct addrinfo *results;
-    struct addrinfo *rp;
-    ret = getaddrinfo(
-        dst_host,
-        dst_port,
-        &hints,
-        &results
-    );
-    if(ret != 0) {
-        gobj_log_error(gobj, LOG_OPT_TRACE_STACK,
-            "function",     "%s", __FUNCTION__,
-            "msgset",       "%s", MSGSET_LIBUV_ERROR,
-            "msg",          "%s", "getaddrinfo() FAILED",
-            "url",          "%s", dst_url,
-            "host",         "%s", dst_host,
-            "port",         "%s", dst_port,
-            "errno",        "%d", errno,
-            "strerror",     "%s", strerror(errno),
-            NULL
-        );
+    struct addrinfo *results = dns_resolve(gobj, yev_loop, dst_url, dst_host, dst_port, &hints);
+    if(!results) {
+        // Error already logged
         return -1;
     }
 
+    struct addrinfo *rp;
     int fd = -1;
     for (rp = results; rp; rp = rp->ai_next) {
-		fd = socket(rp->ai_family, rp->ai_socktype, rp->ai_protocol);
-		if (fd == -1) {
+        fd = socket(rp->ai_family, rp->ai_socktype, rp->ai_protocol);
+        if (fd == -1) {
             print_addrinfo(gobj, saddr, sizeof(saddr), rp, atoi(dst_port));
             gobj_log_error(gobj, LOG_OPT_TRACE_STACK,
                 "function",     "%s", __FUNCTION__,
@@ -1218,48 +3177,19 @@ PUBLIC int yev_setup_connect_event(
                 "strerror",     "%s", strerror(errno),
                 NULL
             );
-			continue;
-		}
-
-        /*--------------------------------------*
-         *  Option to bind to local host/port
-         *--------------------------------------*/
-		if(!empty_string(src_url)) {
-            char src_host[120] = {0};
-            char src_port[10] = {0};
-            if(!empty_string(src_host)) {
-                ret = parse_url(
-                    gobj,
-                    src_url,
-                    0, 0,
-                    src_host, sizeof(src_host),
-                    src_port, sizeof(src_port),
-                    0, 0,
-                    0, 0,
-                    TRUE
-                );
-                if(ret < 0) {
-                    close(fd);
-                    // Error already logged
-                    return -1;
-                }
-            }
+            continue;
+        }
 
-            struct addrinfo *res;
-            ret = getaddrinfo(
-                src_host,
-                src_port,
-                &hints,
-                &res
-            );
-            if(ret != 0) {
+        if(src_addrlen > 0) {
+            ret = bind(fd, (struct sockaddr *)&src_addr, src_addrlen);
+            if (ret == -1) {
+                get_sockaddr_name(saddr, sizeof(saddr), (struct sockaddr *)&src_addr);
                 gobj_log_error(gobj, LOG_OPT_TRACE_STACK,
                     "function",     "%s", __FUNCTION__,
                     "msgset",       "%s", MSGSET_LIBUV_ERROR,
-                    "msg",          "%s", "getaddrinfo() src_url FAILED",
+                    "msg",          "%s", "bind() FAILED",
                     "url",          "%s", src_url,
-                    "host",         "%s", src_host,
-                    "port",         "%s", src_port,
+                    "addrinfo",     "%s", saddr,
                     "errno",        "%d", errno,
                     "strerror",     "%s", strerror(errno),
                     NULL
@@ -1267,27 +3197,7 @@ PUBLIC int yev_setup_connect_event(
                 close(fd);
                 return -1;
             }
-
-            ret = bind(fd, res->ai_addr, (socklen_t) res->ai_addrlen);
-			if (ret == -1) {
-                print_addrinfo(gobj, saddr, sizeof(saddr), res, atoi(src_port));
-                gobj_log_error(gobj, LOG_OPT_TRACE_STACK,
-                    "function",     "%s", __FUNCTION__,
-                    "msgset",       "%s", MSGSET_LIBUV_ERROR,
-                    "msg",          "%s", "bind() FAILED",
-                    "url",          "%s", src_url,
-                    "addrinfo",     "%s", saddr,
-                    "errno",        "%d", errno,
-                    "strerror",     "%s", strerror(errno),
-                    NULL
-                );
-            }
-            freeaddrinfo(res);
-            if(ret == -1) {
-                close(fd);
-                return -1;
-            }
-		}
+        }
 
         if(gobj_trace_level(gobj) & TRACE_UV) {
             print_addrinfo(gobj, saddr, sizeof(saddr), rp, atoi(dst_port));
@@ -1305,7 +3215,7 @@ PUBLIC int yev_setup_connect_event(
 
         ret = 0;    // Got a addr
         break;
-	}
+    }
 
     if (!rp || fd == -1) {
         gobj_log_error(gobj, LOG_OPT_TRACE_STACK,
@@ -1317,32 +3227,31 @@ PUBLIC int yev_setup_connect_event(
             "port",         "%s", dst_port,
             NULL
         );
-        ret = -1;
-    }
-
-    if(ret == 0) {
-        yev_event->dst_addr = GBMEM_MALLOC(rp->ai_addrlen);
-        if(yev_event->dst_addr) {
-            memcpy(yev_event->dst_addr, rp->ai_addr, rp->ai_addrlen);
-            yev_event->dst_addrlen = (socklen_t) rp->ai_addrlen;
-        } else {
-            close(fd);
-            fd = -1;
-            ret = -1;
-        }
+        return -1;
     }
 
-    freeaddrinfo(results);
-
-    if(ret == -1) {
-        return ret;
+    if(rp->ai_addrlen > sizeof(yev_event->dst_storage)) {
+        gobj_log_error(gobj, LOG_OPT_TRACE_STACK,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_LIBUV_ERROR,
+            "msg",          "%s", "Address too big",
+            "url",          "%s", dst_url,
+            "addrlen",      "%d", (int)rp->ai_addrlen,
+            NULL
+        );
+        close(fd);
+        return -1;
     }
+    memcpy(&yev_event->dst_storage, rp->ai_addr, rp->ai_addrlen);
+    yev_event->dst_addr = &yev_event->dst_storage.sa;
+    yev_event->dst_addrlen = (socklen_t) rp->ai_addrlen;
 
     if(hints.ai_protocol == IPPROTO_TCP) {
         set_tcp_socket_options(fd);
     }
 
     yev_event->fd = fd;
+    yev_register_fd(yev_event->yev_loop, fd); // The connect and the i/o will use the fixed file
 
     if(gobj_trace_level(gobj) & TRACE_UV) {
         do {
@@ -1365,6 +3274,82 @@ PUBLIC int yev_setup_connect_event(
     return fd;
 }
 
+/***************************************************************************
+ *
+ ***************************************************************************/
+PUBLIC int yev_start_connect_event(
+    yev_event_t *yev_event,
+    const char *dst_url,
+    const char *src_url
+) {
+    hgobj gobj = yev_event->gobj;
+    yev_loop_t *yev_loop = yev_event->yev_loop;
+
+    if(yev_event->type != YEV_CONNECT_TYPE) {
+        gobj_log_error(gobj, LOG_OPT_TRACE_STACK,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_PARAMETER_ERROR,
+            "msg",          "%s", "yev_event is not a connect event",
+            "url",          "%s", dst_url,
+            "type",         "%s", yev_event_type_name(yev_event),
+            "p",            "%p", yev_event,
+            NULL
+        );
+        return -1;
+    }
+    if(yev_event_in_ring(yev_event)) {
+        gobj_log_error(gobj, LOG_OPT_TRACE_STACK,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_LIBUV_ERROR,
+            "msg",          "%s", "yev_event ALREADY in RING",
+            "url",          "%s", dst_url,
+            "type",         "%s", yev_event_type_name(yev_event),
+            "p",            "%p", yev_event,
+            NULL
+        );
+        return -1;
+    }
+
+    if(yev_loop->dns_cache_ttl && !yev_loop->stopping) {
+        char schema[16];
+        char host[120];
+        char port[10];
+        if(parse_url(
+            gobj,
+            dst_url,
+            schema, sizeof(schema),
+            host, sizeof(host),
+            port, sizeof(port),
+            0, 0,
+            0, 0,
+            FALSE
+        )<0) {
+            // Error already logged
+            return -1;
+        }
+
+        struct addrinfo hints;
+        set_hints_by_schema(yev_event, dst_url, schema, &hints);
+
+        unsigned char ip[sizeof(struct in6_addr)];
+        if(!empty_string(host) &&
+                inet_pton(AF_INET, host, ip) != 1 &&
+                inet_pton(AF_INET6, host, ip) != 1 &&
+                !dns_cache_find(yev_loop, host, port, &hints)) {
+            /*
+             *  Name not resolved yet, the connect is started by the resolver
+             */
+            return dns_resolve_async(yev_event, dst_url, src_url, host, port, &hints);
+        }
+    }
+
+    if(yev_setup_connect_event(yev_event, dst_url, src_url) < 0) {
+        // Error already logged
+        return -1;
+    }
+    return yev_start_event(yev_event);
+}
+
 /***************************************************************************
  *
  ***************************************************************************/
@@ -1454,66 +3439,13 @@ PUBLIC int yev_setup_accept_event(
     if(backlog <= 0) {
         backlog = DEFAULT_BACKLOG;
     }
-    struct addrinfo hints = {
-        .ai_family = AF_UNSPEC,  /* Allow IPv4 or IPv6 */
-        .ai_flags = AI_V4MAPPED | AI_ADDRCONFIG,
-    };
-
-    SWITCHS(schema) { // WARNING Repeated
-        ICASES("tcps")
-        ICASES("tcp")
-        ICASES("tcphs")
-        ICASES("tcph")
-        ICASES("http")
-        ICASES("https")
-        ICASES("wss")
-        ICASES("ws")
-            hints.ai_socktype = SOCK_STREAM; /* TCP socket */
-            hints.ai_protocol = IPPROTO_TCP;
-            yev_event->flag |= YEV_FLAG_IS_TCP;
-            break;
-
-        ICASES("udps")
-        ICASES("udp")
-            hints.ai_socktype = SOCK_DGRAM; /* UDP socket */
-            hints.ai_protocol = IPPROTO_UDP;
-            yev_event->flag &= ~YEV_FLAG_IS_TCP;
-            break;
-
-        DEFAULTS
-            gobj_log_warning(gobj, LOG_OPT_TRACE_STACK,
-                "function",     "%s", __FUNCTION__,
-                "msgset",       "%s", MSGSET_LIBUV_ERROR,
-                "msg",          "%s", "schema NOT supported, using tcp",
-                "url",          "%s", listen_url,
-                "schema",       "%s", schema,
-                NULL
-            );
-            hints.ai_socktype = SOCK_STREAM; /* TCP socket */
-            hints.ai_protocol = IPPROTO_TCP;
-            break;
-    } SWITCHS_END;
+    struct addrinfo hints;
+    set_hints_by_schema(yev_event, listen_url, schema, &hints);
 
-    struct addrinfo *results;
     struct addrinfo *rp;
-    ret = getaddrinfo(
-        host,
-        port,
-        &hints,
-        &results
-    );
-    if(ret != 0) {
-        gobj_log_error(gobj, LOG_OPT_TRACE_STACK,
-            "function",     "%s", __FUNCTION__,
-            "msgset",       "%s", MSGSET_LIBUV_ERROR,
-            "msg",          "%s", "getaddrinfo() FAILED",
-            "url",          "%s", listen_url,
-            "host",         "%s", host,
-            "port",         "%s", port,
-            "errno",        "%d", errno,
-            "strerror",     "%s", strerror(errno),
-            NULL
-        );
+    struct addrinfo *results = dns_resolve(gobj, yev_event->yev_loop, listen_url, host, port, &hints);
+    if(!results) {
+        // Error already logged
         return -1;
     }
 
@@ -1577,6 +3509,10 @@ PUBLIC int yev_setup_accept_event(
             continue;
         }
 
+        if(hints.ai_protocol == IPPROTO_TCP && shared && yev_event->yev_loop->cpu >= 0) {
+            attach_reuseport_cpu_steering(gobj, fd);
+        }
+
 		print_addrinfo(gobj, saddr, sizeof(saddr), rp, atoi(port));
         gobj_log_info(gobj, 0,
             "function",     "%s", __FUNCTION__,
@@ -1606,126 +3542,2841 @@ PUBLIC int yev_setup_accept_event(
     }
 
     if(ret == 0) {
-        yev_event->src_addr = GBMEM_MALLOC(rp->ai_addrlen);
-        if(yev_event->src_addr) {
-            memcpy(yev_event->src_addr, rp->ai_addr, rp->ai_addrlen);
+        if(rp->ai_addrlen <= sizeof(yev_event->src_storage)) {
+            memcpy(&yev_event->src_storage, rp->ai_addr, rp->ai_addrlen);
+            yev_event->src_addr = &yev_event->src_storage.sa;
             yev_event->src_addrlen = (socklen_t) rp->ai_addrlen;
         } else {
+            gobj_log_error(gobj, LOG_OPT_TRACE_STACK,
+                "function",     "%s", __FUNCTION__,
+                "msgset",       "%s", MSGSET_LIBUV_ERROR,
+                "msg",          "%s", "Address too big",
+                "url",          "%s", listen_url,
+                "addrlen",      "%d", (int)rp->ai_addrlen,
+                NULL
+            );
             close(fd);
             fd = -1;
             ret = -1;
         }
     }
 
-    freeaddrinfo(results);
+    if(ret == -1) {
+        return ret;
+    }
+
+    yev_event->fd = fd;
+
+    if(gobj_trace_level(gobj) & TRACE_UV) {
+        do {
+            json_t *jn_flags = bits2jn_strlist(yev_flag_s, yev_event->flag);
+            gobj_log_info(gobj, 0,
+                "function",     "%s", __FUNCTION__,
+                "msgset",       "%s", MSGSET_YEV_LOOP,
+                "msg",          "%s", "yev_setup_accept_event",
+                "msg2",         "%s", "💥🟦🟦 yev_setup_accept_event",
+                "type",         "%s", yev_event_type_name(yev_event),
+                "fd",           "%d", fd,
+                "p",            "%p", yev_event,
+                "flag",         "%j", jn_flags,
+                NULL
+            );
+            json_decref(jn_flags);
+        } while(0);
+    }
+
+    return fd;
+}
+
+/***************************************************************************
+ *
+ *********** ****************************************************************/
+PUBLIC yev_event_t *yev_create_read_event(
+    yev_loop_t *loop,
+    yev_callback_t callback,
+    hgobj gobj,
+    int fd,
+    gbuffer_t *gbuf
+) {
+    yev_event_t *yev_event = create_event(loop, callback, gobj, fd);
+    if(!yev_event) {
+        // Error already logged
+        return NULL;
+    }
+
+    yev_event->type = YEV_READ_TYPE;
+    yev_event->gbuf = gbuf;
+
+    if(gobj_trace_level(gobj) & TRACE_UV) {
+        do {
+            json_t *jn_flags = bits2jn_strlist(yev_flag_s, yev_event->flag);
+            gobj_log_info(gobj, 0,
+                "function",     "%s", __FUNCTION__,
+                "msgset",       "%s", MSGSET_YEV_LOOP,
+                "msg",          "%s", "yev_create_read_event",
+                "msg2",         "%s", "💥🟦 yev_create_read_event",
+                "type",         "%s", yev_event_type_name(yev_event),
+                "fd",           "%d", fd,
+                "p",            "%p", yev_event,
+                "gbuffer",      "%p", gbuf,
+                "flag",         "%j", jn_flags,
+                NULL
+            );
+            json_decref(jn_flags);
+        } while(0);
+    }
+
+    return yev_event;
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PUBLIC yev_event_t *yev_create_write_event(
+    yev_loop_t *loop,
+    yev_callback_t callback,
+    hgobj gobj,
+    int fd,
+    gbuffer_t *gbuf
+) {
+    yev_event_t *yev_event = create_event(loop, callback, gobj, fd);
+    if(!yev_event) {
+        // Error already logged
+        return NULL;
+    }
+
+    yev_event->type = YEV_WRITE_TYPE;
+    yev_event->gbuf = gbuf;
+
+    if(gobj_trace_level(gobj) & TRACE_UV) {
+        do {
+            json_t *jn_flags = bits2jn_strlist(yev_flag_s, yev_event->flag);
+            gobj_log_info(gobj, 0,
+                "function",     "%s", __FUNCTION__,
+                "msgset",       "%s", MSGSET_YEV_LOOP,
+                "msg",          "%s", "yev_create_write_event",
+                "msg2",         "%s", "💥🟦 yev_create_write_event",
+                "type",         "%s", yev_event_type_name(yev_event),
+                "fd",           "%d", fd,
+                "p",            "%p", yev_event,
+                "gbuffer",      "%p", gbuf,
+                "flag",         "%j", jn_flags,
+                NULL
+            );
+            json_decref(jn_flags);
+        } while(0);
+    }
+
+    return yev_event;
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PUBLIC yev_event_t *yev_create_writev_event(
+    yev_loop_t *loop,
+    yev_callback_t callback,
+    hgobj gobj,
+    int fd
+) {
+    yev_event_t *yev_event = create_event(loop, callback, gobj, fd);
+    if(!yev_event) {
+        // Error already logged
+        return NULL;
+    }
+
+    yev_event->type = YEV_WRITEV_TYPE;
+
+    if(gobj_trace_level(gobj) & TRACE_UV) {
+        do {
+            json_t *jn_flags = bits2jn_strlist(yev_flag_s, yev_event->flag);
+            gobj_log_info(gobj, 0,
+                "function",     "%s", __FUNCTION__,
+                "msgset",       "%s", MSGSET_YEV_LOOP,
+                "msg",          "%s", "yev_create_writev_event",
+                "msg2",         "%s", "💥🟦 yev_create_writev_event",
+                "type",         "%s", yev_event_type_name(yev_event),
+                "fd",           "%d", fd,
+                "p",            "%p", yev_event,
+                "flag",         "%j", jn_flags,
+                NULL
+            );
+            json_decref(jn_flags);
+        } while(0);
+    }
+
+    return yev_event;
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PUBLIC yev_event_t *yev_create_recv_multishot_event(
+    yev_loop_t *loop,
+    yev_callback_t callback,
+    hgobj gobj,
+    int fd
+) {
+    yev_event_t *yev_event = create_event(loop, callback, gobj, fd);
+    if(!yev_event) {
+        // Error already logged
+        return NULL;
+    }
+
+    yev_event->type = YEV_RECV_MULTISHOT_TYPE;
+
+    if(gobj_trace_level(gobj) & TRACE_UV) {
+        do {
+            json_t *jn_flags = bits2jn_strlist(yev_flag_s, yev_event->flag);
+            gobj_log_info(gobj, 0,
+                "function",     "%s", __FUNCTION__,
+                "msgset",       "%s", MSGSET_YEV_LOOP,
+                "msg",          "%s", "yev_create_recv_multishot_event",
+                "msg2",         "%s", "💥🟦 yev_create_recv_multishot_event",
+                "type",         "%s", yev_event_type_name(yev_event),
+                "fd",           "%d", fd,
+                "p",            "%p", yev_event,
+                "flag",         "%j", jn_flags,
+                NULL
+            );
+            json_decref(jn_flags);
+        } while(0);
+    }
+
+    return yev_event;
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PUBLIC BOOL yev_recv_multishot_available(yev_loop_t *yev_loop)
+{
+    return (yev_loop->caps & YEV_CAP_RECV_MULTISHOT)? TRUE:FALSE;
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PUBLIC yev_event_t *yev_create_send_zc_event(
+    yev_loop_t *loop,
+    yev_callback_t callback,
+    hgobj gobj,
+    int fd,
+    gbuffer_t *gbuf
+) {
+    yev_event_t *yev_event = create_event(loop, callback, gobj, fd);
+    if(!yev_event) {
+        // Error already logged
+        return NULL;
+    }
+
+    yev_event->type = YEV_SEND_ZC_TYPE;
+    yev_event->gbuf = gbuf;
+
+    if(gobj_trace_level(gobj) & TRACE_UV) {
+        do {
+            json_t *jn_flags = bits2jn_strlist(yev_flag_s, yev_event->flag);
+            gobj_log_info(gobj, 0,
+                "function",     "%s", __FUNCTION__,
+                "msgset",       "%s", MSGSET_YEV_LOOP,
+                "msg",          "%s", "yev_create_send_zc_event",
+                "msg2",         "%s", "💥🟦 yev_create_send_zc_event",
+                "type",         "%s", yev_event_type_name(yev_event),
+                "fd",           "%d", fd,
+                "p",            "%p", yev_event,
+                "gbuffer",      "%p", gbuf,
+                "flag",         "%j", jn_flags,
+                NULL
+            );
+            json_decref(jn_flags);
+        } while(0);
+    }
+
+    return yev_event;
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PUBLIC BOOL yev_send_zc_available(yev_loop_t *yev_loop)
+{
+    return (yev_loop->caps & YEV_CAP_SEND_ZC)? TRUE:FALSE;
+}
+
+/***************************************************************************
+ *  Get an event of the loop's slab, zeroed
+ ***************************************************************************/
+PRIVATE yev_event_t *slab_get(yev_loop_t *yev_loop)
+{
+    if(!yev_loop->free_events) {
+        void **chunk = GBMEM_MALLOC(sizeof(void *) + YEV_EVENTS_PER_CHUNK * sizeof(yev_event_t));
+        if(!chunk) {
+            return NULL;
+        }
+        *chunk = yev_loop->event_chunks;
+        yev_loop->event_chunks = chunk;
+
+        yev_event_t *events = (yev_event_t *)(chunk + 1);
+        for(int i=YEV_EVENTS_PER_CHUNK-1; i>=0; i--) {
+            events[i].tw_next = yev_loop->free_events;
+            yev_loop->free_events = &events[i];
+        }
+        yev_loop->events_allocated += YEV_EVENTS_PER_CHUNK;
+    }
+
+    yev_event_t *yev_event = yev_loop->free_events;
+    yev_loop->free_events = yev_event->tw_next;
+    memset(yev_event, 0, sizeof(*yev_event));
+    yev_loop->events_in_use++;
+    return yev_event;
+}
+
+/***************************************************************************
+ *  Return the event to the loop's slab
+ ***************************************************************************/
+PRIVATE void slab_put(yev_loop_t *yev_loop, yev_event_t *yev_event)
+{
+    yev_event->type = 0;
+    yev_event->gobj = NULL;
+    yev_event->callback = NULL;
+    yev_event->tw_next = yev_loop->free_events;
+    yev_loop->free_events = yev_event;
+    yev_loop->events_in_use--;
+}
+
+/***************************************************************************
+ *  Free the chunks, the events must not be used after destroying the loop.
+ *  The ring is gone, release what the zombies kept for the kernel.
+ ***************************************************************************/
+PRIVATE void slab_destroy(yev_loop_t *yev_loop)
+{
+    void **chunk = yev_loop->event_chunks;
+    while(chunk) {
+        void **next = *chunk;
+        yev_event_t *events = (yev_event_t *)(chunk + 1);
+        for(int i=0; i<YEV_EVENTS_PER_CHUNK && yev_loop->events_zombies > 0; i++) {
+            if(events[i].zombie) {
+                GBUFFER_DECREF(events[i].gbuf)
+                GBMEM_FREE(events[i].msghdr)
+                yev_loop->events_zombies--;
+            }
+        }
+        GBMEM_FREE(chunk)
+        chunk = next;
+    }
+    yev_loop->event_chunks = NULL;
+    yev_loop->free_events = NULL;
+}
+
+/***************************************************************************
+ *  Cqe of an event destroyed while in ring:
+ *  release what the kernel gives (sockets accepted, buffers of the ring)
+ *  and recycle the event with its last cqe.
+ ***************************************************************************/
+PRIVATE void process_zombie_cqe(yev_loop_t *yev_loop, yev_event_t *yev_event, struct io_uring_cqe *cqe)
+{
+    if((yev_type_t)yev_event->type == YEV_ACCEPT_TYPE && cqe->res >= 0) {
+        if(yev_event->accept_direct) {
+            yev_loop->fixed->direct_used++;
+            release_slot(yev_loop, yev_loop->fixed, cqe->res);  // the socket is only in the slot
+        } else {
+            close(cqe->res);
+        }
+    }
+    yev_recv_ring_t *recv_ring = yev_loop->recv_ring;
+    if((cqe->flags & IORING_CQE_F_BUFFER) && recv_ring) {
+        unsigned bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+        recv_ring->in_use++;
+        recv_ring_give_back(recv_ring, recv_ring->buffers + (size_t)bid * recv_ring->stride);
+    }
+    if(cqe->flags & IORING_CQE_F_MORE) {
+        return;
+    }
+    if(yev_event->sync_pending > 1) {
+        // Write of a write+fdatasync chain, the fdatasync cqe is the last
+        yev_event->sync_pending--;
+        return;
+    }
+
+    fd_ops_del(yev_event);
+    cancel_group_done(yev_event);
+    GBUFFER_DECREF(yev_event->gbuf)
+    GBMEM_FREE(yev_event->msghdr)
+    yev_event->zombie = FALSE;
+    yev_loop->events_zombies--;
+    slab_put(yev_loop, yev_event);
+}
+
+/***************************************************************************
+ *  Event of datagrams, with its message header
+ ***************************************************************************/
+PRIVATE yev_event_t *create_msghdr_event(
+    yev_loop_t *yev_loop,
+    yev_callback_t callback,
+    hgobj gobj,
+    int fd
+) {
+    yev_event_t *yev_event = create_event(yev_loop, callback, gobj, fd);
+    if(!yev_event) {
+        // Error already logged
+        return NULL;
+    }
+
+    yev_event->msghdr = GBMEM_MALLOC(sizeof(yev_msghdr_t));
+    if(!yev_event->msghdr) {
+        gobj_log_critical(gobj, 0,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_MEMORY_ERROR,
+            "msg",          "%s", "No memory for yev msghdr",
+            NULL
+        );
+        slab_put(yev_loop, yev_event);
+        return NULL;
+    }
+
+    return yev_event;
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PUBLIC yev_event_t *yev_create_recvmsg_event(
+    yev_loop_t *loop,
+    yev_callback_t callback,
+    hgobj gobj,
+    int fd,
+    gbuffer_t *gbuf
+) {
+    yev_event_t *yev_event = create_msghdr_event(loop, callback, gobj, fd);
+    if(!yev_event) {
+        // Error already logged
+        return NULL;
+    }
+
+    yev_event->type = YEV_RECVMSG_TYPE;
+    yev_event->gbuf = gbuf;
+
+    if(gobj_trace_level(gobj) & TRACE_UV) {
+        do {
+            json_t *jn_flags = bits2jn_strlist(yev_flag_s, yev_event->flag);
+            gobj_log_info(gobj, 0,
+                "function",     "%s", __FUNCTION__,
+                "msgset",       "%s", MSGSET_YEV_LOOP,
+                "msg",          "%s", "yev_create_recvmsg_event",
+                "msg2",         "%s", "💥🟦 yev_create_recvmsg_event",
+                "type",         "%s", yev_event_type_name(yev_event),
+                "fd",           "%d", fd,
+                "p",            "%p", yev_event,
+                "gbuffer",      "%p", gbuf,
+                "flag",         "%j", jn_flags,
+                NULL
+            );
+            json_decref(jn_flags);
+        } while(0);
+    }
+
+    return yev_event;
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PUBLIC yev_event_t *yev_create_recvmsg_multishot_event(
+    yev_loop_t *loop,
+    yev_callback_t callback,
+    hgobj gobj,
+    int fd
+) {
+    yev_event_t *yev_event = create_msghdr_event(loop, callback, gobj, fd);
+    if(!yev_event) {
+        // Error already logged
+        return NULL;
+    }
+
+    yev_event->type = YEV_RECVMSG_MULTISHOT_TYPE;
+
+    if(gobj_trace_level(gobj) & TRACE_UV) {
+        do {
+            json_t *jn_flags = bits2jn_strlist(yev_flag_s, yev_event->flag);
+            gobj_log_info(gobj, 0,
+                "function",     "%s", __FUNCTION__,
+                "msgset",       "%s", MSGSET_YEV_LOOP,
+                "msg",          "%s", "yev_create_recvmsg_multishot_event",
+                "msg2",         "%s", "💥🟦 yev_create_recvmsg_multishot_event",
+                "type",         "%s", yev_event_type_name(yev_event),
+                "fd",           "%d", fd,
+                "p",            "%p", yev_event,
+                "flag",         "%j", jn_flags,
+                NULL
+            );
+            json_decref(jn_flags);
+        } while(0);
+    }
+
+    return yev_event;
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PUBLIC yev_event_t *yev_create_sendmsg_event(
+    yev_loop_t *loop,
+    yev_callback_t callback,
+    hgobj gobj,
+    int fd,
+    gbuffer_t *gbuf
+) {
+    yev_event_t *yev_event = create_msghdr_event(loop, callback, gobj, fd);
+    if(!yev_event) {
+        // Error already logged
+        return NULL;
+    }
+
+    yev_event->type = YEV_SENDMSG_TYPE;
+    yev_event->gbuf = gbuf;
+
+    if(gobj_trace_level(gobj) & TRACE_UV) {
+        do {
+            json_t *jn_flags = bits2jn_strlist(yev_flag_s, yev_event->flag);
+            gobj_log_info(gobj, 0,
+                "function",     "%s", __FUNCTION__,
+                "msgset",       "%s", MSGSET_YEV_LOOP,
+                "msg",          "%s", "yev_create_sendmsg_event",
+                "msg2",         "%s", "💥🟦 yev_create_sendmsg_event",
+                "type",         "%s", yev_event_type_name(yev_event),
+                "fd",           "%d", fd,
+                "p",            "%p", yev_event,
+                "gbuffer",      "%p", gbuf,
+                "flag",         "%j", jn_flags,
+                NULL
+            );
+            json_decref(jn_flags);
+        } while(0);
+    }
+
+    return yev_event;
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PUBLIC int yev_set_peer(
+    yev_event_t *yev_event,
+    const struct sockaddr *addr,
+    socklen_t addrlen
+) {
+    if(!yev_event->msghdr) {
+        gobj_log_error(yev_event->gobj, LOG_OPT_TRACE_STACK,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_PARAMETER_ERROR,
+            "msg",          "%s", "yev_event without msghdr, not a datagram event",
+            "event_type",   "%s", yev_event_type_name(yev_event),
+            NULL
+        );
+        return -1;
+    }
+    if(!addr || addrlen == 0) {
+        yev_event->msghdr->peerlen = 0;
+        return 0;
+    }
+    if(addrlen > sizeof(yev_event->msghdr->peer)) {
+        gobj_log_error(yev_event->gobj, LOG_OPT_TRACE_STACK,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_PARAMETER_ERROR,
+            "msg",          "%s", "addrlen too big",
+            "addrlen",      "%d", (int)addrlen,
+            NULL
+        );
+        return -1;
+    }
+    memcpy(&yev_event->msghdr->peer, addr, addrlen);
+    yev_event->msghdr->peerlen = addrlen;
+    return 0;
+}
+
+/***************************************************************************
+ *  Event receiving the messages of other loops, never started
+ ***************************************************************************/
+PUBLIC yev_event_t *yev_create_msg_event(
+    yev_loop_t *loop,
+    yev_callback_t callback,
+    hgobj gobj
+) {
+    yev_event_t *yev_event = create_event(loop, callback, gobj, -1);
+    if(!yev_event) {
+        // Error already logged
+        return NULL;
+    }
+
+    yev_event->type = YEV_MSG_TYPE;     // Without fd, its cqes are posted by other loops
+
+    if(gobj_trace_level(gobj) & TRACE_UV) {
+        do {
+            json_t *jn_flags = bits2jn_strlist(yev_flag_s, yev_event->flag);
+            gobj_log_info(gobj, 0,
+                "function",     "%s", __FUNCTION__,
+                "msgset",       "%s", MSGSET_YEV_LOOP,
+                "msg",          "%s", "yev_create_msg_event",
+                "msg2",         "%s", "💥🟦 yev_create_msg_event",
+                "type",         "%s", yev_event_type_name(yev_event),
+                "p",            "%p", yev_event,
+                "flag",         "%j", jn_flags,
+                NULL
+            );
+            json_decref(jn_flags);
+        } while(0);
+    }
+
+    return yev_event;
+}
+
+/***************************************************************************
+ *  Post a cqe with the value in the ring of the msg event's loop.
+ *  Called from the thread of `yev_loop`, the sqe goes in its ring.
+ ***************************************************************************/
+PUBLIC int yev_send_msg(
+    yev_loop_t *yev_loop,
+    yev_event_t *yev_msg_event,
+    uint32_t value
+) {
+    if(!(yev_loop->caps & YEV_CAP_MSG_RING)) {
+        gobj_log_error(yev_loop->yuno, LOG_OPT_TRACE_STACK,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_LIBUV_ERROR,
+            "msg",          "%s", "IORING_OP_MSG_RING not available in the ring",
+            NULL
+        );
+        return -1;
+    }
+    if((yev_type_t)yev_msg_event->type != YEV_MSG_TYPE) {
+        gobj_log_error(yev_loop->yuno, LOG_OPT_TRACE_STACK,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_PARAMETER_ERROR,
+            "msg",          "%s", "Not a msg event",
+            "event_type",   "%s", yev_event_type_name(yev_msg_event),
+            NULL
+        );
+        return -1;
+    }
+    if(yev_loop->stopping) {
+        return -1;
+    }
+
+    struct io_uring_sqe *sqe = yev_get_sqe(yev_loop);
+    if(!sqe) {
+        // Error already logged
+        yev_loop->stats.msgs_failed++;
+        return -1;
+    }
+    io_uring_prep_msg_ring(
+        sqe,
+        yev_msg_event->yev_loop->ring.ring_fd,
+        value,
+        (uint64_t)(uintptr_t)yev_msg_event,
+        0
+    );
+    io_uring_sqe_set_data64(sqe, YEV_UDATA_MSG_RING);
+    yev_loop->stats.msgs_sent++;
+    yev_submit(yev_loop);
+
+    return 0;
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PUBLIC BOOL yev_msg_available(yev_loop_t *yev_loop)
+{
+    return (yev_loop->caps & YEV_CAP_MSG_RING)? TRUE:FALSE;
+}
+
+/***************************************************************************
+ *  Disk i/o event
+ ***************************************************************************/
+PRIVATE yev_event_t *create_file_event(
+    yev_loop_t *yev_loop,
+    yev_callback_t callback,
+    hgobj gobj,
+    int fd,
+    gbuffer_t *gbuf,
+    yev_type_t type,
+    const char *fn
+) {
+    yev_event_t *yev_event = create_event(yev_loop, callback, gobj, fd);
+    if(!yev_event) {
+        // Error already logged
+        return NULL;
+    }
+
+    yev_event->type = type;
+    yev_event->gbuf = gbuf;
+    yev_event->offset = YEV_FILE_POSITION;
+
+    if(gobj_trace_level(gobj) & TRACE_UV) {
+        do {
+            json_t *jn_flags = bits2jn_strlist(yev_flag_s, yev_event->flag);
+            gobj_log_info(gobj, 0,
+                "function",     "%s", fn,
+                "msgset",       "%s", MSGSET_YEV_LOOP,
+                "msg",          "%s", fn,
+                "msg2",         "%s", "💥🟦 create file event",
+                "type",         "%s", yev_event_type_name(yev_event),
+                "fd",           "%d", fd,
+                "p",            "%p", yev_event,
+                "gbuffer",      "%p", gbuf,
+                "flag",         "%j", jn_flags,
+                NULL
+            );
+            json_decref(jn_flags);
+        } while(0);
+    }
+
+    return yev_event;
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PUBLIC yev_event_t *yev_create_file_read_event(
+    yev_loop_t *loop,
+    yev_callback_t callback,
+    hgobj gobj,
+    int fd,
+    gbuffer_t *gbuf
+) {
+    return create_file_event(loop, callback, gobj, fd, gbuf, YEV_FILE_READ_TYPE, __FUNCTION__);
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PUBLIC yev_event_t *yev_create_file_write_event(
+    yev_loop_t *loop,
+    yev_callback_t callback,
+    hgobj gobj,
+    int fd,
+    gbuffer_t *gbuf
+) {
+    return create_file_event(loop, callback, gobj, fd, gbuf, YEV_FILE_WRITE_TYPE, __FUNCTION__);
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PUBLIC yev_event_t *yev_create_fsync_event(
+    yev_loop_t *loop,
+    yev_callback_t callback,
+    hgobj gobj,
+    int fd
+) {
+    return create_file_event(loop, callback, gobj, fd, 0, YEV_FSYNC_TYPE, __FUNCTION__);
+}
+
+/***************************************************************************
+ *  Start a disk i/o event at offset,
+ *  with sync a write is durable when its callback is called
+ ***************************************************************************/
+PUBLIC int yev_start_file_event(
+    yev_event_t *yev_event,
+    uint64_t offset,
+    BOOL sync
+) {
+    switch((yev_type_t)yev_event->type) {
+        case YEV_FILE_READ_TYPE:
+        case YEV_FILE_WRITE_TYPE:
+        case YEV_FSYNC_TYPE:
+            break;
+        default:
+            gobj_log_error(yev_event->gobj, LOG_OPT_TRACE_STACK,
+                "function",     "%s", __FUNCTION__,
+                "msgset",       "%s", MSGSET_LIBUV_ERROR,
+                "msg",          "%s", "Cannot start event: not a file event",
+                "event_type",   "%s", yev_event_type_name(yev_event),
+                "p",            "%p", yev_event,
+                NULL
+            );
+            return -1;
+    }
+    if(yev_event_in_ring(yev_event)) {
+        // Don't change an operation in flight, error logged by yev_start_event()
+        return yev_start_event(yev_event);
+    }
+
+    yev_event->offset = offset;
+    yev_event->sync = sync?TRUE:FALSE;
+    return yev_start_event(yev_event);
+}
+
+/***************************************************************************
+ *  Submit the sqe of a disk i/o event,
+ *  the write with sync is linked to a fdatasync, both in the same submit.
+ ***************************************************************************/
+PRIVATE int start_file_event(yev_event_t *yev_event)
+{
+    hgobj gobj = yev_event->gobj;
+    yev_loop_t *yev_loop = yev_event->yev_loop;
+    yev_type_t type = (yev_type_t)yev_event->type;
+
+    if(yev_event->fd < 0) {
+        gobj_log_error(gobj, LOG_OPT_TRACE_STACK,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_LIBUV_ERROR,
+            "msg",          "%s", "Cannot start event: fd negative",
+            "event_type",   "%s", yev_event_type_name(yev_event),
+            "p",            "%p", yev_event,
+            NULL
+        );
+        return -1;
+    }
+    if(type != YEV_FSYNC_TYPE) {
+        if(!yev_event->gbuf) {
+            gobj_log_error(gobj, LOG_OPT_TRACE_STACK,
+                "function",     "%s", __FUNCTION__,
+                "msgset",       "%s", MSGSET_LIBUV_ERROR,
+                "msg",          "%s", "Cannot start event: gbuffer NULL",
+                "event_type",   "%s", yev_event_type_name(yev_event),
+                "p",            "%p", yev_event,
+                NULL
+            );
+            return -1;
+        }
+        size_t len = (type == YEV_FILE_READ_TYPE)?
+            gbuffer_freebytes(yev_event->gbuf) : gbuffer_leftbytes(yev_event->gbuf);
+        if(len == 0) {
+            gobj_log_error(gobj, LOG_OPT_TRACE_STACK,
+                "function",     "%s", __FUNCTION__,
+                "msgset",       "%s", MSGSET_LIBUV_ERROR,
+                "msg",          "%s", (type == YEV_FILE_READ_TYPE)?
+                                    "Cannot start event: gbuffer WITHOUT space to read":
+                                    "Cannot start event: gbuffer WITHOUT data to write",
+                "event_type",   "%s", yev_event_type_name(yev_event),
+                "p",            "%p", yev_event,
+                "gbuf_label",   "%s", gbuffer_getlabel(yev_event->gbuf),
+                NULL
+            );
+            return -1;
+        }
+    }
+
+    BOOL chain = (type == YEV_FILE_WRITE_TYPE && yev_event->sync)? TRUE:FALSE;
+    if(chain && io_uring_sq_space_left(&yev_loop->ring) < 2) {
+        yev_loop->stats.sq_full++;
+        yev_loop_flush(yev_loop);
+    }
+
+    struct io_uring_sqe *sqe = yev_get_sqe(yev_loop);
+    if(!sqe) {
+        // Error already logged
+        return -1;
+    }
+    io_uring_sqe_set_data(sqe, yev_event);
+
+    switch(type) {
+        case YEV_FILE_READ_TYPE:
+            if(is_fixed_gbuffer(yev_loop, yev_event->gbuf)) {
+                io_uring_prep_read_fixed(
+                    sqe,
+                    yev_event->fd,
+                    gbuffer_cur_wr_pointer(yev_event->gbuf),
+                    (unsigned)gbuffer_freebytes(yev_event->gbuf),
+                    yev_event->offset,
+                    0   // the region is the buffer index 0
+                );
+                yev_loop->stats.fixed_bufs_ops++;
+            } else {
+                io_uring_prep_read(
+                    sqe,
+                    yev_event->fd,
+                    gbuffer_cur_wr_pointer(yev_event->gbuf),
+                    (unsigned)gbuffer_freebytes(yev_event->gbuf),
+                    yev_event->offset
+                );
+            }
+            break;
+        case YEV_FILE_WRITE_TYPE:
+            if(is_fixed_gbuffer(yev_loop, yev_event->gbuf)) {
+                io_uring_prep_write_fixed(
+                    sqe,
+                    yev_event->fd,
+                    gbuffer_cur_rd_pointer(yev_event->gbuf),
+                    (unsigned)gbuffer_leftbytes(yev_event->gbuf),
+                    yev_event->offset,
+                    0   // the region is the buffer index 0
+                );
+                yev_loop->stats.fixed_bufs_ops++;
+            } else {
+                io_uring_prep_write(
+                    sqe,
+                    yev_event->fd,
+                    gbuffer_cur_rd_pointer(yev_event->gbuf),
+                    (unsigned)gbuffer_leftbytes(yev_event->gbuf),
+                    yev_event->offset
+                );
+            }
+            break;
+        default:
+            io_uring_prep_fsync(sqe, yev_event->fd, yev_event->sync? IORING_FSYNC_DATASYNC:0);
+            break;
+    }
+    sqe_set_fixed_file(yev_loop, sqe, yev_event->fd);
+
+    yev_event->sync_pending = 0;
+    if(chain) {
+        /*
+         *  The fdatasync runs when the write is complete,
+         *  its cqe calls the callback with the result of the write.
+         */
+        sqe->flags |= IOSQE_IO_LINK;
+        struct io_uring_sqe *sqe_sync = yev_get_sqe(yev_loop);
+        if(!sqe_sync) {
+            // Error already logged, the write goes alone
+            sqe->flags &= (__u8)~IOSQE_IO_LINK;
+        } else {
+            io_uring_sqe_set_data(sqe_sync, yev_event);
+            io_uring_prep_fsync(sqe_sync, yev_event->fd, IORING_FSYNC_DATASYNC);
+            sqe_set_fixed_file(yev_loop, sqe_sync, yev_event->fd);
+            yev_event->sync_pending = 2;
+        }
+    }
+
+    yev_submit(yev_loop);
+    set_in_ring(yev_event);
+    return 0;
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PUBLIC yev_event_t *yev_create_poll_event(
+    yev_loop_t *loop,
+    yev_callback_t callback,
+    hgobj gobj,
+    int fd,
+    unsigned poll_events
+) {
+    yev_event_t *yev_event = create_event(loop, callback, gobj, fd);
+    if(!yev_event) {
+        // Error already logged
+        return NULL;
+    }
+
+    yev_event->type = YEV_POLL_TYPE;
+    yev_event->poll_events = poll_events;
+
+    if(gobj_trace_level(gobj) & TRACE_UV) {
+        do {
+            json_t *jn_flags = bits2jn_strlist(yev_flag_s, yev_event->flag);
+            gobj_log_info(gobj, 0,
+                "function",     "%s", __FUNCTION__,
+                "msgset",       "%s", MSGSET_YEV_LOOP,
+                "msg",          "%s", "yev_create_poll_event",
+                "msg2",         "%s", "💥🟦 yev_create_poll_event",
+                "type",         "%s", yev_event_type_name(yev_event),
+                "fd",           "%d", fd,
+                "p",            "%p", yev_event,
+                "flag",         "%j", jn_flags,
+                NULL
+            );
+            json_decref(jn_flags);
+        } while(0);
+    }
+
+    return yev_event;
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PUBLIC yev_event_t *yev_create_splice_event(
+    yev_loop_t *loop,
+    yev_callback_t callback,
+    hgobj gobj,
+    int fd
+) {
+    yev_event_t *yev_event = create_event(loop, callback, gobj, fd);
+    if(!yev_event) {
+        // Error already logged
+        return NULL;
+    }
+
+    yev_event->type = YEV_SPLICE_TYPE;
+    yev_event->fd_in = -1;
+    yev_event->pipe_fds[0] = -1;
+    yev_event->pipe_fds[1] = -1;
+
+    if(gobj_trace_level(gobj) & TRACE_UV) {
+        do {
+            json_t *jn_flags = bits2jn_strlist(yev_flag_s, yev_event->flag);
+            gobj_log_info(gobj, 0,
+                "function",     "%s", __FUNCTION__,
+                "msgset",       "%s", MSGSET_YEV_LOOP,
+                "msg",          "%s", "yev_create_splice_event",
+                "msg2",         "%s", "💥🟦 yev_create_splice_event",
+                "type",         "%s", yev_event_type_name(yev_event),
+                "fd",           "%d", fd,
+                "p",            "%p", yev_event,
+                "flag",         "%j", jn_flags,
+                NULL
+            );
+            json_decref(jn_flags);
+        } while(0);
+    }
+
+    return yev_event;
+}
+
+/***************************************************************************
+ *  Send up to len bytes of fd_in at offset to the fd of the event
+ ***************************************************************************/
+PUBLIC int yev_start_splice_event(
+    yev_event_t *yev_event,
+    int fd_in,
+    uint64_t offset,
+    size_t len
+) {
+    if((yev_type_t)yev_event->type != YEV_SPLICE_TYPE) {
+        gobj_log_error(yev_event->gobj, LOG_OPT_TRACE_STACK,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_LIBUV_ERROR,
+            "msg",          "%s", "Cannot start event: not a splice event",
+            "event_type",   "%s", yev_event_type_name(yev_event),
+            "p",            "%p", yev_event,
+            NULL
+        );
+        return -1;
+    }
+    if(yev_event_in_ring(yev_event)) {
+        // Don't change an operation in flight, error logged by yev_start_event()
+        return yev_start_event(yev_event);
+    }
+
+    yev_event->fd_in = fd_in;
+    yev_event->offset = offset;
+    yev_event->splice_len = (uint32_t)MIN(len, (size_t)UINT32_MAX);
+    return yev_start_event(yev_event);
+}
+
+/***************************************************************************
+ *  Submit the chain fd_in->pipe, pipe->fd
+ ***************************************************************************/
+PRIVATE int start_splice_event(yev_event_t *yev_event)
+{
+    hgobj gobj = yev_event->gobj;
+    yev_loop_t *yev_loop = yev_event->yev_loop;
+
+    if(yev_event->fd < 0 || yev_event->fd_in < 0 || yev_event->splice_len == 0) {
+        gobj_log_error(gobj, LOG_OPT_TRACE_STACK,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_LIBUV_ERROR,
+            "msg",          "%s", "Cannot start event: fd negative or nothing to splice",
+            "event_type",   "%s", yev_event_type_name(yev_event),
+            "p",            "%p", yev_event,
+            "fd",           "%d", yev_event->fd,
+            "fd_in",        "%d", yev_event->fd_in,
+            NULL
+        );
+        return -1;
+    }
+
+    if(yev_event->pipe_fds[0] < 0) {
+        if(pipe2(yev_event->pipe_fds, O_CLOEXEC) < 0) {
+            gobj_log_error(gobj, 0,
+                "function",     "%s", __FUNCTION__,
+                "msgset",       "%s", MSGSET_SYSTEM_ERROR,
+                "msg",          "%s", "pipe2() FAILED",
+                "errno",        "%d", errno,
+                "serrno",       "%s", strerror(errno),
+                NULL
+            );
+            yev_event->pipe_fds[0] = -1;
+            yev_event->pipe_fds[1] = -1;
+            return -1;
+        }
+        // Bigger pipe, fewer round trips. Without permission it keeps the default size
+        fcntl(yev_event->pipe_fds[1], F_SETPIPE_SZ, YEV_SPLICE_PIPE_SIZE);
+        yev_event->in_pipe = 0;
+    }
+    int pipe_size = fcntl(yev_event->pipe_fds[1], F_GETPIPE_SZ);
+    if(pipe_size > 0 && yev_event->splice_len > (uint32_t)pipe_size) {
+        yev_event->splice_len = (uint32_t)pipe_size;
+    }
+
+    if(io_uring_sq_space_left(&yev_loop->ring) < 2) {
+        yev_loop->stats.sq_full++;
+        yev_loop_flush(yev_loop);
+    }
+
+    struct io_uring_sqe *sqe = yev_get_sqe(yev_loop);
+    if(!sqe) {
+        // Error already logged
+        return -1;
+    }
+    io_uring_sqe_set_data(sqe, yev_event);
+    io_uring_prep_splice(
+        sqe,
+        yev_event->fd_in,
+        (yev_event->offset == YEV_FILE_POSITION)? -1 : (int64_t)yev_event->offset,
+        yev_event->pipe_fds[1],
+        -1,
+        yev_event->splice_len,
+        0
+    );
+
+    /*
+     *  The pipe->fd runs when the fd_in->pipe is complete,
+     *  its cqe calls the callback (or resumes a short send).
+     */
+    struct io_uring_sqe *sqe_out = yev_get_sqe(yev_loop);
+    if(!sqe_out) {
+        // Error already logged, the fd_in->pipe cannot go alone, its cqe is ignored
+        io_uring_prep_nop(sqe);
+        io_uring_sqe_set_data64(sqe, YEV_UDATA_LINK_TIMEOUT);
+        return -1;
+    }
+    sqe->flags |= IOSQE_IO_LINK;
+    io_uring_sqe_set_data(sqe_out, yev_event);
+    io_uring_prep_splice(
+        sqe_out,
+        yev_event->pipe_fds[0],
+        -1,
+        yev_event->fd,
+        -1,
+        yev_event->splice_len,
+        0
+    );
+    sqe_set_fixed_file(yev_loop, sqe_out, yev_event->fd);
+    yev_event->splice_moved = 0;
+    yev_event->sync_pending = 2;
+
+    yev_submit(yev_loop);
+    set_in_ring(yev_event);
+    return 0;
+}
+
+/***************************************************************************
+ *  Send the rest of the pipe to the fd
+ ***************************************************************************/
+PRIVATE int splice_drain(yev_event_t *yev_event)
+{
+    yev_loop_t *yev_loop = yev_event->yev_loop;
+
+    if(yev_event->fd < 0 || yev_event->pipe_fds[0] < 0) {
+        return -1;
+    }
+    struct io_uring_sqe *sqe = yev_get_sqe(yev_loop);
+    if(!sqe) {
+        // Error already logged
+        return -1;
+    }
+    io_uring_sqe_set_data(sqe, yev_event);
+    io_uring_prep_splice(
+        sqe,
+        yev_event->pipe_fds[0],
+        -1,
+        yev_event->fd,
+        -1,
+        yev_event->in_pipe,
+        0
+    );
+    sqe_set_fixed_file(yev_loop, sqe, yev_event->fd);
+    yev_submit(yev_loop);
+    set_in_ring(yev_event);
+    return 0;
+}
+
+/***************************************************************************
+ *  Close the pipe, with the data not sent
+ ***************************************************************************/
+PRIVATE void splice_reset_pipe(yev_event_t *yev_event)
+{
+    if(yev_event->pipe_fds[0] >= 0) {
+        close(yev_event->pipe_fds[0]);
+    }
+    if(yev_event->pipe_fds[1] >= 0) {
+        close(yev_event->pipe_fds[1]);
+    }
+    yev_event->pipe_fds[0] = -1;
+    yev_event->pipe_fds[1] = -1;
+    yev_event->in_pipe = 0;
+}
+
+/***************************************************************************
+ *  Prepare the multishot recv (or recvmsg) sqe, buffers selected from the recv buffer ring
+ ***************************************************************************/
+PRIVATE int rearm_recv_multishot(yev_event_t *yev_event)
+{
+    yev_loop_t *yev_loop = yev_event->yev_loop;
+
+    struct io_uring_sqe *sqe = yev_get_sqe(yev_loop);
+    if(!sqe) {
+        // Error already logged
+        return -1;
+    }
+    io_uring_sqe_set_data(sqe, yev_event);
+    if(yev_event->type == YEV_RECVMSG_MULTISHOT_TYPE) {
+        /*
+         *  The msghdr is a template: room for the source address in the buffer, no iovecs
+         */
+        yev_msghdr_t *msghdr = yev_event->msghdr;
+        memset(&msghdr->msg, 0, sizeof(msghdr->msg));
+        msghdr->msg.msg_namelen = sizeof(msghdr->peer);
+        io_uring_prep_recvmsg_multishot(sqe, yev_event->fd, &msghdr->msg, 0);
+    } else {
+        io_uring_prep_recv_multishot(sqe, yev_event->fd, NULL, 0, 0);
+    }
+    sqe_set_fixed_file(yev_loop, sqe, yev_event->fd);
+    sqe->flags |= IOSQE_BUFFER_SELECT;
+    sqe->buf_group = YEV_RECV_BGID;
+    yev_submit(yev_loop);
+    set_in_ring(yev_event);
+    return 0;
+}
+
+/***************************************************************************
+ *  Get the recv buffer ring of the loop, create it on first use
+ ***************************************************************************/
+PRIVATE yev_recv_ring_t *get_recv_ring(yev_loop_t *yev_loop)
+{
+    if(yev_loop->recv_ring) {
+        return yev_loop->recv_ring;
+    }
+
+    if(!(yev_loop->caps & YEV_CAP_RECV_MULTISHOT)) {
+        gobj_log_error(yev_loop->yuno, LOG_OPT_TRACE_STACK,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_LIBUV_ERROR,
+            "msg",          "%s", "multishot recv not available in the ring",
+            NULL
+        );
+        return NULL;
+    }
+
+    yev_recv_ring_t *recv_ring = GBMEM_MALLOC(sizeof(yev_recv_ring_t));
+    if(!recv_ring) {
+        gobj_log_critical(yev_loop->yuno, 0,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_MEMORY_ERROR,
+            "msg",          "%s", "No memory to recv ring",
+            NULL
+        );
+        return NULL;
+    }
+    recv_ring->nbufs = yev_loop->recv_buffers;
+    recv_ring->buf_size = yev_loop->recv_buffer_size;
+    recv_ring->stride = (recv_ring->buf_size + 1 + 63) & ~63U; // room for final null of gbuffer
+    recv_ring->buffers_size = (size_t)recv_ring->nbufs * recv_ring->stride;
+
+    recv_ring->buffers = mmap(
+        NULL,
+        recv_ring->buffers_size,
+        PROT_READ|PROT_WRITE,
+        MAP_PRIVATE|MAP_ANONYMOUS,
+        -1,
+        0
+    );
+    if(recv_ring->buffers == MAP_FAILED) {
+        gobj_log_critical(yev_loop->yuno, 0,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_MEMORY_ERROR,
+            "msg",          "%s", "mmap() of recv buffers FAILED",
+            "size",         "%lu", (unsigned long)recv_ring->buffers_size,
+            "errno",        "%d", errno,
+            "serrno",       "%s", strerror(errno),
+            NULL
+        );
+        GBMEM_FREE(recv_ring)
+        return NULL;
+    }
+
+    int err = 0;
+    recv_ring->br = io_uring_setup_buf_ring(
+        &yev_loop->ring,
+        recv_ring->nbufs,
+        YEV_RECV_BGID,
+        0,
+        &err
+    );
+    if(!recv_ring->br) {
+        gobj_log_error(yev_loop->yuno, 0,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_LIBUV_ERROR,
+            "msg",          "%s", "io_uring_setup_buf_ring() FAILED, multishot recv not available",
+            "nbufs",        "%d", (int)recv_ring->nbufs,
+            "errno",        "%d", -err,
+            "serrno",       "%s", strerror(-err),
+            NULL
+        );
+        munmap(recv_ring->buffers, recv_ring->buffers_size);
+        GBMEM_FREE(recv_ring)
+        yev_loop->caps &= ~(uint32_t)YEV_CAP_RECV_MULTISHOT;
+        return NULL;
+    }
+
+    int mask = io_uring_buf_ring_mask(recv_ring->nbufs);
+    for(unsigned i=0; i<recv_ring->nbufs; i++) {
+        io_uring_buf_ring_add(
+            recv_ring->br,
+            recv_ring->buffers + (size_t)i * recv_ring->stride,
+            recv_ring->buf_size,
+            (unsigned short)i,
+            mask,
+            (int)i
+        );
+    }
+    io_uring_buf_ring_advance(recv_ring->br, (int)recv_ring->nbufs);
+
+    recv_ring->yev_loop = yev_loop;
+    yev_loop->recv_ring = recv_ring;
+    return recv_ring;
+}
+
+/***************************************************************************
+ *  Unregister the buffer ring,
+ *  the buffers memory is freed when the last gbuffer using it is released.
+ ***************************************************************************/
+PRIVATE void recv_ring_destroy(yev_loop_t *yev_loop)
+{
+    yev_recv_ring_t *recv_ring = yev_loop->recv_ring;
+    if(!recv_ring) {
+        return;
+    }
+    yev_loop->recv_ring = NULL;
+
+    io_uring_free_buf_ring(&yev_loop->ring, recv_ring->br, recv_ring->nbufs, YEV_RECV_BGID);
+    recv_ring->br = NULL;
+    recv_ring->yev_loop = NULL;
+    GBMEM_FREE(recv_ring->starved)
+    recv_ring->n_starved = 0;
+    recv_ring->max_starved = 0;
+
+    if(recv_ring->in_use == 0) {
+        munmap(recv_ring->buffers, recv_ring->buffers_size);
+        GBMEM_FREE(recv_ring)
+    }
+}
+
+/***************************************************************************
+ *  Called on remove of gbuffers wrapping a recv buffer: return it to the ring
+ ***************************************************************************/
+PRIVATE void recv_ring_give_back(void *user_data, char *data)
+{
+    yev_recv_ring_t *recv_ring = user_data;
+
+    recv_ring->in_use--;
+
+    if(!recv_ring->yev_loop) {
+        // Loop destroyed, the last one free the memory
+        if(recv_ring->in_use == 0) {
+            munmap(recv_ring->buffers, recv_ring->buffers_size);
+            GBMEM_FREE(recv_ring)
+        }
+        return;
+    }
+
+    // data can be inside the buffer (payload of a recvmsg)
+    unsigned bid = (unsigned)((size_t)(data - recv_ring->buffers) / recv_ring->stride);
+    data = recv_ring->buffers + (size_t)bid * recv_ring->stride;
+    io_uring_buf_ring_add(
+        recv_ring->br,
+        data,
+        recv_ring->buf_size,
+        (unsigned short)bid,
+        io_uring_buf_ring_mask(recv_ring->nbufs),
+        0
+    );
+    io_uring_buf_ring_advance(recv_ring->br, 1);
+
+    /*
+     *  Re-arm a recv stopped by lack of buffers
+     */
+    if(recv_ring->n_starved > 0) {
+        yev_event_t *yev_event = recv_ring->starved[--recv_ring->n_starved];
+        if(recv_ring->yev_loop->running && !yev_event_in_ring(yev_event) && yev_event->fd > 0) {
+            rearm_recv_multishot(yev_event);
+        }
+    }
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PRIVATE int recv_ring_add_starved(yev_recv_ring_t *recv_ring, yev_event_t *yev_event)
+{
+    for(unsigned i=0; i<recv_ring->n_starved; i++) {
+        if(recv_ring->starved[i] == yev_event) {
+            return 0;
+        }
+    }
+    if(recv_ring->n_starved >= recv_ring->max_starved) {
+        unsigned max_starved = recv_ring->max_starved? recv_ring->max_starved*2 : 16;
+        yev_event_t **starved = GBMEM_REALLOC(recv_ring->starved, max_starved * sizeof(yev_event_t *));
+        if(!starved) {
+            gobj_log_critical(recv_ring->yev_loop->yuno, 0,
+                "function",     "%s", __FUNCTION__,
+                "msgset",       "%s", MSGSET_MEMORY_ERROR,
+                "msg",          "%s", "No memory to starved recv events",
+                NULL
+            );
+            return -1;
+        }
+        recv_ring->starved = starved;
+        recv_ring->max_starved = max_starved;
+    }
+    recv_ring->starved[recv_ring->n_starved++] = yev_event;
+    return 0;
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PRIVATE void recv_ring_del_starved(yev_recv_ring_t *recv_ring, yev_event_t *yev_event)
+{
+    for(unsigned i=0; i<recv_ring->n_starved; i++) {
+        if(recv_ring->starved[i] == yev_event) {
+            recv_ring->starved[i] = recv_ring->starved[--recv_ring->n_starved];
+            return;
+        }
+    }
+}
+
+/***************************************************************************
+ *  Get the registered files table, created (sparse) on first use.
+ *  Return NULL if not available, the plain fds are used.
+ ***************************************************************************/
+PRIVATE yev_fixed_files_t *get_fixed_files(yev_loop_t *yev_loop)
+{
+    if(yev_loop->fixed) {
+        return yev_loop->fixed;
+    }
+    if(!yev_loop->fixed_files) {
+        return NULL;
+    }
+
+    /*
+     *  The kernel refuses tables bigger than RLIMIT_NOFILE
+     */
+    unsigned size = yev_loop->fixed_files;
+    struct rlimit rl;
+    if(getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur != RLIM_INFINITY && size > rl.rlim_cur) {
+        size = (unsigned)rl.rlim_cur;
+    }
+
+    yev_fixed_files_t *fixed = GBMEM_MALLOC(sizeof(yev_fixed_files_t));
+    if(fixed) {
+        fixed->free_slots = GBMEM_MALLOC(size * sizeof(int));
+    }
+    if(!fixed || !fixed->free_slots) {
+        gobj_log_critical(yev_loop->yuno, 0,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_MEMORY_ERROR,
+            "msg",          "%s", "No memory to registered files table",
+            "size",         "%d", (int)size,
+            NULL
+        );
+        if(fixed) {
+            GBMEM_FREE(fixed)
+        }
+        yev_loop->fixed_files = 0;
+        return NULL;
+    }
+
+    int ret = io_uring_register_files_sparse(&yev_loop->ring, size);
+    if(ret < 0) {
+        gobj_log_warning(yev_loop->yuno, 0,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_YEV_LOOP,
+            "msg",          "%s", "io_uring_register_files_sparse() FAILED, using plain fds",
+            "size",         "%d", (int)size,
+            "errno",        "%d", -ret,
+            "serrno",       "%s", strerror(-ret),
+            NULL
+        );
+        GBMEM_FREE(fixed->free_slots)
+        GBMEM_FREE(fixed)
+        yev_loop->fixed_files = 0;
+        return NULL;
+    }
+
+    fixed->size = size;
+    for(unsigned i=0; i<size; i++) {
+        fixed->free_slots[i] = (int)(size - 1 - i);  // slot 0 on top
+    }
+    fixed->n_free = size;
+    fixed->fd2slot = NULL;
+    fixed->fd2slot_size = 0;
+    fixed->in_use = 0;
+    fixed->direct_start = size;
+    fixed->direct_used = 0;
+    fixed->direct_low = 0;
+    fixed->accepting = NULL;
+
+    yev_loop->fixed_files = size;
+    yev_loop->fixed = fixed;
+    return fixed;
+}
+
+/***************************************************************************
+ *  The table in kernel is released by io_uring_queue_exit()
+ ***************************************************************************/
+PRIVATE void fixed_files_destroy(yev_loop_t *yev_loop)
+{
+    yev_fixed_files_t *fixed = yev_loop->fixed;
+    if(!fixed) {
+        return;
+    }
+    yev_loop->fixed = NULL;
+    GBMEM_FREE(fixed->fd2slot)
+    GBMEM_FREE(fixed->free_slots)
+    GBMEM_FREE(fixed->accepting)
+    GBMEM_FREE(fixed)
+}
+
+/***************************************************************************
+ *  Use the fixed slot of fd in the sqe if it's registered
+ ***************************************************************************/
+PRIVATE void sqe_set_fixed_file(yev_loop_t *yev_loop, struct io_uring_sqe *sqe, int fd)
+{
+    yev_fixed_files_t *fixed = yev_loop->fixed;
+    if(fixed && fd >= 0 && (unsigned)fd < fixed->fd2slot_size && fixed->fd2slot[fd] >= 0) {
+        sqe->fd = fixed->fd2slot[fd];
+        sqe->flags |= IOSQE_FIXED_FILE;
+    }
+}
+
+/***************************************************************************
+ *  Install the fd in the registered files table.
+ *  Return the fixed slot, -1 if not registered (the plain fd is used)
+ ***************************************************************************/
+PUBLIC int yev_register_fd(yev_loop_t *yev_loop, int fd)
+{
+    if(fd < 0) {
+        return -1;
+    }
+    yev_fixed_files_t *fixed = get_fixed_files(yev_loop);
+    if(!fixed) {
+        return -1;
+    }
+
+    /*
+     *  If the fd has a slot it's re-installed: the number can be reused by a new file
+     */
+    int slot = (unsigned)fd < fixed->fd2slot_size? fixed->fd2slot[fd] : -1;
+    if(slot < 0) {
+        if(fixed->n_free == 0) {
+            yev_loop->stats.fixed_full++;
+            return -1;
+        }
+        slot = fixed->free_slots[--fixed->n_free];
+        if(fd2slot_set(yev_loop, fixed, fd, -1) < 0) {
+            fixed->free_slots[fixed->n_free++] = slot;
+            return -1;
+        }
+        fixed->in_use++;
+    }
+
+    int ret = io_uring_register_files_update(&yev_loop->ring, (unsigned)slot, &fd, 1);
+    if(ret < 0) {
+        gobj_log_error(yev_loop->yuno, 0,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_LIBUV_ERROR,
+            "msg",          "%s", "io_uring_register_files_update() FAILED",
+            "fd",           "%d", fd,
+            "slot",         "%d", slot,
+            "errno",        "%d", -ret,
+            "serrno",       "%s", strerror(-ret),
+            NULL
+        );
+        release_slot(yev_loop, fixed, slot);
+        fixed->fd2slot[fd] = -1;
+        fixed->in_use--;
+        return -1;
+    }
+
+    fixed->fd2slot[fd] = slot;
+    return slot;
+}
+
+/***************************************************************************
+ *  Remove the fd from the registered files table
+ ***************************************************************************/
+PUBLIC int yev_unregister_fd(yev_loop_t *yev_loop, int fd)
+{
+    yev_fixed_files_t *fixed = yev_loop->fixed;
+    if(!fixed || fd < 0 || (unsigned)fd >= fixed->fd2slot_size || fixed->fd2slot[fd] < 0) {
+        return -1;
+    }
+    int slot = fixed->fd2slot[fd];
+
+    /*
+     *  The queued sqes must reach the kernel with the current file of the slot
+     */
+    if(io_uring_sq_ready(&yev_loop->ring) > 0) {
+        yev_loop_flush(yev_loop);
+    }
+
+    fixed->fd2slot[fd] = -1;
+    release_slot(yev_loop, fixed, slot);
+    fixed->in_use--;
+    return 0;
+}
+
+/***************************************************************************
+ *  Set the fixed slot of fd, growing the map
+ ***************************************************************************/
+PRIVATE int fd2slot_set(yev_loop_t *yev_loop, yev_fixed_files_t *fixed, int fd, int slot)
+{
+    if((unsigned)fd >= fixed->fd2slot_size) {
+        unsigned new_size = fixed->fd2slot_size? fixed->fd2slot_size : 64;
+        while(new_size <= (unsigned)fd) {
+            new_size *= 2;
+        }
+        int *fd2slot = GBMEM_REALLOC(fixed->fd2slot, new_size * sizeof(int));
+        if(!fd2slot) {
+            gobj_log_critical(yev_loop->yuno, 0,
+                "function",     "%s", __FUNCTION__,
+                "msgset",       "%s", MSGSET_MEMORY_ERROR,
+                "msg",          "%s", "No memory to fd map of registered files",
+                "fd",           "%d", fd,
+                NULL
+            );
+            return -1;
+        }
+        for(unsigned i=fixed->fd2slot_size; i<new_size; i++) {
+            fd2slot[i] = -1;
+        }
+        fixed->fd2slot = fd2slot;
+        fixed->fd2slot_size = new_size;
+    }
+    fixed->fd2slot[fd] = slot;
+    return 0;
+}
+
+/***************************************************************************
+ *  Empty the slot (the table's reference to the file is dropped),
+ *  the slots of the kernel allocation are free again for it.
+ ***************************************************************************/
+PRIVATE void release_slot(yev_loop_t *yev_loop, yev_fixed_files_t *fixed, int slot)
+{
+    int none = -1;
+    io_uring_register_files_update(&yev_loop->ring, (unsigned)slot, &none, 1);
+
+    if((unsigned)slot < fixed->direct_start) {
+        fixed->free_slots[fixed->n_free++] = slot;
+    } else {
+        fixed->direct_used--;
+    }
+}
+
+/***************************************************************************
+ *  Accept direct: the kernel accepts in a free slot of the registered files table,
+ *  without io_uring_register_files_update() syscall per socket.
+ *  The upper half of the table is given to the kernel allocation on first use,
+ *  the lower half keeps for yev_register_fd() (its free slots of the upper half are dropped).
+ *  Without free slot the kernel closes the socket accepted (-ENFILE):
+ *  with `direct_low` free slots left the accepts are rearmed plain.
+ ***************************************************************************/
+PRIVATE BOOL accept_direct_available(yev_loop_t *yev_loop)
+{
+    if(!(yev_loop->caps & YEV_CAP_ACCEPT_DIRECT)) {
+        return FALSE;
+    }
+    yev_fixed_files_t *fixed = get_fixed_files(yev_loop);
+    if(!fixed) {
+        return FALSE;
+    }
+    if(fixed->accepting) {
+        return (fixed->size - fixed->direct_start - fixed->direct_used > fixed->direct_low)? TRUE : FALSE;
+    }
+
+    unsigned direct_start = fixed->size / 2;
+    yev_event_t **accepting = GBMEM_MALLOC(fixed->size * sizeof(yev_event_t *));
+    if(!accepting || direct_start == 0) {
+        GBMEM_FREE(accepting)
+        yev_loop->caps &= ~YEV_CAP_ACCEPT_DIRECT;
+        return FALSE;
+    }
+    memset(accepting, 0, fixed->size * sizeof(yev_event_t *));
+
+    int ret = io_uring_register_file_alloc_range(
+        &yev_loop->ring, direct_start, fixed->size - direct_start
+    );
+    if(ret < 0) {
+        gobj_log_warning(yev_loop->yuno, 0,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_YEV_LOOP,
+            "msg",          "%s", "io_uring_register_file_alloc_range() FAILED, using plain accept",
+            "errno",        "%d", -ret,
+            "serrno",       "%s", strerror(-ret),
+            NULL
+        );
+        GBMEM_FREE(accepting)
+        yev_loop->caps &= ~YEV_CAP_ACCEPT_DIRECT;
+        return FALSE;
+    }
+
+    unsigned n = 0;
+    for(unsigned i=0; i<fixed->n_free; i++) {
+        if((unsigned)fixed->free_slots[i] < direct_start) {
+            fixed->free_slots[n++] = fixed->free_slots[i];
+        }
+    }
+    fixed->n_free = n;
+    fixed->direct_start = direct_start;
+    fixed->direct_low = (fixed->size - direct_start) / 8;
+    if(fixed->direct_low == 0) {
+        fixed->direct_low = 1;
+    }
+    fixed->accepting = accepting;
+    return (fixed->size - direct_start > fixed->direct_low)? TRUE : FALSE;
+}
+
+/***************************************************************************
+ *  Multishot accept armed direct with the free slots at the low mark,
+ *  or armed plain with free slots again (half of the kernel allocation):
+ *  cancel it, the cqe of the cancel rearms it (prep_accept() chooses)
+ ***************************************************************************/
+PRIVATE void accept_switch(yev_loop_t *yev_loop, yev_event_t *yev_event)
+{
+    if(yev_event->accept_switch || yev_event_cancelling(yev_event) ||
+            !(yev_loop->caps & YEV_CAP_ACCEPT_DIRECT)) {
+        return;
+    }
+    yev_fixed_files_t *fixed = yev_loop->fixed;
+    if(!fixed || !fixed->accepting) {
+        return;
+    }
+    unsigned direct_size = fixed->size - fixed->direct_start;
+    unsigned direct_free = direct_size - fixed->direct_used;
+    if(yev_event->accept_direct) {
+        if(direct_free > fixed->direct_low) {
+            return;
+        }
+    } else {
+        if(direct_free <= fixed->direct_low || direct_free < direct_size / 2) {
+            return;
+        }
+    }
+
+    struct io_uring_sqe *sqe = yev_get_sqe(yev_loop);
+    if(!sqe) {
+        // Error already logged
+        return;
+    }
+    io_uring_prep_cancel(sqe, yev_event, 0);
+    io_uring_sqe_set_data64(sqe, YEV_UDATA_CANCEL);
+    yev_submit(yev_loop);
+    yev_event->accept_switch = TRUE;
+    yev_loop->stats.accepts_switched++;
+}
+
+/***************************************************************************
+ *  Prepare the accept sqe: direct in a fixed slot, multishot or single
+ ***************************************************************************/
+PRIVATE void prep_accept(yev_loop_t *yev_loop, struct io_uring_sqe *sqe, yev_event_t *yev_event)
+{
+    yev_event->accept_direct = FALSE;
+    yev_event->accept_switch = FALSE;
+    if(accept_direct_available(yev_loop)) {
+        io_uring_prep_multishot_accept_direct(
+            sqe,
+            yev_event->fd,
+            NULL,
+            NULL,
+            0
+        );
+        yev_event->accept_direct = TRUE;
+
+    } else if(yev_loop->caps & YEV_CAP_ACCEPT_MULTISHOT) {
+        io_uring_prep_multishot_accept(
+            sqe,
+            yev_event->fd,
+            NULL,
+            NULL,
+            0
+        );
+
+    } else {
+        yev_event->src_addrlen = sizeof(yev_event->src_storage);
+        io_uring_prep_accept(
+            sqe,
+            yev_event->fd,
+            yev_event->src_addr,
+            &yev_event->src_addrlen,
+            0
+        );
+    }
+    sqe_set_fixed_file(yev_loop, sqe, yev_event->fd);
+}
+
+/***************************************************************************
+ *  Socket accepted in the slot: get a fd of it (IORING_OP_FIXED_FD_INSTALL),
+ *  the transports need the fd (socket options, peer name, ktls, close).
+ ***************************************************************************/
+PRIVATE void accept_fd_install(yev_loop_t *yev_loop, yev_event_t *yev_event, int slot)
+{
+    yev_fixed_files_t *fixed = yev_loop->fixed;
+
+    struct io_uring_sqe *sqe = yev_get_sqe(yev_loop);
+    if(!sqe) {
+        // Error already logged
+        release_slot(yev_loop, fixed, slot);
+        return;
+    }
+    fixed->in_use++;
+    io_uring_prep_rw(YEV_IORING_OP_FIXED_FD_INSTALL, sqe, slot, NULL, 0, 0);
+    sqe->flags |= IOSQE_FIXED_FILE;
+    io_uring_sqe_set_data64(sqe, YEV_UDATA_FD_INSTALL | (uint32_t)slot);
+    fixed->accepting[slot] = yev_event;
+    yev_submit(yev_loop);
+}
+
+/***************************************************************************
+ *  The fd of the socket accepted in the slot, to the callback of its accept event
+ ***************************************************************************/
+PRIVATE void accept_fd_installed(yev_loop_t *yev_loop, int slot, int fd)
+{
+    yev_fixed_files_t *fixed = yev_loop->fixed;
+    if(!fixed || (unsigned)slot >= fixed->size) {
+        if(fd >= 0) {
+            close(fd);
+        }
+        return;
+    }
+    yev_event_t *yev_event = fixed->accepting[slot];
+    fixed->accepting[slot] = NULL;
+
+    if(fd < 0 || !yev_event || fd2slot_set(yev_loop, fixed, fd, slot) < 0) {
+        if(fd < 0) {
+            gobj_log_error(yev_loop->yuno, 0,
+                "function",     "%s", __FUNCTION__,
+                "msgset",       "%s", MSGSET_LIBUV_ERROR,
+                "msg",          "%s", "fd install of socket accepted FAILED",
+                "slot",         "%d", slot,
+                "errno",        "%d", -fd,
+                "serrno",       "%s", strerror(-fd),
+                NULL
+            );
+        }
+        release_slot(yev_loop, fixed, slot);     // The socket is closed with its last reference
+        fixed->in_use--;
+        if(fd >= 0) {
+            close(fd);
+        }
+        return;
+    }
+
+    if(is_tcp_socket(fd)) {
+        set_tcp_socket_options(fd);
+    }
+    yev_event->result = fd;     // cli_srv socket, registered
+    if(yev_event->callback) {
+        yev_event->callback(
+            yev_event
+        );
+    }
+}
+
+/***************************************************************************
+ *  Unregister and close the fd
+ ***************************************************************************/
+PUBLIC int yev_close_fd(yev_loop_t *yev_loop, int fd)
+{
+    if(fd < 0) {
+        return -1;
+    }
+
+    if((unsigned)fd < yev_loop->fd_ops_size && yev_loop->fd_ops[fd]) {
+        /*
+         *  Operations of the fd in the kernel: they keep the file open.
+         *  The cancel by fd must find the fd (a closed fd fails with -EBADF),
+         *  the fd is closed when the last operation returns.
+         */
+        yev_cancel_fd(yev_loop, fd, NULL, NULL);
+        yev_loop->fd_close_pending[fd] = 1;
+        yev_loop->stats.closes_deferred++;
+        return 0;
+    }
+    yev_unregister_fd(yev_loop, fd);
+    return close(fd);
+}
+
+/***************************************************************************
+ *  Hints of getaddrinfo() by the schema of the url
+ ***************************************************************************/
+PRIVATE void set_hints_by_schema(
+    yev_event_t *yev_event,
+    const char *url,
+    const char *schema,
+    struct addrinfo *hints
+) {
+    memset(hints, 0, sizeof(*hints));
+    hints->ai_family = AF_UNSPEC;  /* Allow IPv4 or IPv6 */
+    hints->ai_flags = AI_V4MAPPED | AI_ADDRCONFIG;
+
+    SWITCHS(schema) {
+        ICASES("tcps")
+        ICASES("tcp")
+        ICASES("tcphs")
+        ICASES("tcph")
+        ICASES("http")
+        ICASES("https")
+        ICASES("wss")
+        ICASES("ws")
+            hints->ai_socktype = SOCK_STREAM; /* TCP socket */
+            hints->ai_protocol = IPPROTO_TCP;
+            yev_event->flag |= YEV_FLAG_IS_TCP;
+            break;
+
+        ICASES("udps")
+        ICASES("udp")
+            hints->ai_socktype = SOCK_DGRAM; /* UDP socket */
+            hints->ai_protocol = IPPROTO_UDP;
+            yev_event->flag &= ~YEV_FLAG_IS_TCP;
+            break;
+
+        DEFAULTS
+            gobj_log_warning(yev_event->gobj, LOG_OPT_TRACE_STACK,
+                "function",     "%s", __FUNCTION__,
+                "msgset",       "%s", MSGSET_LIBUV_ERROR,
+                "msg",          "%s", "schema NOT supported, using tcp",
+                "url",          "%s", url,
+                "schema",       "%s", schema,
+                NULL
+            );
+            hints->ai_socktype = SOCK_STREAM; /* TCP socket */
+            hints->ai_protocol = IPPROTO_TCP;
+            break;
+    } SWITCHS_END;
+}
+
+/***************************************************************************
+ *  Create the resolver: the cache, the thread is started on first async request
+ ***************************************************************************/
+PRIVATE yev_resolver_t *get_resolver(yev_loop_t *yev_loop)
+{
+    if(yev_loop->resolver) {
+        return yev_loop->resolver;
+    }
+
+    yev_resolver_t *resolver = GBMEM_MALLOC(sizeof(yev_resolver_t));
+    if(!resolver) {
+        gobj_log_error(yev_loop->yuno, LOG_OPT_TRACE_STACK,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_MEMORY_ERROR,
+            "msg",          "%s", "No memory to resolver",
+            NULL
+        );
+        return NULL;
+    }
+    pthread_mutex_init(&resolver->mutex, NULL);
+    pthread_cond_init(&resolver->cond, NULL);
+    resolver->todo_tail = &resolver->todo;
+    resolver->efd = -1;
+
+    yev_loop->resolver = resolver;
+    return resolver;
+}
+
+/***************************************************************************
+ *  Stop the thread (it can be blocked in a getaddrinfo() until its timeout)
+ *  and free the cache and the requests
+ ***************************************************************************/
+PRIVATE void resolver_destroy(yev_loop_t *yev_loop)
+{
+    yev_resolver_t *resolver = yev_loop->resolver;
+    if(!resolver) {
+        return;
+    }
+
+    if(resolver->thread_running) {
+        pthread_mutex_lock(&resolver->mutex);
+        resolver->quit = TRUE;
+        pthread_cond_signal(&resolver->cond);
+        pthread_mutex_unlock(&resolver->mutex);
+        pthread_join(resolver->thread, NULL);
+        resolver->thread_running = FALSE;
+    }
+
+    dns_request_t *request = resolver->pending;
+    while(request) {
+        dns_request_t *next = request->next;
+        yev_dns_waiter_t *waiter = request->waiters;
+        while(waiter) {
+            yev_dns_waiter_t *next_waiter = waiter->next;
+            if(waiter->yev_event) {
+                waiter->yev_event->dns_waiter = NULL;
+                yev_set_flag(waiter->yev_event, YEV_FLAG_IN_RING, FALSE);
+            }
+            GBMEM_FREE(waiter->dst_url)
+            GBMEM_FREE(waiter->src_url)
+            GBMEM_FREE(waiter)
+            waiter = next_waiter;
+        }
+        if(request->results) {
+            freeaddrinfo(request->results);
+        }
+        GBMEM_FREE(request)
+        request = next;
+    }
+
+    EXEC_AND_RESET(yev_destroy_event, resolver->yev_efd)
+    if(resolver->efd >= 0) {
+        close(resolver->efd);
+    }
+
+    for(int i=0; i<YEV_DNS_CACHE_SIZE; i++) {
+        if(resolver->cache[i]) {
+            GBMEM_FREE(resolver->cache[i]->results)
+            GBMEM_FREE(resolver->cache[i])
+        }
+    }
+
+    pthread_mutex_destroy(&resolver->mutex);
+    pthread_cond_destroy(&resolver->cond);
+    GBMEM_FREE(resolver)
+    yev_loop->resolver = NULL;
+}
+
+/***************************************************************************
+ *  Return the entry of the cache not expired, NULL if not found
+ ***************************************************************************/
+PRIVATE dns_entry_t *dns_cache_find(
+    yev_loop_t *yev_loop,
+    const char *host,
+    const char *port,
+    const struct addrinfo *hints
+) {
+    yev_resolver_t *resolver = yev_loop->resolver;
+    if(!resolver || !yev_loop->dns_cache_ttl) {
+        return NULL;
+    }
+
+    uint64_t now = yev_now_msec();
+    for(int i=0; i<YEV_DNS_CACHE_SIZE; i++) {
+        dns_entry_t *entry = resolver->cache[i];
+        if(entry && entry->expires > now &&
+                entry->socktype == hints->ai_socktype &&
+                entry->protocol == hints->ai_protocol &&
+                strcmp(entry->host, host)==0 &&
+                strcmp(entry->port, port)==0) {
+            yev_loop->stats.dns_cache_hits++;
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+/***************************************************************************
+ *  Save a copy of the addrinfo chain in the cache, replacing the same name,
+ *  or a free entry, or the entry closest to expire.
+ *  The entry lives until the next save, even with the cache disabled.
+ ***************************************************************************/
+PRIVATE dns_entry_t *dns_cache_save(
+    yev_loop_t *yev_loop,
+    const char *host,
+    const char *port,
+    const struct addrinfo *hints,
+    const struct addrinfo *results
+) {
+    yev_resolver_t *resolver = get_resolver(yev_loop);
+    if(!resolver) {
+        // Error already logged
+        return NULL;
+    }
+
+    /*
+     *  Copy the chain in one block, without canonical names
+     */
+    size_t n = 0;
+    size_t size = 0;
+    for(const struct addrinfo *ai = results; ai; ai = ai->ai_next) {
+        n++;
+        size += sizeof(struct addrinfo) + ai->ai_addrlen;
+    }
+    if(n == 0) {
+        return NULL;
+    }
+    struct addrinfo *chain = GBMEM_MALLOC(size);
+    if(!chain) {
+        gobj_log_error(yev_loop->yuno, LOG_OPT_TRACE_STACK,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_MEMORY_ERROR,
+            "msg",          "%s", "No memory to addrinfo",
+            "host",         "%s", host,
+            NULL
+        );
+        return NULL;
+    }
+    char *p = (char *)(chain + n);
+    size_t i = 0;
+    for(const struct addrinfo *ai = results; ai; ai = ai->ai_next, i++) {
+        chain[i] = *ai;
+        chain[i].ai_canonname = NULL;
+        chain[i].ai_addr = (struct sockaddr *)p;
+        memcpy(p, ai->ai_addr, ai->ai_addrlen);
+        p += ai->ai_addrlen;
+        chain[i].ai_next = (i+1 < n)? &chain[i+1] : NULL;
+    }
+
+    /*
+     *  Choose the entry
+     */
+    int victim = -1;
+    for(int j=0; j<YEV_DNS_CACHE_SIZE; j++) {
+        dns_entry_t *entry = resolver->cache[j];
+        if(!entry) {
+            if(victim < 0 || resolver->cache[victim]) {
+                victim = j;
+            }
+            continue;
+        }
+        if(entry->socktype == hints->ai_socktype &&
+                entry->protocol == hints->ai_protocol &&
+                strcmp(entry->host, host)==0 &&
+                strcmp(entry->port, port)==0) {
+            victim = j;
+            break;
+        }
+        if(victim < 0 ||
+                (resolver->cache[victim] && entry->expires < resolver->cache[victim]->expires)) {
+            victim = j;
+        }
+    }
+
+    dns_entry_t *entry = resolver->cache[victim];
+    if(!entry) {
+        entry = GBMEM_MALLOC(sizeof(dns_entry_t));
+        if(!entry) {
+            gobj_log_error(yev_loop->yuno, LOG_OPT_TRACE_STACK,
+                "function",     "%s", __FUNCTION__,
+                "msgset",       "%s", MSGSET_MEMORY_ERROR,
+                "msg",          "%s", "No memory to dns entry",
+                "host",         "%s", host,
+                NULL
+            );
+            GBMEM_FREE(chain)
+            return NULL;
+        }
+        resolver->cache[victim] = entry;
+    }
+    GBMEM_FREE(entry->results)
+    snprintf(entry->host, sizeof(entry->host), "%s", host);
+    snprintf(entry->port, sizeof(entry->port), "%s", port);
+    entry->socktype = hints->ai_socktype;
+    entry->protocol = hints->ai_protocol;
+    entry->results = chain;
+    entry->expires = yev_now_msec() + yev_loop->dns_cache_ttl;
+
+    return entry;
+}
+
+/***************************************************************************
+ *  Resolve a name in the loop thread, from the cache if possible.
+ *  Return the addrinfo chain of the cache, don't free it,
+ *  it's valid until the next name resolved.
+ ***************************************************************************/
+PRIVATE struct addrinfo *dns_resolve(
+    hgobj gobj,
+    yev_loop_t *yev_loop,
+    const char *url,
+    const char *host,
+    const char *port,
+    const struct addrinfo *hints
+) {
+    dns_entry_t *entry = dns_cache_find(yev_loop, host, port, hints);
+    if(entry) {
+        return entry->results;
+    }
+
+    struct addrinfo *results;
+    uint64_t t0 = yev_now_nsec();
+    int ret = getaddrinfo(
+        host,
+        port,
+        hints,
+        &results
+    );
+    yev_loop->stats.dns_block_ns += yev_now_nsec() - t0;
+    yev_loop->stats.dns_resolves++;
+    if(ret != 0) {
+        gobj_log_error(gobj, LOG_OPT_TRACE_STACK,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_LIBUV_ERROR,
+            "msg",          "%s", "getaddrinfo() FAILED",
+            "url",          "%s", url,
+            "host",         "%s", host,
+            "port",         "%s", port,
+            "error",        "%s", gai_strerror(ret),
+            NULL
+        );
+        return NULL;
+    }
+
+    entry = dns_cache_save(yev_loop, host, port, hints, results);
+    freeaddrinfo(results);
+    if(!entry) {
+        // Error already logged
+        return NULL;
+    }
+    return entry->results;
+}
+
+/***************************************************************************
+ *  Resolver thread, it doesn't use gbmem nor the loop
+ ***************************************************************************/
+PRIVATE void *resolver_thread(void *arg)
+{
+    yev_resolver_t *resolver = arg;
+
+    pthread_mutex_lock(&resolver->mutex);
+    while(!resolver->quit) {
+        dns_request_t *request = resolver->todo;
+        if(!request) {
+            pthread_cond_wait(&resolver->cond, &resolver->mutex);
+            continue;
+        }
+        resolver->todo = request->qnext;
+        if(!resolver->todo) {
+            resolver->todo_tail = &resolver->todo;
+        }
+        pthread_mutex_unlock(&resolver->mutex);
+
+        request->gai_err = getaddrinfo(
+            request->host,
+            request->port,
+            &request->hints,
+            &request->results
+        );
+
+        pthread_mutex_lock(&resolver->mutex);
+        request->qnext = resolver->done;
+        resolver->done = request;
+
+        uint64_t one = 1;
+        if(write(resolver->efd, &one, sizeof(one)) < 0) {
+            // The eventfd counter cannot overflow with so few writes
+        }
+    }
+    pthread_mutex_unlock(&resolver->mutex);
+
+    return NULL;
+}
+
+/***************************************************************************
+ *  Requests done by the thread: save the addresses and start the connects waiting
+ ***************************************************************************/
+PRIVATE void dns_process_done(yev_loop_t *yev_loop)
+{
+    yev_resolver_t *resolver = yev_loop->resolver;
+
+    pthread_mutex_lock(&resolver->mutex);
+    dns_request_t *done = resolver->done;
+    resolver->done = NULL;
+    pthread_mutex_unlock(&resolver->mutex);
+
+    while(done) {
+        dns_request_t *request = done;
+        done = request->qnext;
+
+        dns_request_t **pp = &resolver->pending;
+        while(*pp && *pp != request) {
+            pp = &(*pp)->next;
+        }
+        if(*pp) {
+            *pp = request->next;
+        }
+
+        uint64_t wait_ns = yev_now_nsec() - request->t0;
+        yev_loop->stats.dns_async_resolves++;
+        yev_loop->stats.dns_wait_ns += wait_ns;
+        if(wait_ns > yev_loop->stats.dns_max_wait_ns) {
+            yev_loop->stats.dns_max_wait_ns = wait_ns;
+        }
+
+        if(request->gai_err == 0) {
+            dns_cache_save(yev_loop, request->host, request->port, &request->hints, request->results);
+            freeaddrinfo(request->results);
+            request->results = NULL;
+        } else {
+            gobj_log_error(yev_loop->yuno, 0,
+                "function",     "%s", __FUNCTION__,
+                "msgset",       "%s", MSGSET_LIBUV_ERROR,
+                "msg",          "%s", "getaddrinfo() FAILED",
+                "host",         "%s", request->host,
+                "port",         "%s", request->port,
+                "error",        "%s", gai_strerror(request->gai_err),
+                NULL
+            );
+        }
+
+        /*
+         *  The names in cache now, the setup doesn't block.
+         *  The callbacks can stop the other events waiting.
+         */
+        yev_dns_waiter_t *waiter = request->waiters;
+        while(waiter) {
+            yev_dns_waiter_t *next_waiter = waiter->next;
+            yev_event_t *yev_event = waiter->yev_event;
+            if(yev_event) {
+                yev_event->dns_waiter = NULL;
+                yev_set_flag(yev_event, YEV_FLAG_IN_RING, FALSE);
+                if(request->gai_err != 0 ||
+                        yev_setup_connect_event(yev_event, waiter->dst_url, waiter->src_url) < 0 ||
+                        yev_start_event(yev_event) < 0) {
+                    yev_event->result = -EHOSTUNREACH;
+                    if(yev_event->callback) {
+                        yev_event->callback(
+                            yev_event
+                        );
+                    }
+                }
+            }
+            GBMEM_FREE(waiter->dst_url)
+            GBMEM_FREE(waiter->src_url)
+            GBMEM_FREE(waiter)
+            waiter = next_waiter;
+        }
+
+        GBMEM_FREE(request)
+    }
+}
+
+/***************************************************************************
+ *  The resolver thread has posted requests done
+ ***************************************************************************/
+PRIVATE int yev_resolver_callback(yev_event_t *yev_event)
+{
+    yev_loop_t *yev_loop = yev_event->yev_loop;
+
+    if(yev_event->result < 0) {
+        // Loop stopping, it's started again with the next request
+        return 0;
+    }
+
+    gbuffer_clear(yev_event->gbuf);
+    dns_process_done(yev_loop);
+
+    if(!yev_loop->stopping && !yev_event_in_ring(yev_event)) {
+        yev_start_event(yev_event);
+    }
+    return 0;
+}
+
+/***************************************************************************
+ *  Start the thread and the read of its eventfd
+ ***************************************************************************/
+PRIVATE int resolver_start(yev_loop_t *yev_loop)
+{
+    yev_resolver_t *resolver = yev_loop->resolver;
+
+    if(!resolver->yev_efd) {
+        resolver->efd = eventfd(0, EFD_CLOEXEC);
+        if(resolver->efd < 0) {
+            gobj_log_error(yev_loop->yuno, LOG_OPT_TRACE_STACK,
+                "function",     "%s", __FUNCTION__,
+                "msgset",       "%s", MSGSET_SYSTEM_ERROR,
+                "msg",          "%s", "eventfd() FAILED",
+                "errno",        "%d", errno,
+                "strerror",     "%s", strerror(errno),
+                NULL
+            );
+            return -1;
+        }
+        resolver->yev_efd = yev_create_read_event(
+            yev_loop,
+            yev_resolver_callback,
+            yev_loop->yuno,
+            resolver->efd,
+            gbuffer_create(sizeof(uint64_t), sizeof(uint64_t))
+        );
+        if(!resolver->yev_efd) {
+            // Error already logged
+            close(resolver->efd);
+            resolver->efd = -1;
+            return -1;
+        }
+    }
+
+    if(!resolver->thread_running) {
+        /*
+         *  The signals are for the loop thread
+         */
+        sigset_t all, old;
+        sigfillset(&all);
+        pthread_sigmask(SIG_SETMASK, &all, &old);
+        int ret = pthread_create(&resolver->thread, NULL, resolver_thread, resolver);
+        pthread_sigmask(SIG_SETMASK, &old, NULL);
+        if(ret != 0) {
+            gobj_log_error(yev_loop->yuno, LOG_OPT_TRACE_STACK,
+                "function",     "%s", __FUNCTION__,
+                "msgset",       "%s", MSGSET_SYSTEM_ERROR,
+                "msg",          "%s", "pthread_create() FAILED",
+                "errno",        "%d", ret,
+                "strerror",     "%s", strerror(ret),
+                NULL
+            );
+            return -1;
+        }
+        resolver->thread_running = TRUE;
+    }
+
+    if(!yev_event_in_ring(resolver->yev_efd)) {
+        if(yev_start_event(resolver->yev_efd) < 0) {
+            // Error already logged
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/***************************************************************************
+ *  Wait the resolution of the name in the resolver thread,
+ *  the connects to the same name wait the same request.
+ ***************************************************************************/
+PRIVATE int dns_resolve_async(
+    yev_event_t *yev_event,
+    const char *dst_url,
+    const char *src_url,
+    const char *host,
+    const char *port,
+    const struct addrinfo *hints
+) {
+    yev_loop_t *yev_loop = yev_event->yev_loop;
+    yev_resolver_t *resolver = get_resolver(yev_loop);
+    if(!resolver) {
+        // Error already logged
+        return -1;
+    }
+    if(resolver_start(yev_loop) < 0) {
+        // Error already logged
+        return -1;
+    }
+
+    dns_request_t *request = resolver->pending;
+    while(request) {
+        if(request->hints.ai_socktype == hints->ai_socktype &&
+                request->hints.ai_protocol == hints->ai_protocol &&
+                strcmp(request->host, host)==0 &&
+                strcmp(request->port, port)==0) {
+            break;
+        }
+        request = request->next;
+    }
+
+    yev_dns_waiter_t *waiter = GBMEM_MALLOC(sizeof(yev_dns_waiter_t));
+    if(!waiter) {
+        gobj_log_error(yev_event->gobj, LOG_OPT_TRACE_STACK,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_MEMORY_ERROR,
+            "msg",          "%s", "No memory to dns waiter",
+            "url",          "%s", dst_url,
+            NULL
+        );
+        return -1;
+    }
+    waiter->dst_url = GBMEM_STRDUP(dst_url);
+    waiter->src_url = empty_string(src_url)? NULL : GBMEM_STRDUP(src_url);
+
+    if(!request) {
+        request = GBMEM_MALLOC(sizeof(dns_request_t));
+        if(!request) {
+            gobj_log_error(yev_event->gobj, LOG_OPT_TRACE_STACK,
+                "function",     "%s", __FUNCTION__,
+                "msgset",       "%s", MSGSET_MEMORY_ERROR,
+                "msg",          "%s", "No memory to dns request",
+                "url",          "%s", dst_url,
+                NULL
+            );
+            GBMEM_FREE(waiter->dst_url)
+            GBMEM_FREE(waiter->src_url)
+            GBMEM_FREE(waiter)
+            return -1;
+        }
+        snprintf(request->host, sizeof(request->host), "%s", host);
+        snprintf(request->port, sizeof(request->port), "%s", port);
+        request->hints = *hints;
+        request->t0 = yev_now_nsec();
+        request->next = resolver->pending;
+        resolver->pending = request;
+
+        pthread_mutex_lock(&resolver->mutex);
+        *resolver->todo_tail = request;
+        resolver->todo_tail = &request->qnext;
+        pthread_cond_signal(&resolver->cond);
+        pthread_mutex_unlock(&resolver->mutex);
+    }
+
+    waiter->yev_event = yev_event;
+    waiter->next = request->waiters;
+    request->waiters = waiter;
+    yev_event->dns_waiter = waiter;
+    yev_set_flag(yev_event, YEV_FLAG_IN_RING, TRUE);
+
+    if(gobj_trace_level(yev_event->gobj) & TRACE_UV) {
+        gobj_log_info(yev_event->gobj, 0,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_YEV_LOOP,
+            "msg",          "%s", "waiting resolver",
+            "msg2",         "%s", "💥🟦⏳ waiting resolver",
+            "url",          "%s", dst_url,
+            "p",            "%p", yev_event,
+            NULL
+        );
+    }
+
+    return 0;
+}
+
+/***************************************************************************
+ *  Cancel the connects waiting the resolver
+ ***************************************************************************/
+PRIVATE void dns_cancel_all(yev_loop_t *yev_loop)
+{
+    yev_resolver_t *resolver = yev_loop->resolver;
+    if(!resolver) {
+        return;
+    }
+
+    for(dns_request_t *request = resolver->pending; request; request = request->next) {
+        for(yev_dns_waiter_t *waiter = request->waiters; waiter; waiter = waiter->next) {
+            if(waiter->yev_event) {
+                yev_stop_event(waiter->yev_event);  // it resets waiter->yev_event
+            }
+        }
+    }
+}
+
+/***************************************************************************
+ *  Monotonic time in miliseconds, the clock of the timer wheel
+ ***************************************************************************/
+PRIVATE uint64_t yev_now_msec(void)
+{
+    struct timespec spec;
+    clock_gettime(CLOCK_MONOTONIC, &spec);
+    return ((uint64_t)spec.tv_sec)*1000 + ((uint64_t)spec.tv_nsec)/1000000;
+}
+
+/***************************************************************************
+ *  Monotonic time in nanoseconds, the clock of the loop stats
+ ***************************************************************************/
+PRIVATE uint64_t yev_now_nsec(void)
+{
+    struct timespec spec;
+    clock_gettime(CLOCK_MONOTONIC, &spec);
+    return ((uint64_t)spec.tv_sec)*1000000000 + (uint64_t)spec.tv_nsec;
+}
+
+/***************************************************************************
+ *  Put the timer in the slot of his expiration, O(1)
+ ***************************************************************************/
+PRIVATE void timer_wheel_add(yev_timer_wheel_t *tw, yev_event_t *yev_event, uint64_t expires)
+{
+    yev_event_t **slot;
+
+    yev_event->tw_expires = expires;
+
+    if(expires < tw->jiffies) {
+        expires = tw->jiffies;  // Late, expire in the next tick
+    }
+    uint64_t delta = expires - tw->jiffies;
+    if(delta < TW_ROOT_SIZE) {
+        slot = &tw->root[expires & TW_ROOT_MASK];
+    } else {
+        if(delta > TW_MAX_DELTA) {
+            // Too far, it will be re-inserted in the cascade
+            expires = tw->jiffies + TW_MAX_DELTA;
+            delta = TW_MAX_DELTA;
+        }
+        int level = 0;
+        while(level < TW_LEVELS-1 &&
+                delta >= (1ULL << (TW_ROOT_BITS + (level+1)*TW_LEVEL_BITS))) {
+            level++;
+        }
+        int shift = TW_ROOT_BITS + level*TW_LEVEL_BITS;
+        slot = &tw->levels[level][(expires >> shift) & TW_LEVEL_MASK];
+    }
+
+    yev_event->tw_next = *slot;
+    if(*slot) {
+        (*slot)->tw_pprev = &yev_event->tw_next;
+    }
+    *slot = yev_event;
+    yev_event->tw_pprev = slot;
+    tw->n_timers++;
+
+    if(!tw->next_dirty && expires < tw->next_expiry) {
+        tw->next_expiry = expires;
+    }
+    if(tw->n_timers == 1) {
+        tw->next_expiry = expires;
+        tw->next_dirty = FALSE;
+    }
+}
+
+/***************************************************************************
+ *  Remove the timer from his slot, O(1)
+ ***************************************************************************/
+PRIVATE void timer_wheel_del(yev_timer_wheel_t *tw, yev_event_t *yev_event)
+{
+    if(!yev_event->tw_pprev) {
+        return;
+    }
+    *yev_event->tw_pprev = yev_event->tw_next;
+    if(yev_event->tw_next) {
+        yev_event->tw_next->tw_pprev = yev_event->tw_pprev;
+    }
+    yev_event->tw_next = NULL;
+    yev_event->tw_pprev = NULL;
+    tw->n_timers--;
+    tw->next_dirty = TRUE;
+}
+
+/***************************************************************************
+ *  Move the timers of an upper slot to the lower levels
+ *  Return the slot index, if 0 the next level must be cascaded too
+ ***************************************************************************/
+PRIVATE unsigned timer_wheel_cascade(yev_timer_wheel_t *tw, int level)
+{
+    int shift = TW_ROOT_BITS + level*TW_LEVEL_BITS;
+    unsigned idx = (unsigned)(tw->jiffies >> shift) & TW_LEVEL_MASK;
+
+    yev_event_t *yev_event = tw->levels[level][idx];
+    tw->levels[level][idx] = NULL;
+    while(yev_event) {
+        yev_event_t *next = yev_event->tw_next;
+        tw->n_timers--;
+        timer_wheel_add(tw, yev_event, yev_event->tw_expires);
+        yev_event = next;
+    }
+    return idx;
+}
+
+/***************************************************************************
+ *  Expire the timers until now, calling their callbacks.
+ *  The periodic timers are re-armed if the callback return 0.
+ ***************************************************************************/
+PRIVATE void timer_wheel_run(yev_loop_t *yev_loop)
+{
+    yev_timer_wheel_t *tw = yev_loop->timer_wheel;
+    uint64_t now = yev_now_msec();
 
-    if(ret == -1) {
-        return ret;
+    if(tw->n_timers == 0) {
+        tw->jiffies = now + 1;
+        return;
+    }
+    if(now < tw->next_expiry && !tw->next_dirty) {
+        return;
     }
 
-    yev_event->fd = fd;
+    while(tw->jiffies <= now && tw->n_timers > 0) {
+        unsigned idx = (unsigned)(tw->jiffies & TW_ROOT_MASK);
+        if(idx == 0) {
+            for(int level=0; level<TW_LEVELS; level++) {
+                if(timer_wheel_cascade(tw, level) != 0) {
+                    break;
+                }
+            }
+        }
 
-    if(gobj_trace_level(gobj) & TRACE_UV) {
-        do {
-            json_t *jn_flags = bits2jn_strlist(yev_flag_s, yev_event->flag);
-            gobj_log_info(gobj, 0,
-                "function",     "%s", __FUNCTION__,
-                "msgset",       "%s", MSGSET_YEV_LOOP,
-                "msg",          "%s", "yev_setup_accept_event",
-                "msg2",         "%s", "💥🟦🟦 yev_setup_accept_event",
-                "type",         "%s", yev_event_type_name(yev_event),
-                "fd",           "%d", fd,
-                "p",            "%p", yev_event,
-                "flag",         "%j", jn_flags,
-                NULL
-            );
-            json_decref(jn_flags);
-        } while(0);
-    }
+        yev_event_t *yev_event;
+        while((yev_event = tw->root[idx])) {
+            timer_wheel_del(tw, yev_event);
+            yev_set_flag(yev_event, YEV_FLAG_IN_RING, FALSE);
+            yev_loop->stats.timers_fired++;
+
+            /*
+             *  Call callback
+             */
+            hgobj gobj = yev_event->gobj;
+            gclass_name_t gclass_name = gobj? gobj_gclass_name(gobj) : NULL;
+            yev_event->result = 1;  // nº of expirations
+            int ret = 0;
+            if(yev_event->callback) {
+                uint64_t t0 = yev_now_nsec();
+                ret = yev_event->callback(
+                    yev_event
+                );
+                stats_callback(yev_loop, YEV_TIMER_TYPE, gclass_name, yev_now_nsec() - t0);
+            }
 
-    return fd;
+            if(ret == 0 && yev_loop->running && (yev_event->flag & YEV_FLAG_TIMER_PERIODIC) &&
+                    !yev_event_in_ring(yev_event)) {
+                if(!gobj || (gobj && gobj_is_running(gobj))) {
+                    /*
+                     *  Rearm periodic timer event, without drift
+                     */
+                    uint64_t expires = yev_event->tw_expires + yev_event->tw_period;
+                    if(expires <= now) {
+                        expires = now + yev_event->tw_period;   // too late, skip the lost periods
+                    }
+                    timer_wheel_add(tw, yev_event, expires);
+                    yev_set_flag(yev_event, YEV_FLAG_IN_RING, TRUE);
+                }
+            }
+        }
+        tw->jiffies++;
+    }
+    if(tw->n_timers == 0) {
+        tw->jiffies = now + 1;
+    }
+    tw->next_dirty = TRUE;
 }
 
 /***************************************************************************
- *
- *********** ****************************************************************/
-PUBLIC yev_event_t *yev_create_read_event(
-    yev_loop_t *loop,
-    yev_callback_t callback,
-    hgobj gobj,
-    int fd,
-    gbuffer_t *gbuf
-) {
-    yev_event_t *yev_event = create_event(loop, callback, gobj, fd);
-    if(!yev_event) {
-        // Error already logged
+ *  Return the timeout until the nearest timer, NULL if there is no timer
+ ***************************************************************************/
+PRIVATE struct __kernel_timespec *timer_wheel_timeout(yev_loop_t *yev_loop, struct __kernel_timespec *ts)
+{
+    yev_timer_wheel_t *tw = yev_loop->timer_wheel;
+
+    if(tw->n_timers == 0) {
         return NULL;
     }
 
-    yev_event->type = YEV_READ_TYPE;
-    yev_event->gbuf = gbuf;
+    if(tw->next_dirty) {
+        /*
+         *  The root slots have the exact expiration,
+         *  of upper levels the tick of their cascade is enough.
+         */
+        uint64_t next = tw->jiffies + TW_MAX_DELTA;
+        for(unsigned i=0; i<TW_ROOT_SIZE; i++) {
+            if(tw->root[(tw->jiffies + i) & TW_ROOT_MASK]) {
+                next = tw->jiffies + i;
+                break;
+            }
+        }
+        for(int level=0; level<TW_LEVELS; level++) {
+            int shift = TW_ROOT_BITS + level*TW_LEVEL_BITS;
+            uint64_t pos = tw->jiffies >> shift;
+            for(unsigned k=0; k<=TW_LEVEL_SIZE; k++) {
+                uint64_t cascade = (pos + k) << shift;
+                if(cascade < tw->jiffies) {
+                    continue;   // Tick already past, the slot is cascaded
+                }
+                if(tw->levels[level][(pos + k) & TW_LEVEL_MASK]) {
+                    if(cascade < next) {
+                        next = cascade;
+                    }
+                    break;
+                }
+            }
+        }
+        tw->next_expiry = next;
+        tw->next_dirty = FALSE;
+    }
 
-    if(gobj_trace_level(gobj) & TRACE_UV) {
-        do {
-            json_t *jn_flags = bits2jn_strlist(yev_flag_s, yev_event->flag);
-            gobj_log_info(gobj, 0,
-                "function",     "%s", __FUNCTION__,
-                "msgset",       "%s", MSGSET_YEV_LOOP,
-                "msg",          "%s", "yev_create_read_event",
-                "msg2",         "%s", "💥🟦 yev_create_read_event",
-                "type",         "%s", yev_event_type_name(yev_event),
-                "fd",           "%d", fd,
-                "p",            "%p", yev_event,
-                "gbuffer",      "%p", gbuf,
-                "flag",         "%j", jn_flags,
-                NULL
-            );
-            json_decref(jn_flags);
-        } while(0);
+    uint64_t now = yev_now_msec();
+    uint64_t wait_ms = tw->next_expiry > now? tw->next_expiry - now : 0;
+    ts->tv_sec = (long long)(wait_ms / 1000);
+    ts->tv_nsec = (long long)((wait_ms % 1000) * 1000000);
+    return ts;
+}
+
+/***************************************************************************
+ *  Remove all timers informing with -ECANCELED
+ ***************************************************************************/
+PRIVATE void timer_wheel_cancel_all(yev_loop_t *yev_loop)
+{
+    yev_timer_wheel_t *tw = yev_loop->timer_wheel;
+    yev_event_t **slots[1 + TW_LEVELS];
+
+    slots[0] = tw->root;
+    for(int level=0; level<TW_LEVELS; level++) {
+        slots[level+1] = tw->levels[level];
     }
 
-    return yev_event;
+    for(int l=0; l<1 + TW_LEVELS && tw->n_timers > 0; l++) {
+        unsigned size = l==0? TW_ROOT_SIZE : TW_LEVEL_SIZE;
+        for(unsigned i=0; i<size && tw->n_timers > 0; i++) {
+            yev_event_t *yev_event;
+            while((yev_event = slots[l][i])) {
+                yev_stop_event(yev_event);
+            }
+        }
+    }
 }
 
 /***************************************************************************
  *
  ***************************************************************************/
-PUBLIC yev_event_t *yev_create_write_event(
-    yev_loop_t *loop,
-    yev_callback_t callback,
-    hgobj gobj,
-    int fd,
-    gbuffer_t *gbuf
-) {
-    yev_event_t *yev_event = create_event(loop, callback, gobj, fd);
-    if(!yev_event) {
-        // Error already logged
-        return NULL;
+PRIVATE int attach_reuseport_cpu_steering(hgobj gobj, int fd)
+{
+    /*
+     *  Classic BPF: return the cpu that received the packet,
+     *  the kernel uses it as index of the socket in the reuseport group
+     *  (hash if there is no socket with that index).
+     */
+    struct sock_filter code[] = {
+        { BPF_LD  | BPF_W | BPF_ABS, 0, 0, (uint32_t)(SKF_AD_OFF + SKF_AD_CPU) },
+        { BPF_RET | BPF_A, 0, 0, 0 },
+    };
+    struct sock_fprog prog = {
+        .len = ARRAY_SIZE(code),
+        .filter = code,
+    };
+
+    if(setsockopt(fd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog, sizeof(prog)) < 0) {
+        gobj_log_warning(gobj, 0,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_LIBUV_ERROR,
+            "msg",          "%s", "Cannot attach the cpu steering to the reuseport group",
+            "fd",           "%d", fd,
+            "errno",        "%d", errno,
+            "strerror",     "%s", strerror(errno),
+            NULL
+        );
+        return -1;
     }
+    return 0;
+}
 
-    yev_event->type = YEV_WRITE_TYPE;
-    yev_event->gbuf = gbuf;
+/***************************************************************************
+ *  Capabilities of the ring, from the opcodes supported (io_uring_get_probe_ring())
+ *  and the features of the setup, not from the kernel version:
+ *  backported or restricted kernels give the right answer.
+ *  The flags without own opcode or feature are deduced from one of the same release:
+ *      - multishot accept (5.19): IORING_OP_SOCKET (5.19)
+ *      - accept direct: multishot accept and IORING_OP_FIXED_FD_INSTALL (6.8), to get its fd
+ *      - multishot recv (6.0): IORING_OP_SEND_ZC (6.0), the buffer ring is checked on first use
+ *      - report usage of send zc (6.2): IORING_FEAT_REG_REG_RING (6.3), conservative
+ ***************************************************************************/
+PRIVATE uint32_t probe_capabilities(yev_loop_t *yev_loop, uint32_t features)
+{
+    struct io_uring_probe *probe = io_uring_get_probe_ring(&yev_loop->ring);
+    if(!probe) {
+        gobj_log_warning(yev_loop->yuno, 0,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_YEV_LOOP,
+            "msg",          "%s", "io_uring_get_probe_ring() FAILED, no optional capabilities",
+            NULL
+        );
+        return 0;
+    }
 
-    if(gobj_trace_level(gobj) & TRACE_UV) {
-        do {
-            json_t *jn_flags = bits2jn_strlist(yev_flag_s, yev_event->flag);
-            gobj_log_info(gobj, 0,
-                "function",     "%s", __FUNCTION__,
-                "msgset",       "%s", MSGSET_YEV_LOOP,
-                "msg",          "%s", "yev_create_write_event",
-                "msg2",         "%s", "💥🟦 yev_create_write_event",
-                "type",         "%s", yev_event_type_name(yev_event),
-                "fd",           "%d", fd,
-                "p",            "%p", yev_event,
-                "gbuffer",      "%p", gbuf,
-                "flag",         "%j", jn_flags,
-                NULL
-            );
-            json_decref(jn_flags);
-        } while(0);
+    uint32_t caps = 0;
+    if(io_uring_opcode_supported(probe, IORING_OP_MSG_RING)) {
+        caps |= YEV_CAP_MSG_RING;
+    }
+    if(io_uring_opcode_supported(probe, IORING_OP_ACCEPT) &&
+            io_uring_opcode_supported(probe, IORING_OP_SOCKET)) {
+        caps |= YEV_CAP_ACCEPT_MULTISHOT;
+        if(io_uring_opcode_supported(probe, YEV_IORING_OP_FIXED_FD_INSTALL)) {
+            caps |= YEV_CAP_ACCEPT_DIRECT;
+        }
+    }
+    if(io_uring_opcode_supported(probe, IORING_OP_SEND_ZC)) {
+        caps |= YEV_CAP_SEND_ZC;
+        if(features & IORING_FEAT_REG_REG_RING) {
+            caps |= YEV_CAP_SEND_ZC_REPORT_USAGE;
+        }
+        if(io_uring_opcode_supported(probe, IORING_OP_RECV) &&
+                io_uring_opcode_supported(probe, IORING_OP_RECVMSG)) {
+            caps |= YEV_CAP_RECV_MULTISHOT;
+        }
     }
+    io_uring_free_probe(probe);
 
-    return yev_event;
+    return caps;
 }
 
 /***************************************************************************
@@ -1764,7 +6415,15 @@ PRIVATE int print_addrinfo(hgobj gobj, char *bf, size_t bfsize, struct addrinfo
  ***************************************************************************/
 PUBLIC const char *yev_event_type_name(yev_event_t *yev_event)
 {
-    switch((yev_type_t)yev_event->type) {
+    return yev_type_name((yev_type_t)yev_event->type);
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PRIVATE const char *yev_type_name(yev_type_t type)
+{
+    switch(type) {
         case YEV_READ_TYPE:
             return "YEV_READ_TYPE";
         case YEV_WRITE_TYPE:
@@ -1775,10 +6434,214 @@ PUBLIC const char *yev_event_type_name(yev_event_t *yev_event)
             return "YEV_ACCEPT_TYPE";
         case YEV_TIMER_TYPE:
             return "YEV_TIMER_TYPE";
+        case YEV_RECV_MULTISHOT_TYPE:
+            return "YEV_RECV_MULTISHOT_TYPE";
+        case YEV_SEND_ZC_TYPE:
+            return "YEV_SEND_ZC_TYPE";
+        case YEV_WRITEV_TYPE:
+            return "YEV_WRITEV_TYPE";
+        case YEV_RECVMSG_TYPE:
+            return "YEV_RECVMSG_TYPE";
+        case YEV_RECVMSG_MULTISHOT_TYPE:
+            return "YEV_RECVMSG_MULTISHOT_TYPE";
+        case YEV_SENDMSG_TYPE:
+            return "YEV_SENDMSG_TYPE";
+        case YEV_MSG_TYPE:
+            return "YEV_MSG_TYPE";
+        case YEV_FILE_READ_TYPE:
+            return "YEV_FILE_READ_TYPE";
+        case YEV_FILE_WRITE_TYPE:
+            return "YEV_FILE_WRITE_TYPE";
+        case YEV_FSYNC_TYPE:
+            return "YEV_FSYNC_TYPE";
+        case YEV_POLL_TYPE:
+            return "YEV_POLL_TYPE";
+        case YEV_SPLICE_TYPE:
+            return "YEV_SPLICE_TYPE";
+        case YEV_CANCEL_TYPE:
+            return "YEV_CANCEL_TYPE";
     }
     return "???";
 }
 
+/***************************************************************************
+ *  Create the region of registered buffers
+ ***************************************************************************/
+PRIVATE yev_fixed_bufs_t *get_fixed_bufs(yev_loop_t *yev_loop)
+{
+    if(yev_loop->fixed_bufs || !yev_loop->fixed_buffers) {
+        return yev_loop->fixed_bufs;
+    }
+
+    yev_fixed_bufs_t *fixed_bufs = GBMEM_MALLOC(sizeof(yev_fixed_bufs_t));
+    if(fixed_bufs) {
+        fixed_bufs->free_bufs = GBMEM_MALLOC(yev_loop->fixed_buffers * sizeof(unsigned));
+    }
+    if(!fixed_bufs || !fixed_bufs->free_bufs) {
+        gobj_log_critical(yev_loop->yuno, 0,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_MEMORY_ERROR,
+            "msg",          "%s", "No memory to registered buffers",
+            NULL
+        );
+        if(fixed_bufs) {
+            GBMEM_FREE(fixed_bufs)
+        }
+        yev_loop->fixed_buffers = 0;
+        return NULL;
+    }
+    fixed_bufs->nbufs = yev_loop->fixed_buffers;
+    fixed_bufs->buf_size = yev_loop->fixed_buffer_size;
+    fixed_bufs->stride = (fixed_bufs->buf_size + 1 + 63) & ~63U; // room for final null of gbuffer
+    fixed_bufs->buffers_size = (size_t)fixed_bufs->nbufs * fixed_bufs->stride;
+
+    fixed_bufs->buffers = mmap(
+        NULL,
+        fixed_bufs->buffers_size,
+        PROT_READ|PROT_WRITE,
+        MAP_PRIVATE|MAP_ANONYMOUS,
+        -1,
+        0
+    );
+    if(fixed_bufs->buffers == MAP_FAILED) {
+        gobj_log_critical(yev_loop->yuno, 0,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_MEMORY_ERROR,
+            "msg",          "%s", "mmap() of registered buffers FAILED",
+            "size",         "%lu", (unsigned long)fixed_bufs->buffers_size,
+            "errno",        "%d", errno,
+            "serrno",       "%s", strerror(errno),
+            NULL
+        );
+        GBMEM_FREE(fixed_bufs->free_bufs)
+        GBMEM_FREE(fixed_bufs)
+        yev_loop->fixed_buffers = 0;
+        return NULL;
+    }
+
+    struct iovec iov = {
+        .iov_base = fixed_bufs->buffers,
+        .iov_len = fixed_bufs->buffers_size
+    };
+    int err = io_uring_register_buffers(&yev_loop->ring, &iov, 1);
+    if(err < 0) {
+        /*
+         *  ENOMEM if RLIMIT_MEMLOCK is exceeded (the registered pages are locked)
+         */
+        gobj_log_warning(yev_loop->yuno, 0,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_LIBUV_ERROR,
+            "msg",          "%s", "io_uring_register_buffers() FAILED, using plain gbuffers",
+            "size",         "%lu", (unsigned long)fixed_bufs->buffers_size,
+            "errno",        "%d", -err,
+            "serrno",       "%s", strerror(-err),
+            NULL
+        );
+        munmap(fixed_bufs->buffers, fixed_bufs->buffers_size);
+        GBMEM_FREE(fixed_bufs->free_bufs)
+        GBMEM_FREE(fixed_bufs)
+        yev_loop->fixed_buffers = 0;
+        return NULL;
+    }
+
+    for(unsigned i=0; i<fixed_bufs->nbufs; i++) {
+        fixed_bufs->free_bufs[i] = fixed_bufs->nbufs - 1 - i; // the first buffers first
+    }
+    fixed_bufs->n_free = fixed_bufs->nbufs;
+
+    fixed_bufs->yev_loop = yev_loop;
+    yev_loop->fixed_bufs = fixed_bufs;
+    return fixed_bufs;
+}
+
+/***************************************************************************
+ *  The ring is gone (unregistered), the memory is freed with the last buffer in use
+ ***************************************************************************/
+PRIVATE void fixed_bufs_destroy(yev_loop_t *yev_loop)
+{
+    yev_fixed_bufs_t *fixed_bufs = yev_loop->fixed_bufs;
+    if(!fixed_bufs) {
+        return;
+    }
+    yev_loop->fixed_bufs = NULL;
+    fixed_bufs->yev_loop = NULL;
+
+    if(fixed_bufs->in_use == 0) {
+        munmap(fixed_bufs->buffers, fixed_bufs->buffers_size);
+        GBMEM_FREE(fixed_bufs->free_bufs)
+        GBMEM_FREE(fixed_bufs)
+    }
+}
+
+/***************************************************************************
+ *  Free data function of the gbuffers of registered buffers
+ ***************************************************************************/
+PRIVATE void fixed_bufs_give_back(void *user_data, char *data)
+{
+    yev_fixed_bufs_t *fixed_bufs = user_data;
+
+    fixed_bufs->in_use--;
+
+    if(!fixed_bufs->yev_loop) {
+        // Loop destroyed, the last one free the memory
+        if(fixed_bufs->in_use == 0) {
+            munmap(fixed_bufs->buffers, fixed_bufs->buffers_size);
+            GBMEM_FREE(fixed_bufs->free_bufs)
+            GBMEM_FREE(fixed_bufs)
+        }
+        return;
+    }
+
+    unsigned idx = (unsigned)((size_t)(data - fixed_bufs->buffers) / fixed_bufs->stride);
+    fixed_bufs->free_bufs[fixed_bufs->n_free++] = idx;
+}
+
+/***************************************************************************
+ *  TRUE if the gbuffer's data is in the registered region of this loop
+ ***************************************************************************/
+PRIVATE BOOL is_fixed_gbuffer(yev_loop_t *yev_loop, gbuffer_t *gbuf)
+{
+    return (yev_loop->fixed_bufs &&
+        gbuf->free_data_fn == fixed_bufs_give_back &&
+        gbuf->free_data_user == yev_loop->fixed_bufs)? TRUE:FALSE;
+}
+
+/***************************************************************************
+ *  Gbuffer with a registered buffer, or a plain one
+ ***************************************************************************/
+PUBLIC gbuffer_t *yev_gbuffer_create(
+    yev_loop_t *yev_loop,
+    size_t data_size,
+    size_t max_memory_size
+) {
+    yev_fixed_bufs_t *fixed_bufs = get_fixed_bufs(yev_loop);
+    if(!fixed_bufs) {
+        return gbuffer_create(data_size, max_memory_size);
+    }
+    if(data_size > fixed_bufs->buf_size || fixed_bufs->n_free == 0) {
+        yev_loop->stats.fixed_bufs_full++;
+        return gbuffer_create(data_size, max_memory_size);
+    }
+
+    unsigned idx = fixed_bufs->free_bufs[--fixed_bufs->n_free];
+    char *data = fixed_bufs->buffers + (size_t)idx * fixed_bufs->stride;
+    fixed_bufs->in_use++;
+
+    gbuffer_t *gbuf = gbuffer_create_external(
+        data,
+        fixed_bufs->buf_size,
+        0,
+        fixed_bufs_give_back,
+        fixed_bufs
+    );
+    if(!gbuf) {
+        // Error already logged
+        fixed_bufs_give_back(fixed_bufs, data);
+        return NULL;
+    }
+    return gbuf;
+}
+
 /***************************************************************************
  *  Set TCP_NODELAY, SO_KEEPALIVE and SO_LINGER options to socket
  ***************************************************************************/
@@ -1885,6 +6748,20 @@ PUBLIC int get_peername(char *bf, size_t bfsize, int fd)
     return 0;
 }
 
+/***************************************************************************
+ *  "ip:port" of a socket address, like the received with yev_get_peer()
+ ***************************************************************************/
+PUBLIC int get_sockaddr_name(char *bf, size_t bfsize, const struct sockaddr *sa)
+{
+    if(!sa) {
+        if(bf && bfsize) {
+            *bf = 0;
+        }
+        return -1;
+    }
+    return printSocketAddress(bf, bfsize, sa);
+}
+
 /***************************************************************************
  *
  ***************************************************************************/
@@ -1911,3 +6788,19 @@ PUBLIC const char **yev_flag_strings(void)
 {
     return yev_flag_s;
 }
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PUBLIC const char **yev_loop_mode_strings(void)
+{
+    return yev_loop_mode_s;
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PUBLIC const char **yev_loop_cap_strings(void)
+{
+    return yev_loop_cap_s;
+}
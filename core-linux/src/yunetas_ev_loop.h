@@ -9,6 +9,7 @@
 #pragma once
 
 #include <time.h>
+#include <netinet/in.h>
 #include <liburing.h>
 #include <gobj.h>
 #include <helpers.h>
@@ -22,6 +23,18 @@ extern "C"{
  *              Constants
  ***************************************************************/
 #define DEFAULT_ENTRIES 2024
+#define YEV_CQE_BATCH_SIZE 64   // Max CQEs reaped per io_uring_peek_batch_cqe()
+#define YEV_RECV_BUFFERS 256        // Default buffers of the recv buffer ring, power of 2
+#define YEV_RECV_BUFFER_SIZE 4096   // Default size of each buffer of the recv buffer ring
+#define YEV_FIXED_FILES 1024        // Default slots of the registered (fixed) files table
+#define YEV_FIXED_BUFFERS 256       // Default buffers of the registered (fixed) buffers region
+#define YEV_FIXED_BUFFER_SIZE 4096  // Default size of each registered buffer
+#define YEV_STATS_TYPES 24          // yev types with latency stats, greater than the last yev_type_t
+#define YEV_STATS_LATENCY_BUCKETS 16    // log2 histogram of callback durations: <1us, <2us, ... >=16ms
+#define YEV_STATS_BATCH_BUCKETS 8       // log2 histogram of cqes per wakeup: 1, 2-3, 4-7, ... >=128
+#define YEV_DNS_CACHE_SIZE 64       // Entries of the resolved addresses cache
+#define YEV_DNS_CACHE_TTL 60000     // Default miliseconds of life of the resolved addresses
+#define YEV_SPLICE_PIPE_SIZE (256*1024) // Size asked for the pipe of the splice events, max bytes per start
 
 typedef enum  {
     YEV_TIMER_TYPE        = 1,
@@ -29,6 +42,19 @@ typedef enum  {
     YEV_WRITE_TYPE,
     YEV_CONNECT_TYPE,
     YEV_ACCEPT_TYPE,
+    YEV_RECV_MULTISHOT_TYPE,    // Available since 6.0, multishot recv with buffers of the loop's buffer ring
+    YEV_SEND_ZC_TYPE,           // Available since 6.0, zero copy send
+    YEV_WRITEV_TYPE,            // Gather write of the iovecs set with yev_set_iov()
+    YEV_RECVMSG_TYPE,           // Datagram received in own gbuffer, with its source address
+    YEV_RECVMSG_MULTISHOT_TYPE, // Available since 6.0, multishot recvmsg with buffers of the loop's buffer ring
+    YEV_SENDMSG_TYPE,           // Datagram sent to the destination address set with yev_set_peer()
+    YEV_MSG_TYPE,               // Available since 5.18, messages sent by other loops with yev_send_msg()
+    YEV_FILE_READ_TYPE,         // Read of a file at an offset
+    YEV_FILE_WRITE_TYPE,        // Write of a file at an offset, optionally linked to a fdatasync
+    YEV_FSYNC_TYPE,             // fsync or fdatasync of a file
+    YEV_POLL_TYPE,              // Readiness of a fd (poll(2) events), for the i/o done out of the ring
+    YEV_SPLICE_TYPE,            // File to fd (socket) through a pipe, without copies to user space
+    YEV_CANCEL_TYPE,            // End of a yev_cancel_fd()/yev_cancel_gobj(), created by the loop
 } yev_type_t;
 
 typedef enum  { // WARNING 8 bits only, strings in yev_flag_s[]
@@ -39,42 +65,256 @@ typedef enum  { // WARNING 8 bits only, strings in yev_flag_s[]
     YEV_FLAG_IS_TCP             = 0x10,
     YEV_FLAG_CONNECTED          = 0x20,     // user
     YEV_FLAG_WANT_TX_READY      = 0x40,     // user
+    YEV_FLAG_ZC_COPIED          = 0x80,     // YEV_SEND_ZC_TYPE: the kernel copied the data (no zero copy)
 } yev_flag_t;
 
+typedef enum  { // io_uring setup modes, strings in yev_loop_mode_s[]
+    YEV_LOOP_COOP_TASKRUN       = 0x01,     // Available since 5.18
+    YEV_LOOP_SINGLE_ISSUER      = 0x02,     // Available since 6.0
+    YEV_LOOP_DEFER_TASKRUN      = 0x04,     // Available since 6.1, implies YEV_LOOP_SINGLE_ISSUER
+    YEV_LOOP_SQPOLL             = 0x08,     // Kernel thread polling the SQ, not compatible with *_TASKRUN
+} yev_loop_mode_t;
+
+typedef enum  { // io_uring capabilities probed in the ring of the loop, strings in yev_loop_cap_s[]
+    YEV_CAP_ACCEPT_MULTISHOT    = 0x01,     // Available since 5.19
+    YEV_CAP_RECV_MULTISHOT      = 0x02,     // Available since 6.0, dropped if the buffer ring fails
+    YEV_CAP_SEND_ZC             = 0x04,     // Available since 6.0
+    YEV_CAP_SEND_ZC_REPORT_USAGE = 0x08,    // Available since 6.2
+    YEV_CAP_MSG_RING            = 0x10,     // Available since 5.18
+    YEV_CAP_ACCEPT_DIRECT       = 0x20,     // Available since 6.8, accept in fixed slots
+} yev_loop_cap_t;
+
 /***************************************************************
  *              Structures
  ***************************************************************/
 typedef struct yev_event_s yev_event_t;
 typedef struct yev_loop_s yev_loop_t;
+typedef struct yev_recv_ring_s yev_recv_ring_t;
+typedef struct yev_timer_wheel_s yev_timer_wheel_t;
+typedef struct yev_fixed_files_s yev_fixed_files_t;
+typedef struct yev_fixed_bufs_s yev_fixed_bufs_t;
+typedef struct yev_resolver_s yev_resolver_t;
 
 typedef int (*yev_callback_t)(
     yev_event_t *event
 );
 
+// Inline storage of the event's addresses (the urls are tcp/udp, inet or inet6)
+typedef union yev_sockaddr_u {
+    struct sockaddr sa;
+    struct sockaddr_in in;
+    struct sockaddr_in6 in6;
+} yev_sockaddr_t;
+
+/*
+ *  Message header of the datagram events (YEV_RECVMSG*_TYPE, YEV_SENDMSG_TYPE),
+ *  the peer is the source of the datagram received or the destination of the datagram to send.
+ */
+typedef struct yev_msghdr_s {
+    struct msghdr msg;          // must live until the sqe is completed
+    struct iovec iov;
+    struct sockaddr_storage peer;
+    socklen_t peerlen;          // 0 in YEV_SENDMSG_TYPE: the socket is connected
+} yev_msghdr_t;
+
 struct yev_event_s {
     yev_loop_t *yev_loop;
     uint8_t type;               // yev_type_t
     uint8_t flag;               // yev_flag_t
+    uint8_t zombie;             // destroyed in ring, the loop recycles it with its last cqe
+    uint8_t sync;               // YEV_FILE_WRITE_TYPE: linked fdatasync, YEV_FSYNC_TYPE: fdatasync
+    uint8_t sync_pending;       // cqes pending of a linked chain: write+fdatasync, splice file->pipe->fd
+    uint8_t accept_direct;      // YEV_ACCEPT_TYPE: armed with accept direct, the cqes give fixed slots
+    uint8_t accept_switch;      // YEV_ACCEPT_TYPE: multishot cancelled to rearm it direct or plain
     int fd;
-    uint64_t timer_bf;
     gbuffer_t *gbuf;
     hgobj gobj;
     yev_callback_t callback;
 
     int result;     // In YEV_ACCEPT_TYPE event it has the socket of cli_srv
 
-    struct sockaddr *dst_addr; // TODO eso solo le hace falta al connect y accept type
+    uint64_t offset;            // YEV_FILE_READ_TYPE, YEV_FILE_WRITE_TYPE, YEV_SPLICE_TYPE: offset in the file
+    unsigned poll_events;       // YEV_POLL_TYPE: poll(2) events to wait, the revents are in result
+
+    /*
+     *  YEV_SPLICE_TYPE: fd_in -> pipe of the event -> fd
+     */
+    int fd_in;                  // file to send, owned by the user
+    int pipe_fds[2];            // [0] read end, [1] write end, -1 if not created
+    uint32_t splice_len;        // bytes asked to fd_in in this start
+    uint32_t splice_moved;      // bytes of fd_in moved to the pipe in this start
+    uint32_t in_pipe;           // bytes in the pipe not sent to fd yet
+
+    /*
+     *  Deadline of each operation started, set with yev_set_timeout()
+     */
+    uint32_t timeout_ms;
+    struct __kernel_timespec timeout_ts;    // must live until the sqe is submitted
+
+    struct sockaddr *dst_addr;  // YEV_CONNECT_TYPE: &dst_storage if set
     socklen_t dst_addrlen;
-    struct sockaddr *src_addr;
+    struct sockaddr *src_addr;  // YEV_ACCEPT_TYPE: &src_storage if set
     socklen_t src_addrlen;
+    yev_sockaddr_t dst_storage;
+    yev_sockaddr_t src_storage;
+
+    /*
+     *  YEV_WRITEV_TYPE: iovecs to write, owned by the user
+     */
+    struct iovec *iov;
+    int iovcnt;
+
+    /*
+     *  YEV_RECVMSG_TYPE, YEV_RECVMSG_MULTISHOT_TYPE and YEV_SENDMSG_TYPE: datagram header
+     */
+    yev_msghdr_t *msghdr;
+
+    /*
+     *  YEV_CONNECT_TYPE: waiting the resolver, started with yev_start_connect_event()
+     */
+    struct yev_dns_waiter_s *dns_waiter;
+
+    /*
+     *  YEV_TIMER_TYPE: links in the loop's timer wheel
+     */
+    yev_event_t *tw_next;
+    yev_event_t **tw_pprev;
+    uint64_t tw_expires;        // monotonic msec
+    uint32_t tw_period;         // msec
+
+    /*
+     *  Operations in the kernel: links in the loop's index by fd, for yev_cancel_fd()
+     */
+    yev_event_t *ring_next;
+    yev_event_t **ring_pprev;   // NULL if not in the index
+    int ring_fd;                // fd of the operation in the kernel
+
+    /*
+     *  Bulk cancellation: the YEV_CANCEL_TYPE event of the operations cancelled together,
+     *  it counts the operations not returned yet.
+     */
+    yev_event_t *cancel_group;
+    uint32_t cancel_pending;
 };
 
+/*
+ *  Latency of the callbacks of a yev type
+ */
+typedef struct yev_type_stats_s {
+    uint64_t callbacks;
+    uint64_t total_ns;
+    uint64_t max_ns;
+    uint64_t histogram[YEV_STATS_LATENCY_BUCKETS];
+} yev_type_stats_t;
+
+/*
+ *  Loop counters, to measure the syscalls saved by the batched mode,
+ *  and the latency and saturation of the loop, to find who stalls it.
+ *  They are cheap (a monotonic clock read per callback), always on.
+ */
+typedef struct yev_loop_stats_s {
+    uint64_t loop_iterations;   // iterations of yev_loop_run()
+    uint64_t enter_calls;       // io_uring_submit*() calls done (each one is a io_uring_enter syscall)
+    uint64_t sqes_submitted;    // sqes flushed to kernel
+    uint64_t cqe_batches;       // io_uring_peek_batch_cqe() calls returning cqes
+    uint64_t cqes;              // cqes processed
+    uint64_t max_cqe_batch;     // biggest batch of cqes
+    uint64_t sq_full;           // times the SQ was full and a flush was forced
+    uint64_t recv_enobufs;      // times a multishot recv stopped because the buffer ring was empty
+    uint64_t timers_fired;      // timer callbacks called by expiration
+    uint64_t fixed_full;        // times the registered files table was full and a plain fd was used
+    uint64_t accepts_direct;    // sockets accepted directly in a fixed slot, without register syscall
+    uint64_t accepts_switched;  // multishot accepts rearmed from direct to plain or back
+    uint64_t fixed_bufs_full;   // gbuffers created without registered buffer (all in use or too big)
+    uint64_t fixed_bufs_ops;    // reads and writes done with read_fixed/write_fixed
+    uint64_t zc_sends;          // YEV_SEND_ZC_TYPE sends completed
+    uint64_t zc_copied;         // YEV_SEND_ZC_TYPE sends where the kernel copied the data
+    uint64_t link_timeouts;     // operations cancelled by their linked timeout (result -ETIMEDOUT)
+    uint64_t dgrams_truncated;  // datagrams received bigger than the buffer (MSG_TRUNC)
+    uint64_t dns_cache_hits;    // names got from the resolved addresses cache
+    uint64_t dns_resolves;      // getaddrinfo() done in the loop thread (blocking the loop)
+    uint64_t dns_async_resolves;    // getaddrinfo() done in the resolver thread
+    uint64_t dns_block_ns;      // time the loop was blocked in getaddrinfo()
+    uint64_t dns_wait_ns;       // time the connects waited the resolver thread
+    uint64_t dns_max_wait_ns;   // longest wait of the resolver thread
+    uint64_t msgs_sent;         // messages sent to other loops with yev_send_msg()
+    uint64_t msgs_failed;       // messages not delivered (destination ring overflowed or gone)
+    uint64_t bulk_cancels;      // cancel sqes of yev_cancel_fd() and yev_cancel_gobj()
+    uint64_t bulk_cancelled;    // operations cancelled by them
+    uint64_t bulk_cancels_failed;   // cancel sqes by fd failed, the operations cancelled one by one
+    uint64_t closes_deferred;   // yev_close_fd() with operations in the kernel, closed when they return
+
+    uint64_t wait_ns;           // time blocked in the kernel waiting cqes
+    uint64_t callbacks_ns;      // time in the callbacks
+    uint64_t max_in_flight;     // maximum sqes in flight (submitted and not completed)
+    uint64_t cqes_per_wakeup[YEV_STATS_BATCH_BUCKETS];
+    yev_type_stats_t types[YEV_STATS_TYPES];
+    uint64_t slowest_ns;        // slowest callback
+    uint8_t slowest_type;       // yev_type_t of the slowest callback
+    gclass_name_t slowest_gclass;   // gclass of the gobj of the slowest callback
+    time_t slowest_t;           // when
+} yev_loop_stats_t;
+
+typedef struct yev_loop_options_s {
+    unsigned entries;       // 0 is DEFAULT_ENTRIES
+    uint32_t mode;          // yev_loop_mode_t, modes not supported by the kernel are dropped
+    unsigned sqpoll_idle;   // YEV_LOOP_SQPOLL: miliseconds idle before the kernel thread sleeps, 0 kernel default
+    int sqpoll_cpu;         // YEV_LOOP_SQPOLL: cpu where pin the kernel thread, -1 not pinned
+    BOOL no_batch_submit;   // TRUE to submit every sqe when prepared, see yev_loop_set_batch_submit()
+    unsigned recv_buffers;      // YEV_RECV_MULTISHOT_TYPE: buffers in the ring (power of 2), 0 is YEV_RECV_BUFFERS
+    unsigned recv_buffer_size;  // YEV_RECV_MULTISHOT_TYPE: size of each buffer, 0 is YEV_RECV_BUFFER_SIZE
+    unsigned fixed_files;   // slots of the registered files table, 0 is YEV_FIXED_FILES
+    BOOL no_fixed_files;    // TRUE to use plain fds always
+    unsigned fixed_buffers;     // buffers of the registered buffers region, 0 is YEV_FIXED_BUFFERS
+    unsigned fixed_buffer_size; // size of each registered buffer, 0 is YEV_FIXED_BUFFER_SIZE
+    BOOL no_fixed_buffers;      // TRUE to create plain gbuffers in yev_gbuffer_create()
+    unsigned dns_cache_ttl; // miliseconds of life of the resolved addresses, 0 is YEV_DNS_CACHE_TTL
+    BOOL no_dns_cache;      // TRUE to resolve always, yev_start_connect_event() will block the loop
+    int cpu;                // cpu where pin the thread creating (and running) the loop, -1 not pinned
+} yev_loop_options_t;
+
 struct yev_loop_s {
     struct io_uring ring;
     unsigned entries;
+    uint32_t mode;          // yev_loop_mode_t really got from kernel
+    uint32_t caps;          // yev_loop_cap_t, probed in the ring
     hgobj yuno;
     volatile int running;
     volatile int stopping;
+    BOOL batch_submit;  // TRUE (default): sqes are flushed once per loop iteration
+    yev_loop_stats_t stats;
+    unsigned recv_buffers;
+    unsigned recv_buffer_size;
+    yev_recv_ring_t *recv_ring; // Buffer ring shared by the multishot recv events, created on first use
+    yev_timer_wheel_t *timer_wheel; // Timers of YEV_TIMER_TYPE events, expired by the loop's wait timeout
+    unsigned fixed_files;           // slots of the registered files table, 0 plain fds
+    yev_fixed_files_t *fixed;       // Registered files table, created on first use
+    unsigned fixed_buffers;         // buffers of the registered region, 0 without registered buffers
+    unsigned fixed_buffer_size;
+    yev_fixed_bufs_t *fixed_bufs;   // Registered buffers region, created on first use
+    uint64_t sqes_in_flight;        // sqes submitted without its final cqe
+    uint32_t dns_cache_ttl;         // msec, 0 without cache
+    yev_resolver_t *resolver;       // Resolved addresses cache and resolver thread, created on first use
+    int cpu;                        // cpu where the loop's thread is pinned, -1 not pinned
+
+    /*
+     *  Slab of events: chunks of yev_event_t with a free list,
+     *  an event destroyed while in ring is recycled when its last cqe arrives.
+     */
+    void *event_chunks;             // linked by its first word
+    yev_event_t *free_events;       // linked by tw_next
+    uint32_t events_allocated;
+    uint32_t events_in_use;
+    uint32_t events_zombies;
+
+    /*
+     *  Index of the operations in the kernel by fd (lists linked by ring_next),
+     *  and the YEV_CANCEL_TYPE events complete, to inform after the cqe (linked by tw_next).
+     */
+    yev_event_t **fd_ops;
+    uint8_t *fd_close_pending;      // fds closed by yev_close_fd() waiting their operations
+    unsigned fd_ops_size;
+    yev_event_t *cancels_done;
 };
 
 
@@ -82,6 +322,7 @@ struct yev_loop_s {
  *              Prototypes
  ***************************************************************/
 PUBLIC int yev_loop_create(hgobj yuno, unsigned entries, yev_loop_t **yev_loop);
+PUBLIC int yev_loop_create2(hgobj yuno, const yev_loop_options_t *options, yev_loop_t **yev_loop);
 PUBLIC void yev_loop_destroy(yev_loop_t *yev_loop);
 
 PUBLIC int yev_loop_run(yev_loop_t *yev_loop);
@@ -89,13 +330,74 @@ PUBLIC int yev_loop_run_once(yev_loop_t *yev_loop);
 PUBLIC int yev_loop_stop(yev_loop_t *yev_loop);
 
 /*
+ *  Batched mode (default):
+ *      while the loop is running, the sqes prepared by yev_start_event(), yev_start_timer_event(),
+ *      yev_stop_event() and the re-arms are queued and flushed once per loop iteration
+ *      with io_uring_submit_and_wait(), the cqes are reaped in batches.
+ *  With batch FALSE every sqe is submitted when prepared (one syscall per operation).
+ *  Outside of yev_loop_run() the sqes are always submitted immediately.
+ */
+PUBLIC void yev_loop_set_batch_submit(yev_loop_t *yev_loop, BOOL batch);
+
+/*
+ *  Flush the pending sqes to the kernel. Return the number of sqes submitted or negative if error.
+ */
+PUBLIC int yev_loop_flush(yev_loop_t *yev_loop);
+
+/*
+ *  Return the loop counters (with average syscalls per iteration and cqes per batch), reset them if required
+ */
+PUBLIC json_t *yev_loop_stats(yev_loop_t *yev_loop, BOOL reset);
+
+/*
+ *  Registered (fixed) files:
+ *      the sockets connected by yev_setup_connect_event(), the sockets accepted
+ *      and the fds registered by the user are installed in a sparse table of registered files,
+ *      with YEV_CAP_ACCEPT_DIRECT the sockets are accepted straight in the upper half of the table
+ *      (the kernel allocates the slot, without a register syscall per socket);
+ *      near the end of the upper half the accepts go plain, registered in the lower half.
+ *      The sqes of the events of registered files use IOSQE_FIXED_FILE transparently
+ *      (the kernel doesn't take a file reference per operation).
+ *      If the table is full the plain fd is used.
+ *  WARNING a registered fd must be closed with yev_close_fd(),
+ *      with close() the socket is kept open by the table.
+ */
+PUBLIC int yev_register_fd(yev_loop_t *yev_loop, int fd);   // Return the fixed slot, -1 if plain fd
+PUBLIC int yev_unregister_fd(yev_loop_t *yev_loop, int fd);
+/*
+ *  yev_close_fd(): unregister and close the fd. If it has operations in the kernel
+ *  they are cancelled (see yev_cancel_fd()) and the fd is closed when the last one returns.
+ */
+PUBLIC int yev_close_fd(yev_loop_t *yev_loop, int fd);
+
+/*
+ *  Registered (fixed) buffers:
+ *      gbuffers for socket and tty i/o with memory of a region registered in the kernel,
+ *      the YEV_READ_TYPE and YEV_WRITE_TYPE events with these gbuffers use read_fixed/write_fixed
+ *      transparently (the kernel doesn't pin and unpin the pages in every operation).
+ *  The gbuffer has the size of the registered buffers and cannot grow.
+ *  If data_size is bigger or all the buffers are in use, it's a gbuffer_create(data_size, max_memory_size).
+ *  The buffer returns to the region when the gbuffer is released.
+ */
+PUBLIC gbuffer_t *yev_gbuffer_create(
+    yev_loop_t *yev_loop,
+    size_t data_size,
+    size_t max_memory_size
+);
+
+/*
+ *  The timer events don't use file descriptors nor sqes:
+ *      they live in a hierarchical timer wheel of the loop (O(1) start/stop, msec resolution),
+ *      and the loop waits for cqes with the timeout of the nearest timer.
+ *      yev_stop_event() of a timer is synchronous: the callback is called with -ECANCELED.
+ *
  *  To start a timer event, don't use this yev_start_event(), use yev_start_timer_event().
  *  Before start `connects` and `accepts` events, you need to configure them with
  *      yev_setup_connect_event() and yev_setup_accept_event().
  *      These functions will create and configure a socket to listen or to connect
  */
 
-PUBLIC int yev_set_gbuffer( // only for yev_create_read_event() and yev_create_write_event()
+PUBLIC int yev_set_gbuffer( // only for read, write, recvmsg and sendmsg events
     yev_event_t *yev_event,
     gbuffer_t *gbuf // WARNING if there is previous gbuffer it will be free
 );
@@ -107,6 +409,62 @@ static inline void yev_set_fd( // only for yev_create_read_event() and yev_creat
     yev_event->fd = fd;
 }
 
+static inline void yev_set_poll_events( // only for yev_create_poll_event()
+    yev_event_t *yev_event,
+    unsigned poll_events    // POLLIN, POLLOUT
+) {
+    yev_event->poll_events = poll_events;
+}
+
+static inline void yev_set_iov( // only for yev_create_writev_event()
+    yev_event_t *yev_event,
+    struct iovec *iov,
+    int iovcnt
+) {
+    yev_event->iov = iov;
+    yev_event->iovcnt = iovcnt;
+}
+
+/*
+ *  Destination of the next YEV_SENDMSG_TYPE datagrams, NULL (or addrlen 0) in connected sockets
+ */
+PUBLIC int yev_set_peer(
+    yev_event_t *yev_event,
+    const struct sockaddr *addr,
+    socklen_t addrlen
+);
+
+/*
+ *  Source address of the datagram received in the callback of YEV_RECVMSG*_TYPE events,
+ *  or the destination set with yev_set_peer() in YEV_SENDMSG_TYPE.
+ */
+static inline struct sockaddr *yev_get_peer(
+    yev_event_t *yev_event,
+    socklen_t *addrlen
+) {
+    if(!yev_event->msghdr) {
+        *addrlen = 0;
+        return NULL;
+    }
+    *addrlen = yev_event->msghdr->peerlen;
+    return (struct sockaddr *)&yev_event->msghdr->peer;
+}
+
+/*
+ *  Deadline in miliseconds of the next operations started with yev_start_event(), 0 without deadline.
+ *  It's a linked timeout sqe (IORING_OP_LINK_TIMEOUT) submitted with the operation:
+ *  when it expires the operation is cancelled and the callback gets result -ETIMEDOUT.
+ *  Only for YEV_READ_TYPE, YEV_WRITE_TYPE, YEV_WRITEV_TYPE, YEV_CONNECT_TYPE,
+ *  YEV_RECVMSG_TYPE and YEV_SENDMSG_TYPE,
+ *  the multishot events ignore it.
+ */
+static inline void yev_set_timeout(
+    yev_event_t *yev_event,
+    uint32_t timeout_ms
+) {
+    yev_event->timeout_ms = timeout_ms;
+}
+
 static inline void yev_set_flag(
     yev_event_t *yev_event,
     yev_flag_t flag,
@@ -153,6 +511,33 @@ PUBLIC int yev_start_timer_event(
  */
 PUBLIC int yev_stop_event(yev_event_t *yev_event);
 
+/*
+ *  Bulk cancellation, like yev_stop_event() of every event in ring but with one sqe:
+ *      yev_cancel_fd():    all the operations of the fd (IORING_ASYNC_CANCEL_FD|ALL),
+ *                          call it before closing the fd.
+ *      yev_cancel_gobj():  all the events of the gobj, one sqe per fd used by them
+ *                          (the other operations of these fds are cancelled too),
+ *                          the timers and the connects waiting the resolver are stopped now.
+ *                          It walks all the events of the loop.
+ *  Each event gets its callback as with yev_stop_event(). If callback is not NULL,
+ *  when all the operations cancelled in the kernel have returned (after their callbacks)
+ *  it's called with a YEV_CANCEL_TYPE event: the gobj, the fd (-1 in yev_cancel_gobj())
+ *  and the operations cancelled in result. The loop destroys this event on return.
+ *  Return the number of operations cancelled, 0 if there is nothing in the kernel
+ *  (and the callback is not called), -1 if error.
+ */
+PUBLIC int yev_cancel_fd(
+    yev_loop_t *yev_loop,
+    int fd,
+    yev_callback_t callback,    // aggregated, optional
+    hgobj gobj                  // gobj of the aggregated callback
+);
+PUBLIC int yev_cancel_gobj(
+    yev_loop_t *yev_loop,
+    hgobj gobj,
+    yev_callback_t callback     // aggregated, optional
+);
+
 PUBLIC void yev_destroy_event(yev_event_t *yev_event);
 
 PUBLIC yev_event_t *yev_create_timer_event(
@@ -172,6 +557,36 @@ PUBLIC int yev_setup_connect_event(
     const char *src_url     /* only host:port */
 );
 
+/*
+ *  Setup and start a connect event without blocking the loop in the name resolution.
+ *  The addresses resolved are cached by the loop (options dns_cache_ttl),
+ *  so the connects to the same host resolve it once.
+ *  If the host is a numeric ip or it's in the cache the connect is started now,
+ *  else the name is resolved in a helper thread, and the connect is started when it's done.
+ *  Meanwhile the event is in ring: yev_stop_event() is synchronous,
+ *  the callback is called with -ECANCELED.
+ *  If the name cannot be resolved the callback gets result -EHOSTUNREACH.
+ *  Without cache (options no_dns_cache) it's yev_setup_connect_event() plus yev_start_event().
+ */
+PUBLIC int yev_start_connect_event(
+    yev_event_t *yev_event,
+    const char *dst_url,
+    const char *src_url     /* only host:port */
+);
+
+/*
+ *  The accept is multishot if the kernel supports it (5.19): one sqe accepts all the connections,
+ *  the callback gets the socket of each one in `result`.
+ *  A stopped accept event keeps its listening socket and can be started again.
+ *
+ *  Shared (SO_REUSEPORT): several processes (a yuno per cpu) listen in the same port,
+ *  the kernel distributes the connections among them.
+ *  If the loop is pinned to a cpu (options cpu) a steering program is attached to the group:
+ *  the connection goes to the socket with the index of the cpu that received it,
+ *  the socket of the N-th yuno joined the group has the index N,
+ *  so start the shared yunos in the order of their cpus (0, 1, ...).
+ *  Connections received in cpus without socket are distributed by hash.
+ */
 PUBLIC yev_event_t *yev_create_accept_event(
     yev_loop_t *loop,
     yev_callback_t callback,
@@ -199,6 +614,197 @@ PUBLIC yev_event_t *yev_create_write_event(
     gbuffer_t *gbuf
 );
 
+/*
+ *  Gather write: one sqe (writev) with the iovecs set by yev_set_iov() before every start.
+ *  In the callback the result has the bytes written, it can be less than the total (short write):
+ *  the user must consume his buffers and start again with the remainder.
+ */
+PUBLIC yev_event_t *yev_create_writev_event(
+    yev_loop_t *loop,
+    yev_callback_t callback,
+    hgobj gobj,
+    int fd
+);
+
+/*
+ *  Multishot recv: armed once, a callback per received chunk until error, close or stop.
+ *  In the callback yev_event->gbuf wraps a buffer of the loop's buffer ring,
+ *  it's decref'ed after the callback, incref it to keep the data:
+ *  the buffer is returned to the ring when the gbuffer is released.
+ *  If the ring runs out of buffers the recv is re-armed when a buffer is returned.
+ */
+PUBLIC yev_event_t *yev_create_recv_multishot_event(
+    yev_loop_t *loop,
+    yev_callback_t callback,
+    hgobj gobj,
+    int fd
+);
+
+/*
+ *  Datagram sockets.
+ *  Recvmsg: one datagram in the gbuffer (its free bytes), the source address with yev_get_peer().
+ *      A datagram bigger than the free bytes is truncated, its tail is lost.
+ *  Multishot recvmsg: like the multishot recv, a callback per datagram received
+ *      with the gbuffer wrapping the payload inside a buffer of the loop's buffer ring.
+ *      All the datagrams queued in the socket are reaped in the same loop iteration,
+ *      without a syscall per datagram (the io_uring equivalent of recvmmsg()).
+ *  Sendmsg: the gbuffer is a datagram to the peer set with yev_set_peer(),
+ *      several events started in the same iteration go to kernel in one submit (like sendmmsg()).
+ *      The gbuffer is consumed with the bytes sent, and released on destroy or yev_set_gbuffer().
+ */
+PUBLIC yev_event_t *yev_create_recvmsg_event(
+    yev_loop_t *loop,
+    yev_callback_t callback,
+    hgobj gobj,
+    int fd,
+    gbuffer_t *gbuf
+);
+PUBLIC yev_event_t *yev_create_recvmsg_multishot_event(
+    yev_loop_t *loop,
+    yev_callback_t callback,
+    hgobj gobj,
+    int fd
+);
+PUBLIC yev_event_t *yev_create_sendmsg_event(
+    yev_loop_t *loop,
+    yev_callback_t callback,
+    hgobj gobj,
+    int fd,
+    gbuffer_t *gbuf
+);
+
+/*
+ *  TRUE if the kernel supports multishot recv with buffer rings (>= 6.0)
+ */
+PUBLIC BOOL yev_recv_multishot_available(yev_loop_t *yev_loop);
+
+/*
+ *  Zero copy send (IORING_OP_SEND_ZC), worth with big buffers.
+ *  The gbuffer is pinned until the kernel notifies it's released,
+ *  the callback is called once, after the notification,
+ *  with the bytes sent in result (gbuffer already consumed) or the error.
+ *  YEV_FLAG_ZC_COPIED is set if the kernel had to copy the data (loopback, no sg support...).
+ */
+PUBLIC yev_event_t *yev_create_send_zc_event(
+    yev_loop_t *loop,
+    yev_callback_t callback,
+    hgobj gobj,
+    int fd,
+    gbuffer_t *gbuf
+);
+
+/*
+ *  TRUE if the kernel supports zero copy send (>= 6.0)
+ */
+PUBLIC BOOL yev_send_zc_available(yev_loop_t *yev_loop);
+
+/*
+ *  Messages between loops of the same process (IORING_OP_MSG_RING, kernel >= 5.18),
+ *  each loop running in its own thread:
+ *      the receiver loop creates a msg event, never started,
+ *      the sender loop posts with yev_send_msg() a cqe with `value` directly in the receiver's ring,
+ *      without locks nor wakeup fds, and its callback is called in the receiver thread
+ *      with the value in `result`.
+ *  The value is free for the user (a command, an index in a shared queue...).
+ *  The msg event must not be destroyed while other loops can send to it.
+ *  WARNING the gobjs are dispatched only by the thread of their loop (see Loops in gobj.h):
+ *      use the `loops` of C_YUNO to run gobjs in several loops, it posts the events between them.
+ *  Return -1 if the message cannot be sent, the failed deliveries are counted in msgs_failed.
+ */
+PUBLIC yev_event_t *yev_create_msg_event(
+    yev_loop_t *loop,
+    yev_callback_t callback,
+    hgobj gobj
+);
+PUBLIC int yev_send_msg(
+    yev_loop_t *loop,           // loop of the calling thread
+    yev_event_t *yev_msg_event, // msg event of the receiver loop
+    uint32_t value
+);
+
+/*
+ *  TRUE if the kernel supports messages between loops (>= 5.18)
+ */
+PUBLIC BOOL yev_msg_available(yev_loop_t *yev_loop);
+
+/*
+ *  Disk i/o without blocking the loop (the fd of the file is owned by the user).
+ *  The read fills the free space of the gbuffer, the write pops the bytes written.
+ *  Start them with yev_start_file_event():
+ *      offset: offset in the file, YEV_FILE_POSITION to use (and advance) the file position.
+ *      sync:   YEV_FILE_WRITE_TYPE: the write is linked to a fdatasync,
+ *                  the callback is called when the data is durable (or failed):
+ *                  result is the bytes written or the negative errno of the write or the fdatasync.
+ *                  A short write is not synced (result less than the bytes to write).
+ *              YEV_FSYNC_TYPE: fdatasync instead of fsync.
+ *  The disk i/o is not cancelable, yev_stop_event() fails, the events destroyed
+ *  while in ring are recycled with their last cqe.
+ */
+#define YEV_FILE_POSITION ((uint64_t)-1)
+
+PUBLIC yev_event_t *yev_create_file_read_event(
+    yev_loop_t *loop,
+    yev_callback_t callback,
+    hgobj gobj,
+    int fd,
+    gbuffer_t *gbuf
+);
+PUBLIC yev_event_t *yev_create_file_write_event(
+    yev_loop_t *loop,
+    yev_callback_t callback,
+    hgobj gobj,
+    int fd,
+    gbuffer_t *gbuf
+);
+PUBLIC yev_event_t *yev_create_fsync_event(
+    yev_loop_t *loop,
+    yev_callback_t callback,
+    hgobj gobj,
+    int fd
+);
+PUBLIC int yev_start_file_event(
+    yev_event_t *yev_event,
+    uint64_t offset,    // ignored in YEV_FSYNC_TYPE
+    BOOL sync
+);
+
+/*
+ *  Wait the readiness of a fd (one shot), for the i/o done out of the ring
+ *  like the handshake of a tls library with its own socket reads and writes.
+ *  The callback gets in result the poll(2) revents or a negative errno.
+ *  The fd is not closed on destroy.
+ */
+PUBLIC yev_event_t *yev_create_poll_event(
+    yev_loop_t *loop,
+    yev_callback_t callback,
+    hgobj gobj,
+    int fd,
+    unsigned poll_events    // POLLIN, POLLOUT
+);
+
+/*
+ *  Send a file to a socket (or any fd) without copies to user space (IORING_OP_SPLICE):
+ *  the file is moved to a pipe of the event and from the pipe to the fd,
+ *  two linked sqes in the same submit.
+ *  Every start moves up to `len` bytes (limited by the pipe size, YEV_SPLICE_PIPE_SIZE)
+ *  of fd_in at offset (YEV_FILE_POSITION to use and advance the file position),
+ *  the callback is called when they are all in the fd (the short sends are resumed internally)
+ *  with the bytes sent in result, 0 at the end of the file, or a negative errno.
+ *  The fd_in and the fd are owned by the user, the pipe is closed on destroy.
+ */
+PUBLIC yev_event_t *yev_create_splice_event(
+    yev_loop_t *loop,
+    yev_callback_t callback,
+    hgobj gobj,
+    int fd
+);
+PUBLIC int yev_start_splice_event(
+    yev_event_t *yev_event,
+    int fd_in,
+    uint64_t offset,
+    size_t len
+);
+
 PUBLIC const char *yev_event_type_name(yev_event_t *yev_event);
 
 /*
@@ -210,7 +816,10 @@ PUBLIC BOOL is_tcp_socket(int fd);
 PUBLIC BOOL is_udp_socket(int fd);
 PUBLIC int get_peername(char *bf, size_t bfsize, int fd);
 PUBLIC int get_sockname(char *bf, size_t bfsize, int fd);
+PUBLIC int get_sockaddr_name(char *bf, size_t bfsize, const struct sockaddr *sa);
 PUBLIC const char **yev_flag_strings(void);
+PUBLIC const char **yev_loop_mode_strings(void);
+PUBLIC const char **yev_loop_cap_strings(void);
 
 #ifdef __cplusplus
 }
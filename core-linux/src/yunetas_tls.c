@@ -0,0 +1,670 @@
+/****************************************************************************
+ *          yunetas_tls.c
+ *
+ *          TLS of the transports, with the system OpenSSL.
+ *
+ *          Copyright (c) 2024 Niyamaka.
+ *          All Rights Reserved.
+ ****************************************************************************/
+#include <string.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+#include <openssl/pem.h>
+#include <kwid.h>
+#include "yunetas_tls.h"
+
+/***************************************************************
+ *              Constants
+ ***************************************************************/
+
+/***************************************************************
+ *              Structures
+ ***************************************************************/
+struct ytls_s {
+    SSL_CTX *ctx;
+    BOOL server;
+};
+
+struct ytls_sskt_s {
+    ytls_t *ytls;
+    hgobj gobj;
+    SSL *ssl;
+    unsigned poll_events;
+    BOOL ktls_tx;
+    BOOL ktls_rx;
+    BIO *rbio;          // memory bio of user space rx, NULL with ktls
+    BIO *wbio;          // memory bio of user space tx, NULL with ktls
+    char last_error[256];
+};
+
+/***************************************************************
+ *              Prototypes
+ ***************************************************************/
+PRIVATE const char *ssl_error_string(char *bf, size_t bfsize);
+PRIVATE int add_trusted_pem(hgobj gobj, SSL_CTX *ctx, const char *pem);
+
+
+
+
+                    /***************************
+                     *      Context
+                     ***************************/
+
+
+
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PUBLIC ytls_t *ytls_init(
+    hgobj gobj,
+    json_t *jn_config,  // not owned
+    BOOL server
+) {
+    char err[256];
+
+    const char *ssl_certificate = kw_get_str(gobj, jn_config, "ssl_certificate", "", 0);
+    const char *ssl_certificate_key = kw_get_str(gobj, jn_config, "ssl_certificate_key", "", 0);
+    const char *ssl_trusted_certificate = kw_get_str(gobj, jn_config, "ssl_trusted_certificate", "", 0);
+    const char *ssl_trusted_pem = kw_get_str(gobj, jn_config, "ssl_trusted_pem", "", 0);
+    const char *ssl_ciphers = kw_get_str(gobj, jn_config, "ssl_ciphers", "", 0);
+    int ssl_verify_depth = (int)kw_get_int(gobj, jn_config, "ssl_verify_depth", 1, 0);
+    BOOL ktls = kw_get_bool(gobj, jn_config, "ktls", 1, 0);
+
+    SSL_CTX *ctx = SSL_CTX_new(server? TLS_server_method() : TLS_client_method());
+    if(!ctx) {
+        gobj_log_error(gobj, 0,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_SYSTEM_ERROR,
+            "msg",          "%s", "SSL_CTX_new() FAILED",
+            "error",        "%s", ssl_error_string(err, sizeof(err)),
+            NULL
+        );
+        return NULL;
+    }
+
+    SSL_CTX_set_min_proto_version(ctx, TLS1_2_VERSION);
+    SSL_CTX_set_mode(ctx, SSL_MODE_RELEASE_BUFFERS);    // many idle connections
+    if(ktls) {
+        // The library installs the keys in the socket if the kernel and the cipher support it
+        SSL_CTX_set_options(ctx, SSL_OP_ENABLE_KTLS);
+        // The keys of a renegotiation cannot be installed in the socket
+        SSL_CTX_set_options(ctx, SSL_OP_NO_RENEGOTIATION);
+    }
+
+    if(!empty_string(ssl_ciphers) && !SSL_CTX_set_cipher_list(ctx, ssl_ciphers)) {
+        gobj_log_error(gobj, 0,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_PARAMETER_ERROR,
+            "msg",          "%s", "SSL_CTX_set_cipher_list() FAILED",
+            "ssl_ciphers",  "%s", ssl_ciphers,
+            "error",        "%s", ssl_error_string(err, sizeof(err)),
+            NULL
+        );
+        SSL_CTX_free(ctx);
+        return NULL;
+    }
+
+    if(server) {
+        if(!SSL_CTX_use_certificate_chain_file(ctx, ssl_certificate)) {
+            gobj_log_error(gobj, 0,
+                "function",     "%s", __FUNCTION__,
+                "msgset",       "%s", MSGSET_PARAMETER_ERROR,
+                "msg",          "%s", "SSL_CTX_use_certificate_chain_file() FAILED",
+                "ssl_certificate","%s", ssl_certificate,
+                "error",        "%s", ssl_error_string(err, sizeof(err)),
+                NULL
+            );
+            SSL_CTX_free(ctx);
+            return NULL;
+        }
+        if(!SSL_CTX_use_PrivateKey_file(ctx, ssl_certificate_key, SSL_FILETYPE_PEM) ||
+                !SSL_CTX_check_private_key(ctx)) {
+            gobj_log_error(gobj, 0,
+                "function",     "%s", __FUNCTION__,
+                "msgset",       "%s", MSGSET_PARAMETER_ERROR,
+                "msg",          "%s", "SSL_CTX_use_PrivateKey_file() FAILED",
+                "ssl_certificate_key","%s", ssl_certificate_key,
+                "error",        "%s", ssl_error_string(err, sizeof(err)),
+                NULL
+            );
+            SSL_CTX_free(ctx);
+            return NULL;
+        }
+        /*
+         *  Without session tickets: the TLS 1.3 tickets go after the handshake,
+         *  they would be written out of the transport.
+         */
+        SSL_CTX_set_num_tickets(ctx, 0);
+        SSL_CTX_set_options(ctx, SSL_OP_NO_TICKET);
+    }
+
+    BOOL trusted = FALSE;
+    if(!empty_string(ssl_trusted_certificate)) {
+        if(!SSL_CTX_load_verify_locations(ctx, ssl_trusted_certificate, NULL)) {
+            gobj_log_error(gobj, 0,
+                "function",     "%s", __FUNCTION__,
+                "msgset",       "%s", MSGSET_PARAMETER_ERROR,
+                "msg",          "%s", "SSL_CTX_load_verify_locations() FAILED",
+                "ssl_trusted_certificate","%s", ssl_trusted_certificate,
+                "error",        "%s", ssl_error_string(err, sizeof(err)),
+                NULL
+            );
+            SSL_CTX_free(ctx);
+            return NULL;
+        }
+        trusted = TRUE;
+    }
+    if(!empty_string(ssl_trusted_pem)) {
+        if(add_trusted_pem(gobj, ctx, ssl_trusted_pem) < 0) {
+            // Error already logged
+            SSL_CTX_free(ctx);
+            return NULL;
+        }
+        trusted = TRUE;
+    }
+    if(trusted) {
+        SSL_CTX_set_verify(ctx, SSL_VERIFY_PEER, NULL);
+        SSL_CTX_set_verify_depth(ctx, ssl_verify_depth);
+    }
+
+    ytls_t *ytls = GBMEM_MALLOC(sizeof(ytls_t));
+    if(!ytls) {
+        gobj_log_critical(gobj, 0,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_MEMORY_ERROR,
+            "msg",          "%s", "No memory for ytls",
+            NULL
+        );
+        SSL_CTX_free(ctx);
+        return NULL;
+    }
+    ytls->ctx = ctx;
+    ytls->server = server;
+
+    return ytls;
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PUBLIC void ytls_cleanup(ytls_t *ytls)
+{
+    if(!ytls) {
+        return;
+    }
+    SSL_CTX_free(ytls->ctx);
+    GBMEM_FREE(ytls)
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PUBLIC const char *ytls_version(ytls_t *ytls)
+{
+    return OpenSSL_version(OPENSSL_VERSION);
+}
+
+
+
+
+                    /***************************
+                     *      Secure socket
+                     ***************************/
+
+
+
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PUBLIC ytls_sskt_t *ytls_new_secure_socket(
+    ytls_t *ytls,
+    hgobj gobj,
+    int fd,
+    const char *server_name,
+    BOOL verify_name
+) {
+    char err[256];
+
+    ytls_sskt_t *sskt = GBMEM_MALLOC(sizeof(ytls_sskt_t));
+    if(!sskt) {
+        gobj_log_critical(gobj, 0,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_MEMORY_ERROR,
+            "msg",          "%s", "No memory for secure socket",
+            NULL
+        );
+        return NULL;
+    }
+    sskt->ytls = ytls;
+    sskt->gobj = gobj;
+
+    sskt->ssl = SSL_new(ytls->ctx);
+    if(!sskt->ssl || !SSL_set_fd(sskt->ssl, fd)) {   // the socket bio doesn't close the fd
+        gobj_log_error(gobj, 0,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_SYSTEM_ERROR,
+            "msg",          "%s", "SSL_new() FAILED",
+            "error",        "%s", ssl_error_string(err, sizeof(err)),
+            NULL
+        );
+        ytls_free_secure_socket(sskt);
+        return NULL;
+    }
+
+    if(ytls->server) {
+        SSL_set_accept_state(sskt->ssl);
+    } else {
+        SSL_set_connect_state(sskt->ssl);
+        if(!empty_string(server_name)) {
+            SSL_set_tlsext_host_name(sskt->ssl, server_name);
+            if(verify_name) {
+                SSL_set1_host(sskt->ssl, server_name);
+            }
+        }
+    }
+
+    return sskt;
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PUBLIC void ytls_free_secure_socket(ytls_sskt_t *sskt)
+{
+    if(!sskt) {
+        return;
+    }
+    if(sskt->ssl) {
+        SSL_free(sskt->ssl);    // and its bios
+    }
+    GBMEM_FREE(sskt)
+}
+
+/***************************************************************************
+ *  Handshake step
+ ***************************************************************************/
+PUBLIC int ytls_do_handshake(ytls_sskt_t *sskt)
+{
+    ERR_clear_error();
+    int ret = SSL_do_handshake(sskt->ssl);
+    if(ret == 1) {
+        /*
+         *  The directions without ktls go through memory bios,
+         *  the transport does the i/o of the socket.
+         */
+        sskt->ktls_tx = BIO_get_ktls_send(SSL_get_wbio(sskt->ssl))? TRUE:FALSE;
+        sskt->ktls_rx = BIO_get_ktls_recv(SSL_get_rbio(sskt->ssl))? TRUE:FALSE;
+        if(!sskt->ktls_rx) {
+            sskt->rbio = BIO_new(BIO_s_mem());
+            SSL_set0_rbio(sskt->ssl, sskt->rbio);
+        }
+        if(!sskt->ktls_tx) {
+            sskt->wbio = BIO_new(BIO_s_mem());
+            SSL_set0_wbio(sskt->ssl, sskt->wbio);
+        }
+        if((!sskt->ktls_rx && !sskt->rbio) || (!sskt->ktls_tx && !sskt->wbio)) {
+            gobj_log_critical(sskt->gobj, 0,
+                "function",     "%s", __FUNCTION__,
+                "msgset",       "%s", MSGSET_MEMORY_ERROR,
+                "msg",          "%s", "No memory for bio",
+                NULL
+            );
+            return -1;
+        }
+        return 1;
+    }
+
+    switch(SSL_get_error(sskt->ssl, ret)) {
+        case SSL_ERROR_WANT_READ:
+            sskt->poll_events = POLLIN;
+            return 0;
+        case SSL_ERROR_WANT_WRITE:
+            sskt->poll_events = POLLOUT;
+            return 0;
+        default:
+            ssl_error_string(sskt->last_error, sizeof(sskt->last_error));
+            if(empty_string(sskt->last_error)) {
+                snprintf(sskt->last_error, sizeof(sskt->last_error), "%s", "connection closed");
+            }
+            return -1;
+    }
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PUBLIC unsigned ytls_poll_events(ytls_sskt_t *sskt)
+{
+    return sskt->poll_events;
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PUBLIC BOOL ytls_ktls_tx(ytls_sskt_t *sskt)
+{
+    return sskt->ktls_tx;
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PUBLIC BOOL ytls_ktls_rx(ytls_sskt_t *sskt)
+{
+    return sskt->ktls_rx;
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PUBLIC const char *ytls_cipher_name(ytls_sskt_t *sskt)
+{
+    return SSL_get_cipher_name(sskt->ssl);
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PUBLIC const char *ytls_protocol(ytls_sskt_t *sskt)
+{
+    return SSL_get_version(sskt->ssl);
+}
+
+/***************************************************************************
+ *  Encrypt in user space, the records are accumulated in the memory bio
+ ***************************************************************************/
+PUBLIC int ytls_encrypt(ytls_sskt_t *sskt, const char *data, size_t len)
+{
+    if(!sskt->wbio) {
+        gobj_log_error(sskt->gobj, LOG_OPT_TRACE_STACK,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_INTERNAL_ERROR,
+            "msg",          "%s", "Cannot encrypt: handshake not done or ktls tx",
+            NULL
+        );
+        return -1;
+    }
+    if(len == 0) {
+        return 0;
+    }
+
+    size_t written = 0;
+    ERR_clear_error();
+    if(!SSL_write_ex(sskt->ssl, data, len, &written)) {
+        ssl_error_string(sskt->last_error, sizeof(sskt->last_error));
+        gobj_log_error(sskt->gobj, 0,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_PROTOCOL_ERROR,
+            "msg",          "%s", "SSL_write() FAILED",
+            "error",        "%s", sskt->last_error,
+            NULL
+        );
+        return -1;
+    }
+    return 0;
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PUBLIC size_t ytls_pending_encrypted(ytls_sskt_t *sskt)
+{
+    return sskt->wbio? BIO_ctrl_pending(sskt->wbio) : 0;
+}
+
+/***************************************************************************
+ *  Encrypted data pending to transmit, in a new gbuffer
+ ***************************************************************************/
+PUBLIC gbuffer_t *ytls_get_encrypted(ytls_sskt_t *sskt)
+{
+    size_t pending = ytls_pending_encrypted(sskt);
+    if(pending == 0) {
+        return NULL;
+    }
+
+    gbuffer_t *gbuf = gbuffer_create(pending, pending);
+    if(!gbuf) {
+        gobj_log_critical(sskt->gobj, 0,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_MEMORY_ERROR,
+            "msg",          "%s", "No memory for encrypted gbuffer",
+            "size",         "%lu", (unsigned long)pending,
+            NULL
+        );
+        return NULL;
+    }
+    int n = BIO_read(sskt->wbio, gbuffer_cur_wr_pointer(gbuf), (int)pending);
+    gbuffer_set_wr(gbuf, n > 0? (size_t)n : 0);
+    return gbuf;
+}
+
+/***************************************************************************
+ *  Decrypt in user space the data read from the socket
+ ***************************************************************************/
+PUBLIC int ytls_decrypt(ytls_sskt_t *sskt, gbuffer_t *gbuf, gbuffer_t **plain)
+{
+    *plain = NULL;
+
+    if(!sskt->rbio) {
+        gobj_log_error(sskt->gobj, LOG_OPT_TRACE_STACK,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_INTERNAL_ERROR,
+            "msg",          "%s", "Cannot decrypt: handshake not done or ktls rx",
+            NULL
+        );
+        return -1;
+    }
+
+    size_t len = gbuffer_leftbytes(gbuf);
+    if(len > 0) {
+        BIO_write(sskt->rbio, gbuffer_cur_rd_pointer(gbuf), (int)len);
+        gbuffer_get(gbuf, len);
+    }
+
+    /*
+     *  The plain data is not bigger than the encrypted data,
+     *  but a partial record can be already in the library (up to a record more).
+     */
+    size_t size = BIO_ctrl_pending(sskt->rbio) + (size_t)SSL_pending(sskt->ssl);
+    if(size == 0) {
+        return 0;
+    }
+    gbuffer_t *gbuf_plain = gbuffer_create(size, size + SSL3_RT_MAX_PLAIN_LENGTH);
+    if(!gbuf_plain) {
+        gobj_log_critical(sskt->gobj, 0,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_MEMORY_ERROR,
+            "msg",          "%s", "No memory for decrypted gbuffer",
+            "size",         "%lu", (unsigned long)size,
+            NULL
+        );
+        return -1;
+    }
+
+    int ret = 0;
+    while(1) {
+        size_t readed = 0;
+        ERR_clear_error();
+        if(gbuffer_freebytes(gbuf_plain) > 0) {
+            if(SSL_read_ex(sskt->ssl, gbuffer_cur_wr_pointer(gbuf_plain), gbuffer_freebytes(gbuf_plain), &readed)) {
+                gbuffer_set_wr(gbuf_plain, gbuffer_totalbytes(gbuf_plain) + readed);
+                continue;
+            }
+        } else {
+            char chunk[SSL3_RT_MAX_PLAIN_LENGTH];
+            if(SSL_read_ex(sskt->ssl, chunk, sizeof(chunk), &readed)) {
+                gbuffer_append(gbuf_plain, chunk, readed);
+                continue;
+            }
+        }
+        int err = SSL_get_error(sskt->ssl, 0);
+        if(err == SSL_ERROR_WANT_READ) {
+            break;  // Incomplete record, wait more data
+        }
+        if(err == SSL_ERROR_ZERO_RETURN) {
+            snprintf(sskt->last_error, sizeof(sskt->last_error), "%s", "close notify");
+        } else {
+            ssl_error_string(sskt->last_error, sizeof(sskt->last_error));
+            gobj_log_error(sskt->gobj, 0,
+                "function",     "%s", __FUNCTION__,
+                "msgset",       "%s", MSGSET_PROTOCOL_ERROR,
+                "msg",          "%s", "SSL_read() FAILED",
+                "error",        "%s", sskt->last_error,
+                NULL
+            );
+        }
+        ret = -1;
+        break;
+    }
+
+    if(ret < 0 || gbuffer_leftbytes(gbuf_plain) == 0) {
+        GBUFFER_DECREF(gbuf_plain)
+        return ret;
+    }
+    *plain = gbuf_plain;
+    return 0;
+}
+
+/***************************************************************************
+ *  Kernel rx: the record at the head of the socket is not application data,
+ *  the library reads it (recvmsg with its record type) and processes it.
+ *  The socket is non-blocking meanwhile: nothing more than what's there is read.
+ ***************************************************************************/
+PUBLIC int ytls_ktls_read_record(ytls_sskt_t *sskt, gbuffer_t **plain)
+{
+    *plain = NULL;
+
+    if(!sskt->ktls_rx) {
+        gobj_log_error(sskt->gobj, LOG_OPT_TRACE_STACK,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_INTERNAL_ERROR,
+            "msg",          "%s", "Cannot read record: without ktls rx",
+            NULL
+        );
+        return -1;
+    }
+
+    int fd = SSL_get_rfd(sskt->ssl);
+    int flags = fcntl(fd, F_GETFL);
+    fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+
+    int ret = 0;
+    char chunk[SSL3_RT_MAX_PLAIN_LENGTH];
+    size_t readed = 0;
+    ERR_clear_error();
+    if(SSL_read_ex(sskt->ssl, chunk, sizeof(chunk), &readed)) {
+        /*
+         *  Application data after the record, the rest is read by the transport
+         */
+        gbuffer_t *gbuf_plain = gbuffer_create(readed, readed);
+        if(!gbuf_plain) {
+            gobj_log_critical(sskt->gobj, 0,
+                "function",     "%s", __FUNCTION__,
+                "msgset",       "%s", MSGSET_MEMORY_ERROR,
+                "msg",          "%s", "No memory for decrypted gbuffer",
+                "size",         "%lu", (unsigned long)readed,
+                NULL
+            );
+            ret = -1;
+        } else {
+            gbuffer_append(gbuf_plain, chunk, readed);
+            *plain = gbuf_plain;
+        }
+    } else {
+        int err = SSL_get_error(sskt->ssl, 0);
+        if(err == SSL_ERROR_WANT_READ || err == SSL_ERROR_WANT_WRITE) {
+            // Record processed, no more data
+        } else if(err == SSL_ERROR_ZERO_RETURN) {
+            snprintf(sskt->last_error, sizeof(sskt->last_error), "%s", "close notify");
+            ret = -1;
+        } else {
+            ssl_error_string(sskt->last_error, sizeof(sskt->last_error));
+            if(empty_string(sskt->last_error)) {
+                snprintf(sskt->last_error, sizeof(sskt->last_error), "%s", "connection closed");
+            }
+            gobj_log_error(sskt->gobj, 0,
+                "function",     "%s", __FUNCTION__,
+                "msgset",       "%s", MSGSET_PROTOCOL_ERROR,
+                "msg",          "%s", "SSL_read() FAILED",
+                "error",        "%s", sskt->last_error,
+                NULL
+            );
+            ret = -1;
+        }
+    }
+
+    fcntl(fd, F_SETFL, flags);
+    return ret;
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PUBLIC const char *ytls_last_error(ytls_sskt_t *sskt)
+{
+    return sskt->last_error;
+}
+
+
+
+
+                    /***************************
+                     *      Local methods
+                     ***************************/
+
+
+
+
+/***************************************************************************
+ *  Errors of the OpenSSL's queue
+ ***************************************************************************/
+PRIVATE const char *ssl_error_string(char *bf, size_t bfsize)
+{
+    *bf = 0;
+    unsigned long e;
+    size_t ln = 0;
+    while((e = ERR_get_error()) != 0 && ln + 2 < bfsize) {
+        if(ln > 0) {
+            bf[ln++] = ';';
+        }
+        ERR_error_string_n(e, bf + ln, bfsize - ln);
+        ln = strlen(bf);
+    }
+    return bf;
+}
+
+/***************************************************************************
+ *  Trusted certificates from a PEM string
+ ***************************************************************************/
+PRIVATE int add_trusted_pem(hgobj gobj, SSL_CTX *ctx, const char *pem)
+{
+    BIO *bio = BIO_new_mem_buf(pem, -1);
+    if(!bio) {
+        return -1;
+    }
+    X509_STORE *store = SSL_CTX_get_cert_store(ctx);
+    int n = 0;
+    X509 *x509;
+    while((x509 = PEM_read_bio_X509(bio, NULL, NULL, NULL)) != NULL) {
+        X509_STORE_add_cert(store, x509);
+        X509_free(x509);
+        n++;
+    }
+    BIO_free(bio);
+    ERR_clear_error();  // the end of the pem is an error
+
+    if(n == 0) {
+        gobj_log_error(gobj, 0,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_PARAMETER_ERROR,
+            "msg",          "%s", "No certificate in trusted pem",
+            NULL
+        );
+        return -1;
+    }
+    return 0;
+}
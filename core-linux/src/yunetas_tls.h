@@ -0,0 +1,123 @@
+/****************************************************************************
+ *          yunetas_tls.h
+ *
+ *          TLS of the transports, with the system OpenSSL.
+ *
+ *          The handshake runs in user space, with the socket in non-blocking mode:
+ *          the library reads and writes the socket, the transport waits its readiness
+ *          with a YEV_POLL_TYPE event.
+ *          With kernel TLS (ktls, "tls" ULP) the session keys are installed in the socket
+ *          by the library when the handshake ends, and the io_uring reads and writes
+ *          (and the zero copy sends) of the transport work unchanged with plain data.
+ *          Without ktls (or a direction not supported by the library) the records are
+ *          encrypted and decrypted in user space, through memory buffers:
+ *              - ytls_encrypt() of several messages and one write of ytls_get_encrypted().
+ *              - ytls_decrypt() of the data read.
+ *
+ *          Copyright (c) 2024 Niyamaka.
+ *          All Rights Reserved.
+ ****************************************************************************/
+#pragma once
+
+#include <gobj.h>
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+/***************************************************************
+ *              Constants
+ ***************************************************************/
+#define YTLS_TX_BATCH_BYTES (16*1024)   // Plain bytes encrypted for one write without ktls
+
+/***************************************************************
+ *              Structures
+ ***************************************************************/
+typedef struct ytls_s ytls_t;           // Context: configuration, certificates (SSL_CTX)
+typedef struct ytls_sskt_s ytls_sskt_t; // Secure socket: a tls session (SSL)
+
+/***************************************************************
+ *              Prototypes
+ ***************************************************************/
+/*
+ *  jn_config (not owned):
+ *      "ssl_certificate":          file with the certificate chain (PEM), required in server
+ *      "ssl_certificate_key":      file with the private key (PEM), required in server
+ *      "ssl_trusted_certificate":  file with the trusted CA certificates (PEM)
+ *      "ssl_trusted_pem":          trusted CA certificate (PEM string)
+ *      "ssl_ciphers":              cipher list (TLS 1.2), default OpenSSL's
+ *      "ssl_verify_depth":         verify depth of the peer certificate, default 1
+ *      "ktls":                     use kernel TLS if available, default true
+ *  A client verifies the server certificate only with trusted certificates.
+ *  A server doesn't send session tickets (no post-handshake messages in the ktls sockets),
+ *  the ones received by a client are processed with ytls_ktls_read_record().
+ *  With ktls the renegotiation is refused.
+ */
+PUBLIC ytls_t *ytls_init(
+    hgobj gobj,
+    json_t *jn_config,  // not owned
+    BOOL server
+);
+PUBLIC void ytls_cleanup(ytls_t *ytls);
+PUBLIC const char *ytls_version(ytls_t *ytls);
+
+/*
+ *  New tls session over a connected socket (the socket is not closed on free).
+ *  server_name: in client, SNI and, if verify_name, the name checked in the server certificate.
+ */
+PUBLIC ytls_sskt_t *ytls_new_secure_socket(
+    ytls_t *ytls,
+    hgobj gobj,
+    int fd,
+    const char *server_name,
+    BOOL verify_name
+);
+PUBLIC void ytls_free_secure_socket(ytls_sskt_t *sskt);
+
+/*
+ *  Handshake step, the socket must be in non-blocking mode.
+ *  Return 1 done, 0 in progress (wait ytls_poll_events() of the socket and repeat), -1 error.
+ */
+PUBLIC int ytls_do_handshake(ytls_sskt_t *sskt);
+PUBLIC unsigned ytls_poll_events(ytls_sskt_t *sskt); // POLLIN or POLLOUT
+
+/*
+ *  After the handshake: TRUE if the direction is done by kernel TLS
+ *  (the socket transmits/receives plain data), else use ytls_encrypt()/ytls_decrypt()
+ */
+PUBLIC BOOL ytls_ktls_tx(ytls_sskt_t *sskt);
+PUBLIC BOOL ytls_ktls_rx(ytls_sskt_t *sskt);
+PUBLIC const char *ytls_cipher_name(ytls_sskt_t *sskt);
+PUBLIC const char *ytls_protocol(ytls_sskt_t *sskt);
+
+/*
+ *  User space tx: encrypt plain data (one or more records),
+ *  the encrypted data is accumulated until ytls_get_encrypted().
+ */
+PUBLIC int ytls_encrypt(ytls_sskt_t *sskt, const char *data, size_t len);
+PUBLIC size_t ytls_pending_encrypted(ytls_sskt_t *sskt);
+PUBLIC gbuffer_t *ytls_get_encrypted(ytls_sskt_t *sskt); // NULL if nothing pending
+
+/*
+ *  User space rx: decrypt the data read from the socket (the gbuffer is consumed).
+ *  Return -1 on error or peer's close, else *plain has a new gbuffer
+ *  with the plain data of the complete records, NULL if none.
+ *  It can leave data to transmit (ytls_pending_encrypted()), alerts or replies of the protocol.
+ */
+PUBLIC int ytls_decrypt(ytls_sskt_t *sskt, gbuffer_t *gbuf, gbuffer_t **plain);
+
+/*
+ *  Kernel rx: the read of the socket fails with EIO when the next record is not
+ *  application data (an alert, a TLS 1.3 NewSessionTicket or KeyUpdate),
+ *  it must be processed by the library before reading again.
+ *  Return -1 on error or peer's close, else *plain has a new gbuffer
+ *  with the application data read after the record, NULL if none.
+ *  Like ytls_decrypt() it can leave data to transmit.
+ */
+PUBLIC int ytls_ktls_read_record(ytls_sskt_t *sskt, gbuffer_t **plain);
+
+PUBLIC const char *ytls_last_error(ytls_sskt_t *sskt);
+
+#ifdef __cplusplus
+}
+#endif
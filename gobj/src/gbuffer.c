@@ -79,6 +79,73 @@ PUBLIC gbuffer_t *gbuffer_create(
     return gbuf;
 }
 
+/***************************************************************************
+ *  Crea un gbuf envolviendo datos externos, no se pueden realocar.
+ *  Al eliminar el gbuf se llama a free_data_fn() para devolver los datos.
+ *  Retorna NULL if error
+ ***************************************************************************/
+PUBLIC gbuffer_t *gbuffer_create_external(
+    char *data,
+    size_t data_size,
+    size_t data_len,
+    gbuffer_free_data_fn_t free_data_fn,
+    void *free_data_user)
+{
+    if(!data || !free_data_fn || data_len > data_size) {
+        gobj_log_error(0, LOG_OPT_TRACE_STACK,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_PARAMETER_ERROR,
+            "msg",          "%s", "BAD external data",
+            "data_size",    "%d", (int)data_size,
+            "data_len",     "%d", (int)data_len,
+            NULL
+        );
+        return NULL;
+    }
+
+    /*---------------------------------*
+     *   Alloc memory
+     *---------------------------------*/
+    gbuffer_t *gbuf = GBMEM_MALLOC(sizeof(*gbuf));
+    if(!gbuf) {
+        gobj_log_error(0, LOG_OPT_TRACE_STACK,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_MEMORY_ERROR,
+            "msg",          "%s", "no memory",
+            "sizeof",       "%d", (int)sizeof(struct gbuffer_s),
+            NULL
+        );
+        return NULL;
+    }
+
+    /*---------------------------------*
+     *   Inicializa atributos
+     *---------------------------------*/
+    gbuf->data = data;
+    gbuf->data_size = data_size;
+    gbuf->max_memory_size = data_size;
+    gbuf->free_data_fn = free_data_fn;
+    gbuf->free_data_user = free_data_user;
+
+    gbuf->tail = data_len;
+    gbuf->curp = 0;
+    gbuf->refcount = 1;
+    gbuf->data[data_len] = 0;   // Put final null
+
+    if(__trace_gobj_gbuffers__(0)) {
+        gobj_log_debug(0, 0,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_GBUFFERS,
+            "msg",          "%s", "🚛🟦 Creating external gbuffer",
+            "pointer",      "%p", gbuf,
+            "data_size",    "%d", (int)data_size,
+            "data_len",     "%d", (int)data_len,
+            NULL);
+    }
+
+    return gbuf;
+}
+
 /***************************************************************************
  *    Realloc buffer
  ***************************************************************************/
@@ -87,6 +154,17 @@ PRIVATE BOOL gbuffer_realloc(gbuffer_t *gbuf, size_t need_size)
     size_t more;
     char *new_buf;
 
+    if(gbuf->free_data_fn) {
+        gobj_log_error(0, LOG_OPT_TRACE_STACK,
+            "function",         "%s", __FUNCTION__,
+            "msgset",           "%s", MSGSET_INTERNAL_ERROR,
+            "msg",              "%s", "Cannot realloc external data",
+            "data_size",        "%ld", gbuf->data_size,
+            NULL
+        );
+        return FALSE;
+    }
+
     more = gbuf->data_size + MAX(gbuf->data_size, need_size);
     if((more + 1) > gbuf->max_memory_size) {
         gobj_log_error(0, LOG_OPT_TRACE_STACK,
@@ -152,7 +230,11 @@ PUBLIC void gbuffer_remove(gbuffer_t *gbuf)
         gbuf->label = 0;
     }
     if(gbuf->data) {
-        GBMEM_FREE(gbuf->data);
+        if(gbuf->free_data_fn) {
+            gbuf->free_data_fn(gbuf->free_data_user, gbuf->data);
+        } else {
+            GBMEM_FREE(gbuf->data);
+        }
         gbuf->data = 0;
     }
 
@@ -13,6 +13,7 @@
 
 #ifdef __linux__
     #include <execinfo.h>
+    #include <pthread.h>
 #endif
 
 #ifdef ESP_PLATFORM
@@ -151,6 +152,19 @@ PRIVATE ul_buffer_t ul_buffer[2];
 PRIVATE char __initialized__ = 0;
 PRIVATE volatile char __inside_log__ = 0;
 
+/*
+ *  The buffers are shared by the threads of the loops (see gobj_set_loop_hooks()),
+ *  recursive: a log inside the log of the same thread is dropped by __inside_log__.
+ */
+#ifdef __linux__
+PRIVATE pthread_mutex_t log_mutex = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+#define LOG_LOCK()      pthread_mutex_lock(&log_mutex);
+#define LOG_UNLOCK()    pthread_mutex_unlock(&log_mutex);
+#else
+#define LOG_LOCK()
+#define LOG_UNLOCK()
+#endif
+
 /***************************************************************
  *              Data
  ***************************************************************/
@@ -833,7 +847,9 @@ PRIVATE void _log(hgobj gobj, int priority, log_opt_t opt, va_list ap)
     if(!__initialized__) {
         return;
     }
+    LOG_LOCK()
     if(__inside_log__) {
+        LOG_UNLOCK()
         return;
     }
     __inside_log__ = 1;
@@ -862,6 +878,7 @@ PRIVATE void _log(hgobj gobj, int priority, log_opt_t opt, va_list ap)
     _log_bf(priority, opt, s, strlen(s));
 
     __inside_log__ = 0;
+    LOG_UNLOCK()
 }
 
 /***************************************************************************
@@ -882,7 +899,9 @@ PUBLIC void trace_vjson(
     if(!__initialized__) {
         return;
     }
+    LOG_LOCK()
     if(__inside_log__) {
+        LOG_UNLOCK()
         return;
     }
     __inside_log__ = 1;
@@ -942,6 +961,7 @@ PUBLIC void trace_vjson(
     json_decref(jn_log);
 
     __inside_log__ = 0;
+    LOG_UNLOCK()
 }
 
 /****************************************************************************
@@ -957,7 +977,9 @@ PUBLIC void trace_machine(const char *fmt, ...)
     if(!__initialized__) {
         return;
     }
+    LOG_LOCK()
     if(__inside_log__) {
+        LOG_UNLOCK()
         return;
     }
     __inside_log__ = 1;
@@ -979,6 +1001,7 @@ PUBLIC void trace_machine(const char *fmt, ...)
     _log_bf(LOG_DEBUG, 0, temp, strlen(temp));
 
     __inside_log__ = 0;
+    LOG_UNLOCK()
 }
 
 /*****************************************************************
@@ -14,6 +14,7 @@
 
 #ifdef __linux__
     #include <pwd.h>
+    #include <pthread.h>
     #include <strings.h>
     #include <sys/utsname.h>
     #include <unistd.h>
@@ -50,8 +51,23 @@ typedef struct state_s {
 
     gobj_state_t state_name;
     dl_list_t dl_actions;
+    event_action_t **actions;       // Row of the compiled FSM: action by event index
 } state_t;
 
+/*
+ *  FSM of the gclass compiled to dense tables, see fsm_compile().
+ *  States and events are interned pointers, indexed by the pointer
+ *  in open addressing hash tables (linear probing).
+ *  The action of an event in a state is state->actions[event index].
+ */
+typedef struct fsm_table_s {
+    size_t n_events;
+    size_t hash_mask;               // size of the hash tables - 1, power of 2
+    gobj_event_t *event_keys;       // NULL: free slot
+    size_t *event_idx;
+    state_t **states;               // NULL: free slot, key is states[i]->state_name
+} fsm_table_t;
+
 typedef struct event_s {
     DL_ITEM_FIELDS
 
@@ -64,16 +80,34 @@ typedef enum { // WARNING add new values to opt2json()
     obflag_created          = 0x0004,
 } obflag_t;
 
+/*
+ *  Typed slot of an attribute of a gclass with gcflag_native_attrs,
+ *  the slots are in the order of the attr's table (the index is the handle).
+ */
+typedef union attr_slot_u {
+    BOOL boolean;           // DTP_BOOLEAN
+    json_int_t integer;     // DTP_INTEGER
+    double real;            // DTP_REAL
+    char *string;           // DTP_STRING, own
+    void *pointer;          // DTP_POINTER
+    json_t *json;           // DTP_LIST, DTP_DICT, DTP_JSON, own
+} attr_slot_t;
+
 typedef struct gclass_s {
     DL_ITEM_FIELDS
 
     char *gclass_name;
     dl_list_t dl_states;            // FSM
     dl_list_t dl_events;            // FSM
+    fsm_table_t *fsm;               // FSM compiled, NULL if not compiled or changed
+    BOOL fsm_failed;                // compile failed (no memory), the lists are used until the FSM changes
     const GMETHODS *gmt;            // Global methods
     const LMETHOD *lmt;
 
     const sdata_desc_t *tattr_desc;
+    size_t n_attrs;                 // attributes in tattr_desc
+    size_t attrs_hash_mask;         // size of attrs_hash - 1, power of 2
+    int *attrs_hash;                // index by name of tattr_desc: index+1, 0 free slot
     size_t priv_size;
     const sdata_desc_t *authz_table; // acl
     /*
@@ -107,10 +141,15 @@ typedef struct gobj_s {
 
     json_t *dl_subscriptions; // external subscriptions to events of this gobj.
     json_t *dl_subscribings;  // subscriptions of this gobj to events of others gobj.
+    dl_list_t dl_subs_index;  // subscriptions of dl_subscriptions indexed by event, to publish
+    size_t subs_seq;          // order of the subscriptions
+    int publishing;           // nested gobj_publish_event() of this gobj
+    struct subscription_s *subs_deleted; // subscriptions deleted while publishing, to free
 
     // Data allocated
     char *gobj_name;
-    json_t *jn_attrs;
+    json_t *jn_attrs;       // with gcflag_native_attrs only to introspect, built on demand
+    attr_slot_t *attrs;     // native attributes, with gcflag_native_attrs
     json_t *jn_stats;
     json_t *jn_user_data;
     const char *full_name;
@@ -124,6 +163,11 @@ typedef struct gobj_s {
 
     uint32_t trace_level;
     uint32_t no_trace_level;
+    uint64_t trace_epoch;           // __trace_epoch__ of the cached levels, 0 none
+    uint32_t trace_level_cached;    // gobj_trace_level() of the epoch
+    uint32_t no_trace_level_cached; // gobj_trace_no_level() of the epoch
+
+    void *loop;             // loop of the thread that created it, NULL the main thread
 } gobj_t;
 
 /***************************************************************
@@ -156,7 +200,10 @@ GOBJ_DEFINE_EVENT(EV_DISCONNECT);
 GOBJ_DEFINE_EVENT(EV_DISCONNECTED);
 GOBJ_DEFINE_EVENT(EV_RX_DATA);
 GOBJ_DEFINE_EVENT(EV_TX_DATA);
+GOBJ_DEFINE_EVENT(EV_TX_FILE);
 GOBJ_DEFINE_EVENT(EV_TX_READY);
+GOBJ_DEFINE_EVENT(EV_TX_FULL);
+GOBJ_DEFINE_EVENT(EV_TX_RESUME);
 GOBJ_DEFINE_EVENT(EV_STOPPED);
 
 // Frequent states
@@ -178,6 +225,14 @@ PRIVATE void *_mem_malloc(size_t size);
 PRIVATE void _mem_free(void *p);
 PRIVATE void *_mem_realloc(void *p, size_t new_size);
 PRIVATE void *_mem_calloc(size_t n, size_t size);
+PRIVATE hgobj _gobj_create_gobj(
+    const char *gobj_name,
+    gclass_name_t gclass_name,
+    json_t *kw, // owned
+    hgobj parent,
+    gobj_flag_t gobj_flag
+);
+PRIVATE void _gobj_destroy(hgobj hgobj);
 PRIVATE int register_named_gobj(gobj_t *gobj);
 PRIVATE int deregister_named_gobj(gobj_t *gobj);
 PRIVATE int write_json_parameters(
@@ -215,8 +270,16 @@ PRIVATE int rc_walk_by_level(
 );
 
 PRIVATE json_t *sdata_create(gobj_t *gobj, const sdata_desc_t* schema);
+PRIVATE attr_slot_t *attr_slots_create(gobj_t *gobj);
+PRIVATE void attr_slots_free(gobj_t *gobj);
 PRIVATE int set_default(gobj_t *gobj, json_t *sdata, const sdata_desc_t *it);
-PRIVATE json_t *gobj_hsdata2(gobj_t *gobj, const char *name, BOOL verbose);
+PRIVATE int attrs_index_build(gclass_t *gclass);
+PRIVATE int attr_index(gclass_t *gclass, const char *name);
+PRIVATE json_t *sdata_default_value(gobj_t *gobj, const sdata_desc_t *it);
+PRIVATE void attr_slot_set(attr_slot_t *slot, const sdata_desc_t *it, json_t *jn_value);
+PRIVATE gobj_t *gobj_attr_owner(gobj_t *gobj, const char *name, int *idx);
+PRIVATE json_t *attr_json(gobj_t *gobj, int idx);
+PRIVATE void subs_index_free(gobj_t *publisher);
 PUBLIC void trace_vjson(
     hgobj gobj,
     json_t *jn_data,    // now owned
@@ -225,8 +288,13 @@ PUBLIC void trace_vjson(
     va_list ap
 );
 PRIVATE inline BOOL is_machine_tracing(gobj_t * gobj);
+PRIVATE inline void trace_cache_invalidate(void);
 PRIVATE inline BOOL is_machine_not_tracing(gobj_t * gobj);
 PRIVATE event_action_t *find_event_action(state_t *state, gobj_event_t event);
+PRIVATE fsm_table_t *fsm_compile(gclass_t *gclass);
+PRIVATE void fsm_free(gclass_t *gclass);
+PRIVATE state_t *fsm_find_state(gclass_t *gclass, gobj_state_t state_name);
+PRIVATE event_action_t *fsm_find_action(gclass_t *gclass, state_t *state, gobj_event_t event);
 PRIVATE int add_event_type(
     dl_list_t *dl,
     event_type_t *event_type_
@@ -296,6 +364,7 @@ PRIVATE const char *gclass_flag_names[] = {
     "gcflag_ignore_unknown_attrs",
     "gcflag_required_start_to_play",
     "gcflag_singleton",
+    "gcflag_native_attrs",
     0
 };
 
@@ -315,7 +384,7 @@ PRIVATE const char *gobj_flag_names[] = {
  */
 PRIVATE dl_list_t dl_global_event_types;
 
-PRIVATE int  __inside__ = 0;  // it's a counter
+PRIVATE __thread int  __inside__ = 0;  // it's a counter, of each loop's thread
 PRIVATE volatile int  __shutdowning__ = 0;
 PRIVATE volatile BOOL __yuno_must_die__ = FALSE;
 PRIVATE int  __exit_code__ = 0;
@@ -381,8 +450,25 @@ PRIVATE const trace_level_t s_global_trace_level[16] = {
 PRIVATE uint32_t __global_trace_level__ = 0;
 PRIVATE uint32_t __global_trace_no_level__ = 0;
 PRIVATE volatile uint32_t __deep_trace__ = 0;
+PRIVATE uint64_t __trace_epoch__ = 1; // Bumped by any change of levels, filters or attributes
 
 PRIVATE gobj_t * __yuno__ = 0;
+
+/*
+ *  Loops, see gobj_set_loop_hooks().
+ *  The runtime lock serializes the changes of the tree and the services registry.
+ */
+PRIVATE __thread void *__thread_loop__ = 0;
+PRIVATE gobj_post_event_fn_t __post_event_fn__ = 0;
+PRIVATE gobj_purge_events_fn_t __purge_events_fn__ = 0;
+#ifdef __linux__
+PRIVATE pthread_mutex_t __runtime_mutex__ = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+#define RUNTIME_LOCK()      pthread_mutex_lock(&__runtime_mutex__);
+#define RUNTIME_UNLOCK()    pthread_mutex_unlock(&__runtime_mutex__);
+#else
+#define RUNTIME_LOCK()
+#define RUNTIME_UNLOCK()
+#endif
 PRIVATE gobj_t * __default_service__ = 0;
 
 PRIVATE sys_malloc_fn_t sys_malloc_fn = _mem_malloc;
@@ -710,6 +796,16 @@ PUBLIC hgclass gclass_create(
      *----------------------------------------*/
     // TODO check fsm
 
+    /*----------------------------------------*
+     *          Compile FSM
+     *----------------------------------------*/
+    fsm_compile(gclass);
+
+    /*----------------------------------------*
+     *          Index of attributes
+     *----------------------------------------*/
+    attrs_index_build(gclass);
+
     return gclass;
 }
 
@@ -747,6 +843,8 @@ PUBLIC int gclass_add_state(
 
     state->state_name = state_name;
 
+    fsm_free(gclass);
+    gclass->fsm_failed = FALSE;
     dl_add(&gclass->dl_states, state);
 
     return 0;
@@ -782,6 +880,233 @@ PRIVATE event_action_t *find_event_action(state_t *state, gobj_event_t event)
     return NULL;
 }
 
+/***************************************************************************
+ *  Hash of interned pointers (states and events)
+ ***************************************************************************/
+PRIVATE inline size_t fsm_hash(const void *p, size_t mask)
+{
+    uint64_t h = (uint64_t)(uintptr_t)p;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return (size_t)h & mask;
+}
+
+/***************************************************************************
+ *  Hash of strings (FNV-1a)
+ ***************************************************************************/
+PRIVATE inline size_t string_hash(const char *s, size_t mask)
+{
+    uint32_t h = 2166136261U;
+    while(*s) {
+        h ^= (unsigned char)*s++;
+        h *= 16777619U;
+    }
+    return (size_t)h & mask;
+}
+
+/***************************************************************************
+ *  Compile the FSM of the gclass to dense tables:
+ *  a row of actions by event index in each state, and the hash tables
+ *  to get the index of an event and the state of a state name.
+ *  Return NULL on error (no memory), the lists are used then,
+ *  without compiling again until the FSM changes (one error logged).
+ ***************************************************************************/
+PRIVATE fsm_table_t *fsm_compile(gclass_t *gclass)
+{
+    fsm_free(gclass);
+
+    /*
+     *  Size of hash tables, less than half full
+     */
+    size_t n_states = dl_size(&gclass->dl_states);
+    size_t n_max = n_states;
+    state_t *state = dl_first(&gclass->dl_states);
+    while(state) {
+        size_t n = dl_size(&state->dl_actions);
+        n_max += n; // Upper limit of the different events
+        state = dl_next(state);
+    }
+    size_t hash_size = 4;
+    while(hash_size < 2*n_max) {
+        hash_size <<= 1;
+    }
+
+    fsm_table_t *fsm = sys_malloc_fn(sizeof(*fsm));
+    if(fsm) {
+        memset(fsm, 0, sizeof(*fsm));
+        fsm->hash_mask = hash_size - 1;
+        fsm->event_keys = sys_malloc_fn(hash_size * sizeof(gobj_event_t));
+        fsm->event_idx = sys_malloc_fn(hash_size * sizeof(size_t));
+        fsm->states = sys_malloc_fn(hash_size * sizeof(state_t *));
+    }
+    if(!fsm || !fsm->event_keys || !fsm->event_idx || !fsm->states) {
+        gobj_log_error(NULL, 0,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_MEMORY_ERROR,
+            "msg",          "%s", "No memory to compile fsm",
+            "gclass",       "%s", gclass->gclass_name,
+            "hash_size",    "%d", (int)hash_size,
+            NULL
+        );
+        gclass->fsm = fsm;
+        fsm_free(gclass);
+        gclass->fsm_failed = TRUE;
+        return NULL;
+    }
+    gclass->fsm = fsm;
+    memset(fsm->event_keys, 0, hash_size * sizeof(gobj_event_t));
+    memset(fsm->event_idx, 0, hash_size * sizeof(size_t));
+    memset(fsm->states, 0, hash_size * sizeof(state_t *));
+
+    /*
+     *  Index the states and the events
+     */
+    state = dl_first(&gclass->dl_states);
+    while(state) {
+        size_t h = fsm_hash(state->state_name, fsm->hash_mask);
+        while(fsm->states[h]) {
+            h = (h + 1) & fsm->hash_mask;
+        }
+        fsm->states[h] = state;
+
+        event_action_t *event_action = dl_first(&state->dl_actions);
+        while(event_action) {
+            h = fsm_hash(event_action->event, fsm->hash_mask);
+            while(fsm->event_keys[h] && fsm->event_keys[h] != event_action->event) {
+                h = (h + 1) & fsm->hash_mask;
+            }
+            if(!fsm->event_keys[h]) {
+                fsm->event_keys[h] = event_action->event;
+                fsm->event_idx[h] = fsm->n_events++;
+            }
+            event_action = dl_next(event_action);
+        }
+        state = dl_next(state);
+    }
+
+    /*
+     *  Action of each event in each state
+     */
+    state = dl_first(&gclass->dl_states);
+    while(state) {
+        if(fsm->n_events) {
+            state->actions = sys_malloc_fn(fsm->n_events * sizeof(event_action_t *));
+            if(!state->actions) {
+                gobj_log_error(NULL, 0,
+                    "function",     "%s", __FUNCTION__,
+                    "msgset",       "%s", MSGSET_MEMORY_ERROR,
+                    "msg",          "%s", "No memory to compile fsm",
+                    "gclass",       "%s", gclass->gclass_name,
+                    "state",        "%s", state->state_name,
+                    "n_events",     "%d", (int)fsm->n_events,
+                    NULL
+                );
+                fsm_free(gclass);
+                gclass->fsm_failed = TRUE;
+                return NULL;
+            }
+            memset(state->actions, 0, fsm->n_events * sizeof(event_action_t *));
+        }
+
+        event_action_t *event_action = dl_first(&state->dl_actions);
+        while(event_action) {
+            size_t h = fsm_hash(event_action->event, fsm->hash_mask);
+            while(fsm->event_keys[h] != event_action->event) {
+                h = (h + 1) & fsm->hash_mask;
+            }
+            state->actions[fsm->event_idx[h]] = event_action;
+            event_action = dl_next(event_action);
+        }
+        state = dl_next(state);
+    }
+
+    return fsm;
+}
+
+/***************************************************************************
+ *  Free the compiled FSM, it's rebuilt on demand
+ ***************************************************************************/
+PRIVATE void fsm_free(gclass_t *gclass)
+{
+    fsm_table_t *fsm = gclass->fsm;
+    if(!fsm) {
+        return;
+    }
+    gclass->fsm = NULL;
+
+    state_t *state = dl_first(&gclass->dl_states);
+    while(state) {
+        if(state->actions) {
+            sys_free_fn(state->actions);
+            state->actions = NULL;
+        }
+        state = dl_next(state);
+    }
+    if(fsm->event_keys) {
+        sys_free_fn(fsm->event_keys);
+    }
+    if(fsm->event_idx) {
+        sys_free_fn(fsm->event_idx);
+    }
+    if(fsm->states) {
+        sys_free_fn(fsm->states);
+    }
+    sys_free_fn(fsm);
+}
+
+/***************************************************************************
+ *  Find state by name with the compiled FSM, O(1)
+ ***************************************************************************/
+PRIVATE state_t *fsm_find_state(gclass_t *gclass, gobj_state_t state_name)
+{
+    fsm_table_t *fsm = gclass->fsm;
+    if(!fsm) {
+        if(!gclass->fsm_failed) {
+            fsm = fsm_compile(gclass);
+        }
+        if(!fsm) {
+            return find_state(gclass, state_name);
+        }
+    }
+
+    size_t h = fsm_hash(state_name, fsm->hash_mask);
+    state_t *state;
+    while((state = fsm->states[h])) {
+        if(state->state_name == state_name) {
+            return state;
+        }
+        h = (h + 1) & fsm->hash_mask;
+    }
+    return NULL;
+}
+
+/***************************************************************************
+ *  Find the action of the event in the state with the compiled FSM, O(1)
+ ***************************************************************************/
+PRIVATE event_action_t *fsm_find_action(gclass_t *gclass, state_t *state, gobj_event_t event)
+{
+    fsm_table_t *fsm = gclass->fsm;
+    if(!fsm) {
+        if(!gclass->fsm_failed) {
+            fsm = fsm_compile(gclass);
+        }
+        if(!fsm) {
+            return find_event_action(state, event);
+        }
+    }
+
+    size_t h = fsm_hash(event, fsm->hash_mask);
+    gobj_event_t key;
+    while((key = fsm->event_keys[h])) {
+        if(key == event) {
+            return state->actions[fsm->event_idx[h]];
+        }
+        h = (h + 1) & fsm->hash_mask;
+    }
+    return NULL;
+}
+
 /***************************************************************************
  *
  ***************************************************************************/
@@ -858,6 +1183,8 @@ PUBLIC int gclass_add_ev_action(
     event_action->action = action;
     event_action->next_state = next_state;
 
+    fsm_free(gclass);
+    gclass->fsm_failed = FALSE;
     dl_add(&state->dl_actions, event_action);
 
     return 0;
@@ -955,6 +1282,8 @@ PUBLIC void gclass_unregister(hgclass hgclass)
         return;
     }
 
+    fsm_free(gclass);
+
     state_t *state;
     while((state = dl_first(&gclass->dl_states))) {
         dl_delete(&gclass->dl_states, state, 0);
@@ -974,6 +1303,9 @@ PUBLIC void gclass_unregister(hgclass hgclass)
         sys_free_fn(event_type);
     }
 
+    if(gclass->attrs_hash) {
+        sys_free_fn(gclass->attrs_hash);
+    }
     sys_free_fn(gclass->gclass_name);
     sys_free_fn(gclass);
 }
@@ -1023,9 +1355,25 @@ PRIVATE int add_event_type(
 
 
 /***************************************************************************
- *
+ *  The tree and the services registry are shared by the loops
  ***************************************************************************/
 PUBLIC hgobj gobj_create_gobj(
+    const char *gobj_name,
+    gclass_name_t gclass_name,
+    json_t *kw, // owned
+    hgobj parent,
+    gobj_flag_t gobj_flag
+) {
+    RUNTIME_LOCK()
+    hgobj gobj = _gobj_create_gobj(gobj_name, gclass_name, kw, parent, gobj_flag);
+    RUNTIME_UNLOCK()
+    return gobj;
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PRIVATE hgobj _gobj_create_gobj(
     const char *gobj_name,
     gclass_name_t gclass_name,
     json_t *kw, // owned
@@ -1174,15 +1522,20 @@ PUBLIC hgobj gobj_create_gobj(
     /*--------------------------------*
      *      Initialize variables
      *--------------------------------*/
+    if(!gclass->fsm && !gclass->fsm_failed) {
+        fsm_compile(gclass); // Changed after gclass_create()
+    }
     gobj->gclass = gclass;
     gobj->parent = parent;
     dl_init(&gobj->dl_childs);
     gobj->dl_subscribings = json_array();
     gobj->dl_subscriptions = json_array();
+    dl_init(&gobj->dl_subs_index);
     gobj->current_state = dl_first(&gclass->dl_states);
     gobj->last_state = 0;
     gobj->obflag = 0;
     gobj->gobj_flag = gobj_flag;
+    gobj->loop = __thread_loop__;
 
     if(__trace_gobj_create_delete__(gobj)) {
          trace_machine("💙💙⏩ creating: %s^%s",
@@ -1195,13 +1548,20 @@ PUBLIC hgobj gobj_create_gobj(
      *      Alloc data
      *--------------------------*/
     gobj->gobj_name = gobj_strdup(gobj_name);
-    gobj->jn_attrs = sdata_create(gobj, gclass->tattr_desc);
+    if((gclass->gclass_flag & gcflag_native_attrs) && gclass->n_attrs) {
+        gobj->jn_attrs = json_object();
+        gobj->attrs = attr_slots_create(gobj);
+    } else {
+        gobj->jn_attrs = sdata_create(gobj, gclass->tattr_desc);
+        gobj->attrs = NULL;
+    }
     gobj->jn_stats = json_object();
     gobj->jn_user_data = json_object();
     gobj->priv = gclass->priv_size? sys_malloc_fn(gclass->priv_size):NULL;
 
     if(!gobj->gobj_name || !gobj->jn_user_data || !gobj->jn_stats ||
-            !gobj->jn_attrs || (gclass->priv_size && !gobj->priv)) {
+            !gobj->jn_attrs || (gclass->priv_size && !gobj->priv) ||
+            ((gclass->gclass_flag & gcflag_native_attrs) && gclass->n_attrs && !gobj->attrs)) {
         gobj_log_error(0, LOG_OPT_TRACE_STACK,
             "function",     "%s", __FUNCTION__,
             "msgset",       "%s", MSGSET_MEMORY_ERROR,
@@ -1294,10 +1654,20 @@ PUBLIC hgobj gobj_create_gobj(
     return (hgobj)gobj;
 }
 
+/***************************************************************************
+ *  The tree and the services registry are shared by the loops
+ ***************************************************************************/
+PUBLIC void gobj_destroy(hgobj gobj)
+{
+    RUNTIME_LOCK()
+    _gobj_destroy(gobj);
+    RUNTIME_UNLOCK()
+}
+
 /***************************************************************************
  *
  ***************************************************************************/
-PUBLIC void gobj_destroy(hgobj hgobj)
+PRIVATE void _gobj_destroy(hgobj hgobj)
 {
     if(hgobj == NULL) {
         gobj_log_error(NULL, LOG_OPT_TRACE_STACK,
@@ -1388,6 +1758,7 @@ PUBLIC void gobj_destroy(hgobj hgobj)
     gobj_unsubscribe_list(dl_subs, TRUE);
     dl_subs = json_copy(gobj->dl_subscribings);
     gobj_unsubscribe_list(dl_subs, TRUE);
+    subs_index_free(gobj);
 
     /*--------------------------------*
      *      Delete from parent
@@ -1427,6 +1798,7 @@ PUBLIC void gobj_destroy(hgobj hgobj)
      *      Dealloc data
      *--------------------------------*/
     EXEC_AND_RESET(sys_free_fn, gobj->gobj_name)
+    attr_slots_free(gobj);
     JSON_DECREF(gobj->jn_attrs)
     JSON_DECREF(gobj->jn_stats)
     JSON_DECREF(gobj->jn_user_data)
@@ -1440,6 +1812,13 @@ PUBLIC void gobj_destroy(hgobj hgobj)
     if(gobj->obflag & obflag_created) {
         gobj->gclass->instances--;
     }
+    if(__purge_events_fn__) {
+        __purge_events_fn__(gobj);
+    }
+    if(gobj->publishing) {
+        // Destroyed in his own publishing, freed by gobj_publish_event()
+        return;
+    }
     sys_free_fn(gobj);
 }
 
@@ -1650,9 +2029,23 @@ PRIVATE int write_json_parameters(
     json_t *kw,     // not own
     json_t *jn_global) // not own
 {
-    json_t *hs = gobj_hsdata(gobj);
-
-    json_object_update_existing(hs, kw);    // TODO review below code
+    trace_cache_invalidate();
+    if(gobj->attrs) {
+        /*
+         *  Native attributes, like json_object_update_existing()
+         */
+        const char *key;
+        json_t *jn_value;
+        json_object_foreach(kw, key, jn_value) {
+            int idx = attr_index(gobj->gclass, key);
+            if(idx >= 0) {
+                attr_slot_set(&gobj->attrs[idx], &gobj->gclass->tattr_desc[idx], jn_value);
+            }
+        }
+    } else {
+        json_t *hs = gobj_hsdata(gobj);
+        json_object_update_existing(hs, kw);    // TODO review below code
+    }
 
 //    json_t *jn_global_mine = extract_all_mine(
 //        gobj->gclass->gclass_name,
@@ -1820,6 +2213,7 @@ PRIVATE int sdata_write_default_values(
     sdata_flag_t exclude_flag
 )
 {
+    trace_cache_invalidate();
     const sdata_desc_t *it = gobj->gclass->tattr_desc;
     while(it->name) {
         if(exclude_flag && (it->flag & exclude_flag)) {
@@ -1827,7 +2221,13 @@ PRIVATE int sdata_write_default_values(
             continue;
         }
         if(include_flag == (sdata_flag_t)-1 || (it->flag & include_flag)) {
-            set_default(gobj, gobj->jn_attrs, it);
+            if(gobj->attrs) {
+                json_t *jn_value = sdata_default_value(gobj, it);
+                attr_slot_set(&gobj->attrs[it - gobj->gclass->tattr_desc], it, jn_value);
+                json_decref(jn_value);
+            } else {
+                set_default(gobj, gobj->jn_attrs, it);
+            }
         }
         it++;
     }
@@ -1851,9 +2251,9 @@ PRIVATE json_t *sdata_create(gobj_t *gobj, const sdata_desc_t* schema)
 }
 
 /***************************************************************************
- *  Set array values to sdata, from json or binary
+ *  Return the default value of the attribute, yours
  ***************************************************************************/
-PRIVATE int set_default(gobj_t *gobj, json_t *sdata, const sdata_desc_t *it)
+PRIVATE json_t *sdata_default_value(gobj_t *gobj, const sdata_desc_t *it)
 {
     json_t *jn_value = 0;
     const char *svalue = it->default_value;
@@ -1917,6 +2317,16 @@ PRIVATE int set_default(gobj_t *gobj, json_t *sdata, const sdata_desc_t *it)
         jn_value = json_null();
     }
 
+    return jn_value;
+}
+
+/***************************************************************************
+ *  Set array values to sdata, from json or binary
+ ***************************************************************************/
+PRIVATE int set_default(gobj_t *gobj, json_t *sdata, const sdata_desc_t *it)
+{
+    json_t *jn_value = sdata_default_value(gobj, it);
+
     if(json_object_set_new(sdata, it->name, jn_value)<0) {
         gobj_log_error(gobj, LOG_OPT_TRACE_STACK,
             "function",     "%s", __FUNCTION__,
@@ -1931,64 +2341,442 @@ PRIVATE int set_default(gobj_t *gobj, json_t *sdata, const sdata_desc_t *it)
 }
 
 /***************************************************************************
- *  Set array values to sdata, from json or binary
+ *  Index of the attributes of the gclass by name
  ***************************************************************************/
-PRIVATE int json2item(
-    gobj_t *gobj,
-    json_t *sdata,
-    const sdata_desc_t *it,
-    json_t *jn_value // now owned
-)
+PRIVATE int attrs_index_build(gclass_t *gclass)
 {
-    if(!it) {
+    size_t n_attrs = 0;
+    const sdata_desc_t *it = gclass->tattr_desc;
+    while(it && it->name) {
+        n_attrs++;
+        it++;
+    }
+    gclass->n_attrs = n_attrs;
+    if(!n_attrs) {
+        return 0;
+    }
+
+    size_t buckets = 8;
+    while(buckets < 2*n_attrs) {
+        buckets *= 2;
+    }
+    int *attrs_hash = sys_malloc_fn(buckets * sizeof(int));
+    if(!attrs_hash) {
+        gobj_log_error(0, 0,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_MEMORY_ERROR,
+            "msg",          "%s", "No memory",
+            "gclass",       "%s", gclass->gclass_name,
+            "buckets",      "%d", (int)buckets,
+            NULL
+        );
+        return -1; // The attributes are searched in the table
+    }
+    memset(attrs_hash, 0, buckets * sizeof(int));
+
+    size_t mask = buckets - 1;
+    for(size_t i=0; i<n_attrs; i++) {
+        size_t h = string_hash(gclass->tattr_desc[i].name, mask);
+        while(attrs_hash[h]) {
+            h = (h + 1) & mask;
+        }
+        attrs_hash[h] = (int)i + 1;
+    }
+    gclass->attrs_hash = attrs_hash;
+    gclass->attrs_hash_mask = mask;
+    return 0;
+}
+
+/***************************************************************************
+ *  Return the index of the attribute in tattr_desc, -1 if not found
+ ***************************************************************************/
+PRIVATE int attr_index(gclass_t *gclass, const char *name)
+{
+    if(gclass->attrs_hash) {
+        size_t mask = gclass->attrs_hash_mask;
+        size_t h = string_hash(name, mask);
+        int idx;
+        while((idx = gclass->attrs_hash[h])) {
+            if(strcmp(gclass->tattr_desc[idx-1].name, name)==0) {
+                return idx - 1;
+            }
+            h = (h + 1) & mask;
+        }
         return -1;
     }
+
+    const sdata_desc_t *it = gclass->tattr_desc;
+    while(it && it->name) {
+        if(strcmp(it->name, name)==0) {
+            return (int)(it - gclass->tattr_desc);
+        }
+        it++;
+    }
+    return -1;
+}
+
+/***************************************************************************
+ *  Native attributes: set the slot from json, converted to the type of the attribute
+ ***************************************************************************/
+PRIVATE void attr_slot_set(attr_slot_t *slot, const sdata_desc_t *it, json_t *jn_value)
+{
     switch(it->type) {
         case DTP_STRING:
-            if(!json_is_string(jn_value)) {
-                gobj_log_error(gobj, LOG_OPT_TRACE_STACK,
-                    "function",     "%s", __FUNCTION__,
-                    "msgset",       "%s", MSGSET_PARAMETER_ERROR,
-                    "msg",          "%s", "attr must be a string",
-                    "attr",         "%s", it->name,
-                    NULL
-                );
-                return -1;
+            {
+                char *string = json_is_string(jn_value)?
+                    gobj_strdup(json_string_value(jn_value)) : NULL;
+                if(slot->string) {
+                    sys_free_fn(slot->string);
+                }
+                slot->string = string;
             }
             break;
         case DTP_BOOLEAN:
-            if(!json_is_boolean(jn_value)) {
-                gobj_log_error(gobj, LOG_OPT_TRACE_STACK,
-                    "function",     "%s", __FUNCTION__,
-                    "msgset",       "%s", MSGSET_PARAMETER_ERROR,
-                    "msg",          "%s", "attr must be an boolean",
-                    "attr",         "%s", it->name,
-                    NULL
-                );
-                return -1;
-            }
+            slot->boolean = jn2bool(jn_value);
             break;
         case DTP_INTEGER:
-            if(!json_is_integer(jn_value)) {
-                gobj_log_error(gobj, LOG_OPT_TRACE_STACK,
-                    "function",     "%s", __FUNCTION__,
-                    "msgset",       "%s", MSGSET_PARAMETER_ERROR,
-                    "msg",          "%s", "attr must be an integer",
-                    "attr",         "%s", it->name,
-                    NULL
-                );
-                return -1;
-            }
+            slot->integer = jn2integer(jn_value);
             break;
         case DTP_REAL:
-            if(!json_is_real(jn_value)) {
-                gobj_log_error(gobj, LOG_OPT_TRACE_STACK,
-                    "function",     "%s", __FUNCTION__,
-                    "msgset",       "%s", MSGSET_PARAMETER_ERROR,
-                    "msg",          "%s", "attr must be a real",
-                    "attr",         "%s", it->name,
-                    NULL
-                );
+            slot->real = jn2real(jn_value);
+            break;
+        case DTP_POINTER:
+            slot->pointer = (void *)(size_t)json_integer_value(jn_value);
+            break;
+        case DTP_LIST:
+        case DTP_DICT:
+        case DTP_JSON:
+            {
+                json_t *old = slot->json;
+                slot->json = json_incref(jn_value);
+                json_decref(old); // json_true/false/null are not refcounted
+            }
+            break;
+    }
+}
+
+/***************************************************************************
+ *  Native attributes: return the json of the slot, yours
+ ***************************************************************************/
+PRIVATE json_t *attr_slot_json(attr_slot_t *slot, const sdata_desc_t *it)
+{
+    json_t *jn_value = 0;
+    switch(it->type) {
+        case DTP_STRING:
+            jn_value = slot->string? json_string(slot->string) : 0;
+            break;
+        case DTP_BOOLEAN:
+            jn_value = json_boolean(slot->boolean);
+            break;
+        case DTP_INTEGER:
+            jn_value = json_integer(slot->integer);
+            break;
+        case DTP_REAL:
+            jn_value = json_real(slot->real);
+            break;
+        case DTP_POINTER:
+            jn_value = json_integer((json_int_t)(size_t)slot->pointer);
+            break;
+        case DTP_LIST:
+        case DTP_DICT:
+        case DTP_JSON:
+            jn_value = json_incref(slot->json);
+            break;
+    }
+    return jn_value? jn_value : json_null();
+}
+
+/***************************************************************************
+ *  Native attributes: is the json built of the slot still its value?
+ ***************************************************************************/
+PRIVATE BOOL attr_slot_json_is_current(attr_slot_t *slot, const sdata_desc_t *it, json_t *jn_value)
+{
+    if(!jn_value) {
+        return FALSE;
+    }
+    switch(it->type) {
+        case DTP_STRING:
+            if(!slot->string) {
+                return json_is_null(jn_value);
+            }
+            return json_is_string(jn_value) && strcmp(json_string_value(jn_value), slot->string)==0;
+        case DTP_BOOLEAN:
+            return json_is_boolean(jn_value) && json_is_true(jn_value) == (slot->boolean? 1:0);
+        case DTP_INTEGER:
+            return json_is_integer(jn_value) && json_integer_value(jn_value) == slot->integer;
+        case DTP_REAL:
+            if(json_is_real(jn_value)) {
+                double real = json_real_value(jn_value);
+                return memcmp(&real, &slot->real, sizeof(double))==0; // bitwise, NaN too
+            }
+            return FALSE;
+        case DTP_POINTER:
+            return json_is_integer(jn_value) &&
+                json_integer_value(jn_value) == (json_int_t)(size_t)slot->pointer;
+        default:
+            return FALSE;
+    }
+}
+
+/***************************************************************************
+ *  Native attributes: build the slots with the default values
+ ***************************************************************************/
+PRIVATE attr_slot_t *attr_slots_create(gobj_t *gobj)
+{
+    gclass_t *gclass = gobj->gclass;
+    attr_slot_t *attrs = sys_malloc_fn(gclass->n_attrs * sizeof(attr_slot_t));
+    if(!attrs) {
+        return NULL;
+    }
+    memset(attrs, 0, gclass->n_attrs * sizeof(attr_slot_t));
+
+    for(size_t i=0; i<gclass->n_attrs; i++) {
+        const sdata_desc_t *it = &gclass->tattr_desc[i];
+        json_t *jn_value = sdata_default_value(gobj, it);
+        attr_slot_set(&attrs[i], it, jn_value);
+        json_decref(jn_value);
+    }
+    return attrs;
+}
+
+/***************************************************************************
+ *  Native attributes: free the slots
+ ***************************************************************************/
+PRIVATE void attr_slots_free(gobj_t *gobj)
+{
+    if(!gobj->attrs) {
+        return;
+    }
+    gclass_t *gclass = gobj->gclass;
+    for(size_t i=0; i<gclass->n_attrs; i++) {
+        switch(gclass->tattr_desc[i].type) {
+            case DTP_STRING:
+                if(gobj->attrs[i].string) {
+                    sys_free_fn(gobj->attrs[i].string);
+                }
+                break;
+            case DTP_LIST:
+            case DTP_DICT:
+            case DTP_JSON:
+                json_decref(gobj->attrs[i].json);
+                break;
+            default:
+                break;
+        }
+    }
+    EXEC_AND_RESET(sys_free_fn, gobj->attrs)
+}
+
+/***************************************************************************
+ *  Return the json of the attribute, NOT yours.
+ *  The json of a native attribute is built in jn_attrs, to introspect,
+ *  and rebuilt only when the slot has changed: it's valid until the next write.
+ *  The native json attributes (list, dict, json) are returned as is.
+ ***************************************************************************/
+PRIVATE json_t *attr_json(gobj_t *gobj, int idx)
+{
+    const sdata_desc_t *it = &gobj->gclass->tattr_desc[idx];
+    if(!gobj->attrs) {
+        return json_object_get(gobj->jn_attrs, it->name);
+    }
+    switch(it->type) {
+        case DTP_LIST:
+        case DTP_DICT:
+        case DTP_JSON:
+            return gobj->attrs[idx].json;
+        default:
+            {
+                json_t *jn_value = json_object_get(gobj->jn_attrs, it->name);
+                if(attr_slot_json_is_current(&gobj->attrs[idx], it, jn_value)) {
+                    return jn_value;
+                }
+                json_object_set_new(gobj->jn_attrs, it->name, attr_slot_json(&gobj->attrs[idx], it));
+                return json_object_get(gobj->jn_attrs, it->name);
+            }
+    }
+}
+
+/***************************************************************************
+ *  The trace filters match string values, only writes that can change
+ *  a string value invalidate the cached trace levels.
+ ***************************************************************************/
+PRIVATE inline BOOL attr_can_match_trace_filter(const sdata_desc_t *it, json_t *jn_value)
+{
+    return it->type == DTP_STRING || it->type == DTP_JSON || json_is_string(jn_value);
+}
+
+/***************************************************************************
+ *  Native attributes: set the slot from json, the json of the attr if not native
+ ***************************************************************************/
+PRIVATE int attr_write_json(gobj_t *gobj, int idx, json_t *jn_value) // owned
+{
+    const sdata_desc_t *it = &gobj->gclass->tattr_desc[idx];
+    if(attr_can_match_trace_filter(it, jn_value)) {
+        trace_cache_invalidate();
+    }
+    if(gobj->attrs) {
+        attr_slot_set(&gobj->attrs[idx], it, jn_value);
+        json_decref(jn_value);
+        return 0;
+    }
+    return json_object_set_new(gobj->jn_attrs, it->name, jn_value);
+}
+
+/***************************************************************************
+ *  Typed read/write of the attribute `idx` of gobj, native slots if it has them
+ ***************************************************************************/
+PRIVATE inline const char *attr_read_str(gobj_t *gobj, int idx)
+{
+    if(gobj->attrs && gobj->gclass->tattr_desc[idx].type == DTP_STRING) {
+        return gobj->attrs[idx].string;
+    }
+    return json_string_value(attr_json(gobj, idx));
+}
+
+PRIVATE inline BOOL attr_read_bool(gobj_t *gobj, int idx)
+{
+    if(gobj->attrs && gobj->gclass->tattr_desc[idx].type == DTP_BOOLEAN) {
+        return gobj->attrs[idx].boolean;
+    }
+    return json_boolean_value(attr_json(gobj, idx));
+}
+
+PRIVATE inline json_int_t attr_read_integer(gobj_t *gobj, int idx)
+{
+    if(gobj->attrs && gobj->gclass->tattr_desc[idx].type == DTP_INTEGER) {
+        return gobj->attrs[idx].integer;
+    }
+    return json_integer_value(attr_json(gobj, idx));
+}
+
+PRIVATE inline double attr_read_real(gobj_t *gobj, int idx)
+{
+    if(gobj->attrs && gobj->gclass->tattr_desc[idx].type == DTP_REAL) {
+        return gobj->attrs[idx].real;
+    }
+    return json_real_value(attr_json(gobj, idx));
+}
+
+PRIVATE inline void *attr_read_pointer(gobj_t *gobj, int idx)
+{
+    if(gobj->attrs && gobj->gclass->tattr_desc[idx].type == DTP_POINTER) {
+        return gobj->attrs[idx].pointer;
+    }
+    return (void *)(size_t)json_integer_value(attr_json(gobj, idx));
+}
+
+PRIVATE inline int attr_write_str(gobj_t *gobj, int idx, const char *value)
+{
+    if(gobj->attrs && gobj->gclass->tattr_desc[idx].type == DTP_STRING) {
+        char *string = gobj_strdup(value);
+        if(gobj->attrs[idx].string) {
+            sys_free_fn(gobj->attrs[idx].string);
+        }
+        gobj->attrs[idx].string = string;
+        trace_cache_invalidate();
+        return 0;
+    }
+    json_t *jn_value = json_string(value);
+    if(!jn_value) {
+        return -1;
+    }
+    return attr_write_json(gobj, idx, jn_value);
+}
+
+PRIVATE inline int attr_write_bool(gobj_t *gobj, int idx, BOOL value)
+{
+    if(gobj->attrs && gobj->gclass->tattr_desc[idx].type == DTP_BOOLEAN) {
+        gobj->attrs[idx].boolean = value? TRUE : FALSE;
+        return 0;
+    }
+    return attr_write_json(gobj, idx, json_boolean(value));
+}
+
+PRIVATE inline int attr_write_integer(gobj_t *gobj, int idx, json_int_t value)
+{
+    if(gobj->attrs && gobj->gclass->tattr_desc[idx].type == DTP_INTEGER) {
+        gobj->attrs[idx].integer = value;
+        return 0;
+    }
+    return attr_write_json(gobj, idx, json_integer(value));
+}
+
+PRIVATE inline int attr_write_real(gobj_t *gobj, int idx, double value)
+{
+    if(gobj->attrs && gobj->gclass->tattr_desc[idx].type == DTP_REAL) {
+        gobj->attrs[idx].real = value;
+        return 0;
+    }
+    return attr_write_json(gobj, idx, json_real(value));
+}
+
+PRIVATE inline int attr_write_pointer(gobj_t *gobj, int idx, void *value)
+{
+    if(gobj->attrs && gobj->gclass->tattr_desc[idx].type == DTP_POINTER) {
+        gobj->attrs[idx].pointer = value;
+        return 0;
+    }
+    return attr_write_json(gobj, idx, json_integer((json_int_t)(size_t)value));
+}
+
+/***************************************************************************
+ *  Set array values to sdata, from json or binary
+ ***************************************************************************/
+PRIVATE int json2item(
+    gobj_t *gobj,
+    const sdata_desc_t *it,
+    json_t *jn_value // now owned
+)
+{
+    if(!it) {
+        return -1;
+    }
+    switch(it->type) {
+        case DTP_STRING:
+            if(!json_is_string(jn_value)) {
+                gobj_log_error(gobj, LOG_OPT_TRACE_STACK,
+                    "function",     "%s", __FUNCTION__,
+                    "msgset",       "%s", MSGSET_PARAMETER_ERROR,
+                    "msg",          "%s", "attr must be a string",
+                    "attr",         "%s", it->name,
+                    NULL
+                );
+                return -1;
+            }
+            break;
+        case DTP_BOOLEAN:
+            if(!json_is_boolean(jn_value)) {
+                gobj_log_error(gobj, LOG_OPT_TRACE_STACK,
+                    "function",     "%s", __FUNCTION__,
+                    "msgset",       "%s", MSGSET_PARAMETER_ERROR,
+                    "msg",          "%s", "attr must be an boolean",
+                    "attr",         "%s", it->name,
+                    NULL
+                );
+                return -1;
+            }
+            break;
+        case DTP_INTEGER:
+            if(!json_is_integer(jn_value)) {
+                gobj_log_error(gobj, LOG_OPT_TRACE_STACK,
+                    "function",     "%s", __FUNCTION__,
+                    "msgset",       "%s", MSGSET_PARAMETER_ERROR,
+                    "msg",          "%s", "attr must be an integer",
+                    "attr",         "%s", it->name,
+                    NULL
+                );
+                return -1;
+            }
+            break;
+        case DTP_REAL:
+            if(!json_is_real(jn_value)) {
+                gobj_log_error(gobj, LOG_OPT_TRACE_STACK,
+                    "function",     "%s", __FUNCTION__,
+                    "msgset",       "%s", MSGSET_PARAMETER_ERROR,
+                    "msg",          "%s", "attr must be a real",
+                    "attr",         "%s", it->name,
+                    NULL
+                );
                 return -1;
             }
             break;
@@ -2032,7 +2820,14 @@ PRIVATE int json2item(
             break;
     }
 
-    if(json_object_set(sdata, it->name, jn_value)<0) {
+    if(attr_can_match_trace_filter(it, jn_value)) {
+        trace_cache_invalidate();
+    }
+    if(gobj->attrs) {
+        attr_slot_set(&gobj->attrs[it - gobj->gclass->tattr_desc], it, jn_value);
+        return 0;
+    }
+    if(json_object_set(gobj->jn_attrs, it->name, jn_value)<0) {
         gobj_log_error(gobj, LOG_OPT_TRACE_STACK,
             "function",     "%s", __FUNCTION__,
             "msgset",       "%s", MSGSET_JSON_ERROR,
@@ -2051,6 +2846,27 @@ PRIVATE int json2item(
 PUBLIC json_t *gobj_hsdata(hgobj gobj_) // Return is NOT YOURS
 {
     gobj_t *gobj = gobj_;
+    if(gobj && gobj->attrs) {
+        /*
+         *  Native attributes: build the json, to introspect,
+         *  keeping the json already returned of the unchanged slots.
+         */
+        for(size_t i=0; i<gobj->gclass->n_attrs; i++) {
+            const sdata_desc_t *it = &gobj->gclass->tattr_desc[i];
+            switch(it->type) {
+                case DTP_LIST:
+                case DTP_DICT:
+                case DTP_JSON:
+                    if(json_object_get(gobj->jn_attrs, it->name) != gobj->attrs[i].json) {
+                        json_object_set_new(gobj->jn_attrs, it->name, attr_slot_json(&gobj->attrs[i], it));
+                    }
+                    break;
+                default:
+                    attr_json(gobj, (int)i);
+                    break;
+            }
+        }
+    }
     return gobj?gobj->jn_attrs:NULL;
 }
 
@@ -2077,12 +2893,9 @@ PUBLIC const sdata_desc_t *gclass_attr_desc(hgclass gclass_, const char *name, B
     if(!name) {
         return gclass->tattr_desc;
     }
-    const sdata_desc_t *it = gclass->tattr_desc;
-    while(it->name) {
-        if(strcmp(it->name, name)==0) {
-            return it;
-        }
-        it++;
+    int idx = attr_index(gclass, name);
+    if(idx >= 0) {
+        return &gclass->tattr_desc[idx];
     }
 
     if(verbose) {
@@ -2240,7 +3053,6 @@ PUBLIC json_t *gobj_read_attr(
             NULL
         );
     }
-    json_t *hs = gobj_hsdata(gobj);
 
 //    if(gobj->gclass->gmt->mt_reading) { TODO como hago el reading de todo el record???
 //        if(!(gobj->obflag & obflag_destroyed)) {
@@ -2248,7 +3060,8 @@ PUBLIC json_t *gobj_read_attr(
 //        }
 //    }
 
-    return json_object_get(hs, path);
+    int idx = gobj && !empty_string(path)? attr_index(gobj->gclass, path) : -1;
+    return idx >= 0? attr_json(gobj, idx) : NULL;
 }
 
 /***************************************************************************
@@ -2266,7 +3079,7 @@ PUBLIC json_t *gobj_read_attrs( // Return is yours!
     const sdata_desc_t *it = gobj->gclass->tattr_desc;
     while(it->name) {
         if(include_flag == (sdata_flag_t)-1 || (it->flag & include_flag)) {
-            json_t *jn = json_object_get(gobj->jn_attrs, it->name);
+            json_t *jn = attr_json(gobj, (int)(it - gobj->gclass->tattr_desc));
             json_object_set(jn_attrs, it->name, jn);
         }
         it++;
@@ -2320,9 +3133,8 @@ PUBLIC int gobj_write_attr(
             NULL
         );
     }
-    json_t *hs = gobj_hsdata(gobj);
     const sdata_desc_t *it = gobj_attr_desc(gobj, path, TRUE);
-    int ret = json2item(gobj, hs, it, jn_value);
+    int ret = json2item(gobj, it, jn_value);
 
     JSON_DECREF(jn_value);
     return ret;
@@ -2337,8 +3149,6 @@ PUBLIC int gobj_write_attrs(
     sdata_flag_t flag,
     hgobj src
 ) {
-    json_t *hs = gobj_hsdata(gobj);
-
     int ret = 0;
     const char *attr;
     json_t *jn_value;
@@ -2350,7 +3160,7 @@ PUBLIC int gobj_write_attrs(
         if(!(flag == (sdata_flag_t)-1 || (it->flag & flag))) {
             continue;
         }
-        ret += json2item(gobj, hs, it, jn_value);
+        ret += json2item(gobj, it, jn_value);
     }
 
     JSON_DECREF(kw);
@@ -2379,26 +3189,22 @@ PUBLIC int gobj_write_user_data(
 }
 
 /***************************************************************************
- *  ATTR: Get hsdata of inherited attribute.
+ *  ATTR: Get the gobj with the inherited attribute, and the index of the attribute.
  ***************************************************************************/
-PRIVATE json_t *gobj_hsdata2(gobj_t *gobj, const char *name, BOOL verbose)
+PRIVATE gobj_t *gobj_attr_owner(gobj_t *gobj, const char *name, int *idx)
 {
-    if(gobj_has_attr(gobj, name)) {
-        return gobj_hsdata(gobj);
-    } else if(gobj && gobj->bottom_gobj) {
-        return gobj_hsdata2(gobj->bottom_gobj, name, verbose);
+    if(empty_string(name)) {
+        return NULL;
     }
-    if(verbose) {
-        gobj_log_warning(gobj, LOG_OPT_TRACE_STACK,
-            "function",     "%s", __FUNCTION__,
-            "msgset",       "%s", MSGSET_PARAMETER_ERROR,
-            "msg",          "%s", "GClass Attribute NOT FOUND",
-            "gclass",       "%s", gobj_gclass_name(gobj),
-            "attr",         "%s", name,
-            NULL
-        );
+    while(gobj) {
+        int i = attr_index(gobj->gclass, name);
+        if(i >= 0) {
+            *idx = i;
+            return gobj;
+        }
+        gobj = gobj->bottom_gobj;
     }
-    return 0;
+    return NULL;
 }
 
 /***************************************************************************
@@ -2408,15 +3214,15 @@ PUBLIC const char *gobj_read_str_attr(hgobj gobj_, const char *name)
 {
     gobj_t *gobj = gobj_;
 
-    json_t *hs = gobj_hsdata2(gobj, name, FALSE);
-    if(hs) {
+    int idx;
+    gobj_t *owner = gobj_attr_owner(gobj, name, &idx);
+    if(owner) {
         if(gobj->gclass->gmt->mt_reading) {
             if(!(gobj->obflag & obflag_destroyed)) {
                 gobj->gclass->gmt->mt_reading(gobj, name);
             }
         }
-        const json_t *jn_value = json_object_get(hs, name);
-        return json_string_value(jn_value);
+        return attr_read_str(owner, idx);
     }
 
     gobj_log_warning(gobj, LOG_OPT_TRACE_STACK,
@@ -2437,15 +3243,15 @@ PUBLIC BOOL gobj_read_bool_attr(hgobj gobj_, const char *name)
 {
     gobj_t *gobj = gobj_;
 
-    json_t *hs = gobj_hsdata2(gobj, name, FALSE);
-    if(hs) {
+    int idx;
+    gobj_t *owner = gobj_attr_owner(gobj, name, &idx);
+    if(owner) {
         if(gobj->gclass->gmt->mt_reading) {
             if(!(gobj->obflag & obflag_destroyed)) {
                 gobj->gclass->gmt->mt_reading(gobj, name);
             }
         }
-        const json_t *jn_value = json_object_get(hs, name);
-        return json_boolean_value(jn_value);
+        return attr_read_bool(owner, idx);
     }
 
     gobj_log_warning(gobj, LOG_OPT_TRACE_STACK,
@@ -2466,15 +3272,15 @@ PUBLIC json_int_t gobj_read_integer_attr(hgobj gobj_, const char *name)
 {
     gobj_t *gobj = gobj_;
 
-    json_t *hs = gobj_hsdata2(gobj, name, FALSE);
-    if(hs) {
+    int idx;
+    gobj_t *owner = gobj_attr_owner(gobj, name, &idx);
+    if(owner) {
         if(gobj->gclass->gmt->mt_reading) {
             if(!(gobj->obflag & obflag_destroyed)) {
                 gobj->gclass->gmt->mt_reading(gobj, name);
             }
         }
-        const json_t *jn_value = json_object_get(hs, name);
-        return json_integer_value(jn_value);
+        return attr_read_integer(owner, idx);
     }
 
     gobj_log_warning(gobj, LOG_OPT_TRACE_STACK,
@@ -2495,15 +3301,15 @@ PUBLIC double gobj_read_real_attr(hgobj gobj_, const char *name)
 {
     gobj_t *gobj = gobj_;
 
-    json_t *hs = gobj_hsdata2(gobj, name, FALSE);
-    if(hs) {
+    int idx;
+    gobj_t *owner = gobj_attr_owner(gobj, name, &idx);
+    if(owner) {
         if(gobj->gclass->gmt->mt_reading) {
             if(!(gobj->obflag & obflag_destroyed)) {
                 gobj->gclass->gmt->mt_reading(gobj, name);
             }
         }
-        const json_t *jn_value = json_object_get(hs, name);
-        return json_real_value(jn_value);
+        return attr_read_real(owner, idx);
     }
 
     gobj_log_warning(gobj, LOG_OPT_TRACE_STACK,
@@ -2524,15 +3330,15 @@ PUBLIC json_t *gobj_read_json_attr(hgobj gobj_, const char *name) // WARNING ret
 {
     gobj_t *gobj = gobj_;
 
-    json_t *hs = gobj_hsdata2(gobj, name, FALSE);
-    if(hs) {
+    int idx;
+    gobj_t *owner = gobj_attr_owner(gobj, name, &idx);
+    if(owner) {
         if(gobj->gclass->gmt->mt_reading) {
             if(!(gobj->obflag & obflag_destroyed)) {
                 gobj->gclass->gmt->mt_reading(gobj, name);
             }
         }
-        json_t *jn_value = json_object_get(hs, name);
-        return jn_value;
+        return attr_json(owner, idx);
     }
 
     gobj_log_warning(gobj, LOG_OPT_TRACE_STACK,
@@ -2553,15 +3359,15 @@ PUBLIC void *gobj_read_pointer_attr(hgobj gobj_, const char *name)
 {
     gobj_t *gobj = gobj_;
 
-    json_t *hs = gobj_hsdata2(gobj, name, FALSE);
-    if(hs) {
+    int idx;
+    gobj_t *owner = gobj_attr_owner(gobj, name, &idx);
+    if(owner) {
         if(gobj->gclass->gmt->mt_reading) {
             if(!(gobj->obflag & obflag_destroyed)) {
                 gobj->gclass->gmt->mt_reading(gobj, name);
             }
         }
-        const json_t *jn_value = json_object_get(hs, name);
-        return (void *)(size_t)json_integer_value(jn_value);
+        return attr_read_pointer(owner, idx);
     }
 
     gobj_log_warning(gobj, LOG_OPT_TRACE_STACK,
@@ -2582,9 +3388,10 @@ PUBLIC int gobj_write_str_attr(hgobj gobj_, const char *name, const char *value)
 {
     gobj_t *gobj = gobj_;
 
-    json_t *hs = gobj_hsdata2(gobj, name, FALSE);
-    if(hs) {
-        int ret = json_object_set_new(hs, name, json_string(value));
+    int idx;
+    gobj_t *owner = gobj_attr_owner(gobj, name, &idx);
+    if(owner) {
+        int ret = attr_write_str(owner, idx, value);
         if(gobj->gclass->gmt->mt_writing) {
             if((gobj->obflag & obflag_created) && !(gobj->obflag & obflag_destroyed)) {
                 // Avoid call to mt_writing before mt_create!
@@ -2612,9 +3419,10 @@ PUBLIC int gobj_write_bool_attr(hgobj gobj_, const char *name, BOOL value)
 {
     gobj_t *gobj = gobj_;
 
-    json_t *hs = gobj_hsdata2(gobj, name, FALSE);
-    if(hs) {
-        int ret = json_object_set_new(hs, name, json_boolean(value));
+    int idx;
+    gobj_t *owner = gobj_attr_owner(gobj, name, &idx);
+    if(owner) {
+        int ret = attr_write_bool(owner, idx, value);
         if(gobj->gclass->gmt->mt_writing) {
             if((gobj->obflag & obflag_created) && !(gobj->obflag & obflag_destroyed)) {
                 // Avoid call to mt_writing before mt_create!
@@ -2642,9 +3450,10 @@ PUBLIC int gobj_write_integer_attr(hgobj gobj_, const char *name, json_int_t val
 {
     gobj_t *gobj = gobj_;
 
-    json_t *hs = gobj_hsdata2(gobj, name, FALSE);
-    if(hs) {
-        int ret = json_object_set_new(hs, name, json_integer(value));
+    int idx;
+    gobj_t *owner = gobj_attr_owner(gobj, name, &idx);
+    if(owner) {
+        int ret = attr_write_integer(owner, idx, value);
         if(gobj->gclass->gmt->mt_writing) {
             if((gobj->obflag & obflag_created) && !(gobj->obflag & obflag_destroyed)) {
                 // Avoid call to mt_writing before mt_create!
@@ -2672,9 +3481,10 @@ PUBLIC int gobj_write_real_attr(hgobj gobj_, const char *name, double value)
 {
     gobj_t *gobj = gobj_;
 
-    json_t *hs = gobj_hsdata2(gobj, name, FALSE);
-    if(hs) {
-        int ret = json_object_set_new(hs, name, json_real(value));
+    int idx;
+    gobj_t *owner = gobj_attr_owner(gobj, name, &idx);
+    if(owner) {
+        int ret = attr_write_real(owner, idx, value);
         if(gobj->gclass->gmt->mt_writing) {
             if((gobj->obflag & obflag_created) && !(gobj->obflag & obflag_destroyed)) {
                 // Avoid call to mt_writing before mt_create!
@@ -2702,9 +3512,10 @@ PUBLIC int gobj_write_json_attr(hgobj gobj_, const char *name, json_t *jn_value)
 {
     gobj_t *gobj = gobj_;
 
-    json_t *hs = gobj_hsdata2(gobj, name, FALSE);
-    if(hs) {
-        int ret = json_object_set(hs, name, jn_value);
+    int idx;
+    gobj_t *owner = gobj_attr_owner(gobj, name, &idx);
+    if(owner) {
+        int ret = attr_write_json(owner, idx, json_incref(jn_value));
         if(gobj->gclass->gmt->mt_writing) {
             if((gobj->obflag & obflag_created) && !(gobj->obflag & obflag_destroyed)) {
                 // Avoid call to mt_writing before mt_create!
@@ -2733,9 +3544,10 @@ PUBLIC int gobj_write_new_json_attr(hgobj gobj_, const char *name, json_t *jn_va
 {
     gobj_t *gobj = gobj_;
 
-    json_t *hs = gobj_hsdata2(gobj, name, FALSE);
-    if(hs) {
-        int ret = json_object_set_new(hs, name, jn_value);
+    int idx;
+    gobj_t *owner = gobj_attr_owner(gobj, name, &idx);
+    if(owner) {
+        int ret = attr_write_json(owner, idx, jn_value);
         if(gobj->gclass->gmt->mt_writing) {
             if((gobj->obflag & obflag_created) && !(gobj->obflag & obflag_destroyed)) {
                 // Avoid call to mt_writing before mt_create!
@@ -2764,9 +3576,10 @@ PUBLIC int gobj_write_pointer_attr(hgobj gobj_, const char *name, void *value)
 {
     gobj_t *gobj = gobj_;
 
-    json_t *hs = gobj_hsdata2(gobj, name, FALSE);
-    if(hs) {
-        int ret = json_object_set_new(hs, name, json_integer((json_int_t)(size_t)value));
+    int idx;
+    gobj_t *owner = gobj_attr_owner(gobj, name, &idx);
+    if(owner) {
+        int ret = attr_write_pointer(owner, idx, value);
         if(gobj->gclass->gmt->mt_writing) {
             if((gobj->obflag & obflag_created) && !(gobj->obflag & obflag_destroyed)) {
                 // Avoid call to mt_writing before mt_create!
@@ -2787,9 +3600,250 @@ PUBLIC int gobj_write_pointer_attr(hgobj gobj_, const char *name, void *value)
     return -1;
 }
 
-
-
-
+/***************************************************************************
+ *  ATTR: increment, return the new value
+ ***************************************************************************/
+PUBLIC json_int_t gobj_incr_integer_attr(hgobj gobj_, const char *name, json_int_t value)
+{
+    gobj_t *gobj = gobj_;
+
+    int idx;
+    gobj_t *owner = gobj_attr_owner(gobj, name, &idx);
+    if(owner) {
+        if(gobj->gclass->gmt->mt_reading) {
+            if(!(gobj->obflag & obflag_destroyed)) {
+                gobj->gclass->gmt->mt_reading(gobj, name);
+            }
+        }
+        value += attr_read_integer(owner, idx);
+        attr_write_integer(owner, idx, value);
+        if(gobj->gclass->gmt->mt_writing) {
+            if((gobj->obflag & obflag_created) && !(gobj->obflag & obflag_destroyed)) {
+                // Avoid call to mt_writing before mt_create!
+                gobj->gclass->gmt->mt_writing(gobj, name);
+            }
+        }
+        return value;
+    }
+
+    gobj_log_warning(gobj, LOG_OPT_TRACE_STACK,
+        "function",     "%s", __FUNCTION__,
+        "msgset",       "%s", MSGSET_PARAMETER_ERROR,
+        "msg",          "%s", "GClass Attribute NOT FOUND",
+        "gclass",       "%s", gobj_gclass_name(gobj),
+        "attr",         "%s", name,
+        NULL
+    );
+    return 0;
+}
+
+/***************************************************************************
+ *  ATTR: handle of the attribute (index in attr's table), -1 if not found
+ ***************************************************************************/
+PUBLIC int gclass_attr_handle(hgclass gclass_, const char *name)
+{
+    gclass_t *gclass = gclass_;
+
+    int idx = (gclass && !empty_string(name))? attr_index(gclass, name) : -1;
+    if(idx < 0) {
+        gobj_log_error(0, LOG_OPT_TRACE_STACK,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_PARAMETER_ERROR,
+            "msg",          "%s", "GClass Attribute NOT FOUND",
+            "gclass",       "%s", gclass?gclass->gclass_name:"",
+            "attr",         "%s", name?name:"",
+            NULL
+        );
+    }
+    return idx;
+}
+
+/***************************************************************************
+ *  ATTR: check the handle and call mt_reading
+ ***************************************************************************/
+PRIVATE BOOL attr_handle_reading(gobj_t *gobj, int handle)
+{
+    if(!gobj || handle < 0 || (size_t)handle >= gobj->gclass->n_attrs) {
+        gobj_log_error(gobj, LOG_OPT_TRACE_STACK,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_PARAMETER_ERROR,
+            "msg",          "%s", "Attribute handle WRONG",
+            "handle",       "%d", handle,
+            NULL
+        );
+        return FALSE;
+    }
+    if(gobj->gclass->gmt->mt_reading) {
+        if(!(gobj->obflag & obflag_destroyed)) {
+            gobj->gclass->gmt->mt_reading(gobj, gobj->gclass->tattr_desc[handle].name);
+        }
+    }
+    return TRUE;
+}
+
+/***************************************************************************
+ *  ATTR: check the handle
+ ***************************************************************************/
+PRIVATE BOOL attr_handle_check(gobj_t *gobj, int handle)
+{
+    if(!gobj || handle < 0 || (size_t)handle >= gobj->gclass->n_attrs) {
+        gobj_log_error(gobj, LOG_OPT_TRACE_STACK,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_PARAMETER_ERROR,
+            "msg",          "%s", "Attribute handle WRONG",
+            "handle",       "%d", handle,
+            NULL
+        );
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/***************************************************************************
+ *  ATTR: call mt_writing
+ ***************************************************************************/
+PRIVATE void attr_handle_writing(gobj_t *gobj, int handle)
+{
+    if(gobj->gclass->gmt->mt_writing) {
+        if((gobj->obflag & obflag_created) && !(gobj->obflag & obflag_destroyed)) {
+            // Avoid call to mt_writing before mt_create!
+            gobj->gclass->gmt->mt_writing(gobj, gobj->gclass->tattr_desc[handle].name);
+        }
+    }
+}
+
+/***************************************************************************
+ *  ATTR: read by handle
+ ***************************************************************************/
+PUBLIC const char *gobj_read_str_attr_h(hgobj gobj, int handle)
+{
+    if(!attr_handle_reading(gobj, handle)) {
+        return NULL;
+    }
+    return attr_read_str(gobj, handle);
+}
+
+PUBLIC BOOL gobj_read_bool_attr_h(hgobj gobj, int handle)
+{
+    if(!attr_handle_reading(gobj, handle)) {
+        return 0;
+    }
+    return attr_read_bool(gobj, handle);
+}
+
+PUBLIC json_int_t gobj_read_integer_attr_h(hgobj gobj, int handle)
+{
+    if(!attr_handle_reading(gobj, handle)) {
+        return 0;
+    }
+    return attr_read_integer(gobj, handle);
+}
+
+PUBLIC double gobj_read_real_attr_h(hgobj gobj, int handle)
+{
+    if(!attr_handle_reading(gobj, handle)) {
+        return 0;
+    }
+    return attr_read_real(gobj, handle);
+}
+
+PUBLIC json_t *gobj_read_json_attr_h(hgobj gobj, int handle) // WARNING return its NOT YOURS
+{
+    if(!attr_handle_reading(gobj, handle)) {
+        return 0;
+    }
+    return attr_json(gobj, handle);
+}
+
+PUBLIC void *gobj_read_pointer_attr_h(hgobj gobj, int handle)
+{
+    if(!attr_handle_reading(gobj, handle)) {
+        return 0;
+    }
+    return attr_read_pointer(gobj, handle);
+}
+
+/***************************************************************************
+ *  ATTR: write by handle
+ ***************************************************************************/
+PUBLIC int gobj_write_str_attr_h(hgobj gobj, int handle, const char *value)
+{
+    if(!attr_handle_check(gobj, handle)) {
+        return -1;
+    }
+    int ret = attr_write_str(gobj, handle, value);
+    attr_handle_writing(gobj, handle);
+    return ret;
+}
+
+PUBLIC int gobj_write_bool_attr_h(hgobj gobj, int handle, BOOL value)
+{
+    if(!attr_handle_check(gobj, handle)) {
+        return -1;
+    }
+    int ret = attr_write_bool(gobj, handle, value);
+    attr_handle_writing(gobj, handle);
+    return ret;
+}
+
+PUBLIC int gobj_write_integer_attr_h(hgobj gobj, int handle, json_int_t value)
+{
+    if(!attr_handle_check(gobj, handle)) {
+        return -1;
+    }
+    int ret = attr_write_integer(gobj, handle, value);
+    attr_handle_writing(gobj, handle);
+    return ret;
+}
+
+PUBLIC int gobj_write_real_attr_h(hgobj gobj, int handle, double value)
+{
+    if(!attr_handle_check(gobj, handle)) {
+        return -1;
+    }
+    int ret = attr_write_real(gobj, handle, value);
+    attr_handle_writing(gobj, handle);
+    return ret;
+}
+
+PUBLIC int gobj_write_json_attr_h(hgobj gobj, int handle, json_t *jn_value)
+{
+    if(!attr_handle_check(gobj, handle)) {
+        JSON_INCREF(jn_value); // value is incref always, in error case too
+        return -1;
+    }
+    int ret = attr_write_json(gobj, handle, json_incref(jn_value));
+    attr_handle_writing(gobj, handle);
+    return ret;
+}
+
+PUBLIC int gobj_write_pointer_attr_h(hgobj gobj, int handle, void *value)
+{
+    if(!attr_handle_check(gobj, handle)) {
+        return -1;
+    }
+    int ret = attr_write_pointer(gobj, handle, value);
+    attr_handle_writing(gobj, handle);
+    return ret;
+}
+
+/***************************************************************************
+ *  ATTR: increment by handle, return the new value
+ ***************************************************************************/
+PUBLIC json_int_t gobj_incr_integer_attr_h(hgobj gobj, int handle, json_int_t value)
+{
+    if(!attr_handle_reading(gobj, handle)) {
+        return 0;
+    }
+    value += attr_read_integer(gobj, handle);
+    attr_write_integer(gobj, handle, value);
+    attr_handle_writing(gobj, handle);
+    return value;
+}
+
+
+
+
                     /*---------------------------------*
                      *  Operational functions
                      *---------------------------------*/
@@ -3662,6 +4716,7 @@ PUBLIC hgobj gobj_set_bottom_gobj(hgobj gobj_, hgobj bottom_gobj)
         //return 0;
     }
     gobj->bottom_gobj = bottom_gobj;
+    trace_cache_invalidate(); // the attributes of the trace filters are searched in the bottoms
     return 0;
 }
 
@@ -3726,8 +4781,11 @@ PUBLIC hgobj gobj_find_service(const char *service, BOOL verbose)
         return gobj_yuno();
     }
 
+    RUNTIME_LOCK()
     json_t *o = json_object_get(jn_services, service);
-    if(!o) {
+    hgobj gobj = o? (hgobj)(size_t)json_integer_value(o) : NULL;
+    RUNTIME_UNLOCK()
+    if(!gobj) {
         if(verbose) {
             gobj_log_error(0, LOG_OPT_TRACE_STACK,
                 "function",     "%s", __FUNCTION__,
@@ -3740,7 +4798,7 @@ PUBLIC hgobj gobj_find_service(const char *service, BOOL verbose)
         return NULL;
     }
 
-    return (hgobj)(size_t)json_integer_value(o);
+    return gobj;
 }
 
 /***************************************************************************
@@ -3974,11 +5032,11 @@ PRIVATE BOOL match_child(
 
     BOOL matched = TRUE;
     json_object_foreach(jn_filter, key, jn_value) {
-        json_t *hs = gobj_hsdata2(child, key, FALSE);
-        if(hs) {
-            json_t *jn_var1 = json_object_get(hs, key);
+        int idx;
+        gobj_t *owner = gobj_attr_owner(child, key, &idx);
+        if(owner) {
+            json_t *jn_var1 = attr_json(owner, idx);
             int cmp = cmp_two_simple_json(jn_var1, jn_value);
-            JSON_DECREF(jn_var1);
             if(cmp!=0) {
                 matched = FALSE;
                 break;
@@ -5077,6 +6135,41 @@ PUBLIC json_t *view_gobj_tree(  // Return tree with gobj's tree.
 
 
 
+/***************************************************************************
+ *  Set by the owner of the loops, before running them
+ ***************************************************************************/
+PUBLIC void gobj_set_loop_hooks(
+    gobj_post_event_fn_t post_event_fn,
+    gobj_purge_events_fn_t purge_events_fn
+) {
+    __post_event_fn__ = post_event_fn;
+    __purge_events_fn__ = purge_events_fn;
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PUBLIC void gobj_set_thread_loop(void *loop)
+{
+    __thread_loop__ = loop;
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PUBLIC void *gobj_thread_loop(void)
+{
+    return __thread_loop__;
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PUBLIC void *gobj_loop(hgobj gobj)
+{
+    return gobj? ((gobj_t *)gobj)->loop : NULL;
+}
+
 /***************************************************************************
  *
  ***************************************************************************/
@@ -5100,6 +6193,12 @@ PUBLIC int gobj_send_event(
 
     gobj_t *src = (gobj_t *)src_;
     gobj_t *dst = (gobj_t *)dst_;
+    if(dst->loop != __thread_loop__ && __post_event_fn__) {
+        /*
+         *  Gobj of other loop, the event is sent by the thread of its loop
+         */
+        return __post_event_fn__(dst->loop, dst, event, kw, src);
+    }
     if(dst->obflag & (obflag_destroyed|obflag_destroying)) {
         gobj_log_error(dst, LOG_OPT_TRACE_STACK,
             "function",     "%s", __FUNCTION__,
@@ -5132,7 +6231,7 @@ PUBLIC int gobj_send_event(
     BOOL tracea = is_machine_tracing(dst) && !is_machine_not_tracing(dst) && !is_machine_not_tracing(src);
     __inside__ ++;
 
-    event_action_t *event_action = find_event_action(state, event);
+    event_action_t *event_action = fsm_find_action(dst->gclass, state, event);
     if(!event_action) {
         if(dst->gclass->gmt->mt_inject_event) {
             __inside__ --;
@@ -5281,7 +6380,7 @@ PUBLIC BOOL gobj_change_state(
     if(gobj->current_state->state_name == state_name) {
         return FALSE;
     }
-    state_t *new_state = find_state(gobj->gclass, state_name);
+    state_t *new_state = fsm_find_state(gobj->gclass, state_name);
     if(!new_state) {
         gobj_log_error(NULL, LOG_OPT_TRACE_STACK,
             "function",     "%s", __FUNCTION__,
@@ -5349,98 +6448,806 @@ PUBLIC gobj_state_t gobj_current_state(hgobj hgobj)
 }
 
 /***************************************************************************
- *
+ *
+ ***************************************************************************/
+PUBLIC BOOL gobj_has_input_event(hgobj gobj_, gobj_event_t event)
+{
+    if(gobj_ == NULL) {
+        gobj_log_error(NULL, LOG_OPT_TRACE_STACK,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_PARAMETER_ERROR,
+            "msg",          "%s", "hgobj NULL",
+            "event",        "%s", event,
+            NULL
+        );
+        return FALSE;
+    }
+    gobj_t *gobj = (gobj_t *)gobj_;
+    if(fsm_find_action(gobj->gclass, gobj->current_state, event)) {
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PUBLIC event_type_t *gobj_event_type(hgobj gobj_, gobj_event_t event, event_flag_t event_flag)
+{
+    if(gobj_ == NULL) {
+        gobj_log_error(NULL, LOG_OPT_TRACE_STACK,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_PARAMETER_ERROR,
+            "msg",          "%s", "hgobj NULL",
+            "event",        "%s", event,
+            NULL
+        );
+        return NULL;
+    }
+    gobj_t *gobj = (gobj_t *)gobj_;
+
+    event_t *event_ = dl_first(&gobj->gclass->dl_events);
+    while(event_) {
+        if(event_->event_type.event && event_->event_type.event == event) {
+            if(event_flag && (event_->event_type.event_flag & event_flag)) {
+                return &event_->event_type;
+            }
+        }
+        event_ = dl_next(event_);
+    }
+
+    /*
+     *  Check global (gobj) output events
+     */
+    event_ = dl_first(&dl_global_event_types);
+    while(event_) {
+        if(event_->event_type.event && event_->event_type.event == event) {
+            if(event_flag && (event_->event_type.event_flag & event_flag)) {
+                return &event_->event_type;
+            }
+        }
+        event_ = dl_next(event_);
+    }
+
+    return NULL;
+}
+
+
+
+
+                    /*------------------------------------*
+                     *      Publication/Subscriptions
+                     *------------------------------------*/
+
+
+
+
+/*
+Schema of subs (subscription)
+=============================
+"publisher":            (pointer)int    // publisher gobj
+"subscriber:            (pointer)int    // subscriber gobj
+"event":                (pointer)str    // event name subscribed
+"subs_flag":            int             // subscription flag. See subs_flag_t
+"__config__":           json            // subscription config.
+"__global__":           json            // global event kw. This json is extended with publishing kw.
+"__local__":            json            // local event kw. The keys in this json are removed from publishing kw.
+
+ */
+
+typedef enum {
+    __hard_subscription__   = 0x00000001,
+    __own_event__           = 0x00000002,   // If gobj_send_event return -1 don't continue publishing
+} subs_flag_t;
+
+/*
+ *  Subscriptions of a publisher indexed by event (event NULL: all events),
+ *  with the keys of the json subscription decoded, to publish without json lookups.
+ *  The json subscriptions of dl_subscriptions/dl_subscribings remain as views.
+ *
+ *  The subscriptions with a __filter__ of equality on one key (ex: {"device_id": 7})
+ *  are in a filter index by key, a hash of the constants of the filters:
+ *  the publish gets the subscriptions that can match from the value of the key.
+ *  The constants are hashed by their integer (strings too, converted like
+ *  kw_match_simple() compares them with integers) and the strings by string.
+ *
+ *  The publish works over a list of the subscriptions got at its beginning,
+ *  the subscriptions deleted while publishing are marked, and freed at the end.
+ */
+typedef struct subscription_s {
+    json_t *subs;           // json subscription, own reference
+    gobj_t *subscriber;
+    gobj_event_t event;
+    subs_flag_t subs_flag;
+    json_t *__global__;     // of subs, not owned
+    json_t *__local__;
+    json_t *__filter__;
+    kw_matcher_t *matcher;  // __filter__ compiled
+    size_t seq;             // order of subscription
+    BOOL deleted;
+    struct subscription_s *next_deleted;
+
+    /*
+     *  In a filter index
+     */
+    struct filter_index_s *filter_index;
+    struct subscription_s *next_integer;    // chains of the buckets
+    struct subscription_s *next_string;
+    json_int_t key_integer;
+    const char *key_string; // NULL if the constant is not a string, of the matcher
+} subscription_t;
+
+typedef struct filter_index_s {
+    DL_ITEM_FIELDS
+
+    kw_path_t *kw_path;     // key of the filters
+    size_t n;
+    size_t mask;            // nº of buckets - 1, power of 2
+    subscription_t **by_integer;
+    subscription_t **by_string;
+} filter_index_t;
+
+typedef struct event_subs_s {
+    DL_ITEM_FIELDS
+
+    gobj_event_t event;
+    subscription_t **subscriptions; // not in a filter index, in order of subscription
+    size_t n;
+    size_t size;
+    dl_list_t dl_filter_index;
+} event_subs_t;
+
+/*
+ *  Subscriptions to publish
+ */
+typedef struct subs_list_s {
+    subscription_t **items;
+    size_t n;
+    size_t size;
+    subscription_t *local[32];
+} subs_list_t;
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PRIVATE event_subs_t *find_event_subs(gobj_t *publisher, gobj_event_t event)
+{
+    event_subs_t *event_subs = dl_first(&publisher->dl_subs_index);
+    while(event_subs) {
+        if(event_subs->event == event) {
+            return event_subs;
+        }
+        event_subs = dl_next(event_subs);
+    }
+    return NULL;
+}
+
+/***************************************************************************
+ *  Hashes of the filter index
+ ***************************************************************************/
+PRIVATE inline size_t integer_hash(json_int_t value, size_t mask)
+{
+    return fsm_hash((const void *)(uintptr_t)(uint64_t)value, mask);
+}
+
+/***************************************************************************
+ *  Decode the keys of the json subscription used in publishing
+ ***************************************************************************/
+PRIVATE void subs_index_load(subscription_t *subscription)
+{
+    json_t *subs = subscription->subs;
+    subscription->subs_flag = (subs_flag_t)kw_get_int(0, subs, "subs_flag", 0, 0);
+    subscription->__global__ = kw_get_dict(0, subs, "__global__", 0, 0);
+    subscription->__local__ = kw_get_dict(0, subs, "__local__", 0, 0);
+    subscription->__filter__ = json_object_get(subs, "__filter__"); // dict or list
+
+    EXEC_AND_RESET(kw_matcher_destroy, subscription->matcher)
+    if(subscription->__filter__) {
+        subscription->matcher = kw_matcher_create(subscription->__filter__);
+    }
+}
+
+/***************************************************************************
+ *  Key of the filter index, NULL if the subscription can't be in one
+ ***************************************************************************/
+PRIVATE const char *filter_index_key(gobj_t *publisher, subscription_t *subscription)
+{
+    if(!subscription->matcher) {
+        return NULL;
+    }
+    /*
+     *  The methods of gclass see all the subscriptions
+     */
+    if(publisher->gclass->gmt->mt_publication_pre_filter ||
+            publisher->gclass->gmt->mt_publication_filter) {
+        return NULL;
+    }
+
+    json_t *value;
+    const char *path = kw_matcher_single_key(subscription->matcher, &value);
+    if(!path || !(json_is_integer(value) || json_is_string(value))) {
+        return NULL;
+    }
+    subscription->key_integer = jn2integer(value);
+    subscription->key_string = json_is_string(value)? json_string_value(value) : NULL;
+    return path;
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PRIVATE int filter_index_resize(filter_index_t *filter_index, size_t buckets)
+{
+    subscription_t **by_integer = sys_malloc_fn(buckets * sizeof(subscription_t *));
+    subscription_t **by_string = sys_malloc_fn(buckets * sizeof(subscription_t *));
+    if(!by_integer || !by_string) {
+        gobj_log_error(0, 0,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_MEMORY_ERROR,
+            "msg",          "%s", "No memory",
+            "buckets",      "%d", (int)buckets,
+            NULL
+        );
+        if(by_integer) {
+            sys_free_fn(by_integer);
+        }
+        if(by_string) {
+            sys_free_fn(by_string);
+        }
+        return -1;
+    }
+    memset(by_integer, 0, buckets * sizeof(subscription_t *));
+    memset(by_string, 0, buckets * sizeof(subscription_t *));
+
+    size_t mask = buckets - 1;
+    if(filter_index->by_integer) {
+        for(size_t i=0; i<=filter_index->mask; i++) {
+            subscription_t *subscription = filter_index->by_integer[i];
+            while(subscription) {
+                subscription_t *next = subscription->next_integer;
+                size_t h = integer_hash(subscription->key_integer, mask);
+                subscription->next_integer = by_integer[h];
+                by_integer[h] = subscription;
+                if(subscription->key_string) {
+                    h = string_hash(subscription->key_string, mask);
+                    subscription->next_string = by_string[h];
+                    by_string[h] = subscription;
+                }
+                subscription = next;
+            }
+        }
+        sys_free_fn(filter_index->by_integer);
+        sys_free_fn(filter_index->by_string);
+    }
+    filter_index->by_integer = by_integer;
+    filter_index->by_string = by_string;
+    filter_index->mask = mask;
+    return 0;
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PRIVATE void filter_index_destroy(event_subs_t *event_subs, filter_index_t *filter_index)
+{
+    dl_delete(&event_subs->dl_filter_index, filter_index, 0);
+    kw_path_destroy(filter_index->kw_path);
+    if(filter_index->by_integer) {
+        sys_free_fn(filter_index->by_integer);
+    }
+    if(filter_index->by_string) {
+        sys_free_fn(filter_index->by_string);
+    }
+    sys_free_fn(filter_index);
+}
+
+/***************************************************************************
+ *  Add the subscription to the filter index of the key
+ ***************************************************************************/
+PRIVATE int filter_index_link(
+    event_subs_t *event_subs,
+    const char *path,
+    subscription_t *subscription
+) {
+    filter_index_t *filter_index = dl_first(&event_subs->dl_filter_index);
+    while(filter_index) {
+        if(strcmp(kw_path_path(filter_index->kw_path), path)==0) {
+            break;
+        }
+        filter_index = dl_next(filter_index);
+    }
+    if(!filter_index) {
+        filter_index = sys_malloc_fn(sizeof(*filter_index));
+        if(!filter_index) {
+            gobj_log_error(0, 0,
+                "function",     "%s", __FUNCTION__,
+                "msgset",       "%s", MSGSET_MEMORY_ERROR,
+                "msg",          "%s", "No memory",
+                NULL
+            );
+            return -1;
+        }
+        memset(filter_index, 0, sizeof(*filter_index));
+        dl_add(&event_subs->dl_filter_index, filter_index);
+        filter_index->kw_path = kw_path_create(path);
+        if(!filter_index->kw_path || filter_index_resize(filter_index, 16)<0) {
+            filter_index_destroy(event_subs, filter_index);
+            return -1;
+        }
+    }
+    if(filter_index->n >= 2*(filter_index->mask+1)) {
+        filter_index_resize(filter_index, 2*(filter_index->mask+1));
+    }
+
+    size_t h = integer_hash(subscription->key_integer, filter_index->mask);
+    subscription->next_integer = filter_index->by_integer[h];
+    filter_index->by_integer[h] = subscription;
+    if(subscription->key_string) {
+        h = string_hash(subscription->key_string, filter_index->mask);
+        subscription->next_string = filter_index->by_string[h];
+        filter_index->by_string[h] = subscription;
+    }
+    subscription->filter_index = filter_index;
+    filter_index->n++;
+    return 0;
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PRIVATE void filter_index_unlink(event_subs_t *event_subs, subscription_t *subscription)
+{
+    filter_index_t *filter_index = subscription->filter_index;
+
+    subscription_t **pp = &filter_index->by_integer[
+        integer_hash(subscription->key_integer, filter_index->mask)
+    ];
+    while(*pp) {
+        if(*pp == subscription) {
+            *pp = subscription->next_integer;
+            break;
+        }
+        pp = &(*pp)->next_integer;
+    }
+    if(subscription->key_string) {
+        pp = &filter_index->by_string[
+            string_hash(subscription->key_string, filter_index->mask)
+        ];
+        while(*pp) {
+            if(*pp == subscription) {
+                *pp = subscription->next_string;
+                break;
+            }
+            pp = &(*pp)->next_string;
+        }
+    }
+    subscription->filter_index = NULL;
+    subscription->next_integer = NULL;
+    subscription->next_string = NULL;
+
+    filter_index->n--;
+    if(filter_index->n == 0) {
+        filter_index_destroy(event_subs, filter_index);
+    }
+}
+
+/***************************************************************************
+ *  Link the subscription in the index of the publisher
+ ***************************************************************************/
+PRIVATE int subs_index_link(gobj_t *publisher, subscription_t *subscription)
+{
+    event_subs_t *event_subs = find_event_subs(publisher, subscription->event);
+    if(!event_subs) {
+        event_subs = sys_malloc_fn(sizeof(*event_subs));
+        if(!event_subs) {
+            gobj_log_error(publisher, LOG_OPT_TRACE_STACK,
+                "function",     "%s", __FUNCTION__,
+                "msgset",       "%s", MSGSET_MEMORY_ERROR,
+                "msg",          "%s", "No memory",
+                "event",        "%s", subscription->event?subscription->event:"",
+                NULL
+            );
+            return -1;
+        }
+        memset(event_subs, 0, sizeof(*event_subs));
+        event_subs->event = subscription->event;
+        dl_init(&event_subs->dl_filter_index);
+        dl_add(&publisher->dl_subs_index, event_subs);
+    }
+
+    const char *path = filter_index_key(publisher, subscription);
+    if(path && filter_index_link(event_subs, path, subscription)==0) {
+        return 0;
+    }
+
+    if(event_subs->n >= event_subs->size) {
+        size_t size = event_subs->size? event_subs->size*2 : 4;
+        subscription_t **subscriptions = sys_realloc_fn(
+            event_subs->subscriptions,
+            size * sizeof(subscription_t *)
+        );
+        if(!subscriptions) {
+            gobj_log_error(publisher, LOG_OPT_TRACE_STACK,
+                "function",     "%s", __FUNCTION__,
+                "msgset",       "%s", MSGSET_MEMORY_ERROR,
+                "msg",          "%s", "No memory",
+                "event",        "%s", subscription->event?subscription->event:"",
+                "size",         "%d", (int)size,
+                NULL
+            );
+            return -1;
+        }
+        event_subs->subscriptions = subscriptions;
+        event_subs->size = size;
+    }
+
+    /*
+     *  In order of subscription (a re-linked subscription can be older than the last)
+     */
+    size_t i = event_subs->n;
+    while(i > 0 && event_subs->subscriptions[i-1]->seq > subscription->seq) {
+        event_subs->subscriptions[i] = event_subs->subscriptions[i-1];
+        i--;
+    }
+    event_subs->subscriptions[i] = subscription;
+    event_subs->n++;
+    return 0;
+}
+
+/***************************************************************************
+ *  Unlink the subscription of the index of the publisher
+ ***************************************************************************/
+PRIVATE void subs_index_unlink(gobj_t *publisher, subscription_t *subscription)
+{
+    event_subs_t *event_subs = find_event_subs(publisher, subscription->event);
+    if(!event_subs) {
+        return;
+    }
+
+    if(subscription->filter_index) {
+        filter_index_unlink(event_subs, subscription);
+    } else {
+        for(size_t i=0; i<event_subs->n; i++) {
+            if(event_subs->subscriptions[i] == subscription) {
+                event_subs->n--;
+                memmove(
+                    &event_subs->subscriptions[i],
+                    &event_subs->subscriptions[i+1],
+                    (event_subs->n - i) * sizeof(subscription_t *)
+                );
+                break;
+            }
+        }
+    }
+
+    if(event_subs->n == 0 && dl_size(&event_subs->dl_filter_index) == 0) {
+        dl_delete(&publisher->dl_subs_index, event_subs, 0);
+        if(event_subs->subscriptions) {
+            sys_free_fn(event_subs->subscriptions);
+        }
+        sys_free_fn(event_subs);
+    }
+}
+
+/***************************************************************************
+ *  Add a json subscription to the index of the publisher
+ ***************************************************************************/
+PRIVATE subscription_t *subs_index_add(
+    gobj_t *publisher,
+    gobj_event_t event,
+    json_t *subs, // not owned
+    gobj_t *subscriber
+) {
+    subscription_t *subscription = sys_malloc_fn(sizeof(*subscription));
+    if(!subscription) {
+        gobj_log_error(publisher, LOG_OPT_TRACE_STACK,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_MEMORY_ERROR,
+            "msg",          "%s", "No memory",
+            "event",        "%s", event?event:"",
+            NULL
+        );
+        return NULL;
+    }
+    memset(subscription, 0, sizeof(*subscription));
+    subscription->subs = json_incref(subs);
+    subscription->subscriber = subscriber;
+    subscription->event = event;
+    subscription->seq = publisher->subs_seq++;
+    subs_index_load(subscription);
+
+    if(subs_index_link(publisher, subscription)<0) {
+        EXEC_AND_RESET(kw_matcher_destroy, subscription->matcher)
+        JSON_DECREF(subscription->subs)
+        sys_free_fn(subscription);
+        return NULL;
+    }
+    return subscription;
+}
+
+/***************************************************************************
+ *  Free the subscription, later if the publisher is publishing
+ ***************************************************************************/
+PRIVATE void subs_index_release(gobj_t *publisher, subscription_t *subscription)
+{
+    if(publisher->publishing) {
+        subscription->deleted = TRUE;
+        subscription->next_deleted = publisher->subs_deleted;
+        publisher->subs_deleted = subscription;
+        return;
+    }
+    EXEC_AND_RESET(kw_matcher_destroy, subscription->matcher)
+    JSON_DECREF(subscription->subs)
+    sys_free_fn(subscription);
+}
+
+/***************************************************************************
+ *  Find the subscription of the json subscription
+ ***************************************************************************/
+PRIVATE subscription_t *subs_index_find(
+    gobj_t *publisher,
+    gobj_event_t event,
+    json_t *subs // not owned
+) {
+    event_subs_t *event_subs = find_event_subs(publisher, event);
+    if(!event_subs) {
+        return NULL;
+    }
+    for(size_t i=0; i<event_subs->n; i++) {
+        if(event_subs->subscriptions[i]->subs == subs) {
+            return event_subs->subscriptions[i];
+        }
+    }
+
+    /*
+     *  In a filter index, the chain of the constant of the filter, else all
+     */
+    json_t *__filter__ = json_object_get(subs, "__filter__");
+    filter_index_t *filter_index = dl_first(&event_subs->dl_filter_index);
+    while(filter_index) {
+        json_t *value = json_object_get(__filter__, kw_path_path(filter_index->kw_path));
+        if(value && json_object_size(__filter__)==1) {
+            subscription_t *subscription = filter_index->by_integer[
+                integer_hash(jn2integer(value), filter_index->mask)
+            ];
+            for(; subscription; subscription = subscription->next_integer) {
+                if(subscription->subs == subs) {
+                    return subscription;
+                }
+            }
+        }
+        filter_index = dl_next(filter_index);
+    }
+    filter_index = dl_first(&event_subs->dl_filter_index);
+    while(filter_index) {
+        for(size_t i=0; i<=filter_index->mask; i++) {
+            subscription_t *subscription = filter_index->by_integer[i];
+            for(; subscription; subscription = subscription->next_integer) {
+                if(subscription->subs == subs) {
+                    return subscription;
+                }
+            }
+        }
+        filter_index = dl_next(filter_index);
+    }
+    return NULL;
+}
+
+/***************************************************************************
+ *  Delete the json subscription from the index of the publisher
+ ***************************************************************************/
+PRIVATE int subs_index_delete(
+    gobj_t *publisher,
+    gobj_event_t event,
+    json_t *subs // not owned
+) {
+    subscription_t *subscription = subs_index_find(publisher, event, subs);
+    if(!subscription) {
+        return -1;
+    }
+    subs_index_unlink(publisher, subscription);
+    subs_index_release(publisher, subscription);
+    return 0;
+}
+
+/***************************************************************************
+ *  Decode again the json subscription, it can be modified
+ ***************************************************************************/
+PRIVATE int subs_index_reload(
+    gobj_t *publisher,
+    gobj_event_t event,
+    json_t *subs // not owned
+) {
+    subscription_t *subscription = subs_index_find(publisher, event, subs);
+    if(!subscription) {
+        return -1;
+    }
+    subs_index_unlink(publisher, subscription);
+    subs_index_load(subscription);
+    if(subs_index_link(publisher, subscription)<0) {
+        subs_index_release(publisher, subscription);
+        return -1;
+    }
+    return 0;
+}
+
+/***************************************************************************
+ *  Free the subscriptions deleted while publishing
  ***************************************************************************/
-PUBLIC BOOL gobj_has_input_event(hgobj gobj_, gobj_event_t event)
+PRIVATE void subs_index_purge(gobj_t *publisher)
 {
-    if(gobj_ == NULL) {
-        gobj_log_error(NULL, LOG_OPT_TRACE_STACK,
-            "function",     "%s", __FUNCTION__,
-            "msgset",       "%s", MSGSET_PARAMETER_ERROR,
-            "msg",          "%s", "hgobj NULL",
-            "event",        "%s", event,
-            NULL
-        );
-        return FALSE;
-    }
-    gobj_t *gobj = (gobj_t *)gobj_;
-    if(find_event_action(gobj->current_state, event)) {
-        return TRUE;
+    subscription_t *subscription;
+    while((subscription = publisher->subs_deleted)) {
+        publisher->subs_deleted = subscription->next_deleted;
+        subs_index_release(publisher, subscription);
     }
-
-    return FALSE;
 }
 
 /***************************************************************************
- *
+ *  Free the index, when the publisher is destroyed
  ***************************************************************************/
-PUBLIC event_type_t *gobj_event_type(hgobj gobj_, gobj_event_t event, event_flag_t event_flag)
+PRIVATE void subs_index_free(gobj_t *publisher)
 {
-    if(gobj_ == NULL) {
-        gobj_log_error(NULL, LOG_OPT_TRACE_STACK,
-            "function",     "%s", __FUNCTION__,
-            "msgset",       "%s", MSGSET_PARAMETER_ERROR,
-            "msg",          "%s", "hgobj NULL",
-            "event",        "%s", event,
-            NULL
-        );
-        return NULL;
-    }
-    gobj_t *gobj = (gobj_t *)gobj_;
-
-    event_t *event_ = dl_first(&gobj->gclass->dl_events);
-    while(event_) {
-        if(event_->event_type.event && event_->event_type.event == event) {
-            if(event_flag && (event_->event_type.event_flag & event_flag)) {
-                return &event_->event_type;
+    event_subs_t *event_subs;
+    while((event_subs = dl_first(&publisher->dl_subs_index))) {
+        subscription_t *subscription;
+        filter_index_t *filter_index = dl_first(&event_subs->dl_filter_index);
+        if(event_subs->n > 0) {
+            subscription = event_subs->subscriptions[0];
+        } else {
+            subscription = NULL;
+            for(size_t i=0; i<=filter_index->mask && !subscription; i++) {
+                subscription = filter_index->by_integer[i];
             }
         }
-        event_ = dl_next(event_);
+        subs_index_unlink(publisher, subscription);
+        subs_index_release(publisher, subscription);
     }
+}
 
-    /*
-     *  Check global (gobj) output events
-     */
-    event_ = dl_first(&dl_global_event_types);
-    while(event_) {
-        if(event_->event_type.event && event_->event_type.event == event) {
-            if(event_flag && (event_->event_type.event_flag & event_flag)) {
-                return &event_->event_type;
-            }
+/***************************************************************************
+ *
+ ***************************************************************************/
+PRIVATE void subs_list_add(subs_list_t *list, subscription_t *subscription)
+{
+    if(list->n >= list->size) {
+        size_t size = list->size * 2;
+        subscription_t **items = sys_malloc_fn(size * sizeof(subscription_t *));
+        if(!items) {
+            gobj_log_error(0, 0,
+                "function",     "%s", __FUNCTION__,
+                "msgset",       "%s", MSGSET_MEMORY_ERROR,
+                "msg",          "%s", "No memory",
+                "size",         "%d", (int)size,
+                NULL
+            );
+            return;
         }
-        event_ = dl_next(event_);
+        memcpy(items, list->items, list->n * sizeof(subscription_t *));
+        if(list->items != list->local) {
+            sys_free_fn(list->items);
+        }
+        list->items = items;
+        list->size = size;
     }
-
-    return NULL;
+    list->items[list->n++] = subscription;
 }
 
+/***************************************************************************
+ *  Add the subscriptions of the filter indexes that can match the kw
+ *  Return the number added
+ ***************************************************************************/
+PRIVATE size_t subs_list_add_filtered(subs_list_t *list, event_subs_t *event_subs, json_t *kw)
+{
+    size_t n = list->n;
+
+    filter_index_t *filter_index = dl_first(&event_subs->dl_filter_index);
+    for(; filter_index; filter_index = dl_next(filter_index)) {
+        json_t *jn_value = kw_path_find(filter_index->kw_path, kw);
+        if(!jn_value) {
+            continue;
+        }
 
+        subscription_t *subscription;
+        if(json_is_string(jn_value)) {
+            const char *value = json_string_value(jn_value);
+            subscription = filter_index->by_string[string_hash(value, filter_index->mask)];
+            for(; subscription; subscription = subscription->next_string) {
+                if(strcmp(subscription->key_string, value)==0) {
+                    subs_list_add(list, subscription);
+                }
+            }
+            // The integer constants are compared as integer
+            json_int_t value_integer = jn2integer(jn_value);
+            subscription = filter_index->by_integer[integer_hash(value_integer, filter_index->mask)];
+            for(; subscription; subscription = subscription->next_integer) {
+                if(!subscription->key_string && subscription->key_integer == value_integer) {
+                    subs_list_add(list, subscription);
+                }
+            }
 
+        } else if(json_is_integer(jn_value)) {
+            json_int_t value_integer = json_integer_value(jn_value);
+            subscription = filter_index->by_integer[integer_hash(value_integer, filter_index->mask)];
+            for(; subscription; subscription = subscription->next_integer) {
+                if(subscription->key_integer == value_integer) {
+                    subs_list_add(list, subscription);
+                }
+            }
 
-                    /*------------------------------------*
-                     *      Publication/Subscriptions
-                     *------------------------------------*/
+        } else {
+            // Other types, all, the matcher decides
+            for(size_t i=0; i<=filter_index->mask; i++) {
+                subscription = filter_index->by_integer[i];
+                for(; subscription; subscription = subscription->next_integer) {
+                    subs_list_add(list, subscription);
+                }
+            }
+        }
+    }
 
+    return list->n - n;
+}
 
+/***************************************************************************
+ *
+ ***************************************************************************/
+PRIVATE int cmp_subscription_seq(const void *a, const void *b)
+{
+    const subscription_t *s1 = *(const subscription_t **)a;
+    const subscription_t *s2 = *(const subscription_t **)b;
+    return (s1->seq > s2->seq) - (s1->seq < s2->seq);
+}
 
+/***************************************************************************
+ *  Get the subscriptions to publish the event:
+ *  the subscriptions of the event and of all events, merged in order of subscription,
+ *  and of the filter indexes only those that can match the kw.
+ ***************************************************************************/
+PRIVATE void subs_list_get(subs_list_t *list, gobj_t *publisher, gobj_event_t event, json_t *kw)
+{
+    list->items = list->local;
+    list->n = 0;
+    list->size = ARRAY_SIZE(list->local);
 
-/*
-Schema of subs (subscription)
-=============================
-"publisher":            (pointer)int    // publisher gobj
-"subscriber:            (pointer)int    // subscriber gobj
-"event":                (pointer)str    // event name subscribed
-"subs_flag":            int             // subscription flag. See subs_flag_t
-"__config__":           json            // subscription config.
-"__global__":           json            // global event kw. This json is extended with publishing kw.
-"__local__":            json            // local event kw. The keys in this json are removed from publishing kw.
+    event_subs_t *event_subs = find_event_subs(publisher, event);
+    event_subs_t *all_subs = find_event_subs(publisher, NULL);
+    size_t n_event = event_subs? event_subs->n : 0;
+    size_t n_all = all_subs? all_subs->n : 0;
+    size_t i_event = 0, i_all = 0;
 
- */
+    while(i_event < n_event || i_all < n_all) {
+        if(i_all >= n_all || (i_event < n_event &&
+                event_subs->subscriptions[i_event]->seq < all_subs->subscriptions[i_all]->seq)) {
+            subs_list_add(list, event_subs->subscriptions[i_event++]);
+        } else {
+            subs_list_add(list, all_subs->subscriptions[i_all++]);
+        }
+    }
 
-typedef enum {
-    __hard_subscription__   = 0x00000001,
-    __own_event__           = 0x00000002,   // If gobj_send_event return -1 don't continue publishing
-} subs_flag_t;
+    size_t filtered = 0;
+    if(event_subs) {
+        filtered += subs_list_add_filtered(list, event_subs, kw);
+    }
+    if(all_subs) {
+        filtered += subs_list_add_filtered(list, all_subs, kw);
+    }
+    if(filtered) {
+        qsort(list->items, list->n, sizeof(subscription_t *), cmp_subscription_seq);
+    }
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PRIVATE void subs_list_free(subs_list_t *list)
+{
+    if(list->items != list->local) {
+        sys_free_fn(list->items);
+    }
+    list->items = NULL;
+}
 
 /***************************************************************************
  *
@@ -5461,6 +7268,7 @@ PRIVATE json_t * _create_subscription(
         json_t *__config__ = kw_get_dict(publisher, kw, "__config__", 0, 0);
         json_t *__global__ = kw_get_dict(publisher, kw, "__global__", 0, 0);
         json_t *__local__ = kw_get_dict(publisher, kw, "__local__", 0, 0);
+        json_t *__filter__ = json_object_get(kw, "__filter__"); // dict or list
         const char *__service__ = kw_get_str(publisher, kw, "__service__", 0, 0);
 
         if(__global__) {
@@ -5492,6 +7300,10 @@ PRIVATE json_t * _create_subscription(
             json_t *kw_clone = json_deep_copy(__local__);
             json_object_set_new(subs, "__local__", kw_clone);
         }
+        if(json_is_object(__filter__) || json_is_array(__filter__)) {
+            json_t *kw_clone = json_deep_copy(__filter__);
+            json_object_set_new(subs, "__filter__", kw_clone);
+        }
         if(__service__) { // TODO check if it's used
             json_object_set_new(subs, "__service__", json_string(__service__));
         }
@@ -5574,6 +7386,14 @@ PRIVATE int _delete_subscription(
         );
         gobj_trace_json(gobj, subs, "subscription in publisher not found");
     }
+    if(subs_index_delete(publisher, event, subs)<0) {
+        gobj_log_error(gobj, LOG_OPT_TRACE_STACK,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_INTERNAL_ERROR,
+            "msg",          "%s", "subscription in publisher index not found",
+            NULL
+        );
+    }
 
     idx = kw_find_json_in_list(subscriber->dl_subscribings, subs);
     if(idx >= 0) {
@@ -5819,6 +7639,7 @@ PUBLIC json_t *gobj_subscribe_event( // return not yours
             NULL
         );
     }
+    subs_index_add(publisher, event, subs, subscriber);
     if(json_array_append(subscriber->dl_subscribings, subs)<0) {
         gobj_log_error(publisher, LOG_OPT_TRACE_STACK,
             "function",     "%s", __FUNCTION__,
@@ -5861,6 +7682,11 @@ PUBLIC json_t *gobj_subscribe_event( // return not yours
         if(result < 0) {
             _delete_subscription(publisher, subs, TRUE, TRUE);
             subs = 0;
+        } else {
+            /*
+             *  The json subscription can be modified in mt_subscription_added
+             */
+            subs_index_reload(publisher, event, subs);
         }
     }
 
@@ -6243,10 +8069,24 @@ PUBLIC int gobj_publish_event(
     /*--------------------------------------------------------------*
      *      Default publication method
      *--------------------------------------------------------------*/
-    json_t *dl_subs = json_copy(publisher->dl_subscriptions); // Protect to inside deleted subs
+    /*
+     *  Subscriptions of the event and of all events, in order of subscription,
+     *  of the filter indexes only the candidates by the value of the key in kw.
+     *  The subscriptions added while publishing are not published,
+     *  the deleted are skipped.
+     */
+    subs_list_t subs_list;
+    subs_list_get(&subs_list, publisher, event, kw);
+
+    publisher->publishing++;
+
     int sent_count = 0;
-    json_t *subs; size_t idx;
-    json_array_foreach(dl_subs, idx, subs) {
+    for(size_t idx=0; idx<subs_list.n; idx++) {
+        subscription_t *subscription = subs_list.items[idx];
+        if(subscription->deleted) {
+            continue;
+        }
+
         /*-------------------------------------*
          *  Pre-filter
          *  kw NOT owned! you can modify the publishing kw
@@ -6258,7 +8098,7 @@ PUBLIC int gobj_publish_event(
         if(publisher->gclass->gmt->mt_publication_pre_filter) {
             int topublish = publisher->gclass->gmt->mt_publication_pre_filter(
                 publisher,
-                subs,
+                subscription->subs,
                 event,
                 kw  // not owned
             );
@@ -6268,129 +8108,120 @@ PUBLIC int gobj_publish_event(
                 continue;
             }
         }
-        gobj_t *subscriber = (gobj_t *)(size_t)kw_get_int(
-            publisher, subs, "subscriber", 0, KW_REQUIRED
-        );
+        gobj_t *subscriber = subscription->subscriber;
         if(!(subscriber && !(subscriber->obflag & (obflag_destroying|obflag_destroyed)))) {
             continue;
         }
 
-        /*
-         *  Check if event null or event in event_list
-         */
-        subs_flag_t subs_flag = (subs_flag_t)kw_get_int(publisher, subs, "subs_flag", 0, KW_REQUIRED);
-        gobj_event_t event_ = (gobj_event_t)(size_t)kw_get_int(
-            publisher, subs, "event", 0, KW_REQUIRED
-        );
-        if(!event_ || event_ == event) {
-            // TODO check if need it: json_t *__config__ = kw_get_dict(publisher, subs, "__config__", 0, 0);
-            json_t *__global__ = kw_get_dict(publisher, subs, "__global__", 0, 0);
-            json_t *__local__ = kw_get_dict(publisher, subs, "__local__", 0, 0);
-            json_t *__filter__ = kw_get_dict(publisher, subs, "__filter__", 0, 0);
-
-            json_t *kw2publish = kw_incref(kw);
-
-            /*-------------------------------------*
-             *  User filter method or filter parameter
-             *  Return:
-             *     -1  (broke),
-             *      0  continue without publish,
-             *      1  continue and publish
-             *-------------------------------------*/
-            int topublish = 1;
-            if(publisher->gclass->gmt->mt_publication_filter) {
-                topublish = publisher->gclass->gmt->mt_publication_filter(
-                    publisher,
-                    event,
-                    kw2publish,  // not owned
-                    subscriber
-                );
-            } else if(__filter__) {
-                if(__publish_event_match__) {
-                    KW_INCREF(__filter__);
-                    topublish = __publish_event_match__(kw2publish , __filter__);
-                }
-            }
+        subs_flag_t subs_flag = subscription->subs_flag;
+        json_t *__global__ = subscription->__global__;
+        json_t *__local__ = subscription->__local__;
 
-            if(topublish<0) {
-                KW_DECREF(kw2publish);
-                break;
-            } else if(topublish==0) {
-                /*
-                 *  Must not be published
-                 *  Next subs
-                 */
-                KW_DECREF(kw2publish);
-                continue;
+        /*-------------------------------------*
+         *  User filter method or filter parameter
+         *  Return:
+         *     -1  (broke),
+         *      0  continue without publish,
+         *      1  continue and publish
+         *-------------------------------------*/
+        int topublish = 1;
+        if(publisher->gclass->gmt->mt_publication_filter) {
+            topublish = publisher->gclass->gmt->mt_publication_filter(
+                publisher,
+                event,
+                kw,  // not owned
+                subscriber
+            );
+        } else if(subscription->matcher) {
+            topublish = kw_matcher_match(subscription->matcher, kw);
+        } else if(subscription->__filter__) {
+            if(__publish_event_match__) {
+                KW_INCREF(subscription->__filter__);
+                topublish = __publish_event_match__(kw, subscription->__filter__);
             }
+        }
 
+        if(topublish<0) {
+            break;
+        } else if(topublish==0) {
             /*
-             *  Check if System event: don't send if subscriber has not it
+             *  Must not be published
+             *  Next subs
              */
-            if(event == EV_STATE_CHANGED) {
-                if(!gobj_has_input_event(subscriber, event)) {
-                    KW_DECREF(kw2publish);
-                    continue;
-                }
-            }
+            continue;
+        }
 
-            /*
-             *  Remove local keys
-             */
-            if(__local__) {
-                kw_pop(kw2publish,
-                    __local__ // not owned
-                );
-            }
+        json_t *kw2publish = kw_incref(kw);
 
-            /*
-             *  Add global keys
-             */
-            if(__global__) {
-                json_object_update(kw2publish, __global__);
+        /*
+         *  Check if System event: don't send if subscriber has not it
+         */
+        if(event == EV_STATE_CHANGED) {
+            if(!gobj_has_input_event(subscriber, event)) {
+                KW_DECREF(kw2publish);
+                continue;
             }
+        }
 
-            /*
-             *  Send event
-             */
-            if(tracea) {
-                trace_machine("🔝🔄 mach(%s%s), st: %s, ev: %s, from(%s%s)",
-                    (!subscriber->running)?"!!":"",
-                    gobj_short_name(subscriber),
-                    gobj_current_state(subscriber),
-                    event?event:"",
-                    (publisher && !publisher->running)?"!!":"",
-                    gobj_short_name(publisher)
-                );
-                if(__trace_gobj_ev_kw__(publisher)) {
-                    if(json_object_size(kw2publish)) {
-                        gobj_trace_json(publisher, kw2publish, "kw publish send event");
-                    }
-                }
-            }
+        /*
+         *  Remove local keys
+         */
+        if(__local__) {
+            kw_pop(kw2publish,
+                __local__ // not owned
+            );
+        }
 
-            int ret = gobj_send_event(
-                subscriber,
-                event,
-                kw2publish,
-                publisher
+        /*
+         *  Add global keys
+         */
+        if(__global__) {
+            json_object_update(kw2publish, __global__);
+        }
+
+        /*
+         *  Send event
+         */
+        if(tracea) {
+            trace_machine("🔝🔄 mach(%s%s), st: %s, ev: %s, from(%s%s)",
+                (!subscriber->running)?"!!":"",
+                gobj_short_name(subscriber),
+                gobj_current_state(subscriber),
+                event?event:"",
+                (publisher && !publisher->running)?"!!":"",
+                gobj_short_name(publisher)
             );
-            if(ret < 0 && (subs_flag & __own_event__)) {
-                sent_count = -1; // Return of -1 indicates that someone owned the event
-                break;
+            if(__trace_gobj_ev_kw__(publisher)) {
+                if(json_object_size(kw2publish)) {
+                    gobj_trace_json(publisher, kw2publish, "kw publish send event");
+                }
             }
-            sent_count++;
+        }
 
-            if(publisher->obflag & (obflag_destroying|obflag_destroyed)) {
-                /*
-                 *  break all, self publisher deleted
-                 */
-                break;
-            }
+        int ret = gobj_send_event(
+            subscriber,
+            event,
+            kw2publish,
+            publisher
+        );
+        if(ret < 0 && (subs_flag & __own_event__)) {
+            sent_count = -1; // Return of -1 indicates that someone owned the event
+            break;
+        }
+        sent_count++;
+
+        if(publisher->obflag & (obflag_destroying|obflag_destroyed)) {
+            /*
+             *  break all, self publisher deleted
+             */
+            break;
         }
     }
 
-    if(!sent_count) {
+    publisher->publishing--;
+    subs_list_free(&subs_list);
+
+    if(!sent_count && !(publisher->obflag & obflag_destroyed)) {
         if(!ev || !(ev->event_flag & EVF_NO_WARN_SUBS)) {
             gobj_log_warning(publisher, 0,
                 "msgset",       "%s", MSGSET_INFO,
@@ -6406,8 +8237,14 @@ PUBLIC int gobj_publish_event(
         }
     }
 
-    JSON_DECREF(dl_subs)
     KW_DECREF(kw)
+
+    if(!publisher->publishing) {
+        subs_index_purge(publisher);
+        if(publisher->obflag & obflag_destroyed) {
+            sys_free_fn(publisher);
+        }
+    }
     return sent_count;
 }
 
@@ -7033,43 +8870,75 @@ PUBLIC json_t *gobj_get_gobj_trace_no_level_tree(hgobj gobj)
 }
 
 /****************************************************************************
- *  Return gobj trace level
+ *  Invalidate the cached trace levels of all gobjs
  ****************************************************************************/
-PUBLIC uint32_t gobj_trace_level(hgobj gobj_)
+PRIVATE inline void trace_cache_invalidate(void)
 {
-    gobj_t * gobj = gobj_;
+    __trace_epoch__++;
+}
 
-    if(__deep_trace__) {
-        return (uint32_t)-1;
-    }
+/****************************************************************************
+ *  Compute the effective trace and no trace levels of gobj and cache them,
+ *  valid while __trace_epoch__ doesn't change.
+ ****************************************************************************/
+PRIVATE void trace_cache_update(gobj_t *gobj)
+{
+    uint64_t epoch = __trace_epoch__; // the reading of the filter attrs can change it
     uint32_t bitmask = __global_trace_level__;
-    if(gobj) {
-        if(!gobj->gclass->jn_trace_filter || !gobj->jn_attrs) {
-            bitmask |= gobj->trace_level;
-            if(gobj->gclass) {
-                bitmask |= gobj->gclass->trace_level;
-            }
-        } else {
-            const char *attr; json_t *jn_list_values;
-            json_object_foreach(gobj->gclass->jn_trace_filter, attr, jn_list_values) {
-                size_t idx; json_t *jn_value;
-                json_array_foreach(jn_list_values, idx, jn_value) {
-                    const char *value = json_string_value(jn_value);
-                    // TODO consider other types than str like int
-                    const char *value_ = gobj_read_str_attr(gobj, attr);
-                    if(value && value_ && strcmp(value, value_)==0) {
-                        bitmask |= gobj->trace_level;
-                        if(gobj->gclass) {
-                            bitmask |= gobj->gclass->trace_level;
-                        }
-                        break;
+    if(!gobj->gclass->jn_trace_filter || !gobj->jn_attrs) {
+        bitmask |= gobj->trace_level;
+        if(gobj->gclass) {
+            bitmask |= gobj->gclass->trace_level;
+        }
+    } else {
+        const char *attr; json_t *jn_list_values;
+        json_object_foreach(gobj->gclass->jn_trace_filter, attr, jn_list_values) {
+            size_t idx; json_t *jn_value;
+            json_array_foreach(jn_list_values, idx, jn_value) {
+                const char *value = json_string_value(jn_value);
+                // TODO consider other types than str like int
+                const char *value_ = gobj_read_str_attr(gobj, attr);
+                if(value && value_ && strcmp(value, value_)==0) {
+                    bitmask |= gobj->trace_level;
+                    if(gobj->gclass) {
+                        bitmask |= gobj->gclass->trace_level;
                     }
+                    break;
                 }
             }
         }
     }
+    gobj->trace_level_cached = bitmask;
+
+    bitmask = __global_trace_no_level__ | gobj->no_trace_level;
+    if(gobj->gclass) {
+        bitmask |= gobj->gclass->no_trace_level;
+    }
+    gobj->no_trace_level_cached = bitmask;
+
+    /*
+     *  Without attributes (creating or destroying) the filter is not applied, don't cache.
+     */
+    gobj->trace_epoch = gobj->jn_attrs? epoch : 0;
+}
+
+/****************************************************************************
+ *  Return gobj trace level
+ ****************************************************************************/
+PUBLIC uint32_t gobj_trace_level(hgobj gobj_)
+{
+    gobj_t * gobj = gobj_;
 
-    return bitmask;
+    if(__deep_trace__) {
+        return (uint32_t)-1;
+    }
+    if(!gobj) {
+        return __global_trace_level__;
+    }
+    if(gobj->trace_epoch != __trace_epoch__) {
+        trace_cache_update(gobj);
+    }
+    return gobj->trace_level_cached;
 }
 
 /****************************************************************************
@@ -7079,15 +8948,13 @@ PUBLIC uint32_t gobj_trace_no_level(hgobj gobj_)
 {
     gobj_t * gobj = gobj_;
 
-    uint32_t bitmask = __global_trace_no_level__;
-
-    if(gobj) {
-        bitmask |= gobj->no_trace_level;
-        if (gobj->gclass) {
-            bitmask |= gobj->gclass->no_trace_level;
-        }
+    if(!gobj) {
+        return __global_trace_no_level__;
+    }
+    if(gobj->trace_epoch != __trace_epoch__) {
+        trace_cache_update(gobj);
     }
-    return bitmask;
+    return gobj->no_trace_level_cached;
 }
 
 /****************************************************************************
@@ -7208,6 +9075,7 @@ PRIVATE int _set_gobj_trace_level(gobj_t * gobj, const char *level, BOOL set)
          */
         gobj->trace_level &= ~bitmask;
     }
+    trace_cache_invalidate();
 
     return 0;
 }
@@ -7290,6 +9158,7 @@ PUBLIC int gobj_set_gclass_trace(hgclass gclass_, const char *level, BOOL set)
          */
         gclass->trace_level &= ~bitmask;
     }
+    trace_cache_invalidate();
 
     return 0;
 }
@@ -7350,6 +9219,7 @@ PUBLIC int gobj_set_global_trace(const char *level, BOOL set)
          */
         __global_trace_level__ &= ~bitmask;
     }
+    trace_cache_invalidate();
     return 0;
 }
 
@@ -7394,6 +9264,7 @@ PUBLIC int gobj_set_global_no_trace(const char *level, BOOL set)
          */
         __global_trace_no_level__ &= ~bitmask;
     }
+    trace_cache_invalidate();
     return 0;
 }
 
@@ -7406,6 +9277,7 @@ PUBLIC int gobj_load_trace_filter(hgclass gclass_, json_t *jn_trace_filter) // o
 
     JSON_DECREF(gclass->jn_trace_filter)
     gclass->jn_trace_filter = jn_trace_filter;
+    trace_cache_invalidate();
     return 0;
 }
 
@@ -7460,6 +9332,7 @@ PUBLIC int gobj_add_trace_filter(hgclass gclass_, const char *attr, const char *
     if(idx < 0) {
         json_array_append_new(jn_list, json_string(value));
     }
+    trace_cache_invalidate();
     return 0;
 }
 
@@ -7472,6 +9345,7 @@ PUBLIC int gobj_remove_trace_filter(hgclass gclass_, const char *attr, const cha
 
     if(empty_string(attr)) {
         JSON_DECREF(gclass->jn_trace_filter)
+        trace_cache_invalidate();
         return 0;
     }
     if(!gclass->jn_trace_filter) {
@@ -7497,6 +9371,7 @@ PUBLIC int gobj_remove_trace_filter(hgclass gclass_, const char *attr, const cha
         if(json_object_size(gclass->jn_trace_filter)==0) {
             JSON_DECREF(gclass->jn_trace_filter)
         }
+        trace_cache_invalidate();
         return 0;
     }
 
@@ -7521,6 +9396,7 @@ PUBLIC int gobj_remove_trace_filter(hgclass gclass_, const char *attr, const cha
             JSON_DECREF(gclass->jn_trace_filter)
         }
     }
+    trace_cache_invalidate();
 
     return 0;
 }
@@ -7577,6 +9453,7 @@ PUBLIC int gobj_set_gclass_no_trace(hgclass gclass_, const char *level, BOOL set
          */
         gclass->no_trace_level &= ~bitmask;
     }
+    trace_cache_invalidate();
 
     return 0;
 }
@@ -7626,6 +9503,7 @@ PRIVATE int _set_gobj_trace_no_level(hgobj gobj_, const char *level, BOOL set)
          */
         gobj->no_trace_level &= ~bitmask;
     }
+    trace_cache_invalidate();
 
     return 0;
 }
@@ -7900,9 +9778,9 @@ PRIVATE void *_mem_malloc(size_t size)
         return NULL;
     }
 
-    __cur_system_memory__ += size;
+    size_t cur_system_memory = __atomic_add_fetch(&__cur_system_memory__, size, __ATOMIC_RELAXED);
 
-    if(__cur_system_memory__ > __max_system_memory__) {
+    if(cur_system_memory > __max_system_memory__) {
         gobj_log_critical(0, LOG_OPT_ABORT,
             "function",             "%s", __FUNCTION__,
             "msgset",               "%s", MSGSET_MEMORY_ERROR,
@@ -7959,7 +9837,7 @@ PRIVATE void _mem_free(void *p)
     dl_delete(&dl_busy_mem, pm_, 0);
 #endif
 
-    __cur_system_memory__ -= size;
+    __atomic_sub_fetch(&__cur_system_memory__, size, __ATOMIC_RELAXED);
     free(pm);
 }
 
@@ -7988,10 +9866,10 @@ PRIVATE void *_mem_realloc(void *p, size_t new_size)
     dl_delete(&dl_busy_mem, pm_, 0);
 #endif
 
-    __cur_system_memory__ -= size;
+    __atomic_sub_fetch(&__cur_system_memory__, size, __ATOMIC_RELAXED);
 
-    __cur_system_memory__ += new_size;
-    if(__cur_system_memory__ > __max_system_memory__) {
+    size_t cur_system_memory = __atomic_add_fetch(&__cur_system_memory__, new_size, __ATOMIC_RELAXED);
+    if(cur_system_memory > __max_system_memory__) {
         gobj_log_critical(0, LOG_OPT_ABORT,
             "function",             "%s", __FUNCTION__,
             "msgset",               "%s", MSGSET_MEMORY_ERROR,
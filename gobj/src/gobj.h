@@ -899,6 +899,7 @@ typedef enum { // HACK strict ascendant value!, strings in gclass_flag_names
     gcflag_ignore_unknown_attrs     = 0x0004,   // When creating a gobj, ignore not existing attrs
     gcflag_required_start_to_play   = 0x0008,   // Don't to play if no start done.
     gcflag_singleton                = 0x0010,   // Can only have one instance
+    gcflag_native_attrs             = 0x0020,   // Attributes in typed native slots, json only to introspect
 } gclass_flag_t;
 
 typedef enum { // HACK strict ascendant value!, strings in gobj_flag_names
@@ -958,7 +959,10 @@ GOBJ_DECLARE_EVENT(EV_DISCONNECT);
 GOBJ_DECLARE_EVENT(EV_DISCONNECTED);
 GOBJ_DECLARE_EVENT(EV_RX_DATA);
 GOBJ_DECLARE_EVENT(EV_TX_DATA);
+GOBJ_DECLARE_EVENT(EV_TX_FILE);
 GOBJ_DECLARE_EVENT(EV_TX_READY);
+GOBJ_DECLARE_EVENT(EV_TX_FULL);
+GOBJ_DECLARE_EVENT(EV_TX_RESUME);
 GOBJ_DECLARE_EVENT(EV_STOPPED);
 
 // Frequent states
@@ -1094,10 +1098,10 @@ PUBLIC void gobj_destroy_childs(hgobj gobj);
  *  Attribute functions
  *---------------------------------*/
 #define INCR_ATTR_INTEGER(__name__) \
-    gobj_write_integer_attr(gobj, #__name__, gobj_read_integer_attr(gobj, #__name__) + 1);
+    gobj_incr_integer_attr(gobj, #__name__, 1);
 
 #define INCR_ATTR_INTEGER2(__name__, __size__) \
-    gobj_write_integer_attr(gobj, #__name__, gobj_read_integer_attr(gobj, #__name__) + (__size__));
+    gobj_incr_integer_attr(gobj, #__name__, (__size__));
 
 #define RESET_ATTR_INTEGER(__name__) \
     gobj_write_integer_attr(gobj, #__name__, 0);
@@ -1125,7 +1129,12 @@ PUBLIC json_t * gobj_list_persistent_attrs(hgobj gobj, json_t *jn_attrs); // str
 PUBLIC const sdata_desc_t *gclass_attr_desc(hgclass gclass, const char *name, BOOL verbose);
 PUBLIC const sdata_desc_t *gobj_attr_desc(hgobj gobj, const char *attr, BOOL verbose);
 PUBLIC data_type_t gobj_attr_type(hgobj gobj, const char *name);
-PUBLIC json_t *gobj_hsdata(hgobj gobj); // Return is NOT YOURS
+/*
+ *  Return is NOT YOURS.
+ *  With gcflag_native_attrs it's a READ-ONLY copy of the typed slots, to introspect:
+ *  changes done in it are not seen by the gobj, use gobj_write_*_attr().
+ */
+PUBLIC json_t *gobj_hsdata(hgobj gobj);
 
 PUBLIC BOOL gclass_has_attr(hgclass gclass, const char* name);
 PUBLIC BOOL gobj_has_attr(hgobj hgobj, const char *name);
@@ -1192,6 +1201,34 @@ PUBLIC int gobj_write_json_attr(hgobj gobj, const char *name, json_t *value);
 PUBLIC int gobj_write_new_json_attr(hgobj gobj, const char *name, json_t *value);
 PUBLIC int gobj_write_pointer_attr(hgobj gobj, const char *name, void *value);
 
+PUBLIC json_int_t gobj_incr_integer_attr(hgobj gobj, const char *name, json_int_t value); // Return new value
+
+/*
+ *  Attribute functions by handle, WITHOUT bottom inheritance.
+ *
+ *  The handle is the index of the attribute in the attr's table of the gclass,
+ *  get it once with gclass_attr_handle(), it's valid for all gobjs of the gclass.
+ *  In gclasses with gcflag_native_attrs the attributes are in typed slots
+ *  and these functions read/write them directly, without json.
+ */
+PUBLIC int gclass_attr_handle(hgclass gclass, const char *name); // Return -1 if not found
+
+PUBLIC const char *gobj_read_str_attr_h(hgobj gobj, int handle);
+PUBLIC BOOL gobj_read_bool_attr_h(hgobj gobj, int handle);
+PUBLIC json_int_t gobj_read_integer_attr_h(hgobj gobj, int handle);
+PUBLIC double gobj_read_real_attr_h(hgobj gobj, int handle);
+PUBLIC json_t *gobj_read_json_attr_h(hgobj gobj, int handle); // WARNING return its NOT YOURS
+PUBLIC void *gobj_read_pointer_attr_h(hgobj gobj, int handle);
+
+PUBLIC int gobj_write_str_attr_h(hgobj gobj, int handle, const char *value);
+PUBLIC int gobj_write_bool_attr_h(hgobj gobj, int handle, BOOL value);
+PUBLIC int gobj_write_integer_attr_h(hgobj gobj, int handle, json_int_t value);
+PUBLIC int gobj_write_real_attr_h(hgobj gobj, int handle, double value);
+PUBLIC int gobj_write_json_attr_h(hgobj gobj, int handle, json_t *value); // value is incref
+PUBLIC int gobj_write_pointer_attr_h(hgobj gobj, int handle, void *value);
+
+PUBLIC json_int_t gobj_incr_integer_attr_h(hgobj gobj, int handle, json_int_t value); // Return new value
+
 /*--------------------------------------------*
  *  Operational functions
  *--------------------------------------------*/
@@ -1317,7 +1354,7 @@ PUBLIC int gobj_walk_gobj_childs_tree(
 /*---------------------------------*
  *      Info functions
  *---------------------------------*/
-PUBLIC hgobj gobj_yuno(void); // Return yuno, the grandfather (Only one yuno per process, single thread)
+PUBLIC hgobj gobj_yuno(void); // Return yuno, the grandfather (Only one yuno per process, see Loops)
 PUBLIC const char * gobj_name(hgobj gobj);
 PUBLIC gclass_name_t gobj_gclass_name(hgobj gobj);
 PUBLIC hgclass gobj_gclass(hgobj gobj);
@@ -1410,6 +1447,42 @@ PUBLIC gobj_state_t gobj_current_state(hgobj gobj);
 PUBLIC BOOL gobj_has_input_event(hgobj gobj, gobj_event_t event);
 PUBLIC event_type_t *gobj_event_type(hgobj gobj_, gobj_event_t event, event_flag_t event_flag);
 
+/*--------------------------------------------*
+ *          Loops
+ *
+ *  A yuno can run several event loops, each one in its own thread
+ *  with its own subtree of gobjs (see the `loops` attribute of C_YUNO in linux).
+ *  Each gobj belongs to the loop of the thread that created it (NULL the main thread),
+ *  and is dispatched only from that thread:
+ *      - gobj_send_event() to a gobj of other loop doesn't run the action,
+ *        the event is posted to the loop of the gobj (return 0, kw owned by the post)
+ *        and sent from its thread. The events posted to a gobj destroyed are dropped.
+ *      - the creation and destruction of gobjs, the services registry,
+ *        the memory accounting and the log are shared by all the loops.
+ *      - the rest of the api (attributes, subscriptions, start/stop, tree walks)
+ *        is not thread safe: use it with the gobjs of the own loop.
+ *        Between loops use events, the `src` of a posted event must live until it's sent
+ *        (a service or the root of the subtree of the loop).
+ *  The hooks are set by the owner of the loops before running them.
+ *--------------------------------------------*/
+typedef int (*gobj_post_event_fn_t)(
+    void *loop,         // loop of dst, NULL the main thread
+    hgobj dst,
+    gobj_event_t event,
+    json_t *kw,         // owned
+    hgobj src
+);
+typedef void (*gobj_purge_events_fn_t)(
+    hgobj gobj          // destroyed: drop the events posted to it, clear it as src
+);
+PUBLIC void gobj_set_loop_hooks(
+    gobj_post_event_fn_t post_event_fn,     // NULL: single loop
+    gobj_purge_events_fn_t purge_events_fn
+);
+PUBLIC void gobj_set_thread_loop(void *loop);   // Loop of the calling thread, the gobjs created by it are of the loop
+PUBLIC void *gobj_thread_loop(void);            // Loop of the calling thread, NULL the main thread
+PUBLIC void *gobj_loop(hgobj gobj);             // Loop of the gobj, NULL the main thread
+
 /*--------------------------------------------*
  *          Publication/Subscriptions
  *--------------------------------------------*/
@@ -1664,6 +1737,10 @@ PUBLIC json_t *gobj_get_gclass_trace_no_level_list(hgclass gclass);
 PUBLIC json_t *gobj_get_gobj_trace_level_tree(hgobj gobj);
 PUBLIC json_t *gobj_get_gobj_trace_no_level_tree(hgobj gobj);
 
+/*
+ *  Effective levels of gobj, cached in the gobj until a trace level, a trace filter
+ *  or an attribute is changed through the api.
+ */
 PUBLIC uint32_t gobj_trace_level(hgobj gobj);
 PUBLIC uint32_t gobj_trace_no_level(hgobj gobj);
 PUBLIC BOOL is_level_tracing(hgobj gobj, uint32_t level);
@@ -1838,6 +1915,11 @@ PUBLIC size_t dl_size(dl_list_t *dl);
 /*---------------------------------*
  *      GBuffer functions
  *---------------------------------*/
+typedef void (*gbuffer_free_data_fn_t)(
+    void *user_data,
+    char *data
+);
+
 typedef struct gbuffer_s {
     DL_ITEM_FIELDS
 
@@ -1861,6 +1943,13 @@ typedef struct gbuffer_s {
      *  In file_mode this buffer only is for read from file.
      */
     char *data;
+
+    /*
+     *  Not null if data is external (not owned, see gbuffer_create_external()),
+     *  called on remove to give back the data to the owner.
+     */
+    gbuffer_free_data_fn_t free_data_fn;
+    void *free_data_user;
 } gbuffer_t;
 
 #define GBUFFER_DECREF(ptr)    \
@@ -1879,6 +1968,18 @@ PUBLIC gbuffer_t *gbuffer_create(
     size_t data_size,
 size_t max_memory_size
 );
+/*
+ *  Create a gbuffer wrapping external data of `data_size` bytes, with `data_len` bytes already written.
+ *  Like gbuffer_create() the data must have room for data_size+1 bytes (final null).
+ *  The data is not owned and cannot grow: on remove `free_data_fn` is called to give it back.
+ */
+PUBLIC gbuffer_t *gbuffer_create_external(
+    char *data,
+    size_t data_size,
+    size_t data_len,
+    gbuffer_free_data_fn_t free_data_fn,
+    void *free_data_user
+);
 PUBLIC void gbuffer_remove(gbuffer_t *gbuf); /* WARNING do not call gbuffer_remove(), call gbuffer_decref() */
 PUBLIC void gbuffer_incref(gbuffer_t *gbuf);
 PUBLIC void gbuffer_decref(gbuffer_t *gbuf);
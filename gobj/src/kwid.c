@@ -38,6 +38,42 @@ typedef struct serialize_fields_s {
     decref_fn_t decref_fn;
 } serialize_fields_t;
 
+/*
+ *  Path compiled, see kw_path_create()
+ */
+struct kw_path_s {
+    char *path;             // full key
+    const char **segments;  // path split by delimiter
+    int n_segments;
+};
+
+/*
+ *  Filter of kw_match_simple() compiled, see kw_matcher_create()
+ */
+typedef enum {
+    KWM_TRUE = 0,           // NULL filter or empty dict at first level
+    KWM_FALSE,              // empty dict, or a filter not dict or list
+    KWM_ANY,                // list: some item matches
+    KWM_ALL,                // dict: all the simple values match, and the complex one if any
+    KWM_EQUAL,              // simple value of a dict
+} kwm_type_t;
+
+struct kw_matcher_s {
+    kwm_type_t type;
+    kw_matcher_t **items;   // ANY: the items, ALL: the simple values, the complex one the last
+    size_t n_items;
+    BOOL complex_last;      // ALL: the last item is a complex value (only the first is used)
+
+    /*
+     *  KWM_EQUAL: the constant converted like cmp_two_simple_json() does
+     */
+    kw_path_t *kw_path;
+    json_t *value;
+    double value_real;
+    json_int_t value_integer;
+    char *value_string;
+};
+
 /***************************************************************
  *              Data
  ***************************************************************/
@@ -1491,6 +1527,317 @@ PUBLIC BOOL kw_match_simple(
     return _kw_match_simple(kw, jn_filter, 0);
 }
 
+/***************************************************************************
+    Compile a path of kw_find_path()
+ ***************************************************************************/
+PUBLIC kw_path_t *kw_path_create(const char *path)
+{
+    kw_path_t *kw_path = GBMEM_MALLOC(sizeof(*kw_path));
+    if(!kw_path) {
+        gobj_log_error(0, 0,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_MEMORY_ERROR,
+            "msg",          "%s", "No memory",
+            "path",         "%s", path,
+            NULL
+        );
+        return NULL;
+    }
+    memset(kw_path, 0, sizeof(*kw_path));
+    kw_path->path = GBMEM_STRDUP(path?path:"");
+    if(!empty_string(path)) {
+        kw_path->segments = split2(path, delimiter, &kw_path->n_segments);
+    }
+    return kw_path;
+}
+
+/***************************************************************************
+    Find the value by the compiled path, else by the path as full key
+ ***************************************************************************/
+PUBLIC json_t *kw_path_find(kw_path_t *kw_path, json_t *kw)
+{
+    if(!(json_is_object(kw) || json_is_array(kw))) {
+        return 0;
+    }
+
+    json_t *v = 0;
+    if(kw_path->segments) {
+        v = kw;
+        for(int i=0; i<kw_path->n_segments && v; i++) {
+            const char *segment = kw_path->segments[i];
+            if(json_is_object(v)) {
+                v = json_object_get(v, segment);
+            } else if(json_is_array(v)) {
+                v = json_array_get(v, (size_t)atoi(segment));
+            } else {
+                // Like kw_find_path(), a simple value in the path is the result
+                break;
+            }
+        }
+    }
+    if(!v) {
+        v = json_object_get(kw, kw_path->path);
+    }
+    return v;
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PUBLIC const char *kw_path_path(kw_path_t *kw_path)
+{
+    return kw_path->path;
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PUBLIC void kw_path_destroy(kw_path_t *kw_path)
+{
+    if(!kw_path) {
+        return;
+    }
+    if(kw_path->segments) {
+        split_free2(kw_path->segments);
+    }
+    GBMEM_FREE(kw_path->path);
+    GBMEM_FREE(kw_path);
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PRIVATE kw_matcher_t *kwm_create(kwm_type_t type)
+{
+    kw_matcher_t *matcher = GBMEM_MALLOC(sizeof(*matcher));
+    if(!matcher) {
+        gobj_log_error(0, 0,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_MEMORY_ERROR,
+            "msg",          "%s", "No memory",
+            NULL
+        );
+        return NULL;
+    }
+    memset(matcher, 0, sizeof(*matcher));
+    matcher->type = type;
+    return matcher;
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PRIVATE int kwm_add_item(kw_matcher_t *matcher, kw_matcher_t *item)
+{
+    if(!item) {
+        return -1;
+    }
+    kw_matcher_t **items = GBMEM_REALLOC(
+        matcher->items,
+        (matcher->n_items + 1) * sizeof(kw_matcher_t *)
+    );
+    if(!items) {
+        kw_matcher_destroy(item);
+        return -1;
+    }
+    matcher->items = items;
+    matcher->items[matcher->n_items++] = item;
+    return 0;
+}
+
+/***************************************************************************
+ *  Compile a filter (not first level) like _kw_match_simple() evaluates it
+ ***************************************************************************/
+PRIVATE kw_matcher_t *kwm_compile(json_t *jn_filter)
+{
+    kw_matcher_t *matcher;
+
+    if(json_is_array(jn_filter)) {
+        // Empty array evaluate as false, until a match condition occurs.
+        matcher = kwm_create(KWM_ANY);
+        if(!matcher) {
+            return NULL;
+        }
+        size_t idx;
+        json_t *jn_filter_value;
+        json_array_foreach(jn_filter, idx, jn_filter_value) {
+            if(kwm_add_item(matcher, kwm_compile(jn_filter_value))<0) {
+                kw_matcher_destroy(matcher);
+                return NULL;
+            }
+        }
+        return matcher;
+    }
+
+    if(!json_is_object(jn_filter) || json_object_size(jn_filter)==0) {
+        // Empty object evaluate as false.
+        return kwm_create(KWM_FALSE);
+    }
+
+    matcher = kwm_create(KWM_ALL);
+    if(!matcher) {
+        return NULL;
+    }
+    const char *filter_path;
+    json_t *jn_filter_value;
+    json_object_foreach(jn_filter, filter_path, jn_filter_value) {
+        if(json_is_array(jn_filter_value) || json_is_object(jn_filter_value)) {
+            /*
+             *  Complex value: its match is the result, the next keys are not evaluated
+             */
+            if(kwm_add_item(matcher, kwm_compile(jn_filter_value))<0) {
+                kw_matcher_destroy(matcher);
+                return NULL;
+            }
+            matcher->complex_last = TRUE;
+            break;
+        }
+
+        /*
+         *  Simple value, op __equal__
+         */
+        kw_matcher_t *equal = kwm_create(KWM_EQUAL);
+        if(equal) {
+            equal->kw_path = kw_path_create(filter_path);
+            equal->value = json_incref(jn_filter_value);
+            equal->value_real = jn2real(jn_filter_value);
+            equal->value_integer = jn2integer(jn_filter_value);
+            equal->value_string = jn2string(jn_filter_value);
+            if(!equal->kw_path || !equal->value_string) {
+                kw_matcher_destroy(equal);
+                equal = NULL;
+            }
+        }
+        if(kwm_add_item(matcher, equal)<0) {
+            kw_matcher_destroy(matcher);
+            return NULL;
+        }
+    }
+    return matcher;
+}
+
+/***************************************************************************
+    Compile a filter of kw_match_simple()
+ ***************************************************************************/
+PUBLIC kw_matcher_t *kw_matcher_create(
+    json_t *jn_filter   // NOT owned
+)
+{
+    if(!jn_filter) {
+        // Si no hay filtro pasan todos.
+        return kwm_create(KWM_TRUE);
+    }
+    if(json_is_object(jn_filter) && json_object_size(jn_filter)==0) {
+        // A empty object at first level evaluate as true.
+        return kwm_create(KWM_TRUE);
+    }
+    return kwm_compile(jn_filter);
+}
+
+/***************************************************************************
+ *  Compare like cmp_two_simple_json() with the constant already converted
+ ***************************************************************************/
+PRIVATE BOOL kwm_equal(kw_matcher_t *matcher, json_t *kw)
+{
+    json_t *jn_record_value = kw_path_find(matcher->kw_path, kw);
+    if(!jn_record_value) {
+        return FALSE;
+    }
+
+    if(json_is_object(jn_record_value) || json_is_array(jn_record_value)) {
+        // Discard complex types, done as matched
+        return TRUE;
+    }
+    if(json_is_real(jn_record_value) || json_is_real(matcher->value)) {
+        double val1 = jn2real(jn_record_value);
+        return !(val1 > matcher->value_real) && !(val1 < matcher->value_real);
+    }
+    if(json_is_integer(jn_record_value) || json_is_integer(matcher->value) ||
+            json_is_boolean(jn_record_value) || json_is_boolean(matcher->value)) {
+        return jn2integer(jn_record_value) == matcher->value_integer;
+    }
+    const char *val1 = json_is_string(jn_record_value)? json_string_value(jn_record_value) : "";
+    return strcmp(val1, matcher->value_string)==0;
+}
+
+/***************************************************************************
+    Match a json dict with a compiled filter
+ ***************************************************************************/
+PUBLIC BOOL kw_matcher_match(
+    kw_matcher_t *matcher,
+    json_t *kw          // NOT owned
+)
+{
+    switch(matcher->type) {
+        case KWM_TRUE:
+            return TRUE;
+
+        case KWM_FALSE:
+            return FALSE;
+
+        case KWM_ANY:
+            for(size_t i=0; i<matcher->n_items; i++) {
+                if(kw_matcher_match(matcher->items[i], kw)) {
+                    return TRUE;
+                }
+            }
+            return FALSE;
+
+        case KWM_ALL:
+            for(size_t i=0; i<matcher->n_items; i++) {
+                kw_matcher_t *item = matcher->items[i];
+                if(item->type != KWM_EQUAL) {
+                    // The complex value, the last
+                    return kw_matcher_match(item, kw);
+                }
+                if(!kwm_equal(item, kw)) {
+                    return FALSE;
+                }
+            }
+            return TRUE;
+
+        case KWM_EQUAL:
+            return kwm_equal(matcher, kw);
+    }
+    return FALSE;
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PUBLIC void kw_matcher_destroy(kw_matcher_t *matcher)
+{
+    if(!matcher) {
+        return;
+    }
+    for(size_t i=0; i<matcher->n_items; i++) {
+        kw_matcher_destroy(matcher->items[i]);
+    }
+    GBMEM_FREE(matcher->items);
+    kw_path_destroy(matcher->kw_path);
+    json_decref(matcher->value); // json_true/false/null are not refcounted
+    GBMEM_FREE(matcher->value_string);
+    GBMEM_FREE(matcher);
+}
+
+/***************************************************************************
+    Return the path of the key if the matcher is an equality on only one key
+ ***************************************************************************/
+PUBLIC const char *kw_matcher_single_key(
+    kw_matcher_t *matcher,
+    json_t **value
+)
+{
+    if(matcher->type != KWM_ALL || matcher->n_items != 1 || matcher->complex_last) {
+        return NULL;
+    }
+    kw_matcher_t *equal = matcher->items[0];
+    if(value) {
+        *value = equal->value;
+    }
+    return equal->kw_path->path;
+}
+
 /***************************************************************************
     HACK Convention: private data begins with "_".
     Delete private keys
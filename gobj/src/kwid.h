@@ -360,6 +360,42 @@ typedef BOOL (*kw_match_fn)(
     json_t *jn_filter   // owned
 );
 
+/**rst**
+    Path of kw_find_path() compiled (segments split once).
+    kw_path_find() returns the value by path, else by the path as full key,
+    like kw_match_simple().
+**rst**/
+typedef struct kw_path_s kw_path_t;
+PUBLIC kw_path_t *kw_path_create(const char *path);
+PUBLIC json_t *kw_path_find(kw_path_t *kw_path, json_t *kw); // Return not yours
+PUBLIC const char *kw_path_path(kw_path_t *kw_path);
+PUBLIC void kw_path_destroy(kw_path_t *kw_path);
+
+/**rst**
+    Filter of kw_match_simple() compiled to a matcher:
+    paths resolved and the constants converted to their types once.
+    kw_matcher_match(matcher, kw) is equivalent to kw_match_simple(kw, jn_filter).
+    A NULL filter or an empty dict match all.
+**rst**/
+typedef struct kw_matcher_s kw_matcher_t;
+PUBLIC kw_matcher_t *kw_matcher_create(
+    json_t *jn_filter   // NOT owned
+);
+PUBLIC BOOL kw_matcher_match(
+    kw_matcher_t *matcher,
+    json_t *kw          // NOT owned
+);
+PUBLIC void kw_matcher_destroy(kw_matcher_t *matcher);
+
+/**rst**
+    If the matcher is an equality on only one key (ex: {"device_id": 7})
+    return the path of the key and the constant (not yours) in *value, else NULL.
+**rst**/
+PUBLIC const char *kw_matcher_single_key(
+    kw_matcher_t *matcher,
+    json_t **value
+);
+
 /**rst**
     HACK Convention: private data begins with "_".
     Delete private keys (only first level)
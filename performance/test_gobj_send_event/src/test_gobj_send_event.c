@@ -0,0 +1,266 @@
+/****************************************************************************
+ *          test_gobj_send_event
+ *
+ *          Benchmark of gobj_send_event():
+ *          a gclass with 40 events in every state, ns/op of the first,
+ *          the middle and the last event of the states, and of the events
+ *          that change of state.
+ *
+ *          Copyright (c) 2024 Niyamaka.
+ *          All Rights Reserved.
+ ****************************************************************************/
+#include <string.h>
+#include <time.h>
+#include <gobj.h>
+#include <stacktrace_with_bfd.h>
+
+/***************************************************************
+ *              Constants
+ ***************************************************************/
+#define C_BENCH_FSM "C_BENCH_FSM"
+#define BENCH_EVENTS    40
+#define BENCH_STATES    4
+
+/***************************************************************
+ *              Prototypes
+ ***************************************************************/
+PRIVATE int ac_count(hgobj gobj, const char *event, json_t *kw, hgobj src);
+
+/***************************************************************
+ *              Data
+ ***************************************************************/
+int bench_loops = 1000000;  // Set by command line
+uint64_t bench_actions = 0;
+
+char event_names[BENCH_EVENTS][16];
+gobj_event_t bench_events[BENCH_EVENTS];
+char state_names[BENCH_STATES][16];
+gobj_state_t bench_states[BENCH_STATES];
+
+/*---------------------------------------------*
+ *          Attributes
+ *---------------------------------------------*/
+PRIVATE sdata_desc_t tattr_desc[] = {
+/*-ATTR-type------------name----------------flag--------default-----description---------- */
+SDATA_END()
+};
+
+typedef struct _PRIVATE_DATA {
+    int dummy;
+} PRIVATE_DATA;
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PRIVATE int mt_state_changed(hgobj gobj, gobj_event_t event, json_t *kw)
+{
+    // Don't publish EV_STATE_CHANGED, only the dispatch is measured
+    json_decref(kw);
+    return 0;
+}
+
+PRIVATE const GMETHODS gmt = {
+    .mt_state_changed = mt_state_changed,
+};
+
+/***************************************************************************
+ *  Every state has the 40 events, the last one changes to the next state
+ ***************************************************************************/
+PRIVATE int register_c_bench_fsm(void)
+{
+    ev_action_t st_actions[BENCH_STATES][BENCH_EVENTS+1];
+    states_t states[BENCH_STATES+1];
+    event_type_t event_types[BENCH_EVENTS+1];
+
+    for(int i=0; i<BENCH_EVENTS; i++) {
+        snprintf(event_names[i], sizeof(event_names[i]), "EV_BENCH_%02d", i);
+        bench_events[i] = event_names[i];
+        event_types[i].event = bench_events[i];
+        event_types[i].event_flag = 0;
+    }
+    memset(&event_types[BENCH_EVENTS], 0, sizeof(event_type_t));
+
+    for(int i=0; i<BENCH_STATES; i++) {
+        snprintf(state_names[i], sizeof(state_names[i]), "ST_BENCH_%d", i);
+        bench_states[i] = state_names[i];
+    }
+
+    for(int s=0; s<BENCH_STATES; s++) {
+        for(int i=0; i<BENCH_EVENTS; i++) {
+            st_actions[s][i].event = bench_events[i];
+            st_actions[s][i].action = ac_count;
+            st_actions[s][i].next_state = (i == BENCH_EVENTS-1)?
+                bench_states[(s+1) % BENCH_STATES] : 0;
+        }
+        memset(&st_actions[s][BENCH_EVENTS], 0, sizeof(ev_action_t));
+        states[s].state_name = bench_states[s];
+        states[s].state = st_actions[s];
+    }
+    memset(&states[BENCH_STATES], 0, sizeof(states_t));
+
+    hgclass gclass = gclass_create(
+        C_BENCH_FSM,
+        event_types,
+        states,
+        &gmt,
+        0,  // lmt,
+        tattr_desc,
+        sizeof(PRIVATE_DATA),
+        0,  // authz_table,
+        0,  // command_table,
+        0,  // s_user_trace_level
+        0   // gclass_flag
+    );
+    return gclass? 0 : -1;
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PRIVATE int ac_count(hgobj gobj, const char *event, json_t *kw, hgobj src)
+{
+    bench_actions++;
+    return 0;
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PRIVATE uint64_t now_nsec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec*1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PRIVATE void bench_event(hgobj gobj, int idx)
+{
+    uint64_t t0 = now_nsec();
+    for(int i=0; i<bench_loops; i++) {
+        gobj_send_event(gobj, bench_events[idx], 0, gobj);
+    }
+    printf("send_event %-12s (%2d of %d): %8.1f ns/op\n",
+        bench_events[idx],
+        idx+1,
+        BENCH_EVENTS,
+        (double)(now_nsec() - t0)/bench_loops
+    );
+}
+
+/***************************************************************************
+ *              Test
+ ***************************************************************************/
+int do_test(void)
+{
+    if(register_c_bench_fsm()<0) {
+        return -1;
+    }
+    hgobj gobj = gobj_create_yuno("bench", C_BENCH_FSM, 0);
+    if(!gobj) {
+        return -1;
+    }
+
+    bench_event(gobj, 0);
+    bench_event(gobj, BENCH_EVENTS/2);
+    bench_event(gobj, BENCH_EVENTS-2);
+
+    /*
+     *  The last event changes of state, round robin of the states
+     */
+    uint64_t t0 = now_nsec();
+    for(int i=0; i<bench_loops; i++) {
+        gobj_send_event(gobj, bench_events[BENCH_EVENTS-1], 0, gobj);
+    }
+    printf("send_event %-12s (change of state): %8.1f ns/op\n",
+        bench_events[BENCH_EVENTS-1],
+        (double)(now_nsec() - t0)/bench_loops
+    );
+
+    t0 = now_nsec();
+    for(int i=0; i<bench_loops; i++) {
+        gobj_change_state(gobj, bench_states[i % BENCH_STATES]);
+    }
+    printf("change_state (%d states): %8.1f ns/op\n",
+        BENCH_STATES,
+        (double)(now_nsec() - t0)/bench_loops
+    );
+
+    printf("actions %lu\n", (unsigned long)bench_actions);
+
+    gobj_destroy(gobj);
+    return 0;
+}
+
+/***************************************************************************
+ *              Main
+ ***************************************************************************/
+int main(int argc, char *argv[])
+{
+    if(argc > 1) {
+        bench_loops = atoi(argv[1]);   // test_gobj_send_event <nº loops>
+        if(bench_loops <= 0) {
+            printf("Use: test_gobj_send_event [nº loops]\n");
+            exit(-1);
+        }
+    }
+
+    /*----------------------------------*
+     *      Startup gobj system
+     *----------------------------------*/
+    sys_malloc_fn_t malloc_func;
+    sys_realloc_fn_t realloc_func;
+    sys_calloc_fn_t calloc_func;
+    sys_free_fn_t free_func;
+
+    gobj_get_allocators(
+        &malloc_func,
+        &realloc_func,
+        &calloc_func,
+        &free_func
+    );
+
+    json_set_alloc_funcs(
+        malloc_func,
+        free_func
+    );
+
+#ifdef DEBUG
+    init_backtrace_with_bfd(argv[0]);
+    set_show_backtrace_fn(show_backtrace_with_bfd);
+#endif
+
+    gobj_start_up(
+        argc,
+        argv,
+        NULL, // jn_global_settings
+        NULL, // startup_persistent_attrs
+        NULL, // end_persistent_attrs
+        0,  // load_persistent_attrs
+        0,  // save_persistent_attrs
+        0,  // remove_persistent_attrs
+        0,  // list_persistent_attrs
+        NULL, // global_command_parser
+        NULL, // global_stats_parser
+        NULL, // global_authz_checker
+        NULL, // global_authenticate_parser
+        8*1024L,    // max_block, largest memory block
+        100*1024L   // max_system_memory, maximum system memory
+    );
+
+    /*--------------------------------*
+     *      Log handlers
+     *--------------------------------*/
+    gobj_log_add_handler("stdout", "stdout", LOG_OPT_ALL, 0);
+
+    /*--------------------------------*
+     *      Test
+     *--------------------------------*/
+    do_test();
+
+    gobj_end();
+
+    return gobj_get_exit_code();
+}
@@ -33,11 +33,19 @@ int who_drop = 0; // 0 client, 1 srv_cli, 2 server
 PUBLIC void yuno_catch_signals(void);
 PRIVATE int yev_server_callback(yev_event_t *event);
 PRIVATE int yev_client_callback(yev_event_t *event);
+PRIVATE int set_loop_mode(const char *mode);
 
 /***************************************************************
  *              Data
  ***************************************************************/
 yev_loop_t *yev_loop;
+yev_loop_options_t loop_options = { // Set by command line, see set_loop_mode()
+    .entries = 2024,
+    .sqpoll_cpu = -1,
+    .recv_buffer_size = BUFFER_SIZE
+};
+BOOL recv_multishot = FALSE;    // Set by command line, see set_loop_mode()
+BOOL send_zc = FALSE;           // Set by command line, see set_loop_mode()
 
 #ifdef LIKE_LIBUV_PING_PONG
 static char PING[] = "PING\n";
@@ -72,11 +80,14 @@ int do_test(void)
     /*--------------------------------*
      *  Create the event loop
      *--------------------------------*/
-    yev_loop_create(
+    yev_loop_create2(
         NULL,
-        2024,
+        &loop_options,
         &yev_loop
     );
+    json_t *jn_loop_mode = bits2jn_strlist(yev_loop_mode_strings(), yev_loop->mode);
+    gobj_trace_json(0, jn_loop_mode, "io_uring mode, batch %s", yev_loop->batch_submit?"on":"off");
+    json_decref(jn_loop_mode);
 
     /*--------------------------------*
      *      Setup server
@@ -182,6 +193,7 @@ PRIVATE int yev_server_callback(yev_event_t *yev_event)
 
     switch(yev_event->type) {
         case YEV_READ_TYPE:
+        case YEV_RECV_MULTISHOT_TYPE:
             {
                 if(yev_event->result < 0) {
                     /*
@@ -197,17 +209,17 @@ PRIVATE int yev_server_callback(yev_event_t *yev_event)
                     seconds_count++;
                     if(seconds_count && (seconds_count % drop_in_seconds)==0) {
                         if(who_drop) {
-                            printf(Cursor_Down, 3);
+                            printf(Cursor_Down, 4);
                             printf(Move_Horizontal, 1);
                             switch(who_drop) {
                                 case 1:
-                                    close(fd_connect);
+                                    yev_close_fd(yev_loop, fd_connect);
                                     break;
                                 case 2:
-                                    close(srv_cli_fd);
+                                    yev_close_fd(yev_loop, srv_cli_fd);
                                     break;
                                 case 3:
-                                    close(fd_listen);
+                                    yev_close_fd(yev_loop, fd_listen);
                                     break;
                             }
                         }
@@ -220,7 +232,17 @@ PRIVATE int yev_server_callback(yev_event_t *yev_event)
                     printf(Erase_Whole_Line Move_Horizontal, 1);
                     nice_size(nice, sizeof(nice), bytes_per_second);
                     printf("Bytes/sec  : %s\n", nice);
-                    printf(Cursor_Up, 3);
+                    json_t *jn_stats = yev_loop_stats(yev_loop, TRUE);
+                    printf(Erase_Whole_Line Move_Horizontal, 1);
+                    printf("Syscalls/iteration: %.2f, CQEs/batch: %.2f (max %d), batch %s, fixed files %d\n",
+                        json_real_value(json_object_get(jn_stats, "syscalls_per_iteration")),
+                        json_real_value(json_object_get(jn_stats, "cqes_per_batch")),
+                        (int)json_integer_value(json_object_get(jn_stats, "max_cqe_batch")),
+                        yev_loop->batch_submit?"on":"off",
+                        (int)json_integer_value(json_object_get(jn_stats, "fixed_files_in_use"))
+                    );
+                    json_decref(jn_stats);
+                    printf(Cursor_Up, 4);
                     printf(Move_Horizontal, 1);
 
                     fflush(stdout);
@@ -249,15 +271,18 @@ PRIVATE int yev_server_callback(yev_event_t *yev_event)
 
                 /*
                  *  Clear buffer
-                 *  Re-arm read
+                 *  Re-arm read, the multishot recv keeps armed
                  */
-                gbuffer_clear(yev_event->gbuf);
-                yev_set_gbuffer(yev_server_rx, yev_event->gbuf);
-                yev_start_event(yev_server_rx);
+                if(yev_event->type == YEV_READ_TYPE) {
+                    gbuffer_clear(yev_event->gbuf);
+                    yev_set_gbuffer(yev_server_rx, yev_event->gbuf);
+                    yev_start_event(yev_server_rx);
+                }
             }
             break;
 
         case YEV_WRITE_TYPE:
+        case YEV_SEND_ZC_TYPE:
             {
                 if(yev_event->result < 0) {
                     /*
@@ -282,18 +307,29 @@ PRIVATE int yev_server_callback(yev_event_t *yev_event)
                 /*
                  *  Ready to receive
                  */
-                if(!gbuf_server_rx) {
-                    gbuf_server_rx = gbuffer_create(BUFFER_SIZE, BUFFER_SIZE);
-                    gbuffer_setlabel(gbuf_server_rx, "server-rx");
-                }
-                if(!yev_server_rx) {
-                    yev_server_rx = yev_create_read_event(
-                        yev_event->yev_loop,
-                        yev_server_callback,
-                        NULL,
-                        srv_cli_fd,
-                        0
-                    );
+                if(recv_multishot) {
+                    if(!yev_server_rx) {
+                        yev_server_rx = yev_create_recv_multishot_event(
+                            yev_event->yev_loop,
+                            yev_server_callback,
+                            NULL,
+                            srv_cli_fd
+                        );
+                    }
+                } else {
+                    if(!gbuf_server_rx) {
+                        gbuf_server_rx = gbuffer_create(BUFFER_SIZE, BUFFER_SIZE);
+                        gbuffer_setlabel(gbuf_server_rx, "server-rx");
+                    }
+                    if(!yev_server_rx) {
+                        yev_server_rx = yev_create_read_event(
+                            yev_event->yev_loop,
+                            yev_server_callback,
+                            NULL,
+                            srv_cli_fd,
+                            0
+                        );
+                    }
                 }
 
                 /*
@@ -304,7 +340,7 @@ PRIVATE int yev_server_callback(yev_event_t *yev_event)
                     gbuffer_setlabel(gbuf_server_tx, "server-tx");
                 }
                 if(!yev_server_tx) {
-                    yev_server_tx = yev_create_write_event(
+                    yev_server_tx = (send_zc? yev_create_send_zc_event : yev_create_write_event)(
                         yev_event->yev_loop,
                         yev_server_callback,
                         NULL,
@@ -312,7 +348,9 @@ PRIVATE int yev_server_callback(yev_event_t *yev_event)
                         0
                     );
                 }
-                yev_set_gbuffer(yev_server_rx, gbuf_server_rx);
+                if(!recv_multishot) {
+                    yev_set_gbuffer(yev_server_rx, gbuf_server_rx);
+                }
                 yev_start_event(yev_server_rx);
             }
             break;
@@ -362,6 +400,7 @@ PRIVATE int yev_client_callback(yev_event_t *yev_event)
 
     switch(yev_event->type) {
         case YEV_READ_TYPE:
+        case YEV_RECV_MULTISHOT_TYPE:
             {
                 if(yev_event->result < 0) {
                     /*
@@ -391,14 +430,17 @@ PRIVATE int yev_client_callback(yev_event_t *yev_event)
 
                 /*
                  *  Clear buffer
-                 *  Re-arm read
+                 *  Re-arm read, the multishot recv keeps armed
                  */
-                gbuffer_clear(yev_event->gbuf);
-                yev_start_event(yev_client_rx);
+                if(yev_event->type == YEV_READ_TYPE) {
+                    gbuffer_clear(yev_event->gbuf);
+                    yev_start_event(yev_client_rx);
+                }
             }
             break;
 
         case YEV_WRITE_TYPE:
+        case YEV_SEND_ZC_TYPE:
             {
                 if(yev_event->result < 0) {
                     /*
@@ -429,20 +471,31 @@ PRIVATE int yev_client_callback(yev_event_t *yev_event)
                 /*
                  *  Ready to receive
                  */
-                if(!gbuf_client_rx) {
-                    gbuf_client_rx = gbuffer_create(BUFFER_SIZE, BUFFER_SIZE);
-                    gbuffer_setlabel(gbuf_client_rx, "client-rx");
-                }
-                if(!yev_client_rx) {
-                    yev_client_rx = yev_create_read_event(
-                        yev_event->yev_loop,
-                        yev_client_callback,
-                        NULL,
-                        yev_event->fd,
-                        0
-                    );
+                if(recv_multishot) {
+                    if(!yev_client_rx) {
+                        yev_client_rx = yev_create_recv_multishot_event(
+                            yev_event->yev_loop,
+                            yev_client_callback,
+                            NULL,
+                            yev_event->fd
+                        );
+                    }
+                } else {
+                    if(!gbuf_client_rx) {
+                        gbuf_client_rx = gbuffer_create(BUFFER_SIZE, BUFFER_SIZE);
+                        gbuffer_setlabel(gbuf_client_rx, "client-rx");
+                    }
+                    if(!yev_client_rx) {
+                        yev_client_rx = yev_create_read_event(
+                            yev_event->yev_loop,
+                            yev_client_callback,
+                            NULL,
+                            yev_event->fd,
+                            0
+                        );
+                    }
+                    yev_set_gbuffer(yev_client_rx, gbuf_client_rx);
                 }
-                yev_set_gbuffer(yev_client_rx, gbuf_client_rx);
                 yev_start_event(yev_client_rx);
 
                 /*
@@ -461,7 +514,7 @@ PRIVATE int yev_client_callback(yev_event_t *yev_event)
                 }
 
                 if(!yev_client_tx) {
-                    yev_client_tx = yev_create_write_event(
+                    yev_client_tx = (send_zc? yev_create_send_zc_event : yev_create_write_event)(
                         yev_event->yev_loop,
                         yev_client_callback,
                         NULL,
@@ -494,11 +547,60 @@ PRIVATE int yev_client_callback(yev_event_t *yev_event)
     return 0;
 }
 
+/***************************************************************************
+ *  io_uring setup mode from command line:
+ *      default | no_batch | coop_taskrun | single_issuer | defer_taskrun | sqpoll | recv_multishot | no_fixed_files | send_zc
+ ***************************************************************************/
+PRIVATE int set_loop_mode(const char *mode)
+{
+    SWITCHS(mode) {
+        CASES("default")
+            break;
+        CASES("no_batch")
+            loop_options.no_batch_submit = TRUE;
+            break;
+        CASES("coop_taskrun")
+            loop_options.mode = YEV_LOOP_COOP_TASKRUN;
+            break;
+        CASES("single_issuer")
+            loop_options.mode = YEV_LOOP_SINGLE_ISSUER;
+            break;
+        CASES("defer_taskrun")
+            loop_options.mode = YEV_LOOP_DEFER_TASKRUN;
+            break;
+        CASES("sqpoll")
+            loop_options.mode = YEV_LOOP_SQPOLL;
+            loop_options.sqpoll_idle = 1000;
+            break;
+        CASES("recv_multishot")
+            recv_multishot = TRUE;
+            break;
+        CASES("no_fixed_files")
+            loop_options.no_fixed_files = TRUE;
+            break;
+        CASES("send_zc")
+            send_zc = TRUE;
+            break;
+        DEFAULTS
+            printf("Mode unknown: %s\n", mode);
+            printf("Use: default | no_batch | coop_taskrun | single_issuer | defer_taskrun | sqpoll | recv_multishot | no_fixed_files | send_zc\n");
+            return -1;
+    } SWITCHS_END;
+
+    return 0;
+}
+
 /***************************************************************************
  *              Main
  ***************************************************************************/
 int main(int argc, char *argv[])
 {
+    if(argc > 1) {
+        if(set_loop_mode(argv[1])<0) {
+            exit(-1);
+        }
+    }
+
     /*----------------------------------*
      *      Startup gobj system
      *----------------------------------*/
@@ -558,7 +660,7 @@ int main(int argc, char *argv[])
      *--------------------------------*/
     do_test();
 
-    printf(Cursor_Down "\n", 4);
+    printf(Cursor_Down "\n", 5);
 
     gobj_end();
 
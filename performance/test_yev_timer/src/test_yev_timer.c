@@ -6,6 +6,8 @@
  ****************************************************************************/
 #include <string.h>
 #include <signal.h>
+#include <time.h>
+#include <sys/resource.h>
 #include <gobj.h>
 #include <stacktrace_with_bfd.h>
 #include <yunetas_ev_loop.h>
@@ -15,17 +17,34 @@
  ***************************************************************/
 PUBLIC void yuno_catch_signals(void);
 PRIVATE int yev_callback(yev_event_t *event);
+PRIVATE int yev_bench_callback(yev_event_t *event);
+PRIVATE int set_loop_mode(const char *mode);
 
 /***************************************************************
  *              Data
  ***************************************************************/
 yev_loop_t *yev_loop;
+yev_loop_options_t loop_options = { // Set by command line, see set_loop_mode()
+    .entries = 2024,
+    .sqpoll_cpu = -1
+};
 yev_event_t *yev_event_once;
 yev_event_t *yev_event_periodic;
 int wait_time = 1;
 int times_once = 0;
 int times_periodic = 0;
 
+/*
+ *  Benchmark, see do_bench()
+ */
+int bench_timers = 0;       // Set by command line, nº of timers
+int bench_seconds = 5;
+yev_event_t **bench_events;
+yev_event_t *bench_end;
+uint64_t bench_fired = 0;
+uint64_t bench_late_sum = 0;
+uint64_t bench_late_max = 0;
+
 /***************************************************************************
  *              Test
  ***************************************************************************/
@@ -34,11 +53,14 @@ int do_test(void)
     /*--------------------------------*
      *  Create the event loop
      *--------------------------------*/
-    yev_loop_create(
+    yev_loop_create2(
         0,
-        2024,
+        &loop_options,
         &yev_loop
     );
+    json_t *jn_loop_mode = bits2jn_strlist(yev_loop_mode_strings(), yev_loop->mode);
+    gobj_trace_json(0, jn_loop_mode, "io_uring mode, batch %s", yev_loop->batch_submit?"on":"off");
+    json_decref(jn_loop_mode);
 
     /*--------------------------------*
      *      Create timer
@@ -65,6 +87,129 @@ int do_test(void)
     return 0;
 }
 
+/***************************************************************************
+ *
+ ***************************************************************************/
+PRIVATE uint64_t now_nsec(int clock)
+{
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (uint64_t)ts.tv_sec*1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PRIVATE uint64_t cpu_usec(void)
+{
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return (uint64_t)(ru.ru_utime.tv_sec + ru.ru_stime.tv_sec)*1000000ULL +
+        (uint64_t)(ru.ru_utime.tv_usec + ru.ru_stime.tv_usec);
+}
+
+/***************************************************************************
+ *  Benchmark: `bench_timers` periodic timers, of 500 to 1499 miliseconds
+ *      - create, start, restart (stop + start, like clear_timeout() + set_timeout())
+ *      - run the loop `bench_seconds` seconds: expirations, lateness and cpu
+ ***************************************************************************/
+int do_bench(void)
+{
+    uint64_t t0;
+
+    yev_loop_create2(
+        0,
+        &loop_options,
+        &yev_loop
+    );
+
+    bench_events = GBMEM_MALLOC(sizeof(yev_event_t *) * (size_t)bench_timers);
+    if(!bench_events) {
+        printf("No memory for %d timers\n", bench_timers);
+        return -1;
+    }
+
+    srand(1);
+    t0 = now_nsec(CLOCK_MONOTONIC);
+    for(int i=0; i<bench_timers; i++) {
+        bench_events[i] = yev_create_timer_event(yev_loop, yev_bench_callback, NULL);
+    }
+    printf("create  %d timers: %8.1f ns/timer\n", bench_timers,
+        (double)(now_nsec(CLOCK_MONOTONIC) - t0)/bench_timers);
+
+    t0 = now_nsec(CLOCK_MONOTONIC);
+    for(int i=0; i<bench_timers; i++) {
+        yev_start_timer_event(bench_events[i], 500 + rand()%1000, TRUE);
+    }
+    printf("start   %d timers: %8.1f ns/timer\n", bench_timers,
+        (double)(now_nsec(CLOCK_MONOTONIC) - t0)/bench_timers);
+
+    t0 = now_nsec(CLOCK_MONOTONIC);
+    for(int i=0; i<bench_timers; i++) {
+        yev_stop_event(bench_events[i]);
+        yev_start_timer_event(bench_events[i], 500 + rand()%1000, TRUE);
+    }
+    printf("restart %d timers: %8.1f ns/timer\n", bench_timers,
+        (double)(now_nsec(CLOCK_MONOTONIC) - t0)/bench_timers);
+
+    bench_end = yev_create_timer_event(yev_loop, yev_bench_callback, NULL);
+    yev_start_timer_event(bench_end, bench_seconds*1000, FALSE);
+
+    uint64_t cpu0 = cpu_usec();
+    t0 = now_nsec(CLOCK_MONOTONIC);
+    yev_loop_run(yev_loop);
+    double elapsed = (double)(now_nsec(CLOCK_MONOTONIC) - t0)/1e9;
+    uint64_t cpu = cpu_usec() - cpu0;
+
+    json_t *jn_stats = yev_loop_stats(yev_loop, FALSE);
+    printf("run %.1f s: %lu expirations (%.0f/s), late avg %.2f ms max %lu ms, cpu %.1f%%, %lu syscalls\n",
+        elapsed,
+        (unsigned long)bench_fired,
+        (double)bench_fired/elapsed,
+        bench_fired? (double)bench_late_sum/(double)bench_fired : 0,
+        (unsigned long)bench_late_max,
+        (double)cpu/(elapsed*1e6)*100,
+        (unsigned long)json_integer_value(json_object_get(jn_stats, "enter_calls"))
+    );
+    json_decref(jn_stats);
+
+    t0 = now_nsec(CLOCK_MONOTONIC);
+    for(int i=0; i<bench_timers; i++) {
+        yev_destroy_event(bench_events[i]);
+    }
+    printf("destroy %d timers: %8.1f ns/timer\n", bench_timers,
+        (double)(now_nsec(CLOCK_MONOTONIC) - t0)/bench_timers);
+
+    yev_destroy_event(bench_end);
+    GBMEM_FREE(bench_events)
+    yev_loop_destroy(yev_loop);
+
+    return 0;
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PRIVATE int yev_bench_callback(yev_event_t *yev_event)
+{
+    if(yev_event->result < 0) {
+        return 0;   // cancelled
+    }
+    if(yev_event == bench_end) {
+        yev_loop_stop(yev_loop);
+        return 0;
+    }
+
+    bench_fired++;
+    uint64_t now = now_nsec(CLOCK_MONOTONIC)/1000000;
+    uint64_t late = now > yev_event->tw_expires? now - yev_event->tw_expires : 0;
+    bench_late_sum += late;
+    if(late > bench_late_max) {
+        bench_late_max = late;
+    }
+    return 0;
+}
+
 /***************************************************************************
  *  Callback that will be executed when the timer period lapses.
  *  Posts the timer expiry event to the default event loop.
@@ -127,11 +272,54 @@ PRIVATE int yev_callback(yev_event_t *yev_event)
     return 0;
 }
 
+/***************************************************************************
+ *  io_uring setup mode from command line:
+ *      default | no_batch | coop_taskrun | single_issuer | defer_taskrun | sqpoll
+ ***************************************************************************/
+PRIVATE int set_loop_mode(const char *mode)
+{
+    SWITCHS(mode) {
+        CASES("default")
+            break;
+        CASES("no_batch")
+            loop_options.no_batch_submit = TRUE;
+            break;
+        CASES("coop_taskrun")
+            loop_options.mode = YEV_LOOP_COOP_TASKRUN;
+            break;
+        CASES("single_issuer")
+            loop_options.mode = YEV_LOOP_SINGLE_ISSUER;
+            break;
+        CASES("defer_taskrun")
+            loop_options.mode = YEV_LOOP_DEFER_TASKRUN;
+            break;
+        CASES("sqpoll")
+            loop_options.mode = YEV_LOOP_SQPOLL;
+            loop_options.sqpoll_idle = 1000;
+            break;
+        DEFAULTS
+            printf("Mode unknown: %s\n", mode);
+            printf("Use: default | no_batch | coop_taskrun | single_issuer | defer_taskrun | sqpoll\n");
+            return -1;
+    } SWITCHS_END;
+
+    return 0;
+}
+
 /***************************************************************************
  *              Main
  ***************************************************************************/
 int main(int argc, char *argv[])
 {
+    if(argc > 1) {
+        if(set_loop_mode(argv[1])<0) {
+            exit(-1);
+        }
+    }
+    if(argc > 2) {
+        bench_timers = atoi(argv[2]);   // test_yev_timer <mode> <nº timers>: benchmark
+    }
+
     /*----------------------------------*
      *      Startup gobj system
      *----------------------------------*/
@@ -174,8 +362,8 @@ int main(int argc, char *argv[])
         NULL, // global_stats_parser
         NULL, // global_authz_checker
         NULL, // global_authenticate_parser
-        8*1024L,    // max_block, largest memory block
-        100*1024L   // max_system_memory, maximum system memory
+        bench_timers? 1024*1024L : 8*1024L,     // max_block, largest memory block
+        bench_timers? 1024*1024*1024L : 100*1024L  // max_system_memory, maximum system memory
     );
 
     yuno_catch_signals();
@@ -189,7 +377,11 @@ int main(int argc, char *argv[])
     /*--------------------------------*
      *      Test
      *--------------------------------*/
-    do_test();
+    if(bench_timers > 0) {
+        do_bench();
+    } else {
+        do_test();
+    }
 
     gobj_end();
 
@@ -0,0 +1,503 @@
+/****************************************************************************
+ *          test_yev_udp
+ *
+ *          Datagrams received (and echoed) by the yev loop
+ *          from a local udp blaster (a thread sending with sendmmsg()).
+ *
+ *          Copyright (c) 2024 Niyamaka.
+ *          All Rights Reserved.
+ ****************************************************************************/
+#include <string.h>
+#include <signal.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <gobj.h>
+#include <ansi_escape_codes.h>
+#include <stacktrace_with_bfd.h>
+#include <yunetas_ev_loop.h>
+
+/***************************************************************
+ *              Constants
+ ***************************************************************/
+BOOL dump = FALSE;
+int time2exit = 10;
+
+int server_port = 2223;
+
+#define DGRAM_SIZE      512
+#define BLASTER_BATCH   32      // datagrams by sendmmsg()
+#define MAX_ECHOES      256     // sendmsg events in flight
+
+/***************************************************************
+ *              Prototypes
+ ***************************************************************/
+PUBLIC void yuno_catch_signals(void);
+PRIVATE int yev_server_callback(yev_event_t *event);
+PRIVATE int set_test_mode(const char *mode);
+
+/***************************************************************
+ *              Data
+ ***************************************************************/
+yev_loop_t *yev_loop;
+yev_loop_options_t loop_options = {
+    .entries = 2024,
+    .sqpoll_cpu = -1,
+    .recv_buffers = 1024,
+    .recv_buffer_size = 2048
+};
+BOOL recv_multishot = FALSE;    // Set by command line, see set_test_mode()
+BOOL echo = FALSE;              // Set by command line, see set_test_mode()
+
+volatile BOOL blaster_running = TRUE;
+uint64_t blaster_sent = 0;
+
+int fd_server;
+yev_event_t *yev_server_rx = 0;
+yev_event_t *yev_timer = 0;
+yev_event_t *yev_echoes[MAX_ECHOES];       // all the sendmsg events
+yev_event_t *yev_free_echoes[MAX_ECHOES];  // stack of the free ones
+int n_free_echoes = 0;
+
+uint64_t dgrams_per_second = 0;
+uint64_t bytes_per_second = 0;
+uint64_t echoes_per_second = 0;
+uint64_t echoes_dropped = 0;
+
+/***************************************************************************
+ *  The blaster: send datagrams as fast as possible, in batches of sendmmsg()
+ ***************************************************************************/
+PRIVATE void *blaster(void *arg)
+{
+    int fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if(fd < 0) {
+        printf("blaster socket() FAILED: %s\n", strerror(errno));
+        return NULL;
+    }
+
+    struct sockaddr_in dst = {
+        .sin_family = AF_INET,
+        .sin_port = htons((uint16_t)server_port),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK)
+    };
+    if(connect(fd, (struct sockaddr *)&dst, sizeof(dst)) < 0) {
+        printf("blaster connect() FAILED: %s\n", strerror(errno));
+        close(fd);
+        return NULL;
+    }
+
+    static char data[DGRAM_SIZE];
+    memset(data, 'A', sizeof(data));
+
+    struct iovec iov = {
+        .iov_base = data,
+        .iov_len = sizeof(data)
+    };
+    struct mmsghdr msgs[BLASTER_BATCH];
+    memset(msgs, 0, sizeof(msgs));
+    for(int i=0; i<BLASTER_BATCH; i++) {
+        msgs[i].msg_hdr.msg_iov = &iov;
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    while(blaster_running) {
+        int ret = sendmmsg(fd, msgs, BLASTER_BATCH, 0);
+        if(ret > 0) {
+            __atomic_add_fetch(&blaster_sent, (uint64_t)ret, __ATOMIC_RELAXED);
+        } else if(ret < 0 && errno != EAGAIN && errno != ENOBUFS && errno != ECONNREFUSED) {
+            printf("blaster sendmmsg() FAILED: %s\n", strerror(errno));
+            break;
+        }
+    }
+
+    close(fd);
+    return NULL;
+}
+
+/***************************************************************************
+ *              Test
+ ***************************************************************************/
+int do_test(void)
+{
+    /*--------------------------------*
+     *  Create the event loop
+     *--------------------------------*/
+    yev_loop_create2(
+        NULL,
+        &loop_options,
+        &yev_loop
+    );
+    json_t *jn_loop_mode = bits2jn_strlist(yev_loop_mode_strings(), yev_loop->mode);
+    gobj_trace_json(0, jn_loop_mode, "io_uring mode, batch %s", yev_loop->batch_submit?"on":"off");
+    json_decref(jn_loop_mode);
+
+    /*--------------------------------*
+     *      Setup server
+     *--------------------------------*/
+    fd_server = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons((uint16_t)server_port),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK)
+    };
+    int rcvbuf = 4*1024*1024;
+    setsockopt(fd_server, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    if(bind(fd_server, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        gobj_trace_msg(0, "Error bind udp port %d: %s", server_port, strerror(errno));
+        exit(0);
+    }
+
+    if(recv_multishot) {
+        yev_server_rx = yev_create_recvmsg_multishot_event(
+            yev_loop,
+            yev_server_callback,
+            NULL,
+            fd_server
+        );
+    } else {
+        yev_server_rx = yev_create_recvmsg_event(
+            yev_loop,
+            yev_server_callback,
+            NULL,
+            fd_server,
+            gbuffer_create(DGRAM_SIZE*4, DGRAM_SIZE*4)
+        );
+    }
+    yev_start_event(yev_server_rx);
+
+    if(echo) {
+        for(int i=0; i<MAX_ECHOES; i++) {
+            yev_echoes[i] = yev_create_sendmsg_event(
+                yev_loop,
+                yev_server_callback,
+                NULL,
+                fd_server,
+                NULL
+            );
+            yev_free_echoes[n_free_echoes++] = yev_echoes[i];
+        }
+    }
+
+    yev_timer = yev_create_timer_event(yev_loop, yev_server_callback, NULL);
+    yev_start_timer_event(yev_timer, 1000, TRUE);
+
+    /*--------------------------------*
+     *      Start the blaster
+     *--------------------------------*/
+    pthread_t blaster_thread;
+    pthread_create(&blaster_thread, NULL, blaster, NULL);
+
+    printf("\n----------------> Quit in %d seconds <-----------------\n\n", time2exit);
+
+    /*--------------------------------*
+     *      Begin run loop
+     *--------------------------------*/
+    yev_loop_run(yev_loop);
+
+    /*--------------------------------*
+     *      Stop
+     *--------------------------------*/
+    blaster_running = FALSE;
+    pthread_join(blaster_thread, NULL);
+
+    yev_stop_event(yev_server_rx);
+    yev_stop_event(yev_timer);
+
+    yev_loop_run_once(yev_loop);
+
+    yev_destroy_event(yev_server_rx);
+    yev_destroy_event(yev_timer);
+    if(echo) {
+        for(int i=0; i<MAX_ECHOES; i++) {
+            yev_destroy_event(yev_echoes[i]);
+        }
+    }
+    yev_close_fd(yev_loop, fd_server);
+
+    yev_loop_stop(yev_loop);
+    yev_loop_destroy(yev_loop);
+
+    return 0;
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PRIVATE void print_stats(void)
+{
+    char nice[64];
+    uint64_t sent = __atomic_exchange_n(&blaster_sent, 0, __ATOMIC_RELAXED);
+
+    printf("\n" Erase_Whole_Line Move_Horizontal, 1);
+    nice_size(nice, sizeof(nice), dgrams_per_second);
+    printf("Dgrams/sec : %s", nice);
+    nice_size(nice, sizeof(nice), sent);
+    printf(" (blaster %s, lost %.1f%%)\n", nice,
+        sent? 100.0 * (double)(sent > dgrams_per_second? sent - dgrams_per_second : 0)/(double)sent : 0
+    );
+    printf(Erase_Whole_Line Move_Horizontal, 1);
+    nice_size(nice, sizeof(nice), bytes_per_second);
+    printf("Bytes/sec  : %s\n", nice);
+    printf(Erase_Whole_Line Move_Horizontal, 1);
+    nice_size(nice, sizeof(nice), echoes_per_second);
+    printf("Echoes/sec : %s (dropped %llu)\n", nice, (unsigned long long)echoes_dropped);
+
+    json_t *jn_stats = yev_loop_stats(yev_loop, TRUE);
+    printf(Erase_Whole_Line Move_Horizontal, 1);
+    printf("Syscalls/iteration: %.2f, CQEs/batch: %.2f (max %d), enobufs %d, truncated %d\n",
+        json_real_value(json_object_get(jn_stats, "syscalls_per_iteration")),
+        json_real_value(json_object_get(jn_stats, "cqes_per_batch")),
+        (int)json_integer_value(json_object_get(jn_stats, "max_cqe_batch")),
+        (int)json_integer_value(json_object_get(jn_stats, "recv_enobufs")),
+        (int)json_integer_value(json_object_get(jn_stats, "dgrams_truncated"))
+    );
+    json_decref(jn_stats);
+    printf(Cursor_Up, 5);
+    printf(Move_Horizontal, 1);
+    fflush(stdout);
+
+    dgrams_per_second = 0;
+    bytes_per_second = 0;
+    echoes_per_second = 0;
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PRIVATE int yev_server_callback(yev_event_t *yev_event)
+{
+    hgobj gobj = yev_event->gobj;
+
+    if(dump) {
+        json_t *jn_flags = bits2jn_strlist(yev_flag_strings(), yev_event->flag);
+        gobj_log_info(gobj, 0,
+            "function",     "%s", __FUNCTION__,
+            "msgset",       "%s", MSGSET_YEV_LOOP,
+            "msg",          "%s", "yev callback",
+            "msg2",         "%s", "💥 yev server callback",
+            "event type",   "%s", yev_event_type_name(yev_event),
+            "result",       "%d", yev_event->result,
+            "sres",         "%s", (yev_event->result<0)? strerror(-yev_event->result):"",
+            "flag",         "%j", jn_flags,
+            "p",            "%p", yev_event,
+            NULL
+        );
+        json_decref(jn_flags);
+    }
+
+    if(!yev_loop->running) {
+        return 0;
+    }
+
+    switch(yev_event->type) {
+        case YEV_RECVMSG_TYPE:
+        case YEV_RECVMSG_MULTISHOT_TYPE:
+            {
+                if(yev_event->result < 0) {
+                    yev_loop_stop(yev_loop);
+                    break;
+                }
+
+                dgrams_per_second++;
+                bytes_per_second += gbuffer_leftbytes(yev_event->gbuf);
+
+                if(dump) {
+                    gobj_trace_dump_gbuf(gobj, yev_event->gbuf, "Server receiving");
+                }
+
+                /*
+                 *  Echo to the source, all the echoes of the loop iteration go in one submit
+                 */
+                if(echo) {
+                    if(n_free_echoes > 0) {
+                        yev_event_t *yev_echo = yev_free_echoes[--n_free_echoes];
+                        socklen_t addrlen;
+                        struct sockaddr *peer = yev_get_peer(yev_event, &addrlen);
+                        gbuffer_t *gbuf = gbuffer_create(
+                            gbuffer_leftbytes(yev_event->gbuf),
+                            gbuffer_leftbytes(yev_event->gbuf)
+                        );
+                        gbuffer_append_gbuf(gbuf, yev_event->gbuf);
+                        yev_set_gbuffer(yev_echo, gbuf);
+                        yev_set_peer(yev_echo, peer, addrlen);
+                        yev_start_event(yev_echo);
+                    } else {
+                        echoes_dropped++;
+                    }
+                }
+
+                /*
+                 *  Re-arm recvmsg, the multishot keeps armed
+                 */
+                if(yev_event->type == YEV_RECVMSG_TYPE) {
+                    gbuffer_clear(yev_event->gbuf);
+                    yev_start_event(yev_event);
+                }
+            }
+            break;
+
+        case YEV_SENDMSG_TYPE:
+            {
+                if(yev_event->result >= 0) {
+                    echoes_per_second++;
+                }
+                GBUFFER_DECREF(yev_event->gbuf)
+                yev_free_echoes[n_free_echoes++] = yev_event;
+            }
+            break;
+
+        case YEV_TIMER_TYPE:
+            {
+                if(yev_event->result > 0) {    // expirations, < 0 cancelled
+                    print_stats();
+                }
+            }
+            break;
+
+        default:
+            gobj_log_error(gobj, LOG_OPT_TRACE_STACK,
+                "function",     "%s", __FUNCTION__,
+                "msgset",       "%s", MSGSET_SYSTEM_ERROR,
+                "msg",          "%s", "event type NOT IMPLEMENTED",
+                "event_type",   "%s", yev_event_type_name(yev_event),
+                NULL
+            );
+            break;
+    }
+
+    return 0;
+}
+
+/***************************************************************************
+ *  Test mode from command line:
+ *      recvmsg | recvmsg_multishot | echo | echo_multishot
+ ***************************************************************************/
+PRIVATE int set_test_mode(const char *mode)
+{
+    SWITCHS(mode) {
+        CASES("recvmsg")
+            break;
+        CASES("recvmsg_multishot")
+            recv_multishot = TRUE;
+            break;
+        CASES("echo")
+            echo = TRUE;
+            break;
+        CASES("echo_multishot")
+            echo = TRUE;
+            recv_multishot = TRUE;
+            break;
+        DEFAULTS
+            printf("Mode unknown: %s\n", mode);
+            printf("Use: recvmsg | recvmsg_multishot | echo | echo_multishot\n");
+            return -1;
+    } SWITCHS_END;
+
+    return 0;
+}
+
+/***************************************************************************
+ *              Main
+ ***************************************************************************/
+int main(int argc, char *argv[])
+{
+    if(argc > 1) {
+        if(set_test_mode(argv[1])<0) {
+            exit(-1);
+        }
+    }
+
+    /*----------------------------------*
+     *      Startup gobj system
+     *----------------------------------*/
+    sys_malloc_fn_t malloc_func;
+    sys_realloc_fn_t realloc_func;
+    sys_calloc_fn_t calloc_func;
+    sys_free_fn_t free_func;
+
+    gobj_get_allocators(
+        &malloc_func,
+        &realloc_func,
+        &calloc_func,
+        &free_func
+    );
+
+    json_set_alloc_funcs(
+        malloc_func,
+        free_func
+    );
+
+#ifdef DEBUG
+    init_backtrace_with_bfd(argv[0]);
+    set_show_backtrace_fn(show_backtrace_with_bfd);
+#endif
+
+    gobj_start_up(
+        argc,
+        argv,
+        NULL, // jn_global_settings
+        NULL, // startup_persistent_attrs
+        NULL, // end_persistent_attrs
+        0,  // load_persistent_attrs
+        0,  // save_persistent_attrs
+        0,  // remove_persistent_attrs
+        0,  // list_persistent_attrs
+        NULL, // global_command_parser
+        NULL, // global_stats_parser
+        NULL, // global_authz_checker
+        NULL, // global_authenticate_parser
+        60*1024L,  // max_block, largest memory block
+        8*1024*1024L   // max_system_memory, maximum system memory: the echoes in flight
+    );
+
+    yuno_catch_signals();
+
+    /*--------------------------------*
+     *      Log handlers
+     *--------------------------------*/
+    gobj_log_add_handler("stdout", "stdout", LOG_OPT_ALL, 0);
+
+    /*--------------------------------*
+     *      Test
+     *--------------------------------*/
+    do_test();
+
+    printf(Cursor_Down "\n", 6);
+
+    gobj_end();
+
+    return gobj_get_exit_code();
+}
+
+/***************************************************************************
+ *      Signal handlers
+ ***************************************************************************/
+PRIVATE void quit_sighandler(int sig)
+{
+    static int times = 0;
+    times++;
+    yev_loop->running = 0;
+    if(times > 1) {
+        exit(-1);
+    }
+}
+
+PUBLIC void yuno_catch_signals(void)
+{
+    struct sigaction sigIntHandler;
+
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGTERM, SIG_IGN);
+
+    memset(&sigIntHandler, 0, sizeof(sigIntHandler));
+    sigIntHandler.sa_handler = quit_sighandler;
+    sigemptyset(&sigIntHandler.sa_mask);
+    sigIntHandler.sa_flags = SA_NODEFER|SA_RESTART;
+    sigaction(SIGALRM, &sigIntHandler, NULL);   // to debug in kdevelop
+    sigaction(SIGQUIT, &sigIntHandler, NULL);
+    sigaction(SIGINT, &sigIntHandler, NULL);    // ctrl+c
+
+    alarm(time2exit);
+}
@@ -0,0 +1,38 @@
+#!/bin/bash
+#
+#   Run the yev performance tests under every io_uring setup mode.
+#
+#   Use: yev_modes_matrix.sh [bin directory]
+#       Default bin directory: /yuneta/development/outputs/bin (make install)
+#
+#   WARNING sqpoll pinned to a cpu is only set by yuno attribute `io_uring_sqpoll_cpu`,
+#   here the SQPOLL kernel thread is not pinned.
+#
+
+BIN_DIR=${1:-/yuneta/development/outputs/bin}
+MODES="default no_batch coop_taskrun single_issuer defer_taskrun sqpoll"
+
+for mode in $MODES recv_multishot no_fixed_files send_zc
+do
+    echo "==================== test_yev_ping_pong: $mode ===================="
+    "$BIN_DIR"/test_yev_ping_pong "$mode" 2>&1 \
+        | sed 's/\x1b\[[0-9;]*[A-Za-z]//g' \
+        | grep -a -E "YEV_LOOP_|batch|Msg/sec|Bytes/sec|Syscalls" \
+        | tail -4
+done
+
+for mode in $MODES
+do
+    echo "==================== test_yev_timer: $mode ===================="
+    "$BIN_DIR"/test_yev_timer "$mode" 2>&1 \
+        | grep -a -E "YEV_LOOP_|batch|got timer|Quiting"
+done
+
+for mode in recvmsg recvmsg_multishot echo echo_multishot
+do
+    echo "==================== test_yev_udp: $mode ===================="
+    "$BIN_DIR"/test_yev_udp "$mode" 2>&1 \
+        | sed 's/\x1b\[[0-9;]*[A-Za-z]//g' \
+        | grep -a -E "Dgrams/sec|Echoes/sec|Syscalls" \
+        | tail -3
+done
@@ -0,0 +1,184 @@
+#include <criterion/criterion.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <gobj.h>
+#include <kwid.h>
+#include <yunetas_ev_loop.h>
+
+/*
+ *  Accept direct: the sockets accepted in the registered files table by the kernel,
+ *  with the fd installed after, and the switch to plain accept near the end of the table.
+ */
+#define URL_PORT    24475
+#define NCLIENTS    4
+
+static int accepted[2*NCLIENTS];
+static int n_accepted;
+static int read_bytes;
+
+static int accept_callback(yev_event_t *yev_event)
+{
+    if(yev_event->result >= 0 && n_accepted < 2*NCLIENTS) {
+        accepted[n_accepted++] = yev_event->result;
+    }
+    return 0;
+}
+
+static int read_callback(yev_event_t *yev_event)
+{
+    if(yev_event->result > 0) {
+        read_bytes += yev_event->result;
+    }
+    return 0;
+}
+
+static int connect_client(void)
+{
+    struct sockaddr_in addr = {0};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(URL_PORT);
+    inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    cr_assert(fd >= 0);
+    cr_assert_eq(connect(fd, (struct sockaddr *)&addr, sizeof(addr)), 0);
+    return fd;
+}
+
+static json_int_t loop_stat(yev_loop_t *yev_loop, const char *key)
+{
+    json_t *jn_stats = yev_loop_stats(yev_loop, FALSE);
+    json_int_t value = json_integer_value(json_object_get(jn_stats, key));
+    json_decref(jn_stats);
+    return value;
+}
+
+/***************************************************************************
+ *  Accept NCLIENTS connections in a table of `fixed_files` slots,
+ *  read a byte of each one by its fixed slot
+ ***************************************************************************/
+static void run_accept(unsigned fixed_files, int expected_direct, int expected_in_use)
+{
+    char argv0[] = "test_accept_direct";
+    char *argv[] = {argv0, NULL};
+    char url[64];
+    yev_loop_t *yev_loop;
+    int clients[NCLIENTS];
+
+    n_accepted = 0;
+    read_bytes = 0;
+
+    sys_malloc_fn_t malloc_fn; sys_realloc_fn_t realloc_fn; sys_calloc_fn_t calloc_fn; sys_free_fn_t free_fn;
+    gobj_get_allocators(&malloc_fn, &realloc_fn, &calloc_fn, &free_fn);
+    json_set_alloc_funcs(malloc_fn, free_fn);
+    gobj_start_up(1, argv, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+
+    yev_loop_options_t options = {
+        .fixed_files = fixed_files,
+        .cpu = -1
+    };
+    cr_assert_eq(yev_loop_create2(0, &options, &yev_loop), 0);
+    if(!(yev_loop->caps & YEV_CAP_ACCEPT_DIRECT)) {
+        expected_direct = 0;
+        expected_in_use = (int)fixed_files < NCLIENTS? (int)fixed_files : NCLIENTS;
+    }
+
+    yev_event_t *yev_accept = yev_create_accept_event(yev_loop, accept_callback, 0);
+    snprintf(url, sizeof(url), "tcp://127.0.0.1:%d", URL_PORT);
+    cr_assert(yev_setup_accept_event(yev_accept, url, 0, FALSE) >= 0);
+    yev_start_event(yev_accept);
+    yev_loop->running = TRUE;   // rearm of the accept
+
+    uint64_t t0;
+    for(int i=0; i<NCLIENTS; i++) {
+        clients[i] = connect_client();
+        t0 = time_in_miliseconds();
+        while(n_accepted <= i && time_in_miliseconds() - t0 < 2000) {
+            yev_loop_run_once(yev_loop);
+        }
+    }
+
+    cr_assert_eq(n_accepted, NCLIENTS, "accepted %d", n_accepted);
+    cr_assert_eq(yev_loop->stats.accepts_direct, (uint64_t)expected_direct,
+        "accepts direct %d", (int)yev_loop->stats.accepts_direct
+    );
+    cr_assert_eq(loop_stat(yev_loop, "fixed_files_in_use"), expected_in_use);
+
+    /*
+     *  The i/o of the sockets accepted goes by their fixed slots
+     */
+    for(int i=0; i<NCLIENTS; i++) {
+        cr_assert_eq(write(clients[i], "x", 1), 1);
+    }
+    yev_event_t *reads[NCLIENTS];
+    for(int i=0; i<n_accepted; i++) {
+        reads[i] = yev_create_read_event(yev_loop, read_callback, 0, accepted[i], gbuffer_create(16, 16));
+        yev_start_event(reads[i]);
+    }
+    t0 = time_in_miliseconds();
+    while(read_bytes < n_accepted && time_in_miliseconds() - t0 < 2000) {
+        yev_loop_run_once(yev_loop);
+    }
+    cr_assert_eq(read_bytes, n_accepted);
+
+    for(int i=0; i<n_accepted; i++) {
+        yev_destroy_event(reads[i]);
+        yev_close_fd(yev_loop, accepted[i]);
+    }
+    for(int i=0; i<NCLIENTS; i++) {
+        close(clients[i]);
+    }
+
+    /*
+     *  With the slots free again the accepts go back to direct
+     */
+    uint64_t accepts_direct = yev_loop->stats.accepts_direct;
+    for(int i=0; i<NCLIENTS; i++) {
+        clients[i] = connect_client();
+        t0 = time_in_miliseconds();
+        while(n_accepted <= NCLIENTS + i && time_in_miliseconds() - t0 < 2000) {
+            yev_loop_run_once(yev_loop);
+        }
+    }
+    cr_assert_eq(n_accepted, 2*NCLIENTS, "accepted %d", n_accepted);
+    if(expected_direct) {
+        cr_assert(yev_loop->stats.accepts_direct > accepts_direct);
+    }
+    for(int i=NCLIENTS; i<n_accepted; i++) {
+        yev_close_fd(yev_loop, accepted[i]);
+    }
+
+    yev_loop->running = FALSE;
+    yev_stop_event(yev_accept);
+    for(int i=0; i<10; i++) {
+        yev_loop_run_once(yev_loop);
+    }
+    cr_assert_eq(loop_stat(yev_loop, "fixed_files_in_use"), 0);
+
+    yev_destroy_event(yev_accept);
+    for(int i=0; i<NCLIENTS; i++) {
+        close(clients[i]);
+    }
+    yev_loop_destroy(yev_loop);
+    gobj_end();
+}
+
+Test(accept_direct, accepted_in_fixed_slots)
+{
+    run_accept(64, NCLIENTS, NCLIENTS);
+}
+
+Test(accept_direct, table_full)
+{
+    /*
+     *  Two slots for the kernel, the low mark is one free slot:
+     *  the first socket is accepted direct, the rest plain, two registered in the lower half
+     *  and the last one with plain fd. No socket is lost.
+     */
+    run_accept(4, 1, 3);
+}
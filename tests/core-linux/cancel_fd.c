@@ -0,0 +1,111 @@
+#include <criterion/criterion.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <gobj.h>
+#include <yunetas_ev_loop.h>
+
+/*
+ *  Cancel and close of a socket with a read in the kernel:
+ *  the read returns cancelled and the peer sees the socket closed.
+ */
+static int read_result;
+static int read_callbacks;
+
+static int yev_callback(yev_event_t *yev_event)
+{
+    read_result = yev_event->result;
+    read_callbacks++;
+    return 0;
+}
+
+/***************************************************************************
+ *  Close the socket with a read in the kernel, the sqes queued as in a callback
+ *  of the running loop (batched mode), or the close alone (it cancels too)
+ ***************************************************************************/
+static void run_cancel_close(BOOL no_fixed_files, BOOL cancel_before, BOOL plain_close)
+{
+    char argv0[] = "test_cancel_fd";
+    char *argv[] = {argv0, NULL};
+    yev_loop_t *yev_loop;
+    int sv[2];
+
+    read_result = 0;
+    read_callbacks = 0;
+
+    sys_malloc_fn_t malloc_fn; sys_realloc_fn_t realloc_fn; sys_calloc_fn_t calloc_fn; sys_free_fn_t free_fn;
+    gobj_get_allocators(&malloc_fn, &realloc_fn, &calloc_fn, &free_fn);
+    json_set_alloc_funcs(malloc_fn, free_fn);
+    gobj_start_up(1, argv, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+
+    yev_loop_options_t options = {
+        .no_fixed_files = no_fixed_files,
+        .cpu = -1
+    };
+    cr_assert_eq(yev_loop_create2(0, &options, &yev_loop), 0);
+    cr_assert_eq(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+    if(!no_fixed_files) {
+        cr_assert(yev_register_fd(yev_loop, sv[0]) >= 0);
+    }
+
+    yev_event_t *yev_event = yev_create_read_event(
+        yev_loop, yev_callback, 0, sv[0], gbuffer_create(1024, 1024)
+    );
+    cr_assert_not_null(yev_event);
+    yev_start_event(yev_event);
+    yev_loop_run_once(yev_loop);
+    cr_assert(yev_event_in_ring(yev_event));
+
+    if(plain_close) {
+        /*
+         *  The cancel by fd fails (-EBADF), the loop cancels the read by its user_data
+         */
+        close(sv[0]);
+    }
+    yev_loop->running = TRUE;
+    if(cancel_before) {
+        cr_assert_eq(yev_cancel_fd(yev_loop, sv[0], NULL, 0), 1);
+    }
+    if(!plain_close) {
+        yev_close_fd(yev_loop, sv[0]);
+    }
+    yev_loop->running = FALSE;
+
+    for(int i=0; i<20; i++) {
+        yev_loop_run_once(yev_loop);
+    }
+
+    char c;
+    cr_assert_eq(read_callbacks, 1);
+    cr_assert_eq(read_result, -ECANCELED, "read result %d", read_result);
+    cr_assert(!yev_event_in_ring(yev_event));
+    cr_assert_eq(yev_loop->stats.bulk_cancels_failed, plain_close? 1:0);
+    cr_assert_eq(recv(sv[1], &c, 1, MSG_DONTWAIT), 0, "peer not closed, errno %d", errno);
+
+    yev_destroy_event(yev_event);
+    close(sv[1]);
+    yev_loop_destroy(yev_loop);
+    gobj_end();
+}
+
+Test(cancel_fd, cancel_and_close_without_fixed_files)
+{
+    run_cancel_close(TRUE, TRUE, FALSE);
+}
+
+Test(cancel_fd, cancel_and_close_with_fixed_files)
+{
+    run_cancel_close(FALSE, TRUE, FALSE);
+}
+
+Test(cancel_fd, close_without_cancel)
+{
+    run_cancel_close(TRUE, FALSE, FALSE);
+}
+
+Test(cancel_fd, cancel_of_fd_closed)
+{
+    run_cancel_close(TRUE, TRUE, TRUE);
+}
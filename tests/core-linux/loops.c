@@ -0,0 +1,221 @@
+#include <criterion/criterion.h>
+#include <stdlib.h>
+#include <string.h>
+#include <gobj.h>
+#include <kwid.h>
+#include <yunetas_ev_loop.h>
+#include <c_timer.h>
+#include <c_linux_yuno.h>
+
+/*
+ *  A yuno with two loops: a gobj created in the thread of the loop 1,
+ *  the events between it and a gobj of the yuno's loop are posted to the thread of the receiver.
+ */
+#define NPINGS      1000
+
+GOBJ_DEFINE_GCLASS(C_TEST_LOOPS);
+GOBJ_DEFINE_EVENT(EV_TEST_READY);
+GOBJ_DEFINE_EVENT(EV_TEST_PING);
+GOBJ_DEFINE_EVENT(EV_TEST_PONG);
+
+typedef struct _PRIVATE_DATA {
+    int x;
+} PRIVATE_DATA;
+
+static const sdata_desc_t tattr_desc[] = {
+    SDATA_END()
+};
+
+static hgobj yuno;
+static hgobj app;
+static hgobj worker;
+static int ready;
+static int pongs;
+static int pings_out_of_loop;
+static int pongs_out_of_loop;
+static json_int_t sum;
+static int worker_destroyed_in_loop;
+
+/***************************************************************************
+ *  Actions
+ ***************************************************************************/
+static int ac_ready(hgobj gobj, gobj_event_t event, json_t *kw, hgobj src)
+{
+    ready++;
+    KW_DECREF(kw);
+    return 0;
+}
+
+static int ac_ping(hgobj gobj, gobj_event_t event, json_t *kw, hgobj src)
+{
+    if(gobj_thread_loop() != yuno_loop(1) || gobj_loop(gobj) != yuno_loop(1)) {
+        pings_out_of_loop++;
+    }
+    gobj_send_event(src, EV_TEST_PONG, json_pack("{s:I}", "i", kw_get_int(gobj, kw, "i", 0, 0)), gobj);
+    KW_DECREF(kw);
+    return 0;
+}
+
+static int ac_pong(hgobj gobj, gobj_event_t event, json_t *kw, hgobj src)
+{
+    if(gobj_thread_loop() != NULL || src != worker) {
+        pongs_out_of_loop++;
+    }
+    sum += kw_get_int(gobj, kw, "i", 0, 0);
+    pongs++;
+    KW_DECREF(kw);
+    return 0;
+}
+
+static void mt_destroy(hgobj gobj)
+{
+    if(gobj == worker && gobj_thread_loop() == yuno_loop(1)) {
+        worker_destroyed_in_loop++;
+    }
+}
+
+static const GMETHODS gmt = {
+    .mt_destroy = mt_destroy,
+};
+
+static int register_c_test_loops(void)
+{
+    ev_action_t st_idle[] = {
+        {EV_TEST_READY,     ac_ready,       0},
+        {EV_TEST_PING,      ac_ping,        0},
+        {EV_TEST_PONG,      ac_pong,        0},
+        {0,0,0}
+    };
+    states_t states[] = {
+        {ST_IDLE,           st_idle},
+        {0, 0}
+    };
+    event_type_t event_types[] = {
+        {EV_TEST_READY,     0},
+        {EV_TEST_PING,      0},
+        {EV_TEST_PONG,      0},
+        {0, 0}
+    };
+    return gclass_create(
+        C_TEST_LOOPS, event_types, states, &gmt, 0, tattr_desc, sizeof(PRIVATE_DATA), 0, 0, 0, 0
+    )? 0 : -1;
+}
+
+/***************************************************************************
+ *  In the thread of the loop 1
+ ***************************************************************************/
+static void create_worker(void *user_data)
+{
+    worker = gobj_create_pure_child("worker", C_TEST_LOOPS, 0, yuno);
+    gobj_start(worker);
+    gobj_send_event(app, EV_TEST_READY, 0, worker);
+}
+
+static void run_until(int *counter, int value, uint64_t timeout_ms)
+{
+    uint64_t t0 = time_in_miliseconds();
+    while(*counter < value && time_in_miliseconds() - t0 < timeout_ms) {
+        yev_loop_run_once(yuno_event_loop());
+    }
+}
+
+static void setup(int loops)
+{
+    char argv0[] = "test_loops";
+    char *argv[] = {argv0, NULL};
+
+    worker = NULL;
+    ready = pongs = pings_out_of_loop = pongs_out_of_loop = worker_destroyed_in_loop = 0;
+    sum = 0;
+
+    sys_malloc_fn_t malloc_fn; sys_realloc_fn_t realloc_fn; sys_calloc_fn_t calloc_fn; sys_free_fn_t free_fn;
+    gobj_get_allocators(&malloc_fn, &realloc_fn, &calloc_fn, &free_fn);
+    json_set_alloc_funcs(malloc_fn, free_fn);
+    gobj_start_up(1, argv, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+    register_c_linux_yuno();
+    register_c_timer();
+    register_c_test_loops();
+
+    yuno = gobj_create_yuno("yuno", C_YUNO, json_pack("{s:i}", "loops", loops));
+    gobj_start(yuno);   // stopped, it stops the loops
+    app = gobj_create_service("app", C_TEST_LOOPS, 0, yuno);
+    gobj_start(app);
+}
+
+static void teardown(BOOL run_loop)
+{
+    gobj_stop(yuno);    // the loop 1 destroys its gobjs
+    for(int i=0; run_loop && i<5; i++) {
+        yev_loop_run_once(yuno_event_loop());
+    }
+    gobj_destroy(yuno);
+    gobj_end();
+}
+
+/***************************************************************************
+ *  The actions run in the thread of the loop of the gobj
+ ***************************************************************************/
+Test(loops, events_between_loops)
+{
+    setup(2);
+    cr_assert_eq(yuno_loops(), 2);
+    cr_assert_not_null(yuno_loop(1));
+
+    cr_assert_eq(yuno_loop_call(1, create_worker, NULL), 0);
+    run_until(&ready, 1, 2000);
+    cr_assert_eq(ready, 1);
+    cr_assert_eq(gobj_loop(worker), yuno_loop(1));
+    cr_assert_null(gobj_loop(app));
+
+    json_int_t exp_sum = 0;
+    for(int i=0; i<NPINGS; i++) {
+        cr_assert_eq(gobj_send_event(worker, EV_TEST_PING, json_pack("{s:i}", "i", i), app), 0);
+        exp_sum += i;
+    }
+    run_until(&pongs, NPINGS, 4000);
+
+    cr_assert_eq(pongs, NPINGS);
+    cr_assert_eq(sum, exp_sum);
+    cr_assert_eq(pings_out_of_loop, 0);
+    cr_assert_eq(pongs_out_of_loop, 0);
+
+    teardown(TRUE);
+    cr_assert_eq(worker_destroyed_in_loop, 1);
+}
+
+/***************************************************************************
+ *  The events posted to a gobj destroyed are dropped
+ ***************************************************************************/
+Test(loops, posted_to_gobj_destroyed)
+{
+    setup(2);
+    cr_assert_eq(yuno_loop_call(1, create_worker, NULL), 0);
+    run_until(&ready, 1, 2000);
+    cr_assert_eq(ready, 1);
+
+    /*
+     *  The loop 1 answers the pings before stopping,
+     *  the pongs are in the mailbox of app when it's destroyed, without running its loop
+     */
+    for(int i=0; i<NPINGS; i++) {
+        gobj_send_event(worker, EV_TEST_PING, json_pack("{s:i}", "i", i), app);
+    }
+    teardown(FALSE);
+    cr_assert_eq(worker_destroyed_in_loop, 1);
+    cr_assert_eq(pings_out_of_loop, 0);
+    cr_assert_eq(pongs, 0);
+    cr_assert_eq(get_cur_system_memory(), 0, "memory not freed %zu", get_cur_system_memory());
+}
+
+/***************************************************************************
+ *  With one loop all the gobjs are of the yuno's thread
+ ***************************************************************************/
+Test(loops, one_loop)
+{
+    setup(1);
+    cr_assert_eq(yuno_loops(), 1);
+    cr_assert_eq(yuno_loop(0), yuno_event_loop());
+    cr_assert_null(yuno_loop(1));
+    cr_assert_eq(yuno_loop_call(1, create_worker, NULL), -1);
+    teardown(TRUE);
+}
@@ -0,0 +1,279 @@
+#include <criterion/criterion.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/x509.h>
+#include <gobj.h>
+#include <kwid.h>
+#include <yunetas_ev_loop.h>
+#include <c_timer.h>
+#include <c_linux_yuno.h>
+#include <c_linux_transport.h>
+#include <c_linux_tcp_server.h>
+
+/*
+ *  Tls in loopback: a C_LINUX_TRANSPORT client and a C_LINUX_TCP_SERVER,
+ *  with a self-signed certificate made by the test.
+ */
+#define URL_PORT    "24473"
+#define NMSGS       300
+#define MSGLEN      3000
+
+GOBJ_DEFINE_GCLASS(C_TEST_TLS);
+
+typedef struct _PRIVATE_DATA {
+    int x;
+} PRIVATE_DATA;
+
+static const sdata_desc_t tattr_desc[] = {
+    SDATA_END()
+};
+
+static hgobj client;
+static int connected;
+static int done;
+static size_t srv_bytes;
+static size_t srv_sum;
+static size_t exp_sum;
+static char client_got[32];
+
+/***************************************************************************
+ *  Self-signed certificate of "localhost", in <name>-cert.pem and <name>-key.pem of dir
+ ***************************************************************************/
+static int make_certificate(const char *dir, const char *name)
+{
+    char path[256];
+    EVP_PKEY *pkey = EVP_EC_gen("P-256");
+    X509 *x509 = X509_new();
+    if(!pkey || !x509) {
+        return -1;
+    }
+    X509_set_version(x509, 2);
+    ASN1_INTEGER_set(X509_get_serialNumber(x509), 1);
+    X509_gmtime_adj(X509_getm_notBefore(x509), 0);
+    X509_gmtime_adj(X509_getm_notAfter(x509), 24*60*60);
+    X509_set_pubkey(x509, pkey);
+    X509_NAME *x509_name = X509_get_subject_name(x509);
+    X509_NAME_add_entry_by_txt(x509_name, "CN", MBSTRING_ASC, (const unsigned char *)"localhost", -1, -1, 0);
+    X509_set_issuer_name(x509, x509_name);
+    X509_sign(x509, pkey, EVP_sha256());
+
+    snprintf(path, sizeof(path), "%s/%s-cert.pem", dir, name);
+    FILE *fp = fopen(path, "w");
+    PEM_write_X509(fp, x509);
+    fclose(fp);
+    snprintf(path, sizeof(path), "%s/%s-key.pem", dir, name);
+    fp = fopen(path, "w");
+    PEM_write_PrivateKey(fp, pkey, NULL, NULL, 0, NULL, NULL);
+    fclose(fp);
+
+    X509_free(x509);
+    EVP_PKEY_free(pkey);
+    return 0;
+}
+
+static char *read_file(const char *dir, const char *name, char *bf, size_t bfsize)
+{
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    FILE *fp = fopen(path, "r");
+    size_t ln = fp? fread(bf, 1, bfsize-1, fp) : 0;
+    bf[ln] = 0;
+    if(fp) {
+        fclose(fp);
+    }
+    return bf;
+}
+
+/***************************************************************************
+ *  Actions
+ ***************************************************************************/
+static int ac_connected(hgobj gobj, gobj_event_t event, json_t *kw, hgobj src)
+{
+    if(src == client) {
+        connected++;
+        for(int i=0; i<NMSGS; i++) {
+            gbuffer_t *gbuf = gbuffer_create(MSGLEN, MSGLEN);
+            for(int j=0; j<MSGLEN; j++) {
+                char c = (char)((i*7+j) & 0x7f);
+                gbuffer_append_char(gbuf, c);
+                exp_sum += (unsigned char)c;
+            }
+            gobj_send_event(client, EV_TX_DATA, json_pack("{s:I}", "gbuffer", (json_int_t)(size_t)gbuf), gobj);
+        }
+    }
+    KW_DECREF(kw);
+    return 0;
+}
+
+static int ac_rx_data(hgobj gobj, gobj_event_t event, json_t *kw, hgobj src)
+{
+    gbuffer_t *gbuf = (gbuffer_t *)(size_t)kw_get_int(gobj, kw, "gbuffer", 0, 0);
+    size_t ln = gbuffer_leftbytes(gbuf);
+    unsigned char *p = gbuffer_cur_rd_pointer(gbuf);
+    if(src == client) {
+        snprintf(client_got, sizeof(client_got), "%.*s", (int)ln, (char *)p);
+        done = 1;
+    } else {
+        for(size_t i=0; i<ln; i++) {
+            srv_sum += p[i];
+        }
+        srv_bytes += ln;
+        if(srv_bytes == (size_t)NMSGS*MSGLEN) {
+            gbuffer_t *reply = gbuffer_create(10, 10);
+            gbuffer_append_string(reply, srv_sum == exp_sum? "SUM-OK" : "SUM-BAD");
+            gobj_send_event(src, EV_TX_DATA, json_pack("{s:I}", "gbuffer", (json_int_t)(size_t)reply), gobj);
+        }
+    }
+    KW_DECREF(kw);
+    return 0;
+}
+
+static int ac_disconnected(hgobj gobj, gobj_event_t event, json_t *kw, hgobj src)
+{
+    if(src == client) {
+        done = 1;
+    }
+    KW_DECREF(kw);
+    return 0;
+}
+
+static int ac_nop(hgobj gobj, gobj_event_t event, json_t *kw, hgobj src)
+{
+    KW_DECREF(kw);
+    return 0;
+}
+
+static const GMETHODS gmt = {0};
+
+static int register_c_test_tls(void)
+{
+    ev_action_t st_idle[] = {
+        {EV_CONNECTED,      ac_connected,       0},
+        {EV_RX_DATA,        ac_rx_data,         0},
+        {EV_DISCONNECTED,   ac_disconnected,    0},
+        {EV_TX_READY,       ac_nop,             0},
+        {EV_TX_FULL,        ac_nop,             0},
+        {EV_TX_RESUME,      ac_nop,             0},
+        {0,0,0}
+    };
+    states_t states[] = {
+        {ST_IDLE,           st_idle},
+        {0, 0}
+    };
+    event_type_t event_types[] = {
+        {EV_CONNECTED,      0},
+        {EV_RX_DATA,        0},
+        {EV_DISCONNECTED,   0},
+        {EV_TX_READY,       0},
+        {EV_TX_FULL,        0},
+        {EV_TX_RESUME,      0},
+        {0, 0}
+    };
+    return gclass_create(
+        C_TEST_TLS, event_types, states, &gmt, 0, tattr_desc, sizeof(PRIVATE_DATA), 0, 0, 0, 0
+    )? 0 : -1;
+}
+
+/***************************************************************************
+ *  Connect a client trusting the certificate `trusted`, run until done
+ ***************************************************************************/
+static void run_loopback(const char *trusted, uint64_t timeout_ms)
+{
+    char argv0[] = "test_tls";
+    char *argv[] = {argv0, NULL};
+    char tmp_dir[] = "/tmp/test_tls_XXXXXX";
+    char cert[256], key[256], pem[8000];
+
+    connected = done = 0;
+    srv_bytes = srv_sum = exp_sum = 0;
+    client_got[0] = 0;
+
+    cr_assert_not_null(mkdtemp(tmp_dir));
+    cr_assert_eq(make_certificate(tmp_dir, "server"), 0);
+    cr_assert_eq(make_certificate(tmp_dir, "other"), 0);
+    snprintf(cert, sizeof(cert), "%s/server-cert.pem", tmp_dir);
+    snprintf(key, sizeof(key), "%s/server-key.pem", tmp_dir);
+
+    sys_malloc_fn_t malloc_fn; sys_realloc_fn_t realloc_fn; sys_calloc_fn_t calloc_fn; sys_free_fn_t free_fn;
+    gobj_get_allocators(&malloc_fn, &realloc_fn, &calloc_fn, &free_fn);
+    json_set_alloc_funcs(malloc_fn, free_fn);
+    gobj_start_up(1, argv, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+    register_c_linux_yuno();
+    register_c_timer();
+    register_c_linux_transport();
+    register_c_linux_tcp_server();
+    register_c_test_tls();
+
+    hgobj yuno = gobj_create_yuno("yuno", C_YUNO, 0);
+    hgobj app = gobj_create_service("app", C_TEST_TLS, 0, yuno);
+
+    hgobj server = gobj_create_service("server", C_LINUX_TCP_SERVER,
+        json_pack("{s:s, s:{s:s, s:s}, s:I}",
+            "url", "tcps://127.0.0.1:" URL_PORT,
+            "crypto",
+                "ssl_certificate", cert,
+                "ssl_certificate_key", key,
+            "subscriber", (json_int_t)(size_t)app
+        ),
+        yuno
+    );
+    client = gobj_create_service("client", C_LINUX_TRANSPORT,
+        json_pack("{s:s, s:b, s:s, s:I}",
+            "url", "tcps://localhost:" URL_PORT,
+            "skip_cert_cn", 0,
+            "cert_pem", read_file(tmp_dir, trusted, pem, sizeof(pem)),
+            "subscriber", (json_int_t)(size_t)app
+        ),
+        yuno
+    );
+
+    gobj_start(server);
+    gobj_start(client);
+    gobj_send_event(client, EV_CONNECT, 0, app);
+
+    uint64_t t0 = time_in_miliseconds();
+    while(!done && time_in_miliseconds() - t0 < timeout_ms) {
+        yev_loop_run_once(yuno_event_loop());
+    }
+
+    gobj_stop(client);
+    gobj_stop(server);
+    for(int i=0; i<20; i++) {
+        yev_loop_run_once(yuno_event_loop());
+    }
+    gobj_destroy(client);
+    gobj_destroy(server);
+    for(int i=0; i<5; i++) {
+        yev_loop_run_once(yuno_event_loop());
+    }
+    gobj_destroy(yuno);
+    gobj_end();
+
+    snprintf(pem, sizeof(pem), "%s/server-cert.pem", tmp_dir); unlink(pem);
+    snprintf(pem, sizeof(pem), "%s/server-key.pem", tmp_dir); unlink(pem);
+    snprintf(pem, sizeof(pem), "%s/other-cert.pem", tmp_dir); unlink(pem);
+    snprintf(pem, sizeof(pem), "%s/other-key.pem", tmp_dir); unlink(pem);
+    rmdir(tmp_dir);
+}
+
+Test(tls, loopback)
+{
+    run_loopback("server-cert.pem", 8000);
+    cr_assert_eq(connected, 1);
+    cr_assert_eq(srv_bytes, (size_t)NMSGS*MSGLEN);
+    cr_assert_str_eq(client_got, "SUM-OK");
+}
+
+Test(tls, untrusted_server)
+{
+    /*
+     *  The handshake fails and the client retries, it never connects
+     */
+    run_loopback("other-cert.pem", 2000);
+    cr_assert_eq(connected, 0);
+    cr_assert_eq(srv_bytes, 0);
+    cr_assert_str_eq(client_got, "");
+}
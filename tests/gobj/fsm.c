@@ -0,0 +1,107 @@
+#include <criterion/criterion.h>
+#include <stdlib.h>
+#include <string.h>
+#include <gobj.h>
+#include <kwid.h>
+
+/*
+ *  The FSM compiled to tables, and the lists used when it cannot be compiled.
+ */
+GOBJ_DEFINE_GCLASS(C_TEST_FSM);
+GOBJ_DEFINE_EVENT(EV_TEST_A);
+GOBJ_DEFINE_EVENT(EV_TEST_B);
+
+typedef struct _PRIVATE_DATA {
+    int x;
+} PRIVATE_DATA;
+
+static const sdata_desc_t tattr_desc[] = {
+    SDATA_END()
+};
+
+/*
+ *  Allocator failing while `no_memory`, counting the allocations tried
+ */
+static sys_malloc_fn_t real_malloc;
+static BOOL no_memory;
+static int mallocs_failed;
+
+static void *test_malloc(size_t size)
+{
+    if(no_memory) {
+        mallocs_failed++;
+        return NULL;
+    }
+    return real_malloc(size);
+}
+
+static int ac_event(hgobj gobj, gobj_event_t event, json_t *kw, hgobj src)
+{
+    KW_DECREF(kw);
+    return 0;
+}
+
+static const GMETHODS gmt = {0};
+
+/***************************************************************************
+ *  The compile of the FSM fails once: the events are found in the lists,
+ *  without compiling (and logging) again in each lookup.
+ ***************************************************************************/
+Test(fsm, compile_failed)
+{
+    char argv0[] = "test_fsm";
+    char *argv[] = {argv0, NULL};
+
+    sys_realloc_fn_t realloc_fn; sys_calloc_fn_t calloc_fn; sys_free_fn_t free_fn;
+    gobj_get_allocators(&real_malloc, &realloc_fn, &calloc_fn, &free_fn);
+    json_set_alloc_funcs(real_malloc, free_fn);
+    gobj_set_allocators(test_malloc, realloc_fn, calloc_fn, free_fn);
+    gobj_start_up(1, argv, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+
+    ev_action_t st_idle[] = {
+        {EV_TEST_A,     ac_event,   0},
+        {0,0,0}
+    };
+    states_t states[] = {
+        {ST_IDLE,       st_idle},
+        {0, 0}
+    };
+    event_type_t event_types[] = {
+        {EV_TEST_A,     0},
+        {EV_TEST_B,     0},
+        {0, 0}
+    };
+    hgclass gclass = gclass_create(
+        C_TEST_FSM, event_types, states, &gmt, 0, tattr_desc, sizeof(PRIVATE_DATA), 0, 0, 0, 0
+    );
+    cr_assert_not_null(gclass);
+    hgobj gobj = gobj_create_yuno("fsm", C_TEST_FSM, 0);
+    cr_assert(gobj_has_input_event(gobj, EV_TEST_A));
+    cr_assert(!gobj_has_input_event(gobj, EV_TEST_B));
+
+    /*
+     *  The change of the FSM frees the tables, the next lookup compiles them
+     */
+    cr_assert_eq(gclass_add_ev_action(gclass, ST_IDLE, EV_TEST_B, ac_event, 0), 0);
+    no_memory = TRUE;
+    cr_assert(gobj_has_input_event(gobj, EV_TEST_B));
+    cr_assert(mallocs_failed > 0);
+
+    mallocs_failed = 0;
+    for(int i=0; i<10; i++) {
+        cr_assert(gobj_has_input_event(gobj, EV_TEST_A));
+        cr_assert(gobj_has_input_event(gobj, EV_TEST_B));
+    }
+    cr_assert_eq(mallocs_failed, 0, "compiled again %d times", mallocs_failed);
+    no_memory = FALSE;
+
+    /*
+     *  Other change of the FSM compiles it again
+     */
+    cr_assert_eq(gclass_add_state(gclass, ST_STOPPED), 0);
+    cr_assert(gobj_has_input_event(gobj, EV_TEST_B));
+
+    gobj_destroy(gobj);
+    gobj_end();
+    gobj_set_allocators(real_malloc, realloc_fn, calloc_fn, free_fn);
+}
@@ -0,0 +1,186 @@
+#include <criterion/criterion.h>
+#include <stdlib.h>
+#include <string.h>
+#include <gobj.h>
+#include <kwid.h>
+
+/*
+ *  The compiled filters (kw_matcher_t) against kw_match_simple(),
+ *  and the publish with subscriptions in the filter index or not.
+ */
+GOBJ_DEFINE_GCLASS(C_TEST_MATCHER);
+GOBJ_DEFINE_EVENT(EV_TEST_A);
+
+typedef struct _PRIVATE_DATA {
+    int x;
+} PRIVATE_DATA;
+
+static const sdata_desc_t tattr_desc[] = {
+    SDATA_END()
+};
+
+static const char *filters[] = {
+    "{}",
+    "{\"dev\": 1}",
+    "{\"dev\": \"1\"}",
+    "{\"dev\": \"abc\"}",
+    "{\"dev\": 1.0}",
+    "{\"dev\": 2.5}",
+    "{\"dev\": true}",
+    "{\"dev\": false}",
+    "{\"dev\": null}",
+    "{\"dev\": {\"x\": 1}}",
+    "{\"dev\": [1, 2]}",
+    "{\"a`b\": 1}",
+    "{\"a`b\": \"abc\"}",
+    "{\"dev\": 1, \"k\": \"abc\"}",
+    "[{\"dev\": 1}, {\"k\": \"abc\"}]",
+    "[{\"dev\": 1}]",
+    "[]",
+    NULL
+};
+
+static const char *kws[] = {
+    "{}",
+    "{\"dev\": 1}",
+    "{\"dev\": 0}",
+    "{\"dev\": \"1\"}",
+    "{\"dev\": \"01\"}",
+    "{\"dev\": \"abc\"}",
+    "{\"dev\": 1.0}",
+    "{\"dev\": 2.5}",
+    "{\"dev\": true}",
+    "{\"dev\": false}",
+    "{\"dev\": null}",
+    "{\"dev\": {\"x\": 1}}",
+    "{\"dev\": [1, 2]}",
+    "{\"a\": {\"b\": 1}}",
+    "{\"a\": {\"b\": \"abc\"}}",
+    "{\"a`b\": 1}",
+    "{\"dev\": 1, \"k\": \"abc\"}",
+    "{\"dev\": 2, \"k\": \"abc\"}",
+    "{\"k\": \"abc\"}",
+    NULL
+};
+
+static void setup(void)
+{
+    char argv0[] = "test_kw_matcher";
+    char *argv[] = {argv0, NULL};
+
+    sys_malloc_fn_t malloc_fn; sys_realloc_fn_t realloc_fn; sys_calloc_fn_t calloc_fn; sys_free_fn_t free_fn;
+    gobj_get_allocators(&malloc_fn, &realloc_fn, &calloc_fn, &free_fn);
+    json_set_alloc_funcs(malloc_fn, free_fn);
+    gobj_start_up(1, argv, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+}
+
+/***************************************************************************
+ *  kw_matcher_match() is kw_match_simple() with the filter compiled
+ ***************************************************************************/
+Test(kw_matcher, same_as_kw_match_simple)
+{
+    setup();
+    for(int f=0; filters[f]; f++) {
+        json_t *jn_filter = json_loads(filters[f], JSON_DECODE_ANY, 0);
+        cr_assert_not_null(jn_filter);
+        kw_matcher_t *matcher = kw_matcher_create(jn_filter);
+        cr_assert_not_null(matcher);
+
+        for(int k=0; kws[k]; k++) {
+            json_t *kw = json_loads(kws[k], 0, 0);
+            cr_assert_not_null(kw);
+            BOOL expected = kw_match_simple(kw, json_incref(jn_filter));
+            BOOL matched = kw_matcher_match(matcher, kw);
+            cr_assert_eq(matched, expected, "filter %s kw %s: matcher %d, kw_match_simple %d",
+                filters[f], kws[k], matched, expected
+            );
+            json_decref(kw);
+        }
+
+        kw_matcher_destroy(matcher);
+        json_decref(jn_filter);
+    }
+    gobj_end();
+}
+
+/***************************************************************************
+ *  Publish: the subscriptions of the filter index ({"dev": v}) get the same events
+ *  that the equivalent subscriptions out of the index ([{"dev": v}])
+ ***************************************************************************/
+static int deliveries[32];
+
+static int ac_event(hgobj gobj, gobj_event_t event, json_t *kw, hgobj src)
+{
+    deliveries[atoi(gobj_name(gobj))]++;
+    KW_DECREF(kw);
+    return 0;
+}
+
+static const GMETHODS gmt = {0};
+
+Test(kw_matcher, indexed_subscriptions)
+{
+    static const char *values[] = {"1", "2", "\"1\"", "\"abc\"", "\"xyz\"", "7", NULL};
+
+    setup();
+    ev_action_t st_idle[] = {
+        {EV_TEST_A,     ac_event,   0},
+        {0,0,0}
+    };
+    states_t states[] = {
+        {ST_IDLE,       st_idle},
+        {0, 0}
+    };
+    event_type_t event_types[] = {
+        {EV_TEST_A,     EVF_OUTPUT_EVENT|EVF_NO_WARN_SUBS},
+        {0, 0}
+    };
+    cr_assert_not_null(
+        gclass_create(C_TEST_MATCHER, event_types, states, &gmt, 0, tattr_desc, sizeof(PRIVATE_DATA), 0, 0, 0, 0)
+    );
+    hgobj pub = gobj_create_yuno("pub", C_TEST_MATCHER, 0);
+
+    /*
+     *  Subscriber 2*i in the index, 2*i+1 the same filter in a list, out of the index
+     */
+    int n_values = 0;
+    for(int i=0; values[i]; i++, n_values++) {
+        char name[16];
+        json_t *jn_value = json_loads(values[i], JSON_DECODE_ANY, 0);
+        json_t *jn_filter = json_pack("{s:O}", "dev", jn_value);
+
+        kw_matcher_t *matcher = kw_matcher_create(jn_filter);
+        cr_assert_not_null(kw_matcher_single_key(matcher, 0));
+        kw_matcher_destroy(matcher);
+        json_t *jn_list = json_pack("[O]", jn_filter);
+        matcher = kw_matcher_create(jn_list);
+        cr_assert_null(kw_matcher_single_key(matcher, 0));
+        kw_matcher_destroy(matcher);
+        json_decref(jn_list);
+
+        snprintf(name, sizeof(name), "%d", 2*i);
+        hgobj indexed = gobj_create_pure_child(name, C_TEST_MATCHER, 0, pub);
+        gobj_subscribe_event(pub, (i%2)? EV_TEST_A : NULL, json_pack("{s:O}", "__filter__", jn_filter), indexed);
+
+        snprintf(name, sizeof(name), "%d", 2*i+1);
+        hgobj not_indexed = gobj_create_pure_child(name, C_TEST_MATCHER, 0, pub);
+        gobj_subscribe_event(pub, (i%2)? EV_TEST_A : NULL, json_pack("{s:[O]}", "__filter__", jn_filter), not_indexed);
+
+        json_decref(jn_filter);
+        json_decref(jn_value);
+    }
+
+    for(int k=0; kws[k]; k++) {
+        memset(deliveries, 0, sizeof(deliveries));
+        json_t *kw = json_loads(kws[k], 0, 0);
+        gobj_publish_event(pub, EV_TEST_A, kw);
+        for(int i=0; i<n_values; i++) {
+            cr_assert_eq(deliveries[2*i], deliveries[2*i+1], "kw %s dev %s: indexed %d, not indexed %d",
+                kws[k], values[i], deliveries[2*i], deliveries[2*i+1]
+            );
+        }
+    }
+
+    gobj_destroy(pub);
+    gobj_end();
+}
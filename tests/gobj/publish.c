@@ -0,0 +1,190 @@
+#include <criterion/criterion.h>
+#include <stdlib.h>
+#include <string.h>
+#include <gobj.h>
+#include <kwid.h>
+
+/*
+ *  Publishing of events: order of delivery and changes of the subscriptions
+ *  (unsubscribe, destroy) done by the subscribers while the event is published.
+ */
+GOBJ_DEFINE_GCLASS(C_TEST_PUB);
+GOBJ_DEFINE_EVENT(EV_TEST_A);
+GOBJ_DEFINE_EVENT(EV_TEST_B);
+
+typedef struct _PRIVATE_DATA {
+    int x;
+} PRIVATE_DATA;
+
+static const sdata_desc_t tattr_desc[] = {
+    SDATA_END()
+};
+
+static hgobj pub;
+static hgobj s1, s2, s3, s4;
+static char deliveries[1024];   // "subscriber:event " of each delivery, in order
+
+/***************************************************************************
+ *  Record the delivery and do what the kw says
+ ***************************************************************************/
+static int ac_event(hgobj gobj, gobj_event_t event, json_t *kw, hgobj src)
+{
+    char delivery[80];
+    snprintf(delivery, sizeof(delivery), "%s:%s ", gobj_name(gobj), event);
+    strncat(deliveries, delivery, sizeof(deliveries) - strlen(deliveries) - 1);
+
+    if(gobj == s1) {
+        if(kw_get_bool(gobj, kw, "unsubscribe_s2", 0, 0)) {
+            gobj_unsubscribe_event(src, EV_TEST_A, 0, s2);
+        }
+        if(kw_get_bool(gobj, kw, "subscribe_s4", 0, 0)) {
+            gobj_subscribe_event(src, EV_TEST_A, 0, s4);
+        }
+        if(kw_get_bool(gobj, kw, "destroy_s2", 0, 0)) {
+            gobj_destroy(s2);
+        }
+        if(kw_get_bool(gobj, kw, "destroy_publisher", 0, 0)) {
+            gobj_destroy(src);
+        }
+    }
+    KW_DECREF(kw);
+    return 0;
+}
+
+static const GMETHODS gmt = {0};
+
+/***************************************************************************
+ *  The publisher and four subscribers, children of it
+ ***************************************************************************/
+static void setup(void)
+{
+    char argv0[] = "test_publish";
+    char *argv[] = {argv0, NULL};
+
+    sys_malloc_fn_t malloc_fn; sys_realloc_fn_t realloc_fn; sys_calloc_fn_t calloc_fn; sys_free_fn_t free_fn;
+    gobj_get_allocators(&malloc_fn, &realloc_fn, &calloc_fn, &free_fn);
+    json_set_alloc_funcs(malloc_fn, free_fn);
+    gobj_start_up(1, argv, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+
+    ev_action_t st_idle[] = {
+        {EV_TEST_A,     ac_event,   0},
+        {EV_TEST_B,     ac_event,   0},
+        {0,0,0}
+    };
+    states_t states[] = {
+        {ST_IDLE,       st_idle},
+        {0, 0}
+    };
+    event_type_t event_types[] = {
+        {EV_TEST_A,     EVF_OUTPUT_EVENT},
+        {EV_TEST_B,     EVF_OUTPUT_EVENT},
+        {0, 0}
+    };
+    cr_assert_not_null(
+        gclass_create(C_TEST_PUB, event_types, states, &gmt, 0, tattr_desc, sizeof(PRIVATE_DATA), 0, 0, 0, 0)
+    );
+
+    pub = gobj_create_yuno("pub", C_TEST_PUB, 0);
+    s1 = gobj_create_pure_child("s1", C_TEST_PUB, 0, pub);
+    s2 = gobj_create_pure_child("s2", C_TEST_PUB, 0, pub);
+    s3 = gobj_create_pure_child("s3", C_TEST_PUB, 0, pub);
+    s4 = gobj_create_pure_child("s4", C_TEST_PUB, 0, pub);
+    deliveries[0] = 0;
+}
+
+static void teardown(void)
+{
+    gobj_destroy(pub);
+    gobj_end();
+}
+
+static int publish(hgobj publisher, gobj_event_t event, json_t *kw)
+{
+    deliveries[0] = 0;
+    return gobj_publish_event(publisher, event, kw);
+}
+
+/***************************************************************************
+ *  The subscribers get the event in the order of subscription,
+ *  the event-specific and the all-events subscriptions mixed.
+ ***************************************************************************/
+Test(publish, order_of_subscription)
+{
+    setup();
+    gobj_subscribe_event(pub, EV_TEST_A, 0, s1);
+    gobj_subscribe_event(pub, 0, 0, s2);            // all events
+    gobj_subscribe_event(pub, EV_TEST_A, 0, s3);
+    gobj_subscribe_event(pub, EV_TEST_B, 0, s4);
+
+    cr_assert_eq(publish(pub, EV_TEST_A, 0), 3);
+    cr_assert_str_eq(deliveries, "s1:EV_TEST_A s2:EV_TEST_A s3:EV_TEST_A ");
+
+    cr_assert_eq(publish(pub, EV_TEST_B, 0), 2);
+    cr_assert_str_eq(deliveries, "s2:EV_TEST_B s4:EV_TEST_B ");
+    teardown();
+}
+
+/***************************************************************************
+ *  Unsubscribed while publishing: not delivered now.
+ *  Subscribed while publishing: delivered from the next publish.
+ ***************************************************************************/
+Test(publish, unsubscribe_while_publishing)
+{
+    setup();
+    gobj_subscribe_event(pub, EV_TEST_A, 0, s1);
+    gobj_subscribe_event(pub, EV_TEST_A, 0, s2);
+    gobj_subscribe_event(pub, EV_TEST_A, 0, s3);
+
+    publish(pub, EV_TEST_A, json_pack("{s:b, s:b}", "unsubscribe_s2", 1, "subscribe_s4", 1));
+    cr_assert_str_eq(deliveries, "s1:EV_TEST_A s3:EV_TEST_A ");
+
+    cr_assert_eq(publish(pub, EV_TEST_A, 0), 3);
+    cr_assert_str_eq(deliveries, "s1:EV_TEST_A s3:EV_TEST_A s4:EV_TEST_A ");
+    teardown();
+}
+
+/***************************************************************************
+ *  A subscriber destroyed while publishing is not delivered,
+ *  the rest of the subscribers are.
+ ***************************************************************************/
+Test(publish, subscriber_destroyed_while_publishing)
+{
+    setup();
+    gobj_subscribe_event(pub, EV_TEST_A, 0, s1);
+    gobj_subscribe_event(pub, EV_TEST_A, 0, s2);
+    gobj_subscribe_event(pub, 0, 0, s3);
+
+    publish(pub, EV_TEST_A, json_pack("{s:b}", "destroy_s2", 1));
+    cr_assert_str_eq(deliveries, "s1:EV_TEST_A s3:EV_TEST_A ");
+
+    cr_assert_eq(publish(pub, EV_TEST_A, 0), 2);
+    cr_assert_str_eq(deliveries, "s1:EV_TEST_A s3:EV_TEST_A ");
+    json_t *jn_subs = gobj_find_subscriptions(pub, 0, 0, 0);
+    cr_assert_eq(json_array_size(jn_subs), 2);
+    json_decref(jn_subs);
+    teardown();
+}
+
+/***************************************************************************
+ *  The publisher destroyed by a subscriber: the publish stops,
+ *  and its subscriptions are gone from the subscribers.
+ ***************************************************************************/
+Test(publish, publisher_destroyed_while_publishing)
+{
+    setup();
+    hgobj pub2 = gobj_create_pure_child("pub2", C_TEST_PUB, 0, pub);
+    gobj_subscribe_event(pub2, EV_TEST_A, 0, s1);
+    gobj_subscribe_event(pub2, EV_TEST_A, 0, s2);
+    gobj_subscribe_event(pub2, 0, 0, s3);
+
+    publish(pub2, EV_TEST_A, json_pack("{s:b}", "destroy_publisher", 1));
+    cr_assert_str_eq(deliveries, "s1:EV_TEST_A ");
+
+    json_t *jn_subs = gobj_find_subscribings(s2, 0, 0, 0);
+    cr_assert_eq(json_array_size(jn_subs), 0);
+    json_decref(jn_subs);
+    jn_subs = gobj_find_subscribings(s3, 0, 0, 0);
+    cr_assert_eq(json_array_size(jn_subs), 0);
+    json_decref(jn_subs);
+    teardown();
+}